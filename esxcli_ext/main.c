@@ -60,6 +60,7 @@ typedef enum sfvmk_objectType_e {
   SFVMK_OBJECT_FEC,
   SFVMK_OBJECT_SENSOR,
   SFVMK_OBJECT_VIB,
+  SFVMK_OBJECT_TRACE,
   SFVMK_OBJECT_MAX
 } sfvmk_objectType_t;
 
@@ -70,7 +71,8 @@ static const char * supportedObjects[] = {
   "firmware",
   "fec",
   "sensor",
-  "vib"
+  "vib",
+  "trace"
 };
 
 /*
@@ -84,6 +86,10 @@ static vmk_uint32 sfvmk_fecModeParse(const char *pFecModeName);
 static VMK_ReturnStatus sfvmk_fecModeSet(sfvmk_mgmtDevInfo_t *pMgmtParm, vmk_uint32 fec);
 static VMK_ReturnStatus sfvmk_fecModeGet(sfvmk_mgmtDevInfo_t *pMgmtParm);
 static VMK_ReturnStatus sfvmk_hwSensorGet(sfvmk_mgmtDevInfo_t *pMgmtParm, int opType);
+static VMK_ReturnStatus sfvmk_traceSet(sfvmk_mgmtDevInfo_t *pMgmtParm,
+                                       const char *pProbeName, vmk_Bool enable);
+static VMK_ReturnStatus sfvmk_traceGet(sfvmk_mgmtDevInfo_t *pMgmtParm,
+                                       const char *pFileName);
 static VMK_ReturnStatus sfvmk_verifyFWOption(vmk_Bool updateDefault, vmk_Bool fwFileSet,
                                              vmk_Bool nicNameSet, vmk_Bool overwrite);
 
@@ -133,6 +139,7 @@ main(int argc, char **argv)
   char fwTypeName[16];
   char fileName[128];
   char fecModeName[11];
+  char probeName[SFVMK_TRACE_PROBE_NAME_LEN];
   vmk_uint32 fecMode = SFVMK_MGMT_FEC_NONE_MASK;
   vmk_Bool optionEnable = VMK_FALSE;
   vmk_Bool nicNameSet = VMK_FALSE;
@@ -150,6 +157,7 @@ main(int argc, char **argv)
   printf("<string>");
 
   memset(&mgmtParm, 0, sizeof(mgmtParm));
+  memset(probeName, 0, sizeof(probeName));
 
   while (1) {
     int option_index = 0;
@@ -166,6 +174,7 @@ main(int argc, char **argv)
       {"mode",       required_argument, 0, 'm'},
       {"default",    no_argument,       0, 'd'},
       {"overwrite",  no_argument,       0, 'w'},
+      {"probe",      required_argument, 0, 'p'},
       {0, 0, 0, 0}
     };
 
@@ -303,6 +312,20 @@ main(int argc, char **argv)
         overwrite = VMK_TRUE;
         break;
 
+      case 'p':
+        if (!optarg) {
+          printf("ERROR: Probe name is not provided\n");
+          goto end;
+        }
+
+        if (strlen(optarg) >= SFVMK_TRACE_PROBE_NAME_LEN) {
+          printf("ERROR: Probe name is invalid\n");
+          goto end;
+        }
+
+        strcpy(probeName, optarg);
+        break;
+
       case '?':
       default:
         break;
@@ -325,7 +348,8 @@ main(int argc, char **argv)
   /* Confirm if NIC name is a Solarflare NIC or not */
   if (!nicNameSet) {
     if ((objType != SFVMK_OBJECT_FIRMWARE) &&
-        (objType != SFVMK_OBJECT_VIB)) {
+        (objType != SFVMK_OBJECT_VIB) &&
+        (objType != SFVMK_OBJECT_TRACE)) {
       printf("ERROR: Missing required parameter -n|--nic-name\n");
       goto destroy_handle;
     }
@@ -404,6 +428,28 @@ main(int argc, char **argv)
       printf("%s\n", SFVMK_VIB_PLUGIN_NAME);
       break;
 
+    case SFVMK_OBJECT_TRACE:
+      if (opType == SFVMK_MGMT_DEV_OPS_SET) {
+        if (!strcmp(mclogOption, "true"))
+          optionEnable = VMK_TRUE;
+        else if (!strcmp(mclogOption, "false"))
+          optionEnable = VMK_FALSE;
+        else {
+          printf("ERROR: Missing required parameter -e|--enable\n");
+          goto destroy_handle;
+        }
+
+        if (probeName[0] == '\0') {
+          printf("ERROR: Missing required parameter -p|--probe\n");
+          goto destroy_handle;
+        }
+
+        sfvmk_traceSet(&mgmtParm, probeName, optionEnable);
+      } else {
+        sfvmk_traceGet(&mgmtParm, fwFileSet ? fileName : NULL);
+      }
+      break;
+
     default:
       printf("ERROR: Unknown object - %s\n", objectName);
   }
@@ -767,6 +813,161 @@ end:
   return status;
 }
 
+static VMK_ReturnStatus
+sfvmk_traceSet(sfvmk_mgmtDevInfo_t *pMgmtParm, const char *pProbeName,
+               vmk_Bool enable)
+{
+  sfvmk_traceReq_t traceReq;
+  VMK_ReturnStatus status;
+
+  memset(&traceReq, 0, sizeof(traceReq));
+  traceReq.subCmd = enable ? SFVMK_MGMT_TRACE_ENABLE : SFVMK_MGMT_TRACE_DISABLE;
+  strcpy(traceReq.probeName, pProbeName);
+
+  status = vmk_MgmtUserCallbackInvoke(mgmtHandle, VMK_MGMT_NO_INSTANCE_ID,
+                                      SFVMK_CB_TRACE_REQUEST, pMgmtParm, &traceReq);
+  if (status != VMK_OK) {
+    status = VMK_NO_CONNECT;
+    printf("ERROR: Unable to connect to the backend, error 0x%x\n", status);
+    return status;
+  }
+
+  if (pMgmtParm->status != VMK_OK) {
+    printf("ERROR: Trace %s of %s failed, error 0x%x\n",
+           enable ? "enable" : "disable", pProbeName, pMgmtParm->status);
+    return pMgmtParm->status;
+  }
+
+  printf("Trace of %s %s\n", pProbeName, enable ? "enabled" : "disabled");
+
+  return VMK_OK;
+}
+
+static sfvmk_traceProbeName_t *
+sfvmk_traceProbeNameFind(sfvmk_traceProbeName_t *pNames, vmk_uint32 numNames,
+                         vmk_uint32 probeId)
+{
+  vmk_uint32 i;
+
+  for (i = 0; i < numNames; i++) {
+    if (pNames[i].probeId == probeId)
+      return &pNames[i];
+  }
+
+  return NULL;
+}
+
+static VMK_ReturnStatus
+sfvmk_traceGet(sfvmk_mgmtDevInfo_t *pMgmtParm, const char *pFileName)
+{
+#define SFVMK_TRACE_USER_RECORDS  4096
+#define SFVMK_TRACE_USER_PROBES   256
+  sfvmk_traceReq_t traceReq;
+  sfvmk_traceRecord_t *pRecords = NULL;
+  sfvmk_traceProbeName_t *pNames = NULL;
+  sfvmk_traceRecord_t *pRecord;
+  sfvmk_traceProbeName_t *pName;
+  vmk_uint32 numRecords;
+  vmk_uint32 numNames;
+  vmk_uint32 i, j;
+  FILE *pFile = stdout;
+  VMK_ReturnStatus status;
+
+  pRecords = malloc(SFVMK_TRACE_USER_RECORDS * sizeof(sfvmk_traceRecord_t));
+  pNames = malloc(SFVMK_TRACE_USER_PROBES * sizeof(sfvmk_traceProbeName_t));
+  if (!pRecords || !pNames) {
+    status = VMK_NO_MEMORY;
+    printf("ERROR: Unable to allocate memmory for trace buffer\n");
+    goto free_buffer;
+  }
+
+  memset(&traceReq, 0, sizeof(traceReq));
+  traceReq.subCmd = SFVMK_MGMT_TRACE_DRAIN;
+  traceReq.size = SFVMK_TRACE_USER_RECORDS * sizeof(sfvmk_traceRecord_t);
+#if (VMKAPI_REVISION <= VMK_REVISION_FROM_NUMBERS(2, 5, 0, 0))
+  traceReq.traceBuffer = (vmk_uint64)((vmk_uint32)pRecords);
+#else
+  traceReq.traceBuffer = (vmk_uint64)pRecords;
+#endif
+
+  status = vmk_MgmtUserCallbackInvoke(mgmtHandle, VMK_MGMT_NO_INSTANCE_ID,
+                                      SFVMK_CB_TRACE_REQUEST, pMgmtParm, &traceReq);
+  if (status != VMK_OK) {
+    status = VMK_NO_CONNECT;
+    printf("ERROR: Unable to connect to the backend, error 0x%x\n", status);
+    goto free_buffer;
+  }
+
+  if (pMgmtParm->status != VMK_OK) {
+    status = pMgmtParm->status;
+    printf("ERROR: Trace drain failed, error 0x%x\n", status);
+    goto free_buffer;
+  }
+
+  numRecords = traceReq.size / sizeof(sfvmk_traceRecord_t);
+
+  /* Names are only needed to decode the records, so failing to get
+   * them is not fatal */
+  memset(&traceReq, 0, sizeof(traceReq));
+  traceReq.subCmd = SFVMK_MGMT_TRACE_NAMES;
+  traceReq.size = SFVMK_TRACE_USER_PROBES * sizeof(sfvmk_traceProbeName_t);
+#if (VMKAPI_REVISION <= VMK_REVISION_FROM_NUMBERS(2, 5, 0, 0))
+  traceReq.traceBuffer = (vmk_uint64)((vmk_uint32)pNames);
+#else
+  traceReq.traceBuffer = (vmk_uint64)pNames;
+#endif
+
+  numNames = 0;
+  status = vmk_MgmtUserCallbackInvoke(mgmtHandle, VMK_MGMT_NO_INSTANCE_ID,
+                                      SFVMK_CB_TRACE_REQUEST, pMgmtParm, &traceReq);
+  if ((status == VMK_OK) && (pMgmtParm->status == VMK_OK))
+    numNames = traceReq.size / sizeof(sfvmk_traceProbeName_t);
+
+  if (pFileName) {
+    pFile = fopen(pFileName, "a");
+    if (!pFile) {
+      status = VMK_NOT_FOUND;
+      printf("ERROR: Unable to open file %s\n", pFileName);
+      goto free_buffer;
+    }
+  }
+
+  for (i = 0; i < numRecords; i++) {
+    pRecord = &pRecords[i];
+    pName = sfvmk_traceProbeNameFind(pNames, numNames, pRecord->probeId);
+
+    fprintf(pFile, "%llu %llu.%06llu cpu%u ",
+            (unsigned long long)pRecord->seq,
+            (unsigned long long)(pRecord->timestamp / 1000000),
+            (unsigned long long)(pRecord->timestamp % 1000000),
+            pRecord->cpu);
+    if (pName)
+      fprintf(pFile, "%.*s(%.*s:%u)",
+              SFVMK_TRACE_PROBE_NAME_LEN, pName->name,
+              SFVMK_TRACE_PROBE_FILE_LEN, pName->file, pName->line);
+    else
+      fprintf(pFile, "probe_0x%08x", pRecord->probeId);
+
+    for (j = 0; (j < pRecord->numArgs) && (j < SFVMK_TRACE_MAX_ARGS); j++)
+      fprintf(pFile, " 0x%llx", (unsigned long long)pRecord->args[j]);
+
+    fprintf(pFile, "\n");
+  }
+
+  if (pFileName) {
+    fclose(pFile);
+    printf("%u trace records written to %s\n", numRecords, pFileName);
+  }
+
+  status = VMK_OK;
+
+free_buffer:
+  free(pNames);
+  free(pRecords);
+
+  return status;
+}
+
 static VMK_ReturnStatus
 sfvmk_verifyFWOption(vmk_Bool updateDefault, vmk_Bool fwFileSet,
                      vmk_Bool nicNameSet, vmk_Bool overwrite)
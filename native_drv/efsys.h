@@ -569,28 +569,43 @@ typedef uint64_t    efsys_stat_t;
 
 #ifndef EFSYS_PROBES
 
-#define EFSYS_PROBE(_name)
+/* Probes are recorded to the trace ring when enabled at runtime
+ * through the SFVMK_CB_TRACE_REQUEST mgmt callback */
 
-#define EFSYS_PROBE1(_name, _type1, _arg1)
+#define EFSYS_PROBE(_name)                                              \
+        SFVMK_TRACE_PROBE(_name, 0, 0, 0, 0, 0, 0, 0, 0)
+
+#define EFSYS_PROBE1(_name, _type1, _arg1)                              \
+        SFVMK_TRACE_PROBE(_name, 1, _arg1, 0, 0, 0, 0, 0, 0)
 
-#define EFSYS_PROBE2(_name, _type1, _arg1, _type2, _arg2)
+#define EFSYS_PROBE2(_name, _type1, _arg1, _type2, _arg2)               \
+        SFVMK_TRACE_PROBE(_name, 2, _arg1, _arg2, 0, 0, 0, 0, 0)
 
 #define EFSYS_PROBE3(_name, _type1, _arg1, _type2, _arg2,               \
-            _type3, _arg3)
+            _type3, _arg3)                                              \
+        SFVMK_TRACE_PROBE(_name, 3, _arg1, _arg2, _arg3, 0, 0, 0, 0)
 
 #define EFSYS_PROBE4(_name, _type1, _arg1, _type2, _arg2,               \
-            _type3, _arg3, _type4, _arg4)
+            _type3, _arg3, _type4, _arg4)                               \
+        SFVMK_TRACE_PROBE(_name, 4, _arg1, _arg2, _arg3, _arg4,         \
+            0, 0, 0)
 
 #define EFSYS_PROBE5(_name, _type1, _arg1, _type2, _arg2,               \
-            _type3, _arg3, _type4, _arg4, _type5, _arg5)
+            _type3, _arg3, _type4, _arg4, _type5, _arg5)                \
+        SFVMK_TRACE_PROBE(_name, 5, _arg1, _arg2, _arg3, _arg4,         \
+            _arg5, 0, 0)
 
 #define EFSYS_PROBE6(_name, _type1, _arg1, _type2, _arg2,               \
             _type3, _arg3, _type4, _arg4, _type5, _arg5,                \
-            _type6, _arg6)
+            _type6, _arg6)                                              \
+        SFVMK_TRACE_PROBE(_name, 6, _arg1, _arg2, _arg3, _arg4,         \
+            _arg5, _arg6, 0)
 
 #define EFSYS_PROBE7(_name, _type1, _arg1, _type2, _arg2,               \
             _type3, _arg3, _type4, _arg4, _type5, _arg5,                \
-            _type6, _arg6, _type7, _arg7)
+            _type6, _arg6, _type7, _arg7)                               \
+        SFVMK_TRACE_PROBE(_name, 7, _arg1, _arg2, _arg3, _arg4,         \
+            _arg5, _arg6, _arg7)
 
 #else /* EFSYS_PROBES */
 
@@ -49,6 +49,9 @@ typedef struct sfvmk_modInfo_s {
    vmk_MgmtHandle     mgmtHandle;
    vmk_HashTable      vmkdevHashTable;
    vmk_Semaphore      lock;
+   /* EFSYS probe trace ring and the number of probes recorded to it */
+   struct sfvmk_trace_s *pTrace;
+   vmk_uint32         traceNumEnabled;
 #ifdef SFVMK_SUPPORT_SRIOV
    vmk_ListLinks      primaryList;
    vmk_ListLinks      unassociatedList;
@@ -60,6 +63,48 @@ typedef struct sfvmk_modInfo_s {
 
 extern sfvmk_modInfo_t sfvmk_modInfo;
 
+/* EFSYS probe tracing. Each probe site owns one of these, so sites
+ * sharing a generic name (fail1, ...) keep distinct identifiers and
+ * can be enabled on their own */
+typedef struct sfvmk_traceSite_s {
+  const char    *pName;
+  const char    *pFile;
+  vmk_uint32    line;
+  /* Hash of file, line and name, 0 until the site is registered */
+  vmk_uint32    probeId;
+  vmk_atomic64  registered;
+  /* Enable state, recomputed when enableGen lags the trace ring's */
+  vmk_Bool      enabled;
+  vmk_uint32    enableGen;
+} sfvmk_traceSite_t;
+
+void sfvmk_traceProbeRegister(sfvmk_traceSite_t *pSite);
+void sfvmk_traceRecord(sfvmk_traceSite_t *pSite, vmk_uint32 numArgs,
+                       vmk_uint64 arg1, vmk_uint64 arg2, vmk_uint64 arg3,
+                       vmk_uint64 arg4, vmk_uint64 arg5, vmk_uint64 arg6,
+                       vmk_uint64 arg7);
+
+/* Record a probe hit if any probe is being traced. The probe site
+ * is registered on its first hit while tracing */
+#define SFVMK_TRACE_PROBE(_name, _numArgs, _arg1, _arg2, _arg3, _arg4,  \
+                          _arg5, _arg6, _arg7)                          \
+  do {                                                                  \
+    if (VMK_UNLIKELY(sfvmk_modInfo.traceNumEnabled != 0)) {             \
+      static sfvmk_traceSite_t sfvmkSite = {                            \
+        #_name, __FILE__, __LINE__                                      \
+      };                                                                \
+                                                                        \
+      if (sfvmkSite.probeId == 0)                                       \
+        sfvmk_traceProbeRegister(&sfvmkSite);                           \
+                                                                        \
+      sfvmk_traceRecord(&sfvmkSite, (_numArgs),                         \
+                        (vmk_uint64)(_arg1), (vmk_uint64)(_arg2),       \
+                        (vmk_uint64)(_arg3), (vmk_uint64)(_arg4),       \
+                        (vmk_uint64)(_arg5), (vmk_uint64)(_arg6),       \
+                        (vmk_uint64)(_arg7));                           \
+    }                                                                   \
+  } while (VMK_FALSE)
+
 typedef enum sfvmk_evqType_e {
   SFVMK_EVQ_TYPE_AUTO,
   SFVMK_EVQ_TYPE_THROUGHPUT,
@@ -67,6 +112,26 @@ typedef enum sfvmk_evqType_e {
   SFVMK_EVQ_TYPE_MAX
 } sfvmk_evqType_t;
 
+/* Placement of TXQ completion events */
+typedef enum sfvmk_txEvqMode_e {
+  /* TXQ completions share the EVQ of the paired RXQ */
+  SFVMK_TX_EVQ_MODE_SHARED,
+  /* TXQ completions are delivered on dedicated TX only EVQs */
+  SFVMK_TX_EVQ_MODE_DEDICATED,
+  SFVMK_TX_EVQ_MODE_MAX
+} sfvmk_txEvqMode_t;
+
+/* Affinity policy applied to the MSIX vectors */
+typedef enum sfvmk_intrAffinity_e {
+  /* Leave vector placement to vmkernel */
+  SFVMK_INTR_AFFINITY_NONE,
+  /* Spread vectors across all PCPUs */
+  SFVMK_INTR_AFFINITY_SPREAD,
+  /* Spread vectors across PCPUs of the device NUMA node */
+  SFVMK_INTR_AFFINITY_NUMA_LOCAL,
+  SFVMK_INTR_AFFINITY_MAX
+} sfvmk_intrAffinity_t;
+
 /* Structure for module params */
 typedef struct sfvmk_modParams_s {
   vmk_uint32       debugMask;
@@ -75,6 +140,18 @@ typedef struct sfvmk_modParams_s {
   vmk_uint32       vxlanOffload;
   vmk_uint32       geneveOffload;
   sfvmk_evqType_t  evqType;
+  sfvmk_txEvqMode_t txEvqMode;
+  vmk_uint32       txqsPerEvq;
+  sfvmk_intrAffinity_t intrAffinity;
+  vmk_uint32       latSampleRate;
+  vmk_uint32       rxFlowSketch;
+  vmk_uint32       rssBalanceMs;
+  vmk_uint32       rssImbalancePct;
+  vmk_uint32       dpProfile;
+  vmk_uint32       arfsMaxFlows;
+  vmk_uint32       rssHashFields;
+  vmk_uint32       netqRssCount;
+  vmk_uint32       storageRxq;
 #if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
   vmk_uint32 maxVfsCount;
 #endif
@@ -118,9 +195,19 @@ typedef enum sfvmk_logLevel_e {
 #define SFVMK_LOG_LEVEL_DEFAULT SFVMK_LOG_LEVEL_INFO
 #endif
 
+/* Datapath (per packet) logging is compiled in only when
+ * ENABLE_IO_DEBUG_LOG is set, which defaults to debug builds. Release
+ * builds can define SFVMK_DATAPATH_TRACE to get static datapath trace
+ * points recorded to the probe trace ring instead */
+#ifndef ENABLE_IO_DEBUG_LOG
 #ifdef VMX86_DEBUG
 #define ENABLE_IO_DEBUG_LOG 1
+#else
+#define ENABLE_IO_DEBUG_LOG 0
+#endif
+#endif
 
+#ifdef VMX86_DEBUG
 #define SFVMK_DEBUG_DEFAULT (SFVMK_DEBUG_DRIVER |                            \
                              SFVMK_DEBUG_UPLINK |                            \
                              SFVMK_DEBUG_EVQ    |                            \
@@ -130,8 +217,6 @@ typedef enum sfvmk_logLevel_e {
                              SFVMK_DEBUG_PROXY  |                            \
                              SFVMK_DEBUG_HW)
 #else
-#define ENABLE_IO_DEBUG_LOG 0
-
 #define SFVMK_DEBUG_DEFAULT (SFVMK_DEBUG_DRIVER |                            \
                              SFVMK_DEBUG_UPLINK |                            \
                              SFVMK_DEBUG_HW)
@@ -160,12 +245,6 @@ typedef enum sfvmk_logLevel_e {
   } while (0)
 
 
-#if ENABLE_IO_DEBUG_LOG
-#define  SFVMK_ADAPTER_DEBUG_IO(pAdapter, mask, lvl, fmt, ...)               \
-         SFVMK_ADAPTER_DEBUG(pAdapter, mask, lvl, fmt, ##__VA_ARGS__)
-#else
-#define  SFVMK_ADAPTER_DEBUG_IO(pAdapter, mask, lvl, fmt, ...)
-#endif
 
 /* Errors (never masked) */
 #define SFVMK_ADAPTER_ERROR(pAdapter, fmt, ...)                              \
@@ -200,6 +279,42 @@ typedef enum sfvmk_logLevel_e {
 #define SFVMK_DEBUG_FUNC_EXIT(mask,  ...)                                    \
   SFVMK_DEBUG_FUNC(mask, "Exiting ", __VA_ARGS__)
 
+/* Datapath variants, these evaluate nothing unless ENABLE_IO_DEBUG_LOG */
+#if ENABLE_IO_DEBUG_LOG
+#define  SFVMK_ADAPTER_DEBUG_IO(pAdapter, mask, lvl, fmt, ...)               \
+         SFVMK_ADAPTER_DEBUG(pAdapter, mask, lvl, fmt, ##__VA_ARGS__)
+
+#define SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, mask, ...)               \
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, mask, __VA_ARGS__)
+
+#define SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, mask, ...)                \
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, mask, __VA_ARGS__)
+
+#define SFVMK_DEBUG_IO_FUNC_ENTRY(mask, ...)                                 \
+  SFVMK_DEBUG_FUNC_ENTRY(mask, __VA_ARGS__)
+
+#define SFVMK_DEBUG_IO_FUNC_EXIT(mask, ...)                                  \
+  SFVMK_DEBUG_FUNC_EXIT(mask, __VA_ARGS__)
+#else
+#define  SFVMK_ADAPTER_DEBUG_IO(pAdapter, mask, lvl, fmt, ...)
+#define SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, mask, ...)
+#define SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, mask, ...)
+#define SFVMK_DEBUG_IO_FUNC_ENTRY(mask, ...)
+#define SFVMK_DEBUG_IO_FUNC_EXIT(mask, ...)
+#endif
+
+/* Static datapath trace points, enabled by name like the EFSYS probes */
+#ifdef SFVMK_DATAPATH_TRACE
+#define SFVMK_DATAPATH_TRACE2(_name, _arg1, _arg2)                           \
+  SFVMK_TRACE_PROBE(_name, 2, _arg1, _arg2, 0, 0, 0, 0, 0)
+
+#define SFVMK_DATAPATH_TRACE3(_name, _arg1, _arg2, _arg3)                    \
+  SFVMK_TRACE_PROBE(_name, 3, _arg1, _arg2, _arg3, 0, 0, 0, 0)
+#else
+#define SFVMK_DATAPATH_TRACE2(_name, _arg1, _arg2)
+#define SFVMK_DATAPATH_TRACE3(_name, _arg1, _arg2, _arg3)
+#endif
+
 #define SFVMK_MAX(a, b) (a > b ? a : b)
 
 /* Mem Allocation */
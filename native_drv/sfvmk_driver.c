@@ -26,33 +26,59 @@
 
 #include "sfvmk_driver.h"
 
-/* Default number of NetQ supported */
-#define SFVMK_NETQ_COUNT_DEFAULT 8
+/* NetQ and RSSQ counts left at 0 are sized at attach from the NIC
+ * queue, EVQ and interrupt limits and the host CPU count */
+#define SFVMK_QUEUE_COUNT_AUTO 0
 
-/* Default number of RSSQ supported */
-#define SFVMK_RSSQ_COUNT_DEFAULT 0
+/* rssQCount value disabling RSS */
+#define SFVMK_RSSQ_COUNT_DISABLE 1
+
+/* Default number of TXQs served by a dedicated TX EVQ */
+#define SFVMK_TXQS_PER_EVQ_DEFAULT 1
+
+/* Largest latency sampling period accepted */
+#define SFVMK_LAT_SAMPLE_RATE_MAX 65536
+
+/* Limits of the RSS balancer parameters */
+#define SFVMK_RSS_BALANCE_MS_MAX        60000
+#define SFVMK_RSS_IMBALANCE_PCT_MIN     110
+#define SFVMK_RSS_IMBALANCE_PCT_DEFAULT 150
 
 #define SFVMK_DYN_VPD_AREA_TAG   0x10
 
 /* Initialize module params with default values */
 sfvmk_modParams_t modParams = {
   .debugMask = SFVMK_DEBUG_DEFAULT,
-  .netQCount = SFVMK_NETQ_COUNT_DEFAULT,
+  .netQCount = SFVMK_QUEUE_COUNT_AUTO,
   .vxlanOffload = VMK_TRUE,
 #if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
   .geneveOffload = VMK_TRUE,
 #endif
-  .rssQCount = SFVMK_RSSQ_COUNT_DEFAULT,
-  .evqType = SFVMK_EVQ_TYPE_AUTO
+  .rssQCount = SFVMK_QUEUE_COUNT_AUTO,
+  .evqType = SFVMK_EVQ_TYPE_AUTO,
+  .txEvqMode = SFVMK_TX_EVQ_MODE_SHARED,
+  .txqsPerEvq = SFVMK_TXQS_PER_EVQ_DEFAULT,
+  .intrAffinity = SFVMK_INTR_AFFINITY_NONE,
+  .latSampleRate = 0,
+  .rxFlowSketch = VMK_FALSE,
+  .rssBalanceMs = 0,
+  .rssImbalancePct = SFVMK_RSS_IMBALANCE_PCT_DEFAULT,
+  .dpProfile = VMK_FALSE,
+  .arfsMaxFlows = 0,
+  .rssHashFields = SFVMK_RSS_HASH_DEFAULT,
+  .netqRssCount = 0,
+  .storageRxq = VMK_FALSE
 };
 
 /* List of module parameters */
 VMK_MODPARAM_NAMED(debugMask, modParams.debugMask, uint, "Debug Logging Bit Masks");
 VMK_MODPARAM_NAMED(netQCount, modParams.netQCount, uint,
-                   "NetQ count(includes defQ) [Min:1 Max:15 Default:8]"
-                   "(invalid value sets netQCount to default value(8))");
+                   "NetQ count(includes defQ) [Min:1 Max:31 "
+                   "Default:0 (sized from NIC queues, interrupts and CPUs)]"
+                   "(invalid value sets netQCount to default value(0))");
 VMK_MODPARAM_NAMED(rssQCount, modParams.rssQCount, uint,
-                   "RSSQ count [Min:1 (RSS disable) Max:4 Default:RSS disable]"
+                   "RSSQ count [0:Sized from NIC queues, interrupts and CPUs "
+                   "(default), 1:RSS disable, Max:16]"
                    "(invalid value of rssQCount disables RSS");
 VMK_MODPARAM_NAMED(vxlanOffload, modParams.vxlanOffload, bool,
                    "Enable / disable vxlan offload "
@@ -70,6 +96,62 @@ VMK_MODPARAM_ARRAY(max_vfs, int, &modParams.maxVfsCount,
 VMK_MODPARAM_NAMED(evqType, modParams.evqType, uint,
                    "EVQ type [0:Auto (default), 1:Throughput, 2:Low latency]"
                    "(invalid value sets EVQ type to default value (Auto))");
+VMK_MODPARAM_NAMED(txEvqMode, modParams.txEvqMode, uint,
+                   "TX completion EVQ mode [0:Shared with RXQ (default), "
+                   "1:Dedicated TX EVQs]"
+                   "(invalid value sets TX EVQ mode to default value (Shared))");
+VMK_MODPARAM_NAMED(txqsPerEvq, modParams.txqsPerEvq, uint,
+                   "Number of TXQs sharing a dedicated TX EVQ "
+                   "[Min:1 Max:4 Default:1]"
+                   "(invalid value sets txqsPerEvq to default value(1))");
+VMK_MODPARAM_NAMED(intrAffinity, modParams.intrAffinity, uint,
+                   "Interrupt affinity [0:vmkernel default (default), "
+                   "1:Spread across PCPUs, 2:Spread across PCPUs of device NUMA node]"
+                   "(invalid value sets interrupt affinity to default value)");
+VMK_MODPARAM_NAMED(latSampleRate, modParams.latSampleRate, uint,
+                   "Timestamp one of every N packets per TXQ and N RX events "
+                   "per RXQ for the latency histograms "
+                   "[0:Disable (default), Max:65536]"
+                   "(N is rounded up to a power of 2, invalid value disables)");
+VMK_MODPARAM_NAMED(rxFlowSketch, modParams.rxFlowSketch, bool,
+                   "Track the heaviest RSS flows of each RSS RXQ "
+                   "[0:Disable (default), 1:Enable]");
+VMK_MODPARAM_NAMED(rssBalanceMs, modParams.rssBalanceMs, uint,
+                   "Period in msec of the RSS load check that moves hot "
+                   "indirection table buckets to cold RSS queues, "
+                   "until the vmkernel updates the table itself "
+                   "[0:Disable (default), Max:60000]"
+                   "(invalid value disables)");
+VMK_MODPARAM_NAMED(rssImbalancePct, modParams.rssImbalancePct, uint,
+                   "Load of the hottest RSS queue, in percent of the mean, "
+                   "above which the RSS table is rebalanced "
+                   "[Min:110 Default:150]"
+                   "(invalid value sets rssImbalancePct to default value(150))");
+VMK_MODPARAM_NAMED(dpProfile, modParams.dpProfile, bool,
+                   "Account datapath cycles per stage and queue from load time "
+                   "[0:Disable (default), 1:Enable]");
+VMK_MODPARAM_NAMED(arfsMaxFlows, modParams.arfsMaxFlows, uint,
+                   "Number of default and RSS queue flows steered by "
+                   "accelerated RFS to the RSS RXQ interrupting the PCPU "
+                   "they are sent from "
+                   "[0:Disable (default), Min:4, Max:1024]"
+                   "(N is rounded up to a power of 2, invalid value disables)");
+VMK_MODPARAM_NAMED(rssHashFields, modParams.rssHashFields, uint,
+                   "Header fields hashed by RSS, bit mask of "
+                   "[0x1:IPv4, 0x2:TCP/IPv4 4-tuple, 0x4:UDP/IPv4 4-tuple, "
+                   "0x8:IPv6, 0x10:TCP/IPv6 4-tuple, 0x20:UDP/IPv6 4-tuple] "
+                   "(default 0x1b, invalid value sets default value)");
+VMK_MODPARAM_NAMED(netqRssCount, modParams.netqRssCount, uint,
+                   "Number of NetQueues, first allocated first served, whose "
+                   "traffic is spread by an exclusive RSS context over "
+                   "rssQCount HW queues of their own "
+                   "[0:Disable (default), Max:4]"
+                   "(invalid value disables)");
+VMK_MODPARAM_NAMED(storageRxq, modParams.storageRxq, bool,
+                   "Keep the last NetQueue RXQ out of the NetQueue pool as a "
+                   "dedicated queue for storage flow steering rules "
+                   "[0:Disable (default), 1:Enable]"
+                   "(needs netQCount of 3 or more)");
 
 #define SFVMK_MIN_EVQ_COUNT 1
 
@@ -417,6 +499,97 @@ done:
   return status;
 }
 
+/*! \brief  Size the NetQ and RSSQ counts the module params left unset.
+**         The EVQ budget is already bounded by the NIC queue and
+**         interrupt (MSI-X) limits and by the host CPU count. Unless
+**         the NetQ count is set, RSS takes up to half of the budget,
+**         shared with the NetQueue RSS contexts, and never more queues
+**         per pool than PCPUs. NetQueues get what is left.
+**
+** \param[in]      pAdapter     pointer to sfvmk_adapter_t
+** \param[in]      maxEvqCount  EVQs available for the RX/TX queues
+** \param[in,out]  pNetQCount   NetQ count, SFVMK_QUEUE_COUNT_AUTO if unset
+** \param[in,out]  pRssQCount   RSSQ count, SFVMK_QUEUE_COUNT_AUTO if unset
+**
+** \return: void
+*/
+static void
+sfvmk_autoQueueCounts(sfvmk_adapter_t *pAdapter,
+                      vmk_uint32 maxEvqCount,
+                      vmk_uint32 *pNetQCount,
+                      vmk_uint32 *pRssQCount)
+{
+  vmk_uint32 rssShare = pAdapter->rssCtxMax + 1;
+  vmk_uint32 left;
+
+  if (*pRssQCount == SFVMK_QUEUE_COUNT_AUTO) {
+    /* One more queue is taken by the uplink RSS queue */
+    if (*pNetQCount == SFVMK_QUEUE_COUNT_AUTO)
+      left = maxEvqCount / 2;
+    else if (maxEvqCount > *pNetQCount + 1)
+      left = maxEvqCount - *pNetQCount - 1;
+    else
+      left = 0;
+
+    *pRssQCount = MIN(MIN(left / rssShare, vmk_NumPCPUs()),
+                      SFVMK_MAX_RSSQ_COUNT);
+    if (*pRssQCount < 2)
+      *pRssQCount = SFVMK_RSSQ_COUNT_DISABLE;
+  }
+
+  if (*pNetQCount == SFVMK_QUEUE_COUNT_AUTO) {
+    left = maxEvqCount;
+    if (*pRssQCount != SFVMK_RSSQ_COUNT_DISABLE)
+      left -= MIN(left, (*pRssQCount * rssShare) + 1);
+
+    *pNetQCount = MIN(MAX(left, 1), SFVMK_MAX_NETQ_COUNT);
+  }
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_DRIVER, SFVMK_LOG_LEVEL_INFO,
+                      "Queue counts for %u EVQs and %u PCPUs: "
+                      "NetQ %u RSSQ %u",
+                      maxEvqCount, vmk_NumPCPUs(), *pNetQCount,
+                      (*pRssQCount == SFVMK_RSSQ_COUNT_DISABLE) ?
+                      0 : *pRssQCount);
+}
+
+/*! \brief  Upper bound of the HW queues (EVQ with an RXQ and a TXQ) an
+**         adapter creates with the current module params. Used to size
+**         the module heap before any adapter is attached, so it follows
+**         the clamping of sfvmk_setResourceLimits and
+**         sfvmk_autoQueueCounts without the NIC limits.
+**
+** \return: max number of HW queues per adapter
+*/
+vmk_uint32
+sfvmk_getMaxHwqFromModParams(void)
+{
+  vmk_uint32 netQCount;
+  vmk_uint32 rssQCount;
+  vmk_uint32 rssCtxMax = 0;
+
+  netQCount = modParams.netQCount;
+  if ((netQCount == SFVMK_QUEUE_COUNT_AUTO) ||
+      (netQCount > SFVMK_MAX_NETQ_COUNT))
+    netQCount = SFVMK_MAX_NETQ_COUNT;
+
+  rssQCount = modParams.rssQCount;
+  if (rssQCount == SFVMK_QUEUE_COUNT_AUTO)
+    rssQCount = MIN(vmk_NumPCPUs(), SFVMK_MAX_RSSQ_COUNT);
+  else if ((rssQCount == SFVMK_RSSQ_COUNT_DISABLE) ||
+           (rssQCount > SFVMK_MAX_RSSQ_COUNT))
+    rssQCount = 0;
+
+  if (modParams.netqRssCount <= SFVMK_MAX_RSS_CONTEXTS)
+    rssCtxMax = modParams.netqRssCount;
+
+  /* One more HW queue backs the uplink RSS queue */
+  if (rssQCount == 0)
+    return netQCount;
+
+  return netQCount + 1 + (rssQCount * (rssCtxMax + 1));
+}
+
 /*! \brief  Routine to estimate resource (eg number of RXQs,TXQs and EVQs)
 **
 ** \param[in]  pAdapter pointer to sfvmk_adapter_t
@@ -430,6 +603,10 @@ sfvmk_setResourceLimits(sfvmk_adapter_t *pAdapter)
   VMK_ReturnStatus status = VMK_FAILURE;
   vmk_uint32 maxEvqCount;
   vmk_uint32 maxRxq, maxTxq;
+  vmk_uint32 txqsPerEvq;
+  vmk_uint32 maxTxEvqCount;
+  vmk_uint32 netQCount;
+  vmk_uint32 rssQCount;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_DRIVER);
 
@@ -464,6 +641,13 @@ sfvmk_setResourceLimits(sfvmk_adapter_t *pAdapter)
                         vmk_StatusToString(status));
     goto done;
   }
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_DRIVER, SFVMK_LOG_LEVEL_INFO,
+                      "Queue limits: NIC evq %u rxq %u txq %u intr %u, "
+                      "host rxq %u txq %u",
+                      pNicCfg->enc_evq_limit, pNicCfg->enc_rxq_limit,
+                      pNicCfg->enc_txq_limit, pNicCfg->enc_intr_limit,
+                      limits.edl_max_rxq_count, limits.edl_max_txq_count);
   /* Using following scheme for EVQs, RXQs and TXQs
    * One EVQ for each RXQ and TXQ_TYPE_IP_TCP_UDP_CKSUM TXQ
    * EVQ-0 also handles:
@@ -472,16 +656,25 @@ sfvmk_setResourceLimits(sfvmk_adapter_t *pAdapter)
    * MCDI events
    * Error events from firmware/hardware
    */
-  pAdapter->numNetQs = modParams.netQCount;
+  netQCount = modParams.netQCount;
+  if (netQCount > SFVMK_MAX_NETQ_COUNT)
+    netQCount = SFVMK_QUEUE_COUNT_AUTO;
 
-  if ((modParams.netQCount == 0) || (modParams.netQCount > SFVMK_MAX_NETQ_COUNT))
-    pAdapter->numNetQs = SFVMK_NETQ_COUNT_DEFAULT;
+  rssQCount = modParams.rssQCount;
+  if (rssQCount > SFVMK_MAX_RSSQ_COUNT)
+    rssQCount = SFVMK_RSSQ_COUNT_DISABLE;
 
-  pAdapter->numRSSQs = modParams.rssQCount;
-  if (pAdapter->numRSSQs > SFVMK_MAX_RSSQ_COUNT)
-    pAdapter->numRSSQs = SFVMK_RSSQ_COUNT_DEFAULT;
-  else if (pAdapter->numRSSQs == 1)
-    pAdapter->numRSSQs = 0;
+  pAdapter->rssCtxMax = 0;
+  if (modParams.netqRssCount <= SFVMK_MAX_RSS_CONTEXTS)
+    pAdapter->rssCtxMax = modParams.netqRssCount;
+
+  maxEvqCount = MIN(limits.edl_max_rxq_count, limits.edl_max_txq_count);
+  maxEvqCount = MIN(maxEvqCount, pNicCfg->enc_evq_limit);
+
+  sfvmk_autoQueueCounts(pAdapter, maxEvqCount, &netQCount, &rssQCount);
+
+  pAdapter->numNetQs = netQCount;
+  pAdapter->numRSSQs = (rssQCount == SFVMK_RSSQ_COUNT_DISABLE) ? 0 : rssQCount;
 
   limits.edl_min_evq_count = SFVMK_MIN_EVQ_COUNT;
   /* Max number of event q = netQCount +  (rssQCount + 1)
@@ -514,14 +707,22 @@ sfvmk_setResourceLimits(sfvmk_adapter_t *pAdapter)
    *                                            |                   |
    *                                            |                   |
    *                                            |   RSS Q #rssQCount|
+   *                                            | - - - - - - - - - |
+   *                                            |   RSS context #1  |
+   *                                            |   (rssQCount Qs)  |
+   *                                            |   ...             |
+   *                                            |   RSS context #n  |
    *                                            ---------------------
    *
+   * Each of the netqRssCount NetQueue RSS contexts spreads over its own
+   * rssQCount HW queues placed after the vmkernel RSS queues, so that a
+   * NetQueue with a context does not share queues with the RSS pool.
+   *
    *
    *
    * In the corner case of RSS queue being created on the last uplink queue
    * one hardware queue can be saved but currently this case is not optimized
    */
-  maxEvqCount = MIN(limits.edl_max_rxq_count, limits.edl_max_txq_count);
 
   /* Compute EVQ count based on netQCount */
   if (maxEvqCount <= pAdapter->numNetQs) {
@@ -546,11 +747,13 @@ sfvmk_setResourceLimits(sfvmk_adapter_t *pAdapter)
       pAdapter->numRSSQs = 0;
     } else {
       limits.edl_max_evq_count = MIN(maxEvqCount, (limits.edl_max_evq_count +
-                                     modParams.rssQCount + 1));
+                                     (pAdapter->numRSSQs *
+                                      (pAdapter->rssCtxMax + 1)) + 1));
     }
   }
 
-  pAdapter->numEvqsDesired = limits.edl_max_evq_count;
+  if (pAdapter->numRSSQs == 0)
+    pAdapter->rssCtxMax = 0;
 
   limits.edl_min_rxq_count = limits.edl_min_evq_count;
   limits.edl_max_rxq_count = limits.edl_max_evq_count;
@@ -558,6 +761,51 @@ sfvmk_setResourceLimits(sfvmk_adapter_t *pAdapter)
   limits.edl_min_txq_count = limits.edl_min_evq_count;
   limits.edl_max_txq_count = limits.edl_max_evq_count;
 
+  /* In dedicated TX EVQ mode, TXQ completions are moved to additional
+   * EVQs placed after the EVQs with an RXQ, txqsPerEvq TXQs per EVQ.
+   * TX EVQs are limited by the EVQs and interrupts left over.
+   */
+  pAdapter->numTxEvqs = 0;
+  pAdapter->txqsPerEvq = SFVMK_TXQS_PER_EVQ_DEFAULT;
+  if (modParams.txEvqMode == SFVMK_TX_EVQ_MODE_DEDICATED) {
+    txqsPerEvq = modParams.txqsPerEvq;
+    if ((txqsPerEvq == 0) || (txqsPerEvq > SFVMK_MAX_TXQS_PER_EVQ))
+      txqsPerEvq = SFVMK_TXQS_PER_EVQ_DEFAULT;
+
+    /* A TX EVQ takes one event per descriptor of each of its TXQs and
+     * the ring size can be raised to the maximum later on, so the TXQs
+     * sharing it must fit in the largest EVQ at that ring size */
+    while ((txqsPerEvq > 1) &&
+           (txqsPerEvq * pNicCfg->enc_txq_max_ndescs > EFX_EVQ_MAXNEVS))
+      txqsPerEvq--;
+
+    if (txqsPerEvq != modParams.txqsPerEvq) {
+      SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_DRIVER, SFVMK_LOG_LEVEL_INFO,
+                          "txqsPerEvq %u, %u TXQs of %u descs fit in a TX EVQ",
+                          modParams.txqsPerEvq, txqsPerEvq,
+                          pNicCfg->enc_txq_max_ndescs);
+    }
+    pAdapter->txqsPerEvq = txqsPerEvq;
+
+    maxTxEvqCount = MIN(pNicCfg->enc_evq_limit, pNicCfg->enc_intr_limit);
+    if (maxTxEvqCount > limits.edl_max_evq_count)
+      maxTxEvqCount -= limits.edl_max_evq_count;
+    else
+      maxTxEvqCount = 0;
+
+    pAdapter->numTxEvqs = MIN(maxTxEvqCount,
+                              (limits.edl_max_txq_count + txqsPerEvq - 1) /
+                              txqsPerEvq);
+    if (pAdapter->numTxEvqs == 0) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "No EVQ left for TX, "
+                          "TXQ completions are shared with RXQ EVQs");
+    }
+
+    limits.edl_max_evq_count += pAdapter->numTxEvqs;
+  }
+
+  pAdapter->numEvqsDesired = limits.edl_max_evq_count;
+
   status = efx_nic_set_drv_limits(pAdapter->pNic, &limits);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "efx_nic_set_drv_limits failed status: %s",
@@ -1348,6 +1596,15 @@ sfvmk_attachDevice(vmk_Device dev)
     goto failed_tx_init;
   }
 
+  /* Balancer and storage RXQ settings are needed by sfvmk_rxInit */
+  if (modParams.rssBalanceMs <= SFVMK_RSS_BALANCE_MS_MAX)
+    pAdapter->rssBalance.intervalMs = modParams.rssBalanceMs;
+  pAdapter->rssBalance.thresholdPct =
+    (modParams.rssImbalancePct >= SFVMK_RSS_IMBALANCE_PCT_MIN) ?
+    modParams.rssImbalancePct : SFVMK_RSS_IMBALANCE_PCT_DEFAULT;
+  vmk_AtomicWrite64(&pAdapter->rssBalance.pending, 0);
+  pAdapter->storageRxqEnabled = modParams.storageRxq ? VMK_TRUE : VMK_FALSE;
+
   status = sfvmk_rxInit(pAdapter);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_rxInit failed status: %s",
@@ -1371,6 +1628,25 @@ sfvmk_attachDevice(vmk_Device dev)
 #endif
   }
 
+  if ((modParams.latSampleRate != 0) &&
+      (modParams.latSampleRate <= SFVMK_LAT_SAMPLE_RATE_MAX))
+    pAdapter->latSampleRate = sfvmk_pow2GE(modParams.latSampleRate);
+  pAdapter->timerCyclesPerUSec = vmk_TimerCyclesPerSecond() / VMK_USEC_PER_SEC;
+
+  pAdapter->dpProfile = modParams.dpProfile ? VMK_TRUE : VMK_FALSE;
+
+  if ((modParams.arfsMaxFlows >= SFVMK_ARFS_WAYS) &&
+      (modParams.arfsMaxFlows <= SFVMK_ARFS_MAX_FLOWS))
+    pAdapter->arfs.maxFlows = sfvmk_pow2GE(modParams.arfsMaxFlows);
+  vmk_AtomicWrite64(&pAdapter->arfs.pending, 0);
+  vmk_AtomicWrite64(&pAdapter->resetStartTime, 0);
+
+  if ((modParams.rssHashFields != 0) &&
+      ((modParams.rssHashFields & ~SFVMK_RSS_HASH_ALL) == 0))
+    pAdapter->rssHashFields = modParams.rssHashFields;
+  else
+    pAdapter->rssHashFields = SFVMK_RSS_HASH_DEFAULT;
+
   if (pAdapter->isTunnelEncapSupported) {
     status = sfvmk_tunnelInit(pAdapter);
     if (status != VMK_OK) {
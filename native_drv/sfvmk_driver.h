@@ -59,6 +59,13 @@
  */
 #define SFVMK_MAX_FILTER              2048
 #define SFMK_MAX_HWF_PER_UPF          2
+/* HW filter table size and the slots kept for the driver's own MAC
+ * filters and for each enabled VF */
+#define SFVMK_MAX_HW_FILTER           8192
+#define SFVMK_HW_FILTER_RESERVE       256
+#define SFVMK_VF_HW_FILTER_RESERVE    32
+/* Buckets in the filter DB spec index, must be a power of 2 */
+#define SFVMK_FILTER_SPEC_BUCKETS     SFVMK_MAX_FILTER
 
 #define SFVMK_MAX_ADAPTER             16
 #define SFVMK_MAX_FW_SIGNED_IMAGE     1843200 /* 1.8 MB */
@@ -66,11 +73,12 @@
 #define SFVMK_ALLOC_FW_IMAGE_SIZE     SFVMK_MAX((SFVMK_MAX_FW_SIGNED_IMAGE * 2), \
                                                  SFVMK_BUNDLE_IMAGE)
 
-/* Max number of NetQ supported */
-#define SFVMK_MAX_NETQ_COUNT          15
+/* Max number of NetQ supported, the count used is also bounded by the
+ * NIC queue and interrupt limits and the host CPU count at attach */
+#define SFVMK_MAX_NETQ_COUNT          31
 
-/* Max number of RSSQ supported */
-#define SFVMK_MAX_RSSQ_COUNT          4
+/* Max number of RSSQ supported, bounded at attach like the NetQ count */
+#define SFVMK_MAX_RSSQ_COUNT          16
 
 #define SFVMK_NETPOLL_TX_BUDGET       128
 
@@ -87,14 +95,52 @@
  */
 #define SFVMK_MC_REBOOT_TIME_OUT_MSEC               11000
 
-/* 20 EVQs, 15 (NetQ) + 1 (RSS) for Uplink Qs and 4 for HW RSS Q */
-#define SFVMK_MAX_EVQ                 (SFVMK_MAX_NETQ_COUNT + 1 + SFVMK_MAX_RSSQ_COUNT)
+/* 112 HW queues, 31 (NetQ) + 1 (RSS) for Uplink Qs, 16 for HW RSS Q and
+ * 16 for each of the 4 NetQueue RSS contexts */
+#define SFVMK_MAX_HWQ                 (SFVMK_MAX_NETQ_COUNT + 1 +            \
+                                       (SFVMK_MAX_RSSQ_COUNT *               \
+                                        (SFVMK_MAX_RSS_CONTEXTS + 1)))
+/* One EVQ per HW queue plus at most one dedicated TX EVQ per TXQ */
+#define SFVMK_MAX_EVQ                 (SFVMK_MAX_HWQ * 2)
 #define SFVMK_MAX_INTR                SFVMK_MAX_EVQ
-#define SFVMK_MAX_TXQ                 SFVMK_MAX_EVQ
-#define SFVMK_MAX_RXQ                 SFVMK_MAX_EVQ
+/* No PCPU known for an interrupt yet */
+#define SFVMK_PCPU_NONE               ((vmk_uint32)-1)
+/* Max EVQs sharing a legacy line interrupt, limited by the width of the
+ * queue mask returned by efx_intr_status_line */
+#define SFVMK_MAX_LINE_INTR_EVQS      32
+#define SFVMK_MAX_TXQ                 SFVMK_MAX_HWQ
+#define SFVMK_MAX_RXQ                 SFVMK_MAX_HWQ
+
+/* Max number of TXQs sharing a dedicated TX EVQ (module param limit) */
+#define SFVMK_MAX_TXQS_PER_EVQ        4
+
+/* TX completion events carry a 5 bit TXQ label */
+#define SFVMK_MAX_TXQ_LABEL           32
 
 #define SFVMK_RSS_HASH_KEY_SIZE       40
 
+/* Max number of NetQueues spread by an exclusive RSS context of their
+ * own, each context has as many HW queues as the vmkernel RSS pool */
+#define SFVMK_MAX_RSS_CONTEXTS        4
+
+/* RSS hash field selection (rssHashFields module param bits) */
+#define SFVMK_RSS_HASH_IPV4           (1 << 0)
+#define SFVMK_RSS_HASH_TCPIPV4        (1 << 1)
+#define SFVMK_RSS_HASH_UDPIPV4        (1 << 2)
+#define SFVMK_RSS_HASH_IPV6           (1 << 3)
+#define SFVMK_RSS_HASH_TCPIPV6        (1 << 4)
+#define SFVMK_RSS_HASH_UDPIPV6        (1 << 5)
+#define SFVMK_RSS_HASH_ALL            0x3F
+#define SFVMK_RSS_HASH_IPV6_ALL       (SFVMK_RSS_HASH_IPV6 |                  \
+                                       SFVMK_RSS_HASH_TCPIPV6 |               \
+                                       SFVMK_RSS_HASH_UDPIPV6)
+#define SFVMK_RSS_HASH_UDP_ALL        (SFVMK_RSS_HASH_UDPIPV4 |               \
+                                       SFVMK_RSS_HASH_UDPIPV6)
+#define SFVMK_RSS_HASH_DEFAULT        (SFVMK_RSS_HASH_IPV4 |                  \
+                                       SFVMK_RSS_HASH_TCPIPV4 |               \
+                                       SFVMK_RSS_HASH_IPV6 |                  \
+                                       SFVMK_RSS_HASH_TCPIPV6)
+
 /* Bit Masks for Encap offload features */
 #define SFVMK_VXLAN_OFFLOAD           1 << 0
 #define SFVMK_GENEVE_OFFLOAD          1 << 1
@@ -117,6 +163,7 @@ extern const efx_nvram_type_t nvramTypes[];
 
 extern VMK_ReturnStatus sfvmk_driverRegister(void);
 extern void             sfvmk_driverUnregister(void);
+extern vmk_uint32       sfvmk_getMaxHwqFromModParams(void);
 
 /* Lock rank is based on the order in which locks are typically acquired.
  * A lock with higher rank can be acquired while holding a lock with a lower rank.
@@ -174,6 +221,10 @@ typedef struct sfvmk_intr_s {
   sfvmk_intrState_t     state;
   /* Interrupt type (MESSAGE, LINE) */
   efx_intr_type_t       type;
+  /* Set when the EVQs outnumber the interrupts and share vector 0 */
+  vmk_Bool              sharedVector;
+  /* EVQs flagged by the line interrupt status but not yet scheduled */
+  vmk_atomic64          pendingQMask;
 } sfvmk_intr_t;
 
 /* Event queue state */
@@ -184,6 +235,34 @@ typedef enum sfvmk_evqState_e {
   SFVMK_EVQ_STATE_STARTED
 } sfvmk_evqState_t;
 
+#define SFVMK_EVQ_POLL_HIST_BUCKETS \
+  (SFVMK_EVQ_MAX_STATS - SFVMK_EVQ_POLL_HIST_1)
+
+static const char * const pSfvmkEvqStatsName[] = {
+  "ev_interrupts",
+  "ev_netpoll_calls",
+  "ev_polls",
+  "ev_empty_polls",
+  "ev_budget_exhausted",
+  "ev_events",
+  "ev_poll_hist_1",
+  "ev_poll_hist_2_3",
+  "ev_poll_hist_4_7",
+  "ev_poll_hist_8_15",
+  "ev_poll_hist_16_31",
+  "ev_poll_hist_32_63",
+  "ev_poll_hist_64_127",
+  "ev_poll_hist_128_plus",
+  "ev_max_stats"
+};
+
+/* Cost of one datapath stage on one queue, see sfvmk_profStart */
+typedef struct sfvmk_profStage_s {
+  vmk_uint64  cycles;
+  vmk_uint64  calls;
+  vmk_uint64  pkts;
+} sfvmk_profStage_t;
+
 typedef struct sfvmk_evq_s {
   struct sfvmk_adapter_s  *pAdapter;
   /* Memory for event queue */
@@ -208,6 +287,29 @@ typedef struct sfvmk_evq_s {
   vmk_uint32              txBudget;
   /* Used for storing pktList passed in sfvmk_panicPoll */
   vmk_PktList             panicPktList;
+  /* TXQs completing on this EVQ, indexed by TXQ label */
+  struct sfvmk_txq_s      *pTxqs[SFVMK_MAX_TXQ_LABEL];
+  vmk_uint32              numTxqs;
+  /* EVQ does not have an associated RXQ */
+  vmk_Bool                txOnly;
+  /* Event queue type used when the common code EVQ is created */
+  sfvmk_evqType_t         evqType;
+  /* Non-zero while a lockless poll owns the EVQ */
+  vmk_atomic64            polling;
+  /* Number of control paths waiting for the EVQ to quiesce */
+  vmk_atomic64            quiesce;
+  /* Interrupt count, written by the ISR only and kept on its own cache
+   * line away from the poll counters. Reported as SFVMK_EVQ_INTERRUPTS */
+  vmk_uint64              intrCount VMK_ATTRIBUTE_L1_ALIGNED;
+  /* PCPU the last interrupt was delivered on, written by the ISR only.
+   * SFVMK_PCPU_NONE until the first interrupt */
+  vmk_uint32              intrPCPU;
+  /* Poll counters, only written by the netpoll world inside write
+   * sections of statsLock. Read through sfvmk_evqStatsSnapshot */
+  vmk_VersionedAtomic     statsLock VMK_ATTRIBUTE_L1_ALIGNED;
+  vmk_uint64              stats[SFVMK_EVQ_MAX_STATS];
+  /* Datapath profiler, only SFVMK_MGMT_PROF_EVQ_POLL is used */
+  sfvmk_profStage_t       prof[SFVMK_MGMT_PROF_MAX_STAGES];
 } sfvmk_evq_t;
 
 typedef enum sfvmk_flushState_e {
@@ -242,6 +344,12 @@ typedef struct sfvmk_port_s {
   vmk_uint32            advertisedCapabilities;
   efsys_mem_t	        macStatsDmaBuf;
   efx_phy_media_type_t  mediumType;
+  /* Serializes MAC stats snapshot readers against the updater */
+  vmk_VersionedAtomic   macStatsLock;
+  /* Time in usec at which the MAC stats snapshot was last updated */
+  vmk_uint64            macStatsTime;
+  /* Non-zero while a MAC stats update request is queued on the helper */
+  vmk_atomic64          macStatsUpdatePending;
 } sfvmk_port_t;
 
 typedef enum sfvmk_txqState_e {
@@ -251,24 +359,21 @@ typedef enum sfvmk_txqState_e {
   SFVMK_TXQ_STATE_STOPPING
 } sfvmk_txqState_t;
 
-/* Tx Queue statistics */
-typedef enum sfvmk_txqStats_e {
-  SFVMK_TXQ_PKTS = 0,
-  SFVMK_TXQ_BYTES,
-  SFVMK_TXQ_INVALID_QUEUE_STATE,
-  SFVMK_TXQ_QUEUE_BUSY,
-  SFVMK_TXQ_DMA_MAP_ERROR,
-  SFVMK_TXQ_DESC_POST_FAILED,
-  SFVMK_TXQ_TSO_PARSING_FAILED,
-  SFVMK_TXQ_TSO_LONG_HEADER_ERROR,
-  SFVMK_TXQ_QUEUE_BLOCKED,
-  SFVMK_TXQ_QUEUE_UNBLOCKED,
-  SFVMK_TXQ_SG_ELEM_GET_FAILED,
-  SFVMK_TXQ_SG_ELEM_TOO_LONG,
-  SFVMK_TXQ_PARTIAL_COPY_FAILED,
-  SFVMK_TXQ_DISCARD,
-  SFVMK_TXQ_MAX_STATS
-} sfvmk_txqStats_t;
+/* Latency histograms are log-linear over nanoseconds: values below
+ * SFVMK_LAT_HIST_SUB_BUCKETS get a bucket each, above that every power of
+ * two is split into SFVMK_LAT_HIST_SUB_BUCKETS linear buckets. The last
+ * bucket is open ended and also takes everything from 2^31 ns on */
+#define SFVMK_LAT_HIST_SUB_BITS     2
+#define SFVMK_LAT_HIST_SUB_BUCKETS  (1 << SFVMK_LAT_HIST_SUB_BITS)
+#define SFVMK_LAT_HIST_BUCKETS      120
+
+/* Time weighted ring occupancy, see sfvmk_ringLevelUpdate */
+typedef struct sfvmk_ringLevel_s {
+  /* Timer cycles up to which time has been accounted */
+  vmk_uint64  lastCycles;
+  /* Ring level since lastCycles */
+  vmk_uint32  level;
+} sfvmk_ringLevel_t;
 
 static const char * const pSfvmkTxqStatsName[] = {
   "tx_packets",
@@ -285,6 +390,10 @@ static const char * const pSfvmkTxqStatsName[] = {
   "tx_sg_elem_too_long",
   "tx_partial_copy_failed",
   "tx_discard",
+  "tx_ring_level_us",
+  "tx_ring_time_us",
+  "tx_ring_level_hwm",
+  "tx_stopped_us",
   "tx_max_stats"
 };
 
@@ -293,6 +402,8 @@ typedef struct sfvmk_txMapping_s {
   vmk_PktHandle *pOrigPkt;
   vmk_PktHandle *pXmitPkt;
   vmk_SgElem    sgElem;
+  /* Timer cycles at doorbell if the packet is sampled for latency */
+  vmk_uint64    pushTime;
 } sfvmk_txMapping_t;
 
 typedef enum {
@@ -364,12 +475,47 @@ typedef struct sfvmk_hdrParseCtrl_s {
   sfvmk_hdrInfoType_t  hdrInfoType;
 } sfvmk_hdrParseCtrl_t;
 
+/* Accelerated RFS: flows sampled on the default and RSS TXQs get a full
+ * 5-tuple filter steering their receive side to the RSS RXQ whose EVQ
+ * interrupt is delivered on the PCPU the flow was transmitted from */
+#define SFVMK_ARFS_MAX_FLOWS          1024
+#define SFVMK_ARFS_WAYS               4
+/* Flows a TXQ records between two scans */
+#define SFVMK_ARFS_LEARN_SLOTS        16
+/* One of every N packets per TXQ is sampled, must be a power of 2 */
+#define SFVMK_ARFS_SAMPLE_RATE        64
+#define SFVMK_ARFS_SCAN_MS            100
+#define SFVMK_ARFS_EXPIRE_MS          5000
+/* Max number of filters installed per scan */
+#define SFVMK_ARFS_INSERT_BUDGET      32
+
+typedef struct sfvmk_arfsFlowKey_s {
+  /* Addresses in network byte order as sent by the host, ports in host
+   * byte order as efx_filter_spec_set_ipv4_full takes them */
+  vmk_uint32              localIp;
+  vmk_uint32              remoteIp;
+  vmk_uint16              localPort;
+  vmk_uint16              remotePort;
+  vmk_uint8               proto;
+} sfvmk_arfsFlowKey_t;
+
+typedef struct sfvmk_arfsSample_s {
+  sfvmk_arfsFlowKey_t     key;
+  /* PCPU the packet was transmitted from */
+  vmk_uint32              pcpu;
+} sfvmk_arfsSample_t;
+
 typedef struct sfvmk_txq_s {
   struct sfvmk_adapter_s  *pAdapter;
-  /* Lock to synchronize transmit flow with tx completion context */
+  /* Lock to synchronize transmit flow with tx completion context,
+   * always taken through sfvmk_txqLock */
   vmk_Lock                lock;
   /* HW TXQ index */
   vmk_uint32              index;
+  /* Index of the EVQ receiving completions of this TXQ */
+  vmk_uint32              evqIndex;
+  /* Label identifying this TXQ in TX events of its EVQ */
+  vmk_uint32              label;
   /* Number of descriptors in transmit queue */
   vmk_uint32              numDesc;
   vmk_uint32              ptrMask;
@@ -385,14 +531,36 @@ typedef struct sfvmk_txq_s {
   vmk_uint32              added;
   vmk_uint32              reaped;
   vmk_uint32              completed;
-
-  vmk_uint64              stats[SFVMK_TXQ_MAX_STATS];
+  /* Bytes queued by the sfvmk_uplinkTx burst in progress, published by
+   * sfvmk_txqBurstPublish */
+  vmk_uint64              burstBytes;
 
   /* The last VLAN TCI seen on the queue if FW-assisted tagging is used */
   vmk_uint16              hwVlanTci;
   vmk_Bool                isCso;
   vmk_Bool                isEncapCso;
 
+  /* Datapath counters, only written under the TXQ lock through
+   * sfvmk_txqStatsAdd, sfvmk_txqBurstPublish or an explicit statsLock
+   * write section, kept on their own cache lines */
+  vmk_VersionedAtomic     statsLock VMK_ATTRIBUTE_L1_ALIGNED;
+  vmk_uint64              stats[SFVMK_TXQ_MAX_STATS];
+  /* Doorbell to completion latency of sampled packets */
+  vmk_uint64              latHist[SFVMK_LAT_HIST_BUCKETS];
+  vmk_uint32              latSampleCount;
+  /* Descriptors in flight, feeds the SFVMK_TXQ_RING_* counters */
+  sfvmk_ringLevel_t       ringLevel;
+  /* Timer cycles when the uplink queue was stopped, 0 if running */
+  vmk_uint64              stopCycles;
+  /* Datapath profiler, only the TX stages are used */
+  sfvmk_profStage_t       prof[SFVMK_MGMT_PROF_MAX_STAGES];
+  /* Flows sampled for aRFS since the last scan, arfsLearn is set by
+   * the scan on the TXQs whose flows can be steered */
+  vmk_Bool                arfsLearn;
+  vmk_uint32              arfsSampleCount;
+  vmk_uint32              numArfsLearnt;
+  sfvmk_arfsSample_t      arfsLearnt[SFVMK_ARFS_LEARN_SLOTS];
+
   /* The following fields change more often and are read regularly
    * on the transmit and transmit completion path */
   vmk_uint32              pending VMK_ATTRIBUTE_L1_ALIGNED;
@@ -404,26 +572,10 @@ typedef struct sfvmk_rxSwDesc_s {
   vmk_int32      size;
   vmk_PktHandle  *pPkt;
   vmk_IOA        ioAddr;
+  /* Timer cycles at RX event if the packet is sampled for latency */
+  vmk_uint64     evTime;
 } sfvmk_rxSwDesc_t;
 
-/* Rx Queue statistics */
-typedef enum sfvmk_rxqStats_e {
-  SFVMK_RXQ_PKTS = 0,
-  SFVMK_RXQ_BYTES,
-  SFVMK_RXQ_INVALID_DESC,
-  SFVMK_RXQ_INVALID_PKT_BUFFER,
-  SFVMK_RXQ_DMA_UNMAP_FAILED,
-  SFVMK_RXQ_PSEUDO_HDR_PKT_LEN_FAILED,
-  SFVMK_RXQ_PKT_HEAD_ROOM_FAILED,
-  SFVMK_RXQ_PKT_FRAME_MAPPED_PTR_FAILED,
-  SFVMK_RXQ_INVALID_BUFFER_DESC,
-  SFVMK_RXQ_INVALID_FRAME_SZ,
-  SFVMK_RXQ_INVALID_PROTO,
-  SFVMK_RXQ_DISCARD,
-  SFVMK_RXQ_RSS_HASH_FAILED,
-  SFVMK_RXQ_MAX_STATS
-} sfvmk_rxqStats_t;
-
 static const char * const pSfvmkRxqStatsName[] = {
   "rx_packets",
   "rx_bytes",
@@ -438,9 +590,33 @@ static const char * const pSfvmkRxqStatsName[] = {
   "rx_invalid_proto",
   "rx_discard",
   "rx_rsshash_failed",
+  "rx_ring_level_us",
+  "rx_ring_time_us",
+  "rx_ring_level_hwm",
+  "rx_ring_empty_us",
   "rx_max_stats"
 };
 
+/* Count-min sketch dimensions of the RX heavy hitter sampler */
+#define SFVMK_FLOW_SKETCH_DEPTH       4
+#define SFVMK_FLOW_SKETCH_WIDTH_SHIFT 8
+#define SFVMK_FLOW_SKETCH_WIDTH       (1 << SFVMK_FLOW_SKETCH_WIDTH_SHIFT)
+
+typedef struct sfvmk_flowSketchCell_s {
+  vmk_uint64  pkts;
+  vmk_uint64  bytes;
+} sfvmk_flowSketchCell_t;
+
+/* Per RXQ heavy hitter sketch keyed on the RSS hash, written only from
+ * sfvmk_rxqComplete inside the RXQ stats write section */
+typedef struct sfvmk_flowSketch_s {
+  sfvmk_flowSketchCell_t  cells[SFVMK_FLOW_SKETCH_DEPTH][SFVMK_FLOW_SKETCH_WIDTH];
+  /* Top K flows by bytes and index of the smallest of them */
+  sfvmk_flowTopEntry_t    top[SFVMK_FLOW_TOP_K];
+  vmk_uint32              numTop;
+  vmk_uint32              minTop;
+} sfvmk_flowSketch_t;
+
 typedef enum sfvmk_rxqState_e {
   SFVMK_RXQ_STATE_UNINITIALIZED = 0,
   SFVMK_RXQ_STATE_INITIALIZED,
@@ -465,18 +641,125 @@ typedef struct sfvmk_rxq_s {
   vmk_uint32              completed;
   vmk_uint32              refillThreshold;
   vmk_uint32              refillDelay;
-  vmk_uint64              stats[SFVMK_RXQ_MAX_STATS];
   sfvmk_rxSwDesc_t        *pQueue;
+
+  /* Datapath counters, only written from sfvmk_rxqComplete and
+   * sfvmk_rxqFill and kept on their own cache lines */
+  vmk_VersionedAtomic     statsLock VMK_ATTRIBUTE_L1_ALIGNED;
+  vmk_uint64              stats[SFVMK_RXQ_MAX_STATS];
+  /* RX event to delivery latency of sampled packets */
+  vmk_uint64              latHist[SFVMK_LAT_HIST_BUCKETS];
+  vmk_uint32              latSampleCount;
+  /* Buffers owned by the NIC, feeds the SFVMK_RXQ_RING_* counters */
+  sfvmk_ringLevel_t       ringLevel;
+  /* Heavy hitter sketch, NULL unless rxFlowSketch is set */
+  sfvmk_flowSketch_t      *pFlowSketch;
+  /* Bytes received per RSS indirection table bucket, only counted on
+   * RSS queues while the RSS balancer is enabled */
+  vmk_uint64              rssBucketBytes[EFX_RSS_TBL_SIZE];
+  /* Datapath profiler, only the RXQ stages are used */
+  sfvmk_profStage_t       prof[SFVMK_MGMT_PROF_MAX_STAGES];
 } sfvmk_rxq_t;
 
+/* RSS balancer decision counters */
+typedef enum sfvmk_rssBalanceStats_e {
+  SFVMK_RSS_BALANCE_CHECKS = 0,
+  SFVMK_RSS_BALANCE_IMBALANCED,
+  SFVMK_RSS_BALANCE_REBALANCES,
+  SFVMK_RSS_BALANCE_BUCKETS_MOVED,
+  SFVMK_RSS_BALANCE_TBL_SET_FAILED,
+  SFVMK_RSS_BALANCE_HOST_UPDATES,
+  SFVMK_RSS_BALANCE_IMBALANCE_PCT,
+  SFVMK_RSS_BALANCE_MAX_STATS
+} sfvmk_rssBalanceStats_t;
+
+static const char * const pSfvmkRssBalanceStatsName[] = {
+  "rss_balance_checks",
+  "rss_balance_imbalanced",
+  "rss_balance_rebalances",
+  "rss_balance_buckets_moved",
+  "rss_balance_tbl_set_failed",
+  "rss_balance_host_updates",
+  "rss_balance_imbalance_pct",
+  "rss_balance_max_stats"
+};
+
+/* RSS balancer state, protected by the adapter lock */
+typedef struct sfvmk_rssBalance_s {
+  /* Check period in msec, 0 when the balancer is disabled */
+  vmk_uint32  intervalMs;
+  /* Hottest queue load over the mean load, in percent, that
+   * triggers a rebalance */
+  vmk_uint32  thresholdPct;
+  /* Non-zero while a check is queued on the helper */
+  vmk_atomic64 pending;
+  /* The vmkernel updated its indirection table since RSS init, so it
+   * balances the RSS queues itself and the balancer stands down */
+  vmk_Bool    hostActive;
+  /* table is programmed on the NIC in place of the vmkernel table */
+  vmk_Bool    driverTable;
+  /* Time in usec of the last check, 0 before the first one */
+  vmk_uint64  lastTime;
+  /* numRSSQs rows of EFX_RSS_TBL_SIZE counters, allocated by
+   * sfvmk_rxInit when the balancer is enabled */
+  vmk_uint64  *pPrevBucketBytes;
+  vmk_uint64  prevPkts[SFVMK_MAX_RSSQ_COUNT];
+  vmk_uint64  prevBytes[SFVMK_MAX_RSSQ_COUNT];
+  /* Per RSS queue rates over the last interval */
+  vmk_uint64  pktRate[SFVMK_MAX_RSSQ_COUNT];
+  vmk_uint64  byteRate[SFVMK_MAX_RSSQ_COUNT];
+  /* Scratch space of sfvmk_rssBalanceCheck */
+  vmk_uint64  bucketBytes[EFX_RSS_TBL_SIZE];
+  vmk_uint64  bucketLoad[EFX_RSS_TBL_SIZE];
+  vmk_uint64  queueLoad[SFVMK_MAX_RSSQ_COUNT];
+  vmk_uint32  newTable[EFX_RSS_TBL_SIZE];
+  /* Last table programmed by the balancer, kept apart from the vmkernel
+   * table in sfvmk_adapter_t */
+  vmk_uint32  table[EFX_RSS_TBL_SIZE];
+  vmk_uint64  stats[SFVMK_RSS_BALANCE_MAX_STATS];
+} sfvmk_rssBalance_t;
+
 /* Estimate length of hardware queues stats buffer and MAC stats buffer */
 #define SFVMK_STATS_ENTRY_LEN     60
 #define SFVMK_MAC_STATS_BUF_LEN   (EFX_MAC_NSTATS * SFVMK_STATS_ENTRY_LEN)
-#define SFVMK_QUEUE_STATS_BUF_LEN (((SFVMK_MAX_TXQ * SFVMK_TXQ_MAX_STATS)  + \
-                                    (SFVMK_MAX_RXQ * SFVMK_RXQ_MAX_STATS)) * \
+/* Length of the queue stats text for the given queue counts */
+#define SFVMK_QUEUE_STATS_LEN(numTxq, numRxq, numEvq, numRssq)               \
+                                  ((((numTxq) * SFVMK_TXQ_MAX_STATS)  +      \
+                                    ((numRxq) * SFVMK_RXQ_MAX_STATS)  +      \
+                                    ((numEvq) * SFVMK_EVQ_MAX_STATS)  +      \
+                                    SFVMK_RSS_BALANCE_MAX_STATS +            \
+                                    SFVMK_FILTER_MAX_STATS +                 \
+                                    SFVMK_FILTER_CLASS_MAX + 1 +             \
+                                    SFVMK_ARFS_MAX_STATS + 1 +               \
+                                    (2 * (numRssq))) *                       \
                                     SFVMK_STATS_ENTRY_LEN)
+#define SFVMK_QUEUE_STATS_BUF_LEN SFVMK_QUEUE_STATS_LEN(SFVMK_MAX_TXQ,       \
+                                                        SFVMK_MAX_RXQ,       \
+                                                        SFVMK_MAX_EVQ,       \
+                                                        SFVMK_MAX_RSSQ_COUNT)
 #define SFVMK_STATS_BUFFER_SZ     (SFVMK_QUEUE_STATS_BUF_LEN + SFVMK_MAC_STATS_BUF_LEN)
+/* Length of the binary stats record: header, one section per MAC and
+ * hardware queue, one latency section per RXQ and TXQ and one counter
+ * entry per stat */
+#define SFVMK_STATS_BIN_LEN(numTxq, numRxq, numEvq)                           \
+                                  (sizeof(sfvmk_statsBinHdr_t) +             \
+                                   ((1 + (2 * (numRxq)) +                     \
+                                     (2 * (numTxq)) + (numEvq)) *             \
+                                    sizeof(sfvmk_statsBinSection_t)) +        \
+                                   ((EFX_MAC_NSTATS +                         \
+                                     ((numRxq) * SFVMK_RXQ_MAX_STATS) +       \
+                                     ((numTxq) * SFVMK_TXQ_MAX_STATS) +       \
+                                     ((numEvq) * SFVMK_EVQ_MAX_STATS) +       \
+                                     (((numRxq) + (numTxq)) *                 \
+                                      SFVMK_LAT_HIST_BUCKETS)) *              \
+                                    sizeof(sfvmk_statsBinCounter_t)))
+#define SFVMK_STATS_BIN_BUFFER_SZ SFVMK_STATS_BIN_LEN(SFVMK_MAX_TXQ,         \
+                                                      SFVMK_MAX_RXQ,         \
+                                                      SFVMK_MAX_EVQ)
 #define SFVMK_STATS_UPDATE_WAIT_USEC  VMK_USEC_PER_MSEC
+/* Firmware DMAs the MAC stats every second, a snapshot older than this
+ * means the DMA completion events went missing */
+#define SFVMK_MAC_STATS_MAX_AGE_USEC  (2 * VMK_USEC_PER_SEC)
 
 /* Data structure for filter database entry
 ** Note:
@@ -488,8 +771,225 @@ typedef struct sfvmk_filterDBEntry_s {
   vmk_uint32                 qID;
   vmk_uint8                  numHwFilter;
   efx_filter_spec_t          spec[SFMK_MAX_HWF_PER_UPF];
+  /* Canonical hash of class and specs, links entries in the spec index */
+  vmk_uint32                 specHash;
+  vmk_Bool                   specIndexed;
+  struct sfvmk_filterDBEntry_s *pSpecNext;
+  /* Management steering rule ID, 0 for uplink and aRFS filters */
+  vmk_uint32                 ruleId;
+  /* Replayed after a driver reset, until the vmkernel applies it again */
+  vmk_Bool                   replayed;
 } sfvmk_filterDBEntry_t;
 
+/* Slots for filters removed by the vmkernel during a rebalance. Their HW
+ * filters are kept until the rebalance ends in case the match is applied
+ * to another queue, then all removed in one batch */
+#define SFVMK_FILTER_PARK_MAX         SFVMK_FILTER_BATCH_MAX
+/* A rebalance ends once the vmkernel issued no filter operation for
+ * SFVMK_FILTER_REBALANCE_MS. The NetQueue load balancer issues the remove
+ * and apply callbacks of one pass back to back, a few ms apart at most when
+ * queues are also being allocated or freed; a wider window would only keep
+ * parked filters installed longer */
+#define SFVMK_FILTER_REBALANCE_MS     20
+
+typedef struct sfvmk_filterParked_s {
+  sfvmk_filterDBEntry_t      entry;
+  /* Time in usec the entry was parked, 0 when the slot is free */
+  vmk_uint64                 parkTime;
+} sfvmk_filterParked_t;
+
+/* Uplink filter classes accounted by the filter resource manager */
+typedef enum sfvmk_filterClassIdx_e {
+  SFVMK_FILTER_CLASS_MAC = 0,
+  SFVMK_FILTER_CLASS_VLANMAC,
+  SFVMK_FILTER_CLASS_VXLAN,
+  SFVMK_FILTER_CLASS_GENEVE,
+  SFVMK_FILTER_CLASS_ARFS,
+  SFVMK_FILTER_CLASS_MGMT,
+  SFVMK_FILTER_CLASS_OTHER,
+  SFVMK_FILTER_CLASS_MAX
+} sfvmk_filterClassIdx_t;
+
+static const char * const pSfvmkFilterClassName[] = {
+  "mac",
+  "vlanmac",
+  "vxlan",
+  "geneve",
+  "arfs",
+  "mgmt",
+  "other",
+  "max"
+};
+
+/* HW filter slot usage of live and parked filter DB entries,
+ * protected by the adapter lock */
+typedef struct sfvmk_filterRes_s {
+  vmk_uint32                 hwInUse;
+  vmk_uint32                 classFilters[SFVMK_FILTER_CLASS_MAX];
+  vmk_uint32                 classHwFilters[SFVMK_FILTER_CLASS_MAX];
+} sfvmk_filterRes_t;
+
+/* Filter DB entry operations that can be queued in a batch */
+typedef enum sfvmk_filterOpType_e {
+  SFVMK_FILTER_OP_INSERT = 0,
+  SFVMK_FILTER_OP_REMOVE
+} sfvmk_filterOpType_t;
+
+/* Max number of filter DB entries in one batch */
+#define SFVMK_FILTER_BATCH_MAX        32
+
+typedef struct sfvmk_filterOp_s {
+  sfvmk_filterOpType_t       type;
+  sfvmk_filterDBEntry_t      *pFdbEntry;
+} sfvmk_filterOp_t;
+
+/* Filter operations issued back to back by sfvmk_filterBatchCommit,
+ * all of them are rolled back if any hardware filter operation fails */
+typedef struct sfvmk_filterBatch_s {
+  vmk_uint32                 numOps;
+  sfvmk_filterOp_t           ops[SFVMK_FILTER_BATCH_MAX];
+} sfvmk_filterBatch_t;
+
+/* Burst of NetQueue filter operations of one vmkernel rebalance,
+ * protected by the adapter lock */
+typedef struct sfvmk_filterRebalance_s {
+  vmk_Bool                   inProgress;
+  /* Time in usec of the first and of the latest filter operation */
+  vmk_uint64                 startTime;
+  vmk_uint64                 lastOpTime;
+  vmk_uint32                 numOps;
+  /* SFVMK_FILTER_BATCH_COMMITS when the rebalance started */
+  vmk_uint64                 startCommits;
+} sfvmk_filterRebalance_t;
+
+/* aRFS flow table entry */
+typedef struct sfvmk_arfsFlow_s {
+  sfvmk_arfsFlowKey_t        key;
+  /* Time in usec the flow was last sampled, 0 when the entry is free */
+  vmk_uint64                 lastSeen;
+  /* RSS RXQ the flow is steered to, its EVQ interrupt is delivered on
+   * the PCPU the flow was last transmitted from */
+  vmk_uint32                 rxqIndex;
+  /* Installed filter, NULL until the insert budget allows it */
+  sfvmk_filterDBEntry_t      *pFdbEntry;
+} sfvmk_arfsFlow_t;
+
+typedef enum sfvmk_arfsStats_e {
+  SFVMK_ARFS_LEARNT = 0,
+  SFVMK_ARFS_STEERED,
+  SFVMK_ARFS_MOVED,
+  SFVMK_ARFS_EXPIRED,
+  SFVMK_ARFS_EVICTED,
+  SFVMK_ARFS_RATE_LIMITED,
+  SFVMK_ARFS_STEER_FAILED,
+  SFVMK_ARFS_MAX_STATS
+} sfvmk_arfsStats_t;
+
+static const char * const pSfvmkArfsStatsName[] = {
+  "arfs_learnt",
+  "arfs_steered",
+  "arfs_moved",
+  "arfs_expired",
+  "arfs_evicted",
+  "arfs_rate_limited",
+  "arfs_steer_failed",
+  "arfs_max_stats"
+};
+
+/* aRFS engine state, protected by the adapter lock */
+typedef struct sfvmk_arfs_s {
+  /* Flow table size, 0 when aRFS is disabled */
+  vmk_uint32                 maxFlows;
+  vmk_uint32                 numFlows;
+  /* maxFlows entries in SFVMK_ARFS_WAYS way sets, allocated while
+   * the filter DB exists */
+  sfvmk_arfsFlow_t           *pFlows;
+  /* Non-zero while a scan is queued on the helper */
+  vmk_atomic64               pending;
+  vmk_uint64                 stats[SFVMK_ARFS_MAX_STATS];
+} sfvmk_arfs_t;
+
+/* Flow steering rule added through the management interface. The
+ * definition outlives the filter DB, the rule is installed again each
+ * time the adapter is started */
+typedef struct sfvmk_steerRule_s {
+  /* Rule as added, ruleId is 0 when the slot is free */
+  sfvmk_filterRuleInfo_t     info;
+  /* Installed filter, NULL while stopped or if the install failed */
+  sfvmk_filterDBEntry_t      *pFdbEntry;
+} sfvmk_steerRule_t;
+
+/* Exclusive RSS context owned by a NetQueue */
+typedef struct sfvmk_rssContext_s {
+  vmk_Bool                   inUse;
+  /* Uplink queue index of the owning NetQueue */
+  vmk_uint32                 qID;
+  vmk_uint32                 efxContext;
+} sfvmk_rssContext_t;
+
+/* Filter programming counters, protected by the adapter lock */
+typedef enum sfvmk_filterStats_e {
+  SFVMK_FILTER_BATCH_COMMITS = 0,
+  SFVMK_FILTER_BATCH_OPS,
+  SFVMK_FILTER_HW_OPS,
+  SFVMK_FILTER_BATCH_ROLLBACKS,
+  SFVMK_FILTER_ROLLBACK_FAILED,
+  SFVMK_FILTER_REBALANCES,
+  SFVMK_FILTER_REBALANCE_OPS,
+  SFVMK_FILTER_REBALANCE_COMMITS,
+  SFVMK_FILTER_REBALANCE_LAST_USEC,
+  SFVMK_FILTER_REBALANCE_MAX_USEC,
+  SFVMK_FILTER_REBALANCE_TOTAL_USEC,
+  SFVMK_FILTER_PARKED,
+  SFVMK_FILTER_PARK_FLUSHED,
+  SFVMK_FILTER_PARK_DEMOTED,
+  SFVMK_FILTER_PARK_FLUSH_FAILED,
+  SFVMK_FILTER_MOVES_ADOPTED,
+  SFVMK_FILTER_MOVES_REPLACED,
+  SFVMK_FILTER_MOVES_BATCHED,
+  SFVMK_FILTER_MOVE_WINDOW_USEC,
+  SFVMK_FILTER_NO_SPACE,
+  SFVMK_FILTER_REPLAYED,
+  SFVMK_FILTER_REPLAY_FAILED,
+  SFVMK_FILTER_REPLAY_USEC,
+  SFVMK_FILTER_REPLAY_ADOPTED,
+  SFVMK_FILTER_RESET_RESTART_USEC,
+  SFVMK_FILTER_RESET_DARK_USEC,
+  SFVMK_FILTER_RESET_DARK_MAX_USEC,
+  SFVMK_FILTER_MAX_STATS
+} sfvmk_filterStats_t;
+
+static const char * const pSfvmkFilterStatsName[] = {
+  "filter_batch_commits",
+  "filter_batch_ops",
+  "filter_hw_ops",
+  "filter_batch_rollbacks",
+  "filter_rollback_failed",
+  "filter_rebalances",
+  "filter_rebalance_ops",
+  "filter_rebalance_commits",
+  "filter_rebalance_last_usec",
+  "filter_rebalance_max_usec",
+  "filter_rebalance_total_usec",
+  "filter_parked",
+  "filter_park_flushed",
+  "filter_park_demoted",
+  "filter_park_flush_failed",
+  "filter_moves_adopted",
+  "filter_moves_replaced",
+  "filter_moves_batched",
+  "filter_move_window_usec",
+  "filter_no_space",
+  "filter_replayed",
+  "filter_replay_failed",
+  "filter_replay_usec",
+  "filter_replay_adopted",
+  "reset_io_restart_usec",
+  "reset_dark_usec",
+  "reset_dark_max_usec",
+  "filter_max_stats"
+};
+
 typedef struct sfvmk_uplink_s {
   /* Structure advertising a mode (speed/duplex/media) that is supported by an uplink. */
   vmk_UplinkSupportedMode    supportedModes[EFX_PHY_CAP_NTYPES];
@@ -722,6 +1222,10 @@ typedef struct sfvmk_adapter_s {
   vmk_uint32                 numEvqsAllocated;
   vmk_uint32                 numEvqsDesired;
   vmk_uint32                 numEvqsAllotted;
+  /* Dedicated TX EVQs, placed after all EVQs with an RXQ */
+  vmk_uint32                 numTxEvqs;
+  /* Max number of TXQs completing on a dedicated TX EVQ */
+  vmk_uint32                 txqsPerEvq;
   vmk_uint32                 numTxqsAllotted;
   vmk_uint32                 numRxqsAllotted;
   vmk_uint32                 numRSSQs;
@@ -749,6 +1253,16 @@ typedef struct sfvmk_adapter_s {
   size_t                     rxMaxFrameSize;
   vmk_uint8                  rssHashKey[SFVMK_RSS_HASH_KEY_SIZE];
   vmk_uint32                 rssIndTable[EFX_RSS_TBL_SIZE];
+  /* Entries of rssIndTable in use, the NIC repeats them over its table */
+  vmk_uint32                 rssIndTableSize;
+  /* SFVMK_RSS_HASH_* fields requested and fields programmed in the NIC */
+  vmk_uint32                 rssHashFields;
+  vmk_uint32                 rssHashActive;
+  /* NetQueue RSS contexts, rssCtxMax of them have HW queues set aside
+   * after the vmkernel RSS queues */
+  sfvmk_rssContext_t         rssCtx[SFVMK_MAX_RSS_CONTEXTS];
+  vmk_uint32                 rssCtxMax;
+  sfvmk_rssBalance_t         rssBalance;
 
   sfvmk_port_t               port;
 
@@ -764,15 +1278,50 @@ typedef struct sfvmk_adapter_s {
   sfvmk_pktOps_t             pktOps[SFVMK_PKT_COMPLETION_MAX];
   vmk_uint32                 txDmaDescMaxSize;
 
-  /* The number of tx packets dropped */
-  vmk_atomic64               txDrops;
+  /* Latency sampling period in packets per queue, power of 2, 0 when
+   * latency sampling is off */
+  vmk_uint32                 latSampleRate;
+  vmk_uint64                 timerCyclesPerUSec;
+  /* Per stage datapath cycle accounting, see sfvmk_profStart */
+  vmk_Bool                   dpProfile;
+
+  /* The number of tx packets dropped before a TXQ was identified, drops
+   * on a TXQ are counted in its SFVMK_TXQ_DISCARD counter */
+  vmk_atomic64               txDropsNoQueue;
 
   /* Filter Database hash table and key generator */
   vmk_HashTable              filterDBHashTable;
   vmk_uint32                 filterKey;
+  /* Filter DB entries chained by spec hash for duplicate detection */
+  sfvmk_filterDBEntry_t      *pFilterSpecIndex[SFVMK_FILTER_SPEC_BUCKETS];
+  sfvmk_filterParked_t       filterParked[SFVMK_FILTER_PARK_MAX];
+  sfvmk_filterRebalance_t    filterRebalance;
+  /* Non-zero while the end of a filter rebalance is queued on the helper */
+  vmk_atomic64               filterRebalancePending;
+  vmk_uint64                 filterStats[SFVMK_FILTER_MAX_STATS];
+  sfvmk_filterRes_t          filterRes;
+  sfvmk_arfs_t               arfs;
+  /* Set by the reset helper, quiesce keeps the filter DB for replay */
+  vmk_Bool                   filterReplay;
+  /* Filter DB kept over a reset, its HW filters are gone */
+  vmk_Bool                   filterDBKept;
+  /* Time in usec the pending driver reset was requested, 0 if none */
+  vmk_atomic64               resetStartTime;
+  /* IO restarted after a driver reset, next link up ends the outage */
+  vmk_Bool                   resetIOStarted;
+  /* Management steering rules, protected by the adapter lock */
+  sfvmk_steerRule_t          steerRules[SFVMK_MGMT_FILTER_RULE_MAX];
+  vmk_uint32                 steerRuleId;
+  /* RXQ kept out of the NetQueue pool for storage rules, 0 if none */
+  vmk_Bool                   storageRxqEnabled;
+  vmk_uint32                 storageRxq;
 
   /* MAC stats copy */
   efsys_stat_t               adapterStats[EFX_MAC_NSTATS];
+  /* MAC stats copy for lockless readers, see SFVMK_MAC_STATS_BEGIN_READ */
+  efsys_stat_t               adapterStatsSnapshot[EFX_MAC_NSTATS];
+  /* Copy of the snapshot formatted by sfvmk_fillMacStats, adapter lock */
+  efsys_stat_t               macStatsCopy[EFX_MAC_NSTATS];
 
   vmk_Bool                   isRxCsumEnabled;
   vmk_Bool                   isTsoFwAssisted;
@@ -865,6 +1414,9 @@ void *sfvmk_allocDMAMappedMem(vmk_DMAEngine dmaEngine, size_t size,
 
 vmk_uint32 sfvmk_pow2GE(vmk_uint32 value);
 
+void sfvmk_latHistRecord(sfvmk_adapter_t *pAdapter, vmk_uint64 *pHist,
+                         vmk_uint64 startTime, vmk_uint64 endTime);
+
 VMK_ReturnStatus
 sfvmk_createHelper(sfvmk_adapter_t *pAdapter, char *pHelperName,
                    vmk_Helper *pHelper);
@@ -899,9 +1451,17 @@ void sfvmk_evFini(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_evStart(sfvmk_adapter_t *pAdapter);
 void sfvmk_evStop(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_evqPoll(sfvmk_evq_t *pEvq, vmk_Bool panic);
+void sfvmk_evqLock(sfvmk_evq_t *pEvq);
+void sfvmk_evqUnlock(sfvmk_evq_t *pEvq);
 VMK_ReturnStatus sfvmk_evqModerate(sfvmk_adapter_t *pAdapter,
                                    unsigned int qIndex,
                                    unsigned int uSec);
+VMK_ReturnStatus sfvmk_evqTypeSet(sfvmk_adapter_t *pAdapter,
+                                  vmk_uint32 qIndex,
+                                  sfvmk_evqType_t evqType);
+VMK_ReturnStatus sfvmk_evqTypeGet(sfvmk_adapter_t *pAdapter,
+                                  vmk_uint32 qIndex,
+                                  sfvmk_evqType_t *pEvqType);
 
 /* Functions for port module handling */
 VMK_ReturnStatus sfvmk_portInit(sfvmk_adapter_t *pAdapter);
@@ -912,6 +1472,9 @@ void sfvmk_macLinkUpdate(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_scheduleLinkUpdate(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_phyLinkSpeedSet(sfvmk_adapter_t *pAdapter, vmk_LinkSpeed speed);
 VMK_ReturnStatus sfvmk_macStatsUpdate(sfvmk_adapter_t *pAdapter);
+VMK_ReturnStatus sfvmk_scheduleMacStatsUpdate(sfvmk_adapter_t *pAdapter);
+void sfvmk_macStatsSnapshotCheck(sfvmk_adapter_t *pAdapter,
+                                 vmk_uint64 snapshotTime);
 void sfvmk_linkStateGet(sfvmk_adapter_t *pAdapter, vmk_LinkState *pLinkState);
 void sfvmk_phyLinkSpeedGet(sfvmk_adapter_t *pAdapter, vmk_LinkSpeed *pSpeed,
                            vmk_Bool *pAutoNeg);
@@ -934,9 +1497,12 @@ VMK_ReturnStatus sfvmk_txInit(sfvmk_adapter_t *pAdapter);
 void sfvmk_txFini(sfvmk_adapter_t *pAdapter);
 void sfvmk_txStop(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_txStart(sfvmk_adapter_t *pAdapter);
+VMK_ReturnStatus sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex);
+VMK_ReturnStatus sfvmk_txqStop(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex);
 VMK_ReturnStatus sfvmk_txqFlushDone(sfvmk_txq_t *pTxq);
 vmk_Bool sfvmk_isTxqStopped(sfvmk_adapter_t *pAdapter, vmk_uint32 txqIndex);
 VMK_ReturnStatus sfvmk_transmitPkt(sfvmk_txq_t *pTxq, vmk_PktHandle *pkt);
+void sfvmk_txqArfsLearn(sfvmk_txq_t *pTxq, vmk_PktHandle *pkt);
 void sfvmk_txqReap(sfvmk_txq_t *pTxq);
 void sfvmk_txqComplete(sfvmk_txq_t *pTxq, sfvmk_evq_t *pEvq,
                        sfvmk_pktCompCtx_t *pCompCtx);
@@ -946,14 +1512,28 @@ VMK_ReturnStatus sfvmk_rxInit(sfvmk_adapter_t *pAdapter);
 void sfvmk_rxFini(sfvmk_adapter_t *pAdapter);
 void sfvmk_rxStop(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_rxStart(sfvmk_adapter_t *pAdapter);
+VMK_ReturnStatus sfvmk_rxqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex);
+VMK_ReturnStatus sfvmk_rxqStop(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex);
 VMK_ReturnStatus sfvmk_setRxqFlushState(sfvmk_rxq_t *pRxq, sfvmk_flushState_t flushState);
 void sfvmk_rxqFill(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx);
 void sfvmk_rxqComplete(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx);
+void sfvmk_rssBalanceSchedule(sfvmk_adapter_t *pAdapter);
+VMK_ReturnStatus sfvmk_rxqFlowTopGet(sfvmk_adapter_t *pAdapter,
+                                     vmk_uint32 qIndex,
+                                     vmk_Bool reset,
+                                     sfvmk_flowTopEntry_t *pEntries,
+                                     vmk_uint32 *pNumEntries);
 VMK_ReturnStatus sfvmk_configRSS(sfvmk_adapter_t *pAdapter,
                                  vmk_uint8 *pKey,
                                  vmk_uint32 keySize,
                                  vmk_uint32 *pIndTable,
                                  vmk_uint32 indTableSize);
+VMK_ReturnStatus sfvmk_rssContextGet(sfvmk_adapter_t *pAdapter,
+                                     vmk_uint32 qID,
+                                     vmk_uint32 *pEfxContext,
+                                     vmk_uint32 *pRxqStart);
+void sfvmk_rssContextPut(sfvmk_adapter_t *pAdapter, vmk_uint32 qID);
+void sfvmk_rssContextFreeAll(sfvmk_adapter_t *pAdapter);
 
 /*! \brief disable RSS by making numRSSQs as 0  in adapter data structure
 **
@@ -979,6 +1559,67 @@ static inline vmk_Bool sfvmk_isRSSEnable(sfvmk_adapter_t *pAdapter)
   return (pAdapter->numRSSQs > 0) ;
 }
 
+/*! \brief Check if a NetQueue is spread by an exclusive RSS
+**        context of its own
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+** \param[in]  qID       uplink queue index
+**
+** \return: VMK_TRUE if the NetQueue owns an RSS context VMK_FALSE otherwise
+*/
+static inline vmk_Bool sfvmk_isNetqRss(sfvmk_adapter_t *pAdapter,
+                                       vmk_uint32 qID)
+{
+  vmk_uint32 i;
+
+  for (i = 0; i < pAdapter->rssCtxMax; i++) {
+    if (pAdapter->rssCtx[i].inUse && (pAdapter->rssCtx[i].qID == qID))
+      return VMK_TRUE;
+  }
+
+  return VMK_FALSE;
+}
+
+/*! \brief Check if a RXQ is the dedicated storage queue
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+** \param[in]  qIndex    RXQ index
+**
+** \return: VMK_TRUE if the RXQ is reserved for storage rules VMK_FALSE otherwise
+*/
+static inline vmk_Bool sfvmk_isStorageRxq(sfvmk_adapter_t *pAdapter,
+                                          vmk_uint32 qIndex)
+{
+  return ((pAdapter->storageRxq != 0) && (qIndex == pAdapter->storageRxq));
+}
+
+/*! \brief Length of the text stats of an adapter, MAC and queues
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+**
+** \return: buffer length in bytes
+*/
+static inline vmk_ByteCount sfvmk_statsBufferSize(sfvmk_adapter_t *pAdapter)
+{
+  return SFVMK_QUEUE_STATS_LEN(pAdapter->numTxqsAllocated,
+                               pAdapter->numRxqsAllocated,
+                               pAdapter->numEvqsAllocated,
+                               pAdapter->numRSSQs) + SFVMK_MAC_STATS_BUF_LEN;
+}
+
+/*! \brief Length of the binary stats record of an adapter
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+**
+** \return: buffer length in bytes
+*/
+static inline vmk_ByteCount sfvmk_statsBinBufferSize(sfvmk_adapter_t *pAdapter)
+{
+  return SFVMK_STATS_BIN_LEN(pAdapter->numTxqsAllocated,
+                             pAdapter->numRxqsAllocated,
+                             pAdapter->numEvqsAllocated);
+}
+
 /*! \brief Get RSS start queue index in the HW Queue structures
 **
 ** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
@@ -992,6 +1633,50 @@ static inline vmk_uint32 sfvmk_getRSSQStartIndex(sfvmk_adapter_t *pAdapter)
   return pAdapter->numNetQs + 1;
 }
 
+/*! \brief Get the first HW queue of a NetQueue RSS context. Contexts
+**         follow the vmkernel RSS queues, numRSSQs HW queues each
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+** \param[in]  ctxIndex  index of the context in rssCtx
+**
+** \return:  start queue index of the context
+*/
+static inline vmk_uint32
+sfvmk_getRssCtxQStartIndex(sfvmk_adapter_t *pAdapter, vmk_uint32 ctxIndex)
+{
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  return sfvmk_getRSSQStartIndex(pAdapter) +
+         (pAdapter->numRSSQs * (ctxIndex + 1));
+}
+
+/*! \brief Get the number of HW queues receiving RSS spread traffic, the
+**         vmkernel RSS queues and the queues of all NetQueue RSS contexts
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+**
+** \return:  number of RSS HW queues
+*/
+static inline vmk_uint32
+sfvmk_getNumRSSHwQs(sfvmk_adapter_t *pAdapter)
+{
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  return pAdapter->numRSSQs * (pAdapter->rssCtxMax + 1);
+}
+
+/*! \brief Get index of the first dedicated TX EVQ, which is also the
+**         number of EVQs with an associated RXQ
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
+**
+** \return: index of the first TX only EVQ
+*/
+static inline vmk_uint32
+sfvmk_getTxEvqStartIndex(sfvmk_adapter_t *pAdapter)
+{
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  return pAdapter->numEvqsAllocated - pAdapter->numTxEvqs;
+}
+
 /*! \brief Get maximum Rx hardware queue number
 **
 ** \param[in]  pAdapter  pointer to sfvmk_adapter_t structure
@@ -1029,16 +1714,47 @@ VMK_ReturnStatus sfvmk_prepareFilterRule(sfvmk_adapter_t *pAdapter,
                                          vmk_uint32 filterKey, vmk_uint32 qidVal,
                                          efx_filter_flags_t flags);
 VMK_ReturnStatus sfvmk_insertFilterRule(sfvmk_adapter_t *pAdapter, sfvmk_filterDBEntry_t *pFdbEntry);
+sfvmk_filterDBEntry_t * sfvmk_filterReplayedAdopt(sfvmk_adapter_t *pAdapter,
+                                                  sfvmk_filterDBEntry_t *pFdbEntry);
 sfvmk_filterDBEntry_t * sfvmk_removeFilterRule(sfvmk_adapter_t *pAdapter, vmk_uint32 filterKey);
 void sfvmk_freeFilterRule(sfvmk_adapter_t *pAdapter, sfvmk_filterDBEntry_t *pFdbEntry);
+void sfvmk_filterBatchInit(sfvmk_filterBatch_t *pBatch);
+VMK_ReturnStatus sfvmk_filterBatchAdd(sfvmk_filterBatch_t *pBatch,
+                                      sfvmk_filterOpType_t type,
+                                      sfvmk_filterDBEntry_t *pFdbEntry);
+VMK_ReturnStatus sfvmk_filterBatchCommit(sfvmk_adapter_t *pAdapter,
+                                         sfvmk_filterBatch_t *pBatch);
+void sfvmk_filterRebalanceOpStart(sfvmk_adapter_t *pAdapter);
+void sfvmk_filterRebalanceOpDone(sfvmk_adapter_t *pAdapter);
+void sfvmk_filterRebalanceEnd(sfvmk_adapter_t *pAdapter);
+void sfvmk_filterParkedDrop(sfvmk_adapter_t *pAdapter,
+                            vmk_UplinkQueueFilter *pFilter);
+vmk_uint32 sfvmk_filterHwLimit(sfvmk_adapter_t *pAdapter);
+void sfvmk_arfsSchedule(sfvmk_adapter_t *pAdapter);
+void sfvmk_filterDBSuspend(sfvmk_adapter_t *pAdapter);
+void sfvmk_filterReplay(sfvmk_adapter_t *pAdapter);
+VMK_ReturnStatus sfvmk_steerRuleAdd(sfvmk_adapter_t *pAdapter,
+                                    sfvmk_filterRuleInfo_t *pInfo);
+VMK_ReturnStatus sfvmk_steerRuleDel(sfvmk_adapter_t *pAdapter,
+                                    vmk_uint32 ruleId);
+void sfvmk_steerRuleList(sfvmk_adapter_t *pAdapter,
+                         sfvmk_filterRuleReq_t *pRuleReq);
+void sfvmk_steerRulesRestore(sfvmk_adapter_t *pAdapter);
+void sfvmk_updateQueueFilterCapacity(sfvmk_adapter_t *pAdapter);
 
 VMK_ReturnStatus sfvmk_uplinkDataInit(sfvmk_adapter_t * pAdapter);
 void sfvmk_uplinkDataFini(sfvmk_adapter_t *pAdapter);
 void sfvmk_removeUplinkFilter(sfvmk_adapter_t *pAdapter, vmk_uint32 qidVal);
+void sfvmk_resetLinkUp(sfvmk_adapter_t *pAdapter);
+void sfvmk_dpProfileGet(sfvmk_adapter_t *pAdapter,
+                        sfvmk_profStageInfo_t *pStages);
+void sfvmk_dpProfileReset(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus sfvmk_requestQueueStats(sfvmk_adapter_t *pAdapter, char *pStart,
                                          vmk_ByteCount maxBytes, vmk_ByteCount *pBytesCopied);
 VMK_ReturnStatus sfvmk_requestMACStats(sfvmk_adapter_t *pAdapter, char *pStart, vmk_ByteCount maxBytes,
                                        vmk_ByteCount *pBytesCopied);
+VMK_ReturnStatus sfvmk_requestBinStats(sfvmk_adapter_t *pAdapter, vmk_uint8 *pStart,
+                                       vmk_ByteCount maxBytes, vmk_ByteCount *pBytesCopied);
 
 /* Functions for VPD read/write request handling */
 VMK_ReturnStatus sfvmk_vpdGetInfo(sfvmk_adapter_t *pAdapter, vmk_uint8 *pVpdData,
@@ -1063,6 +1779,142 @@ sfvmk_sharedAreaEndWrite(sfvmk_uplink_t *pUplink)
   vmk_SpinlockUnlock(pUplink->shareDataLock);
 }
 
+static inline void __attribute__((always_inline))
+sfvmk_txqLock(sfvmk_txq_t *pTxq)
+{
+  vmk_SpinlockLock(pTxq->lock);
+}
+
+static inline void __attribute__((always_inline))
+sfvmk_txqUnlock(sfvmk_txq_t *pTxq)
+{
+  vmk_SpinlockUnlock(pTxq->lock);
+}
+
+/* Add to a TXQ counter. Every writer of pTxq->stats holds the TXQ lock, so
+ * the lock holder owns the write side of pTxq->statsLock; the write section
+ * only brackets the update itself for lockless readers */
+static inline void __attribute__((always_inline))
+sfvmk_txqStatsAdd(sfvmk_txq_t *pTxq, sfvmk_txqStats_t idx, vmk_uint64 value)
+{
+  vmk_VersionedAtomicBeginWrite(&pTxq->statsLock);
+  pTxq->stats[idx] += value;
+  vmk_VersionedAtomicEndWrite(&pTxq->statsLock);
+}
+
+/* Decide whether the next packet of a queue is timestamped for latency */
+static inline vmk_Bool
+sfvmk_latSample(sfvmk_adapter_t *pAdapter, vmk_uint32 *pSampleCount)
+{
+  if (VMK_LIKELY(pAdapter->latSampleRate == 0))
+    return VMK_FALSE;
+
+  return ((++(*pSampleCount) & (pAdapter->latSampleRate - 1)) == 0);
+}
+
+/* Start timing a datapath stage, returns 0 when profiling is off */
+static inline vmk_uint64
+sfvmk_profStart(sfvmk_adapter_t *pAdapter)
+{
+  if (VMK_LIKELY(!pAdapter->dpProfile))
+    return 0;
+
+  return vmk_GetTimerCycles();
+}
+
+/* Account a datapath stage started with sfvmk_profStart. Must be called
+ * by the single writer of the queue owning pStage */
+static inline void
+sfvmk_profEnd(sfvmk_profStage_t *pStage, vmk_uint64 startCycles,
+              vmk_uint32 numPkts)
+{
+  if (VMK_LIKELY(startCycles == 0))
+    return;
+
+  pStage->cycles += vmk_GetTimerCycles() - startCycles;
+  pStage->calls++;
+  pStage->pkts += numPkts;
+}
+
+/* Account the time since the last update at the previous ring level
+ * and move to the new level. Time is accounted in whole micro seconds,
+ * the remainder is carried over to the next update. Must be called from
+ * within the queue's stats write section.
+ * Returns the micro seconds accounted at the previous level. */
+static inline vmk_uint64
+sfvmk_ringLevelUpdate(sfvmk_adapter_t *pAdapter, sfvmk_ringLevel_t *pRing,
+                      vmk_uint32 level, vmk_uint64 *pLevelUs,
+                      vmk_uint64 *pTimeUs, vmk_uint64 *pLevelHwm)
+{
+  vmk_uint64 elapsedUs;
+
+  elapsedUs = (vmk_GetTimerCycles() - pRing->lastCycles) /
+              pAdapter->timerCyclesPerUSec;
+  pRing->lastCycles += elapsedUs * pAdapter->timerCyclesPerUSec;
+
+  *pLevelUs += elapsedUs * pRing->level;
+  *pTimeUs += elapsedUs;
+  if (level > *pLevelHwm)
+    *pLevelHwm = level;
+
+  pRing->level = level;
+
+  return elapsedUs;
+}
+
+/* Move the TXQ ring level counters to the current level. Must be called
+ * from within the TXQ stats write section */
+static inline void
+sfvmk_txqLevelAccount(sfvmk_txq_t *pTxq)
+{
+  sfvmk_ringLevelUpdate(pTxq->pAdapter, &pTxq->ringLevel,
+                        pTxq->added - pTxq->completed,
+                        &pTxq->stats[SFVMK_TXQ_RING_LEVEL_US],
+                        &pTxq->stats[SFVMK_TXQ_RING_TIME_US],
+                        &pTxq->stats[SFVMK_TXQ_RING_LEVEL_HWM]);
+}
+
+/* Publish the counters of a transmit burst, accumulated by the TXQ lock
+ * holder, and the ring level in a single stats write section */
+static inline void
+sfvmk_txqBurstPublish(sfvmk_txq_t *pTxq, vmk_uint32 numPkts,
+                      vmk_uint32 numDiscard, vmk_uint32 numBusy)
+{
+  vmk_VersionedAtomicBeginWrite(&pTxq->statsLock);
+  pTxq->stats[SFVMK_TXQ_PKTS] += numPkts;
+  pTxq->stats[SFVMK_TXQ_BYTES] += pTxq->burstBytes;
+  pTxq->stats[SFVMK_TXQ_DISCARD] += numDiscard;
+  pTxq->stats[SFVMK_TXQ_QUEUE_BUSY] += numBusy;
+  sfvmk_txqLevelAccount(pTxq);
+  vmk_VersionedAtomicEndWrite(&pTxq->statsLock);
+
+  pTxq->burstBytes = 0;
+}
+
+/* Copy a queue's counters without stalling its datapath writer */
+static inline void
+sfvmk_queueStatsSnapshot(vmk_VersionedAtomic *pStatsLock,
+                         const vmk_uint64 *pStats,
+                         vmk_uint64 *pSnapshot,
+                         vmk_uint32 numStats)
+{
+  vmk_uint32 version;
+
+  do {
+    version = vmk_VersionedAtomicBeginTryRead(pStatsLock);
+    vmk_Memcpy(pSnapshot, pStats, numStats * sizeof(vmk_uint64));
+  } while (!vmk_VersionedAtomicEndTryRead(pStatsLock, version));
+}
+
+/* Copy the counters of an EVQ, the interrupt count included */
+static inline void
+sfvmk_evqStatsSnapshot(sfvmk_evq_t *pEvq, vmk_uint64 *pSnapshot)
+{
+  sfvmk_queueStatsSnapshot(&pEvq->statsLock, pEvq->stats, pSnapshot,
+                           SFVMK_EVQ_MAX_STATS);
+  pSnapshot[SFVMK_EVQ_INTERRUPTS] = pEvq->intrCount;
+}
+
 /* Locking mechanism to serialize multiple readers to access sharedData area */
 #define SFVMK_SHARED_AREA_BEGIN_READ(adapter)                           \
   do {                                                                  \
@@ -1076,6 +1928,20 @@ sfvmk_sharedAreaEndWrite(sfvmk_uplink_t *pUplink)
                  (&adapter->uplink.sharedData.lock, sharedReadLockVer));\
   } while (VMK_FALSE)
 
+/* Lockless read of pAdapter->adapterStatsSnapshot. Snapshot is updated
+ * by sfvmk_macStatsUpdate, which is always called with adapter lock held */
+#define SFVMK_MAC_STATS_BEGIN_READ(adapter)                             \
+  do {                                                                  \
+    vmk_uint32 macStatsReadLockVer;                                     \
+    do {                                                                \
+      macStatsReadLockVer = vmk_VersionedAtomicBeginTryRead             \
+                              (&adapter->port.macStatsLock);
+
+#define SFVMK_MAC_STATS_END_READ(adapter)                               \
+    } while (!vmk_VersionedAtomicEndTryRead                             \
+                 (&adapter->port.macStatsLock, macStatsReadLockVer));   \
+  } while (VMK_FALSE)
+
 /*! \brief Get the start index of uplink TXQs in vmk_UplinkSharedQueueData array
 **
 ** \param[in]  pUplink  pointer to uplink structure
@@ -1172,6 +2038,42 @@ VMK_ReturnStatus sfvmk_removeBundleUpdateDisabledTag(sfvmk_adapter_t *pAdapter);
 VMK_ReturnStatus
 sfvmk_requestSensorData(sfvmk_adapter_t *pAdapter, char *pSensorBuf, vmk_ByteCount size, vmk_ByteCount *pBytesCopied);
 
+/* EFSYS probe trace ring, must be a power of 2 */
+#define SFVMK_TRACE_RING_ENTRIES    4096
+/* Max number of distinct probe sites whose names are remembered */
+#define SFVMK_TRACE_MAX_PROBES      256
+/* Max number of probe names or file:line sites enabled at once */
+#define SFVMK_TRACE_MAX_SPECS       32
+/* Records moved to user space per copy while draining */
+#define SFVMK_TRACE_DRAIN_CHUNK     64
+
+typedef struct sfvmk_trace_s {
+  /* Next ring slot to be written, claimed by the probes
+   * with an atomic increment so recording takes no lock */
+  vmk_atomic64            head;
+  /* Next ring slot to be drained, protected by sfvmk_modInfo.lock */
+  vmk_uint64              tail;
+  vmk_atomic64            numProbes;
+  /* Enabled probes, changed under sfvmk_modInfo.lock. Probe sites
+   * re-evaluate their enable state whenever enableGen moves */
+  vmk_Bool                allEnabled;
+  vmk_uint32              enableGen;
+  vmk_uint32              numSpecs;
+  char                    specs[SFVMK_TRACE_MAX_SPECS][SFVMK_TRACE_PROBE_NAME_LEN];
+  sfvmk_traceProbeName_t  probes[SFVMK_TRACE_MAX_PROBES];
+  sfvmk_traceRecord_t     ring[SFVMK_TRACE_RING_ENTRIES];
+} sfvmk_trace_t;
+
+VMK_ReturnStatus sfvmk_traceInit(void);
+void sfvmk_traceFini(void);
+VMK_ReturnStatus sfvmk_traceEnable(const char *pName, vmk_Bool enable);
+VMK_ReturnStatus
+sfvmk_traceDrain(vmk_uint64 userBuffer, vmk_uint32 size,
+                 vmk_uint32 *pBytesCopied, vmk_uint64 *pNumLost);
+VMK_ReturnStatus
+sfvmk_traceProbeNames(vmk_uint64 userBuffer, vmk_uint32 size,
+                      vmk_uint32 *pBytesCopied);
+
 #ifdef SFVMK_SUPPORT_SRIOV
 /* SR-IOV handlers */
 
@@ -55,6 +55,9 @@ static boolean_t sfvmk_evRX(void *arg, uint32_t label, uint32_t id,
 static boolean_t sfvmk_evTx(void *arg, uint32_t label, uint32_t id);
 static boolean_t sfvmk_evMonitor(void *arg, efx_mon_stat_t id,
                                        efx_mon_stat_value_t value);
+#if EFSYS_OPT_MAC_STATS
+static boolean_t sfvmk_evMacStats(void *arg, uint32_t generation);
+#endif
 
 static const efx_ev_callbacks_t sfvmk_evCallbacks = {
   .eec_tx = sfvmk_evTx,
@@ -69,6 +72,9 @@ static const efx_ev_callbacks_t sfvmk_evCallbacks = {
 #if EFSYS_OPT_MON_STATS
   .eec_monitor = sfvmk_evMonitor,
 #endif
+#if EFSYS_OPT_MAC_STATS
+  .eec_mac_stats = sfvmk_evMacStats,
+#endif
 };
 
 /*! \brief Called when a RX event received on eventQ
@@ -96,8 +102,6 @@ sfvmk_evRX(void *arg, uint32_t label, uint32_t id, uint32_t size, uint16_t flags
 
   VMK_ASSERT_NOT_NULL(pEvq);
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
-
   pAdapter = pEvq->pAdapter;
   VMK_ASSERT_NOT_NULL(pAdapter);
 
@@ -145,9 +149,15 @@ sfvmk_evRX(void *arg, uint32_t label, uint32_t id, uint32_t size, uint16_t flags
     pRxDesc->size = (uint16_t)size;
   }
 
+  /* Stamp the last descriptor of the event, delivered last */
+  if (sfvmk_latSample(pAdapter, &pRxq->latSampleCount))
+    pRxq->pQueue[(stop - 1) & pRxq->ptrMask].evTime = vmk_GetTimerCycles();
+
   pEvq->rxDone++;
   SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_EVQ, SFVMK_LOG_LEVEL_IO,
                          "pending %u, completed %u", pRxq->pending, pRxq->completed);
+  SFVMK_DATAPATH_TRACE3(sfvmk_ev_rx, pRxq->index, pRxq->pending,
+                        pRxq->completed);
 
   if (pRxq->pending - pRxq->completed >= SFVMK_RX_BATCH)
     sfvmk_evqComplete(pEvq);
@@ -184,28 +194,33 @@ sfvmk_evTx(void *arg, uint32_t label, uint32_t id)
   pEvq = (sfvmk_evq_t *)arg;
   VMK_ASSERT_NOT_NULL(pEvq);
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
   pAdapter = pEvq->pAdapter;
   VMK_ASSERT_NOT_NULL(pAdapter);
   VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
 
+  if (VMK_UNLIKELY(label >= pEvq->numTxqs)) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid TXQ label %u on EVQ[%u]",
+                        label, pEvq->index);
+    goto done;
+  }
+
+  pTxq = pEvq->pTxqs[label];
+  VMK_ASSERT_NOT_NULL(pTxq);
+
   /* Process only default transmit queue when system is in panic state */
   if (VMK_UNLIKELY(vmk_SystemCheckState(VMK_SYSTEM_STATE_PANIC) == VMK_TRUE) &&
-     (pEvq != pAdapter->ppEvq[0])) {
+     (pTxq != pAdapter->ppTxq[0])) {
     SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                            "System in panic state, returning");
     status = VMK_FALSE;
     goto done;
   }
 
-  pTxq = pAdapter->ppTxq[pEvq->index];
-  VMK_ASSERT_NOT_NULL(pTxq);
-
-  vmk_SpinlockLock(pTxq->lock);
+  sfvmk_txqLock(pTxq);
 
   if (VMK_UNLIKELY(pTxq->state != SFVMK_TXQ_STATE_STARTED)) {
     SFVMK_ADAPTER_ERROR(pAdapter, "Invalid TXQ state[%d]", pTxq->state);
-    vmk_SpinlockUnlock(pTxq->lock);
+    sfvmk_txqUnlock(pTxq);
     goto done;
   }
 
@@ -226,7 +241,7 @@ sfvmk_evTx(void *arg, uint32_t label, uint32_t id)
     compCtx.netPoll = pEvq->netPoll;
     sfvmk_txqComplete(pTxq, pEvq, &compCtx);
   }
-  vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_txqUnlock(pTxq);
 
   status = (pEvq->txDone >= pEvq->txBudget);
 
@@ -251,8 +266,6 @@ sfvmk_evInitialized(void *arg)
     goto fail;
   }
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
-
   if (pEvq->state != SFVMK_EVQ_STATE_STARTING) {
     SFVMK_ADAPTER_ERROR(pEvq->pAdapter, "Invalid EVQ state(%u)", pEvq->state);
     goto fail;
@@ -289,8 +302,6 @@ sfvmk_evException(void *arg, uint32_t code, uint32_t data)
     goto fail;
   }
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
-
   if (pEvq->state != SFVMK_EVQ_STATE_STARTED) {
     SFVMK_ADAPTER_ERROR(pEvq->pAdapter, "Invalid EVQ state(%u)", pEvq->state);
     goto fail;
@@ -344,8 +355,6 @@ sfvmk_evLinkChange(void *arg, efx_link_mode_t linkMode)
     goto fail;
   }
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
-
   pAdapter = pEvq->pAdapter;
   if (pAdapter == NULL) {
     SFVMK_ERROR("NULL adapter ptr");
@@ -398,8 +407,6 @@ sfvmk_evRxqFlush(void *arg, uint32_t rxqIndex, sfvmk_flushState_t flushState)
     goto fail;
   }
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
-
   pAdapter = pEvq->pAdapter;
   if (pAdapter == NULL) {
     SFVMK_ERROR("NULL adapter ptr");
@@ -480,8 +487,6 @@ sfvmk_evMonitor(void *arg, efx_mon_stat_t id, efx_mon_stat_value_t value)
     goto fail;
   }
 
-  vmk_SpinlockAssertHeldByWorld(pEvq->lock);
-
   pAdapter = pEvq->pAdapter;
   if (pAdapter == NULL) {
     SFVMK_ERROR("NULL adapter ptr");
@@ -503,6 +508,32 @@ sfvmk_evMonitor(void *arg, efx_mon_stat_t id, efx_mon_stat_value_t value)
   return VMK_TRUE;
 }
 
+#if EFSYS_OPT_MAC_STATS
+/*! \brief Called when firmware has completed a periodic MAC stats DMA.
+**
+** \param[in] arg        Pointer to event queue
+** \param[in] generation Generation count of the DMAed stats
+**
+** \return: VMK_FALSE
+*/
+static boolean_t
+sfvmk_evMacStats(void *arg, uint32_t generation)
+{
+  sfvmk_evq_t *pEvq = (sfvmk_evq_t *)arg;
+  sfvmk_adapter_t *pAdapter = NULL;
+
+  VMK_ASSERT_NOT_NULL(pEvq);
+
+  pAdapter = pEvq->pAdapter;
+  VMK_ASSERT_NOT_NULL(pAdapter);
+
+  /* Stats are read from the DMA buffer in helper context as the
+   * update may have to wait and takes the adapter lock */
+  (void)sfvmk_scheduleMacStatsUpdate(pAdapter);
+
+  return VMK_FALSE;
+}
+#endif
 
 /*! \brief  Called when TXQ flush is done.
 **
@@ -528,7 +559,7 @@ sfvmk_evTxqFlushDone(void *arg, uint32_t txqIndex)
 
   VMK_ASSERT_NOT_NULL(pTxq);
 
-  if (pTxq->index == pEvq->index)
+  if (pTxq->evqIndex == pEvq->index)
     sfvmk_txqFlushDone(pTxq);
   else
     goto fail;
@@ -577,26 +608,119 @@ sfvmk_evSoftware(void *arg, uint16_t magic)
   return VMK_FALSE;
 }
 
+/*! \brief  Take exclusive control-path ownership of an EVQ.
+**
+** Raises the quiesce count so that new polls fall back to the EVQ
+** spinlock, takes the spinlock and then waits for a lockless poll that
+** may already be in flight to drain. Must not be used in panic context.
+**
+** \param[in] pEvq     Pointer to event queue
+**
+** \return: void
+*/
+void
+sfvmk_evqLock(sfvmk_evq_t *pEvq)
+{
+  vmk_AtomicInc64(&pEvq->quiesce);
+  vmk_SpinlockLock(pEvq->lock);
+
+  while (vmk_AtomicRead64(&pEvq->polling) != 0)
+    vmk_CPUMemFenceRead();
+}
+
+/*! \brief  Release control-path ownership of an EVQ.
+**
+** \param[in] pEvq     Pointer to event queue
+**
+** \return: void
+*/
+void
+sfvmk_evqUnlock(sfvmk_evq_t *pEvq)
+{
+  vmk_SpinlockUnlock(pEvq->lock);
+  vmk_AtomicDec64(&pEvq->quiesce);
+}
+
+/*! \brief Account one poll of an event queue in its statistics.
+**
+** \param[in] pEvq      Pointer to event queue
+** \param[in] numEvents Number of events consumed by the poll
+**
+** \return: void
+*/
+static void
+sfvmk_evqPollStatsUpdate(sfvmk_evq_t *pEvq, vmk_uint32 numEvents)
+{
+  vmk_uint32 bucket = 0;
+
+  vmk_VersionedAtomicBeginWrite(&pEvq->statsLock);
+
+  pEvq->stats[SFVMK_EVQ_POLLS]++;
+
+  if ((pEvq->rxDone >= pEvq->rxBudget) || (pEvq->txDone >= pEvq->txBudget))
+    pEvq->stats[SFVMK_EVQ_BUDGET_EXHAUSTED]++;
+
+  if (numEvents == 0) {
+    pEvq->stats[SFVMK_EVQ_EMPTY_POLLS]++;
+    goto done;
+  }
+
+  pEvq->stats[SFVMK_EVQ_EVENTS] += numEvents;
+
+  /* Bucket index is floor(log2(numEvents)), last bucket is open ended */
+  while ((numEvents >>= 1) != 0)
+    bucket++;
+  bucket = MIN(bucket, SFVMK_EVQ_POLL_HIST_BUCKETS - 1);
+
+  pEvq->stats[SFVMK_EVQ_POLL_HIST_1 + bucket]++;
+
+done:
+  vmk_VersionedAtomicEndWrite(&pEvq->statsLock);
+}
+
 /*! \brief  Poll event from eventQ and process it. function should be called in thread
 **          context only.
 **
+** In the common case only the owning netpoll world touches the EVQ, so
+** the poll claims the EVQ through the polling flag and runs without the
+** spinlock. If a control path has asked the EVQ to quiesce, the poll
+** falls back to the spinlock. At panic time other CPUs are halted and
+** may have been stopped mid poll, so ownership is overridden outright.
+**
 ** \param[in] pEvq     Pointer to event queue
 ** \param[in] panic    Indicate if system is in panic state or not
 **
 ** \return: VMK_FALSE [success]
+** \return: VMK_BUSY  another poll owns the EVQ
 ** \return: VMK_TRUE  [failure]
 */
 VMK_ReturnStatus
 sfvmk_evqPoll(sfvmk_evq_t *pEvq, vmk_Bool panic)
 {
   VMK_ReturnStatus status = VMK_OK;
+  vmk_Bool locked = VMK_FALSE;
+  vmk_uint32 startPtr;
+  vmk_uint64 profStart;
 
   if (pEvq == NULL) {
     SFVMK_ERROR("NULL event queue ptr");
     return VMK_BAD_PARAM;
   }
 
-  vmk_SpinlockLock(pEvq->lock);
+  if (VMK_UNLIKELY(panic)) {
+    vmk_AtomicWrite64(&pEvq->polling, 1);
+  } else {
+    /* Locked cmpxchg orders the polling claim before the quiesce read.
+     * A poll already in flight owns the EVQ and consumes its events. */
+    if (VMK_UNLIKELY(vmk_AtomicReadIfEqualWrite64(&pEvq->polling, 0, 1) != 0))
+      return VMK_BUSY;
+
+    if (VMK_UNLIKELY(vmk_AtomicRead64(&pEvq->quiesce) != 0)) {
+      vmk_AtomicWrite64(&pEvq->polling, 0);
+      vmk_SpinlockLock(pEvq->lock);
+      locked = VMK_TRUE;
+    }
+  }
 
   if ((pEvq->state != SFVMK_EVQ_STATE_STARTING) &&
       (pEvq->state != SFVMK_EVQ_STATE_STARTED)) {
@@ -604,8 +728,10 @@ sfvmk_evqPoll(sfvmk_evq_t *pEvq, vmk_Bool panic)
     goto done;
   }
 
+  profStart = sfvmk_profStart(pEvq->pAdapter);
   pEvq->rxDone = 0;
   pEvq->txDone = 0;
+  startPtr = pEvq->readPtr;
 
   /* Poll the queue */
   efx_ev_qpoll(pEvq->pCommonEvq, &pEvq->readPtr, &sfvmk_evCallbacks, pEvq);
@@ -613,6 +739,8 @@ sfvmk_evqPoll(sfvmk_evq_t *pEvq, vmk_Bool panic)
   /* Perform any pending completion processing */
   sfvmk_evqComplete(pEvq);
 
+  sfvmk_evqPollStatsUpdate(pEvq, pEvq->readPtr - startPtr);
+
   /* Re-prime the event queue for interrupts */
   if ((pEvq->rxDone < pEvq->rxBudget) &&
       (pEvq->txDone < pEvq->txBudget) && (!panic)) {
@@ -624,8 +752,14 @@ sfvmk_evqPoll(sfvmk_evq_t *pEvq, vmk_Bool panic)
     }
   }
 
+  sfvmk_profEnd(&pEvq->prof[SFVMK_MGMT_PROF_EVQ_POLL], profStart,
+                pEvq->readPtr - startPtr);
+
 done:
-  vmk_SpinlockUnlock(pEvq->lock);
+  if (locked)
+    vmk_SpinlockUnlock(pEvq->lock);
+  else
+    vmk_AtomicWrite64(&pEvq->polling, 0);
 
   return status;
 }
@@ -641,6 +775,7 @@ void sfvmk_evqComplete(sfvmk_evq_t *pEvq)
   sfvmk_adapter_t *pAdapter = NULL;
   sfvmk_rxq_t *pRxq = NULL;
   sfvmk_txq_t *pTxq = NULL;
+  vmk_uint32 label;
   sfvmk_pktCompCtx_t compCtx = {
     .type = SFVMK_PKT_COMPLETION_NETPOLL,
   };
@@ -650,43 +785,85 @@ void sfvmk_evqComplete(sfvmk_evq_t *pEvq)
   pAdapter = pEvq->pAdapter;
   VMK_ASSERT_NOT_NULL(pAdapter);
 
-  VMK_ASSERT_NOT_NULL(pAdapter->ppRxq);
-  pRxq = pAdapter->ppRxq[pEvq->index];
+  compCtx.netPoll = pEvq->netPoll;
 
-  /* Call RX module's fn to process RX data */
-  if (pRxq->pending != pRxq->completed) {
-    compCtx.netPoll = pEvq->netPoll;
-    sfvmk_rxqComplete(pRxq, &compCtx);
+  if (!pEvq->txOnly) {
+    VMK_ASSERT_NOT_NULL(pAdapter->ppRxq);
+    pRxq = pAdapter->ppRxq[pEvq->index];
+
+    /* Call RX module's fn to process RX data */
+    if (pRxq->pending != pRxq->completed)
+      sfvmk_rxqComplete(pRxq, &compCtx);
   }
 
-  VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
-  pTxq = pAdapter->ppTxq[pEvq->index];
+  for (label = 0; label < pEvq->numTxqs; label++) {
+    pTxq = pEvq->pTxqs[label];
+    VMK_ASSERT_NOT_NULL(pTxq);
 
-  vmk_SpinlockLock(pTxq->lock);
-  if (VMK_UNLIKELY(pTxq->state != SFVMK_TXQ_STATE_STARTED)) {
-    goto done;
+    sfvmk_txqLock(pTxq);
+    if (VMK_LIKELY(pTxq->state == SFVMK_TXQ_STATE_STARTED) &&
+        (pTxq->pending != pTxq->completed)) {
+      sfvmk_txqComplete(pTxq, pEvq, &compCtx);
+    }
+    sfvmk_txqUnlock(pTxq);
   }
-  if (pTxq->pending != pTxq->completed) {
-    compCtx.netPoll = pEvq->netPoll;
-    sfvmk_txqComplete(pTxq, pEvq, &compCtx);
+
+  return;
+}
+
+/*! \brief  function to convert sfvmk EVQ type to efx EVQ type.
+**
+** \param[in]  evqType  SFVMK EVQ type data
+**
+** \return: efx EVQ type
+*/
+static uint32_t
+sfvmk_getEvqType(sfvmk_evqType_t evqType)
+{
+  switch (evqType) {
+  case SFVMK_EVQ_TYPE_AUTO:
+    return EFX_EVQ_FLAGS_TYPE_AUTO;
+  case SFVMK_EVQ_TYPE_THROUGHPUT:
+    return EFX_EVQ_FLAGS_TYPE_THROUGHPUT;
+  case SFVMK_EVQ_TYPE_LOW_LATENCY:
+    return EFX_EVQ_FLAGS_TYPE_LOW_LATENCY;
+  default:
+    return EFX_EVQ_FLAGS_TYPE_AUTO;
   }
+}
 
-done:
-  vmk_SpinlockUnlock(pTxq->lock);
+/*! \brief  Build the efx EVQ creation flags for a given sfvmk EVQ type.
+**
+** \param[in]  pAdapter  Pointer to sfvmk_adapter_t
+** \param[in]  evqType   SFVMK EVQ type
+**
+** \return: efx EVQ flags
+*/
+static vmk_uint32
+sfvmk_getEvqFlags(sfvmk_adapter_t *pAdapter, sfvmk_evqType_t evqType)
+{
+  const efx_nic_cfg_t *pNicCfg = efx_nic_cfg_get(pAdapter->pNic);
+  vmk_uint32 flags = EFX_EVQ_FLAGS_NOTIFY_INTERRUPT;
 
-  return;
+  flags |= sfvmk_getEvqType(evqType);
+
+  if ((pNicCfg != NULL) && (pNicCfg->enc_no_cont_ev_mode_supported) &&
+      ((flags & EFX_EVQ_FLAGS_TYPE_MASK) == EFX_EVQ_FLAGS_TYPE_THROUGHPUT)) {
+    flags |= EFX_EVQ_FLAGS_NO_CONT_EV;
+  }
+
+  return flags;
 }
 
 /*! \brief    Create common code EVQ and wait for initilize event from the fw.
 **
 ** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
 ** \param[in]  qIndex      EventQ index
-** \param[in]  flags       Event Queue properties
 **
 ** \return: 0 [success] error code [failure]
 */
 static VMK_ReturnStatus
-sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
+sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 {
   sfvmk_evq_t *pEvq = NULL;
   VMK_ReturnStatus status = VMK_FAILURE;
@@ -715,9 +892,9 @@ sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
     goto done;
   }
 
-  vmk_SpinlockLock(pEvq->lock);
+  sfvmk_evqLock(pEvq);
   if (pEvq->state != SFVMK_EVQ_STATE_INITIALIZED) {
-    vmk_SpinlockUnlock(pEvq->lock);
+    sfvmk_evqUnlock(pEvq);
     SFVMK_ADAPTER_ERROR(pAdapter, "EVQ is not initialized");
     status = VMK_FAILURE;
     goto done;
@@ -726,21 +903,21 @@ sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
   /* Lock has been released here as there is no need to have a lock when
    * state is set to initialized.
    */
-  vmk_SpinlockUnlock(pEvq->lock);
+  sfvmk_evqUnlock(pEvq);
 
   /* Build an event queue with room for one event per TX and RX buffer,
    * plus some extra for link state events and MCDI completions.
    */
+  pEvq->numDesc = pEvq->numTxqs * pAdapter->numTxqBuffDesc;
+
+  if (!pEvq->txOnly)
+    pEvq->numDesc += pAdapter->numRxqBuffDesc;
+
+  if (qIndex == 0)
+    pEvq->numDesc += SFVMK_EVQ_EXTRA_EVENT_SPACE;
 
-  if (qIndex == 0) {
-    pEvq->numDesc = pAdapter->numRxqBuffDesc +
-                    pAdapter->numTxqBuffDesc +
-                    SFVMK_EVQ_EXTRA_EVENT_SPACE;
-  } else {
-    pEvq->numDesc = pAdapter->numRxqBuffDesc + pAdapter->numTxqBuffDesc;
-  }
   /* Make number of descriptors to nearest power of 2 */
-  pEvq->numDesc = sfvmk_pow2GE(pEvq->numDesc);
+  pEvq->numDesc = MIN(sfvmk_pow2GE(pEvq->numDesc), EFX_EVQ_MAXNEVS);
 
   pEvq->mem.ioElem.length = EFX_EVQ_SIZE(pEvq->numDesc);
 
@@ -759,7 +936,8 @@ sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
 
   /* Create common code event queue. */
   status = efx_ev_qcreate(pAdapter->pNic, qIndex, &pEvq->mem, pEvq->numDesc, 0,
-                          pAdapter->intrModeration, flags,
+                          pAdapter->intrModeration,
+                          sfvmk_getEvqFlags(pAdapter, pEvq->evqType),
                           &pEvq->pCommonEvq);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "efx_ev_qcreate failed status: %s",
@@ -767,7 +945,7 @@ sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
     goto failed_ev_qcreate;
   }
 
-  vmk_SpinlockLock(pEvq->lock);
+  sfvmk_evqLock(pEvq);
 
   pEvq->state = SFVMK_EVQ_STATE_STARTING;
 
@@ -777,13 +955,13 @@ sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
   /* Prime the event queue for interrupts */
   status = efx_ev_qprime(pEvq->pCommonEvq, pEvq->readPtr);
   if (status != VMK_OK) {
-    vmk_SpinlockUnlock(pEvq->lock);
+    sfvmk_evqUnlock(pEvq);
     SFVMK_ADAPTER_ERROR(pAdapter, "efx_ev_qprime failed status: %s",
                         vmk_StatusToString(status));
     goto failed_ev_qprime;
   }
 
-  vmk_SpinlockUnlock(pEvq->lock);
+  sfvmk_evqUnlock(pEvq);
 
   sfvmk_getTime(&currentTime);
   timeout = currentTime + SFVMK_EVQ_START_TIME_OUT_USEC;
@@ -797,12 +975,12 @@ sfvmk_evqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex, vmk_uint32 flags)
     }
 
     /* Check to see if the test event has been processed */
-    vmk_SpinlockLock(pEvq->lock);
+    sfvmk_evqLock(pEvq);
     if (pEvq->state == SFVMK_EVQ_STATE_STARTED) {
-      vmk_SpinlockUnlock(pEvq->lock);
+      sfvmk_evqUnlock(pEvq);
       goto done;
     }
-    vmk_SpinlockUnlock(pEvq->lock);
+    sfvmk_evqUnlock(pEvq);
     sfvmk_getTime(&currentTime);
   }
 
@@ -820,9 +998,9 @@ failed_ev_qcreate:
                          pEvq->mem.ioElem.ioAddr,
                          pEvq->mem.ioElem.length);
 
-  vmk_SpinlockLock(pEvq->lock);
+  sfvmk_evqLock(pEvq);
   pEvq->state = SFVMK_EVQ_STATE_INITIALIZED;
-  vmk_SpinlockUnlock(pEvq->lock);
+  sfvmk_evqUnlock(pEvq);
 
 failed_dma_alloc:
 done:
@@ -863,10 +1041,10 @@ sfvmk_evqStop(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
     goto done;
   }
 
-  vmk_SpinlockLock(pEvq->lock);
+  sfvmk_evqLock(pEvq);
 
   if (pEvq->state != SFVMK_EVQ_STATE_STARTED) {
-    vmk_SpinlockUnlock(pEvq->lock);
+    sfvmk_evqUnlock(pEvq);
     SFVMK_ADAPTER_ERROR(pAdapter, "EVQ is not started");
     goto done;
   }
@@ -874,7 +1052,7 @@ sfvmk_evqStop(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   pEvq->state = SFVMK_EVQ_STATE_INITIALIZED;
   pEvq->readPtr = 0;
   pEvq->exception = VMK_FALSE;
-  vmk_SpinlockUnlock(pEvq->lock);
+  sfvmk_evqUnlock(pEvq);
 
   vmk_NetPollDisable(pEvq->netPoll);
   efx_ev_qdestroy(pEvq->pCommonEvq);
@@ -889,27 +1067,6 @@ done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_EVQ, "qIndex[%u]", qIndex);
 }
 
-/*! \brief  function to convert sfvmk EVQ type to efx EVQ type.
-**
-** \param[in]  evqType  SFVMK EVQ type data
-**
-** \return: efx EVQ type
-*/
-static uint32_t
-sfvmk_getEvqType(sfvmk_evqType_t evqType)
-{
-  switch (evqType) {
-  case SFVMK_EVQ_TYPE_AUTO:
-    return EFX_EVQ_FLAGS_TYPE_AUTO;
-  case SFVMK_EVQ_TYPE_THROUGHPUT:
-    return EFX_EVQ_FLAGS_TYPE_THROUGHPUT;
-  case SFVMK_EVQ_TYPE_LOW_LATENCY:
-    return EFX_EVQ_FLAGS_TYPE_LOW_LATENCY;
-  default:
-    return EFX_EVQ_FLAGS_TYPE_AUTO;
-  }
-}
-
 /*! \brief   Create all common code EVQs.
 **
 ** \param[in]  pAdapter  Pointer to sfvmk_adapter_t
@@ -922,7 +1079,6 @@ sfvmk_evStart(sfvmk_adapter_t *pAdapter)
   vmk_uint32 qIndex;
   VMK_ReturnStatus status = VMK_BAD_PARAM;
   const efx_nic_cfg_t *pNicCfg = NULL;
-  vmk_uint32 flags = EFX_EVQ_FLAGS_NOTIFY_INTERRUPT;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_EVQ);
 
@@ -951,16 +1107,9 @@ sfvmk_evStart(sfvmk_adapter_t *pAdapter)
     goto done;
   }
 
-  flags |= sfvmk_getEvqType(modParams.evqType);
-
-  if ((pNicCfg->enc_no_cont_ev_mode_supported) &&
-      ((flags & EFX_EVQ_FLAGS_TYPE_MASK) == EFX_EVQ_FLAGS_TYPE_THROUGHPUT)) {
-    flags |= EFX_EVQ_FLAGS_NO_CONT_EV;
-  }
-
   for (qIndex = 0; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
 
-    status = sfvmk_evqStart(pAdapter, qIndex, flags);
+    status = sfvmk_evqStart(pAdapter, qIndex);
     if (status != VMK_OK) {
       SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_evqStart(%u) failed status: %s",
                           qIndex, vmk_StatusToString(status));
@@ -1049,7 +1198,10 @@ sfvmk_evqInit(sfvmk_adapter_t *pAdapter, unsigned int qIndex)
     goto done;
   }
 
-  pEvq = vmk_HeapAlloc(sfvmk_modInfo.heapID, sizeof(sfvmk_evq_t));
+  /* Cache line aligned so that the ISR counter and the poll counters
+   * do not share lines with other data */
+  pEvq = vmk_HeapAlign(sfvmk_modInfo.heapID, sizeof(sfvmk_evq_t),
+                       VMK_L1_CACHELINE_SIZE);
   if(pEvq == NULL) {
     SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HeapAlloc failed");
     status = VMK_NO_MEMORY;
@@ -1059,6 +1211,7 @@ sfvmk_evqInit(sfvmk_adapter_t *pAdapter, unsigned int qIndex)
 
   pEvq->index = qIndex;
   pEvq->pAdapter = pAdapter;
+  vmk_VersionedAtomicInit(&pEvq->statsLock);
 
   status = sfvmk_createLock(pAdapter, "evqLock",
                             SFVMK_SPINLOCK_RANK_EVQ_LOCK,
@@ -1070,6 +1223,11 @@ sfvmk_evqInit(sfvmk_adapter_t *pAdapter, unsigned int qIndex)
   }
 
   pEvq->panicPktList = NULL;
+  pEvq->txOnly = (qIndex >= sfvmk_getTxEvqStartIndex(pAdapter));
+  pEvq->evqType = modParams.evqType;
+  vmk_AtomicWrite64(&pEvq->polling, 0);
+  vmk_AtomicWrite64(&pEvq->quiesce, 0);
+  pEvq->intrPCPU = SFVMK_PCPU_NONE;
   pAdapter->ppEvq[qIndex] = pEvq;
   pEvq->state = SFVMK_EVQ_STATE_INITIALIZED;
 
@@ -1143,6 +1301,7 @@ sfvmk_evInit(sfvmk_adapter_t *pAdapter)
   VMK_ReturnStatus status = VMK_BAD_PARAM;
   vmk_uint32 qIndex;
   vmk_uint32 evqArraySize;
+  vmk_uint32 numRxEvqsDesired;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_EVQ);
 
@@ -1156,9 +1315,33 @@ sfvmk_evInit(sfvmk_adapter_t *pAdapter)
     status = VMK_FAILURE;
     goto done;
   }
-  /* Number of EVQs can not be greater than number of  intrrupt allocated */
-  pAdapter->numEvqsAllocated = MIN(pAdapter->intr.numIntrAlloc,
-                                   pAdapter->numEvqsDesired);
+  /* Number of EVQs can not be greater than number of  intrrupt allocated,
+   * except for a line interrupt. Its status carries a mask of the EVQs
+   * which fired, so the single vector is shared by all the EVQs. */
+  if ((pAdapter->intr.type == EFX_INTR_LINE) &&
+      (pAdapter->intr.numIntrAlloc == 1)) {
+    pAdapter->numEvqsAllocated = MIN(SFVMK_MAX_LINE_INTR_EVQS,
+                                     pAdapter->numEvqsDesired);
+  } else {
+    pAdapter->numEvqsAllocated = MIN(pAdapter->intr.numIntrAlloc,
+                                     pAdapter->numEvqsDesired);
+  }
+
+  pAdapter->intr.sharedVector = (pAdapter->numEvqsAllocated >
+                                 pAdapter->intr.numIntrAlloc);
+  vmk_AtomicWrite64(&pAdapter->intr.pendingQMask, 0);
+
+  /* Dedicated TX EVQs are the first to go if fewer interrupts were allocated */
+  numRxEvqsDesired = pAdapter->numEvqsDesired - pAdapter->numTxEvqs;
+  if (pAdapter->numEvqsAllocated > numRxEvqsDesired)
+    pAdapter->numTxEvqs = pAdapter->numEvqsAllocated - numRxEvqsDesired;
+  else
+    pAdapter->numTxEvqs = 0;
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_EVQ, SFVMK_LOG_LEVEL_DBG,
+                      "EVQs allocated: %u, dedicated TX EVQs: %u%s",
+                      pAdapter->numEvqsAllocated, pAdapter->numTxEvqs,
+                      pAdapter->intr.sharedVector ? ", shared vector" : "");
 
   evqArraySize = sizeof(sfvmk_evq_t *) * pAdapter->numEvqsAllocated;
   pAdapter->ppEvq = vmk_HeapAlloc(sfvmk_modInfo.heapID, evqArraySize);
@@ -1197,6 +1380,8 @@ failed_evq_init:
 
 failed_evq_alloc:
   pAdapter->numEvqsAllocated = 0;
+  pAdapter->numTxEvqs = 0;
+  pAdapter->intr.sharedVector = VMK_FALSE;
 
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_EVQ);
@@ -1235,6 +1420,7 @@ sfvmk_evFini(sfvmk_adapter_t *pAdapter)
     sfvmk_evqFini(pAdapter, --qIndex);
 
   pAdapter->numEvqsAllocated = 0;
+  pAdapter->numTxEvqs = 0;
 
   vmk_HeapFree(sfvmk_modInfo.heapID, pAdapter->ppEvq);
   pAdapter->ppEvq = NULL;
@@ -1294,3 +1480,200 @@ done:
 
   return status;
 }
+
+/*! \brief  Change the type of a single EVQ at runtime.
+**
+** The EVQ is destroyed and recreated with the new type. The RXQ and
+** TXQs completing on it are flushed and restarted around the recreate;
+** all other queues keep running. If the adapter is not started, the
+** new type is only recorded and applied on the next start.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  qIndex    event queue index
+** \param[in]  evqType   new event queue type
+**
+** \return:    VMK_OK or error code
+*/
+VMK_ReturnStatus
+sfvmk_evqTypeSet(sfvmk_adapter_t *pAdapter,
+                 vmk_uint32 qIndex,
+                 sfvmk_evqType_t evqType)
+{
+  sfvmk_evq_t *pEvq = NULL;
+  sfvmk_evqType_t oldEvqType;
+  sfvmk_txq_t *pTxq;
+  vmk_Bool hasRxq;
+  vmk_Bool isDefRxq = VMK_FALSE;
+  vmk_Bool linkUp;
+  vmk_uint32 i;
+  VMK_ReturnStatus status = VMK_BAD_PARAM;
+  VMK_ReturnStatus resetStatus;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_EVQ, "qIndex[%u]", qIndex);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+
+  if (evqType >= SFVMK_EVQ_TYPE_MAX) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid EVQ type %u", evqType);
+    goto done;
+  }
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  if ((pAdapter->ppEvq == NULL) || (qIndex >= pAdapter->numEvqsAllocated)) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid EVQ index %u", qIndex);
+    goto unlock;
+  }
+
+  pEvq = pAdapter->ppEvq[qIndex];
+  if (pEvq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL event queue ptr");
+    status = VMK_FAILURE;
+    goto unlock;
+  }
+
+  status = VMK_OK;
+  if (pEvq->evqType == evqType)
+    goto unlock;
+
+  oldEvqType = pEvq->evqType;
+  pEvq->evqType = evqType;
+
+  if (pAdapter->state != SFVMK_ADAPTER_STATE_STARTED)
+    goto unlock;
+
+  hasRxq = (!pEvq->txOnly) && (qIndex < pAdapter->numRxqsAllocated);
+  if (hasRxq) {
+    isDefRxq = (qIndex == (pAdapter->rssInit ? sfvmk_getRSSQStartIndex(pAdapter) :
+                                               pAdapter->defRxqIndex));
+  }
+
+  /* EVQ 0 also carries MCDI completions, poll for them while it is down */
+  if (qIndex == 0)
+    sfvmk_setMCDIMode(pAdapter, SFVMK_MCDI_MODE_POLL);
+
+  if (isDefRxq)
+    efx_mac_filter_default_rxq_clear(pAdapter->pNic);
+
+  if (hasRxq)
+    sfvmk_rxqStop(pAdapter, qIndex);
+
+  /* Stop the uplink TX queues so that the stack backs off rather than
+   * having its packets dropped while the TXQs are down */
+  for (i = 0; i < pEvq->numTxqs; i++) {
+    pTxq = pEvq->pTxqs[i];
+    sfvmk_txqLock(pTxq);
+    sfvmk_updateQueueStatus(pAdapter, VMK_UPLINK_QUEUE_STATE_STOPPED,
+                            pTxq->index);
+    sfvmk_txqUnlock(pTxq);
+    sfvmk_txqStop(pAdapter, pTxq->index);
+  }
+
+  sfvmk_evqStop(pAdapter, qIndex);
+
+  status = sfvmk_evqStart(pAdapter, qIndex);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_evqStart(%u) failed status: %s",
+                        qIndex, vmk_StatusToString(status));
+    pEvq->evqType = oldEvqType;
+    if (sfvmk_evqStart(pAdapter, qIndex) != VMK_OK)
+      goto failed_restart;
+  }
+
+  linkUp = (pAdapter->uplink.sharedData.link.state == VMK_LINK_STATE_UP);
+  for (i = 0; i < pEvq->numTxqs; i++) {
+    pTxq = pEvq->pTxqs[i];
+    if (sfvmk_txqStart(pAdapter, pTxq->index) != VMK_OK)
+      goto failed_restart;
+
+    if (linkUp) {
+      sfvmk_txqLock(pTxq);
+      sfvmk_updateQueueStatus(pAdapter, VMK_UPLINK_QUEUE_STATE_STARTED,
+                              pTxq->index);
+      sfvmk_txqUnlock(pTxq);
+    }
+  }
+
+  if (hasRxq) {
+    if (sfvmk_rxqStart(pAdapter, qIndex) != VMK_OK)
+      goto failed_restart;
+  }
+
+  if (isDefRxq) {
+    if (efx_mac_filter_default_rxq_set(pAdapter->pNic,
+                                       pAdapter->ppRxq[qIndex]->pCommonRxq,
+                                       pAdapter->rssInit) != VMK_OK)
+      goto failed_restart;
+  }
+
+  if (qIndex == 0)
+    sfvmk_setMCDIMode(pAdapter, SFVMK_MCDI_MODE_EVENT);
+
+  /* On fallback the queues run again with the old type, status is
+   * still the sfvmk_evqStart failure */
+  if (status == VMK_OK) {
+    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_EVQ, SFVMK_LOG_LEVEL_INFO,
+                        "EVQ[%u] type changed from %u to %u", qIndex,
+                        oldEvqType, pEvq->evqType);
+  } else {
+    SFVMK_ADAPTER_ERROR(pAdapter, "EVQ[%u] type left unchanged at %u",
+                        qIndex, pEvq->evqType);
+  }
+  goto unlock;
+
+failed_restart:
+  /* Queues are left half way torn down, recover with a full reset */
+  SFVMK_ADAPTER_ERROR(pAdapter, "Failed to restart queues on EVQ[%u]", qIndex);
+  if (qIndex == 0)
+    sfvmk_setMCDIMode(pAdapter, SFVMK_MCDI_MODE_EVENT);
+  status = VMK_FAILURE;
+  resetStatus = sfvmk_scheduleReset(pAdapter);
+  if (resetStatus != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_scheduleReset failed status: %s",
+                        vmk_StatusToString(resetStatus));
+    status = resetStatus;
+  }
+
+unlock:
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_EVQ, "qIndex[%u]", qIndex);
+
+  return status;
+}
+
+/*! \brief  Get the type of a single EVQ.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  qIndex    event queue index
+** \param[out] pEvqType  current event queue type
+**
+** \return:    VMK_OK or error code
+*/
+VMK_ReturnStatus
+sfvmk_evqTypeGet(sfvmk_adapter_t *pAdapter,
+                 vmk_uint32 qIndex,
+                 sfvmk_evqType_t *pEvqType)
+{
+  VMK_ReturnStatus status = VMK_BAD_PARAM;
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pEvqType);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  if ((pAdapter->ppEvq == NULL) || (qIndex >= pAdapter->numEvqsAllocated) ||
+      (pAdapter->ppEvq[qIndex] == NULL)) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid EVQ index %u", qIndex);
+    goto done;
+  }
+
+  *pEvqType = pAdapter->ppEvq[qIndex]->evqType;
+  status = VMK_OK;
+
+done:
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  return status;
+}
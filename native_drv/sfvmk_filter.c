@@ -29,7 +29,6 @@
 /* Data structure to retrieve value from a
  * key-value pairs on a given hash table. */
 typedef struct sfvmk_filterDBIterCtx_s {
-  vmk_Bool                foundFilterEntry;
   sfvmk_filterDBEntry_t   *pFdbEntry;
 } sfvmk_filterDBIterCtx_t;
 
@@ -47,6 +46,219 @@ static const sfvmk_filterEncapEntry_t sfvmk_filterEncapList[] = {
   SFVMK_ENCAP_FILTER_ENTRY(IPV6)
 };
 
+static void sfvmk_flushParkedFilters(sfvmk_adapter_t *pAdapter);
+
+/*! \brief  Map a filter DB entry to its usage accounting index
+**
+** \param[in]  pFdbEntry  pointer to filter DB entry
+**
+** \return: index in sfvmk_filterRes_t per class arrays
+**
+*/
+static sfvmk_filterClassIdx_t
+sfvmk_filterClassIdx(const sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  if (pFdbEntry->ruleId != 0)
+    return SFVMK_FILTER_CLASS_MGMT;
+
+  switch (pFdbEntry->class) {
+    case VMK_UPLINK_QUEUE_FILTER_CLASS_MAC_ONLY:
+      return SFVMK_FILTER_CLASS_MAC;
+    case VMK_UPLINK_QUEUE_FILTER_CLASS_VLANMAC:
+      return SFVMK_FILTER_CLASS_VLANMAC;
+    case VMK_UPLINK_QUEUE_FILTER_CLASS_VXLAN:
+      return SFVMK_FILTER_CLASS_VXLAN;
+    /* Driver owned filters other than management rules are aRFS ones */
+    case VMK_UPLINK_QUEUE_FILTER_CLASS_NONE:
+      return SFVMK_FILTER_CLASS_ARFS;
+#if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
+    case VMK_UPLINK_QUEUE_FILTER_CLASS_GENEVE:
+      return SFVMK_FILTER_CLASS_GENEVE;
+#endif
+    default:
+      return SFVMK_FILTER_CLASS_OTHER;
+  }
+}
+
+/*! \brief  Number of HW filter slots the uplink filters of this function
+**         may use. The filter table is shared with the driver's own MAC
+**         filters and with the enabled VFs, which get a fixed reserve each.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: HW filter slot limit
+**
+*/
+vmk_uint32
+sfvmk_filterHwLimit(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint32 reserve = SFVMK_HW_FILTER_RESERVE;
+
+#ifdef SFVMK_SUPPORT_SRIOV
+  reserve += pAdapter->numVfsEnabled * SFVMK_VF_HW_FILTER_RESERVE;
+#endif
+
+  if (reserve >= SFVMK_MAX_HW_FILTER)
+    return 0;
+
+  return SFVMK_MAX_HW_FILTER - reserve;
+}
+
+/*! \brief  Account the HW filter slots held by a filter DB entry
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry
+** \param[in]  add        VMK_TRUE when the slots are taken,
+**                        VMK_FALSE when they are released
+**
+** \return: void
+**
+*/
+static void
+sfvmk_filterResAccount(sfvmk_adapter_t *pAdapter,
+                       const sfvmk_filterDBEntry_t *pFdbEntry,
+                       vmk_Bool add)
+{
+  sfvmk_filterRes_t *pRes = &pAdapter->filterRes;
+  sfvmk_filterClassIdx_t idx = sfvmk_filterClassIdx(pFdbEntry);
+
+  if (add) {
+    pRes->hwInUse += pFdbEntry->numHwFilter;
+    pRes->classHwFilters[idx] += pFdbEntry->numHwFilter;
+    pRes->classFilters[idx]++;
+  } else {
+    VMK_ASSERT(pRes->hwInUse >= pFdbEntry->numHwFilter);
+    pRes->hwInUse -= pFdbEntry->numHwFilter;
+    pRes->classHwFilters[idx] -= pFdbEntry->numHwFilter;
+    pRes->classFilters[idx]--;
+  }
+}
+
+/*! \brief  Check that the HW filters of a new filter DB entry fit in the
+**         filter table, before any MCDI request is issued for them.
+**         Parked filters are flushed to make room if needed.
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry to insert
+**
+** \return: VMK_TRUE if the entry fits, VMK_FALSE otherwise
+**
+*/
+static vmk_Bool
+sfvmk_filterResAdmit(sfvmk_adapter_t *pAdapter,
+                     const sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  vmk_uint32 limit = sfvmk_filterHwLimit(pAdapter);
+
+  if (pAdapter->filterRes.hwInUse + pFdbEntry->numHwFilter <= limit)
+    return VMK_TRUE;
+
+  sfvmk_flushParkedFilters(pAdapter);
+  if (pAdapter->filterRes.hwInUse + pFdbEntry->numHwFilter <= limit)
+    return VMK_TRUE;
+
+  pAdapter->filterStats[SFVMK_FILTER_NO_SPACE]++;
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
+                      "Filter table full, %u of %u HW filters in use",
+                      pAdapter->filterRes.hwInUse, limit);
+  return VMK_FALSE;
+}
+
+/*! \brief  Compute the canonical hash of a filter DB entry
+**
+** The class and the full specs are hashed, which covers the MAC, VLAN,
+** VNI and outer MAC match fields. Specs are built on zeroed memory, so
+** entries that compare equal in sfvmk_matchFilterRule hash equally.
+** The priority is left out as a filter moved between queues keeps
+** EFX_FILTER_PRI_REQUIRED until the vmkernel removes it again.
+**
+** \param[in]  pFdbEntry  pointer to filter DB entry
+**
+** \return: 32 bit FNV-1a hash
+**
+*/
+static vmk_uint32
+sfvmk_filterSpecHash(const sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  efx_filter_spec_t spec;
+  const vmk_uint8 *pByte;
+  vmk_uint32 hash = 2166136261U;
+  vmk_uint32 len;
+  vmk_uint32 i;
+
+  hash = (hash ^ pFdbEntry->class) * 16777619U;
+  hash = (hash ^ pFdbEntry->numHwFilter) * 16777619U;
+
+  for (i = 0; i < pFdbEntry->numHwFilter; i++) {
+    vmk_Memcpy(&spec, &pFdbEntry->spec[i], sizeof(spec));
+    spec.efs_priority = EFX_FILTER_PRI_MANUAL;
+
+    pByte = (const vmk_uint8 *)&spec;
+    len = sizeof(spec);
+    while (len--)
+      hash = (hash ^ *pByte++) * 16777619U;
+  }
+
+  return hash;
+}
+
+/*! \brief  Link a filter DB entry into the spec index
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry
+**
+** \return: void
+**
+*/
+static void
+sfvmk_filterSpecIndexAdd(sfvmk_adapter_t *pAdapter,
+                         sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  sfvmk_filterDBEntry_t **ppHead;
+
+  VMK_ASSERT(pFdbEntry->specIndexed == VMK_FALSE);
+
+  pFdbEntry->specHash = sfvmk_filterSpecHash(pFdbEntry);
+  ppHead = &pAdapter->pFilterSpecIndex[pFdbEntry->specHash &
+                                       (SFVMK_FILTER_SPEC_BUCKETS - 1)];
+  pFdbEntry->pSpecNext = *ppHead;
+  *ppHead = pFdbEntry;
+  pFdbEntry->specIndexed = VMK_TRUE;
+  sfvmk_filterResAccount(pAdapter, pFdbEntry, VMK_TRUE);
+}
+
+/*! \brief  Unlink a filter DB entry from the spec index if linked
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry
+**
+** \return: void
+**
+*/
+static void
+sfvmk_filterSpecIndexDel(sfvmk_adapter_t *pAdapter,
+                         sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  sfvmk_filterDBEntry_t **ppCur;
+
+  if (!pFdbEntry->specIndexed)
+    return;
+
+  ppCur = &pAdapter->pFilterSpecIndex[pFdbEntry->specHash &
+                                      (SFVMK_FILTER_SPEC_BUCKETS - 1)];
+  while (*ppCur != NULL) {
+    if (*ppCur == pFdbEntry) {
+      *ppCur = pFdbEntry->pSpecNext;
+      break;
+    }
+    ppCur = &(*ppCur)->pSpecNext;
+  }
+
+  pFdbEntry->pSpecNext = NULL;
+  pFdbEntry->specIndexed = VMK_FALSE;
+  sfvmk_filterResAccount(pAdapter, pFdbEntry, VMK_FALSE);
+}
+
 /*! \brief  Allocate a filter DB entry
 **
 ** \param[in]  pAdapter   pointer to sfvmk_adapter_t
@@ -87,6 +299,7 @@ sfvmk_freeFilterRule(sfvmk_adapter_t *pAdapter,
     return;
   }
 
+  sfvmk_filterSpecIndexDel(pAdapter, pFdbEntry);
   vmk_HeapFree(sfvmk_modInfo.heapID, pFdbEntry);
   pFdbEntry = NULL;
 }
@@ -370,209 +583,1566 @@ done:
   return status;
 }
 
-/*! \brief Iterator used to iterate and match
-**         the key-value pairs on a given hash table.
+/*! \brief  search in filter data base and find match
 **
-** \param[in]     htbl   Hash handle.
-** \param[in]     key    Hash key.
-** \param[in]     value  Hash entry value stored at key
-** \param[in,out] data   pointer to sfvmk_filterDBIterCtx_t,
-**                       if a match is found then
-**                       foundFilterEntry field is set to true.
+** Only the spec index chain for the entry's hash is walked, so a
+** lookup does not depend on the number of filters installed.
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter entry to compare
 **
-** \return: Key iterator commands.
+** \return: matching filter entry, NULL if filter match not found.
 **
 */
-static vmk_HashKeyIteratorCmd
-sfvmk_matchFilterDBHashIter(vmk_HashTable htbl,
-                            vmk_HashKey key, vmk_HashValue value,
-                            vmk_AddrCookie data)
+static sfvmk_filterDBEntry_t *
+sfvmk_matchFilterRule(sfvmk_adapter_t *pAdapter, sfvmk_filterDBEntry_t *pFdbEntry)
 {
-  sfvmk_filterDBIterCtx_t *pIterCtx = data.ptr;
-  sfvmk_filterDBEntry_t *pMatchFdbEntry = pIterCtx->pFdbEntry;
-  sfvmk_filterDBEntry_t *pStoredFdbEntry = (sfvmk_filterDBEntry_t *)value;
-  vmk_HashKeyIteratorCmd returnCode = VMK_HASH_KEY_ITER_CMD_CONTINUE;
+  sfvmk_filterDBEntry_t *pStoredFdbEntry;
+  efx_filter_spec_t spec;
+  vmk_uint32 specHash;
   vmk_uint32 i;
 
-  if (!pStoredFdbEntry || !pMatchFdbEntry) {
-    returnCode = VMK_HASH_KEY_ITER_CMD_STOP;
-    goto done;
-  }
+  specHash = sfvmk_filterSpecHash(pFdbEntry);
+  pStoredFdbEntry = pAdapter->pFilterSpecIndex[specHash &
+                                               (SFVMK_FILTER_SPEC_BUCKETS - 1)];
 
-  if (pStoredFdbEntry->class != pMatchFdbEntry->class) {
-    returnCode = VMK_HASH_KEY_ITER_CMD_CONTINUE;
-    goto done;
-  }
+  for (; pStoredFdbEntry != NULL; pStoredFdbEntry = pStoredFdbEntry->pSpecNext) {
+    if ((pStoredFdbEntry->specHash != specHash) ||
+        (pStoredFdbEntry->class != pFdbEntry->class) ||
+        (pStoredFdbEntry->numHwFilter != pFdbEntry->numHwFilter))
+      continue;
 
-  if (pStoredFdbEntry->numHwFilter != pMatchFdbEntry->numHwFilter) {
-      returnCode = VMK_HASH_KEY_ITER_CMD_CONTINUE;
-      goto done;
-  }
+    /* Priorities are not compared, see sfvmk_filterSpecHash */
+    for (i = 0; i < pStoredFdbEntry->numHwFilter; i++) {
+      vmk_Memcpy(&spec, &pFdbEntry->spec[i], sizeof(spec));
+      spec.efs_priority = pStoredFdbEntry->spec[i].efs_priority;
+      if (memcmp(&pStoredFdbEntry->spec[i], &spec, sizeof(spec)))
+        break;
+    }
 
-  for (i = 0; i < pStoredFdbEntry->numHwFilter; i++) {
-    if (memcmp(&pStoredFdbEntry->spec[i],
-               &pMatchFdbEntry->spec[i], sizeof(pStoredFdbEntry->spec[0]))) {
-      returnCode = VMK_HASH_KEY_ITER_CMD_CONTINUE;
-      goto done;
+    if (i == pStoredFdbEntry->numHwFilter) {
+      SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
+                          "Found a match for filter");
+      return pStoredFdbEntry;
     }
   }
 
-  returnCode = VMK_HASH_KEY_ITER_CMD_STOP;
-  pIterCtx->foundFilterEntry = VMK_TRUE;
+  return NULL;
+}
 
-done:
-  return returnCode;
+/*! \brief  Reset a filter batch to empty
+**
+** \param[out] pBatch  pointer to filter batch
+**
+** \return: void
+**
+*/
+void
+sfvmk_filterBatchInit(sfvmk_filterBatch_t *pBatch)
+{
+  pBatch->numOps = 0;
 }
 
-/*! \brief  search in filter data base and find match
+/*! \brief  Queue a filter DB entry operation in a batch
 **
-** \param[in]  pAdapter   pointer to sfvmk_adapter_t
-** \param[in]  pFdbEntry  pointer to filter entry to compare
+** \param[in,out] pBatch     pointer to filter batch
+** \param[in]     type       operation to apply on all HW filters of the entry
+** \param[in]     pFdbEntry  pointer to filter DB entry
 **
-** \return: VMK_TRUE if found match, VMK_FLASE if
-**          filter match not found.
+** \return: VMK_OK [success] VMK_LIMIT_EXCEEDED [batch is full]
 **
 */
-static vmk_Bool
-sfvmk_matchFilterRule(sfvmk_adapter_t *pAdapter, sfvmk_filterDBEntry_t *pFdbEntry)
+VMK_ReturnStatus
+sfvmk_filterBatchAdd(sfvmk_filterBatch_t *pBatch,
+                     sfvmk_filterOpType_t type,
+                     sfvmk_filterDBEntry_t *pFdbEntry)
 {
-  sfvmk_filterDBIterCtx_t iterCtx = {VMK_FALSE, pFdbEntry};
-  VMK_ReturnStatus status;
+  if (pBatch->numOps >= SFVMK_FILTER_BATCH_MAX)
+    return VMK_LIMIT_EXCEEDED;
 
-  if (vmk_HashIsEmpty(pAdapter->filterDBHashTable)) {
-    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
-                        "Filter hash database table is empty");
-    return VMK_FALSE;
-  }
+  pBatch->ops[pBatch->numOps].type = type;
+  pBatch->ops[pBatch->numOps].pFdbEntry = pFdbEntry;
+  pBatch->numOps++;
 
-  status = vmk_HashKeyIterate(pAdapter->filterDBHashTable,
-                              sfvmk_matchFilterDBHashIter, &iterCtx);
-  if (status != VMK_OK) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "Iterator failed with error code %s",
-                        vmk_StatusToString(status));
-    return VMK_FALSE;
-  }
+  return VMK_OK;
+}
 
-  if (iterCtx.foundFilterEntry) {
-    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
-                        "Found a match for filter");
-    return VMK_TRUE;
-  }
+/*! \brief  Apply one operation on a HW filter
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  type      operation to apply
+** \param[in]  pSpec     pointer to HW filter spec
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_filterHwOp(sfvmk_adapter_t *pAdapter, sfvmk_filterOpType_t type,
+                 efx_filter_spec_t *pSpec)
+{
+  /* HW filters of a filter DB kept over a reset went with the reset */
+  if ((type == SFVMK_FILTER_OP_REMOVE) && pAdapter->filterDBKept)
+    return VMK_OK;
 
-  return VMK_FALSE;
+  pAdapter->filterStats[SFVMK_FILTER_HW_OPS]++;
+
+  if (type == SFVMK_FILTER_OP_INSERT)
+    return efx_filter_insert(pAdapter->pNic, pSpec);
+
+  return efx_filter_remove(pAdapter->pNic, pSpec);
 }
 
-/*! \brief  insert a filter rule
+/*! \brief  Issue all operations of a filter batch back to back
 **
-** \param[in]  pAdapter   pointer to sfvmk_adapter_t
-** \param[in]  pFdbEntry  pointer to filter DB entry
+** HW filters are programmed in batch order without dropping the adapter
+** lock between MCDI requests. If any of them fails, the HW filters
+** already handled are restored in reverse order so that the hardware
+** matches the filter DB again.
 **
-** \return: VMK_OK if success, error number if failed
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t, adapter lock held
+** \param[in]  pBatch    pointer to filter batch
+**
+** \return: VMK_OK [success] error code [failure]
 **
 */
 VMK_ReturnStatus
-sfvmk_insertFilterRule(sfvmk_adapter_t *pAdapter,
-                       sfvmk_filterDBEntry_t *pFdbEntry)
+sfvmk_filterBatchCommit(sfvmk_adapter_t *pAdapter, sfvmk_filterBatch_t *pBatch)
 {
-  VMK_ReturnStatus status = VMK_FAILURE;
-  vmk_uint32 i;
+  sfvmk_filterDBEntry_t *pFdbEntry;
+  sfvmk_filterOpType_t type;
+  vmk_uint32 op;
+  vmk_uint32 i = 0;
+  VMK_ReturnStatus status = VMK_OK;
 
-  if (sfvmk_matchFilterRule(pAdapter, pFdbEntry) == VMK_TRUE) {
-    status = VMK_EXISTS;
-    goto done;
-  }
+  for (op = 0; op < pBatch->numOps; op++) {
+    pFdbEntry = pBatch->ops[op].pFdbEntry;
+    type = pBatch->ops[op].type;
+
+    for (i = 0; i < pFdbEntry->numHwFilter; i++) {
+      status = sfvmk_filterHwOp(pAdapter, type, &pFdbEntry->spec[i]);
+      if ((status == VMK_OK) ||
+          ((type == SFVMK_FILTER_OP_INSERT) && (status == VMK_EXISTS)))
+        continue;
+
+      /* Table exhaustion is reported by a single counter */
+      if (status == VMK_NO_SPACE) {
+        pAdapter->filterStats[SFVMK_FILTER_NO_SPACE]++;
+        goto rollback;
+      }
 
-  for (i = 0; i < pFdbEntry->numHwFilter; i++) {
-    status = efx_filter_insert(pAdapter->pNic, &pFdbEntry->spec[i]);
-    if ((status != VMK_OK) && (status != VMK_EXISTS)) {
       SFVMK_ADAPTER_ERROR(pAdapter,
-                          "Insert of HW filter failed for entry %d with error code %s",
-                          i, vmk_StatusToString(status));
-      status = VMK_FAILURE;
-      goto failed_insert;
+                          "%s of HW filter %u of batch op %u failed with error code %s",
+                          (type == SFVMK_FILTER_OP_INSERT) ? "Insert" : "Remove",
+                          i, op, vmk_StatusToString(status));
+      goto rollback;
     }
   }
 
   status = VMK_OK;
-  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
-                      "Hw filter inserted successfully");
   goto done;
 
-failed_insert:
-  while (i--)
-    efx_filter_remove(pAdapter->pNic, &pFdbEntry->spec[i]);
+rollback:
+  pAdapter->filterStats[SFVMK_FILTER_BATCH_ROLLBACKS]++;
+
+  /* Undo the HW filters done for the failed op, then every earlier op */
+  for (;;) {
+    pFdbEntry = pBatch->ops[op].pFdbEntry;
+    type = (pBatch->ops[op].type == SFVMK_FILTER_OP_INSERT) ?
+           SFVMK_FILTER_OP_REMOVE : SFVMK_FILTER_OP_INSERT;
+
+    while (i--) {
+      if (sfvmk_filterHwOp(pAdapter, type, &pFdbEntry->spec[i]) != VMK_OK)
+        pAdapter->filterStats[SFVMK_FILTER_ROLLBACK_FAILED]++;
+    }
+
+    if (op == 0)
+      break;
+
+    op--;
+    i = pBatch->ops[op].pFdbEntry->numHwFilter;
+  }
 
 done:
+  pAdapter->filterStats[SFVMK_FILTER_BATCH_COMMITS]++;
+  pAdapter->filterStats[SFVMK_FILTER_BATCH_OPS] += pBatch->numOps;
+
   return status;
 }
 
-/*! \brief  find and remove filter rule for given filterKey
+/*! \brief  Check whether two filter DB entries match the same traffic,
+**         whatever RX queue, RSS context, flags and priority their HW
+**         filters use
 **
-** \param[in]  pAdapter    pointer to sfvmk_adapter_t
-** \param[in]  filterKey   filter key of already created filter.
+** \param[in]  pFdbEntryA  pointer to filter DB entry
+** \param[in]  pFdbEntryB  pointer to filter DB entry
 **
-** \return: pointer to pFdbEntry if success, NULL if failed
+** \return: VMK_TRUE if the match is the same, VMK_FALSE otherwise
 **
 */
-sfvmk_filterDBEntry_t *
-sfvmk_removeFilterRule(sfvmk_adapter_t *pAdapter, vmk_uint32 filterKey)
+static vmk_Bool
+sfvmk_filterSameMatch(const sfvmk_filterDBEntry_t *pFdbEntryA,
+                      const sfvmk_filterDBEntry_t *pFdbEntryB)
 {
-  sfvmk_filterDBEntry_t *pFdbEntry;
-  VMK_ReturnStatus status = VMK_FAILURE;
+  efx_filter_spec_t spec;
   vmk_uint32 i;
 
-  if (vmk_HashIsEmpty(pAdapter->filterDBHashTable)) {
-    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
-                        "Filter hash database table is empty");
-    return NULL;
-  }
+  if ((pFdbEntryA->class != pFdbEntryB->class) ||
+      (pFdbEntryA->numHwFilter != pFdbEntryB->numHwFilter))
+    return VMK_FALSE;
 
-  status = vmk_HashKeyFind(pAdapter->filterDBHashTable,
-                           (vmk_HashKey)(vmk_uint64)filterKey,
-                           (vmk_HashValue *)&pFdbEntry);
-  if (status != VMK_OK) {
-    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
-                        "vmk_HashKeyFind failed with error code %s",
-                        vmk_StatusToString(status));
-    return NULL;
+  for (i = 0; i < pFdbEntryA->numHwFilter; i++) {
+    vmk_Memcpy(&spec, &pFdbEntryB->spec[i], sizeof(spec));
+    spec.efs_priority = pFdbEntryA->spec[i].efs_priority;
+    spec.efs_flags = pFdbEntryA->spec[i].efs_flags;
+    spec.efs_dmaq_id = pFdbEntryA->spec[i].efs_dmaq_id;
+    spec.efs_rss_context = pFdbEntryA->spec[i].efs_rss_context;
+    if (memcmp(&spec, &pFdbEntryA->spec[i], sizeof(spec)))
+      return VMK_FALSE;
   }
 
-  if (!pFdbEntry) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "pFdbEntry is NULL for filter ID %d,"
-                        "This is unexpected", filterKey);
-    return NULL;
+  return VMK_TRUE;
+}
+
+/*! \brief  Remove the HW filters of all parked filter DB entries in one
+**         batch. Entries whose removal failed stay parked and are retried
+**         on the next flush. Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_flushParkedFilters(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_filterParked_t *pParked;
+  sfvmk_filterBatch_t batch;
+  sfvmk_filterBatch_t single;
+  vmk_uint32 slot[SFVMK_FILTER_PARK_MAX];
+  vmk_Bool failed[SFVMK_FILTER_PARK_MAX];
+  vmk_uint32 i;
+
+  sfvmk_filterBatchInit(&batch);
+  for (i = 0; i < SFVMK_FILTER_PARK_MAX; i++) {
+    failed[i] = VMK_FALSE;
+    pParked = &pAdapter->filterParked[i];
+    if (pParked->parkTime != 0) {
+      slot[batch.numOps] = i;
+      sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, &pParked->entry);
+    }
   }
 
-  for (i = 0; i < pFdbEntry->numHwFilter; i++) {
-    status = efx_filter_remove(pAdapter->pNic, &pFdbEntry->spec[i]);
-    if (status != VMK_OK) {
-      SFVMK_ADAPTER_ERROR(pAdapter,
-                          "Remove HW filter failed for entry %d with error code %s",
-                          i, vmk_StatusToString(status));
-      return NULL;
+  if (batch.numOps == 0)
+    return;
+
+  /* A failed batch is rolled back as a whole, retry the entries one by
+   * one so that a single bad entry does not keep the others installed */
+  if (sfvmk_filterBatchCommit(pAdapter, &batch) != VMK_OK) {
+    for (i = 0; i < batch.numOps; i++) {
+      sfvmk_filterBatchInit(&single);
+      sfvmk_filterBatchAdd(&single, SFVMK_FILTER_OP_REMOVE, batch.ops[i].pFdbEntry);
+      if (sfvmk_filterBatchCommit(pAdapter, &single) != VMK_OK) {
+        SFVMK_ADAPTER_ERROR(pAdapter, "Failed to remove parked filter %u",
+                            batch.ops[i].pFdbEntry->key);
+        failed[slot[i]] = VMK_TRUE;
+        pAdapter->filterStats[SFVMK_FILTER_PARK_FLUSH_FAILED]++;
+      }
     }
   }
 
-  return pFdbEntry;
+  for (i = 0; i < SFVMK_FILTER_PARK_MAX; i++) {
+    pParked = &pAdapter->filterParked[i];
+    if ((pParked->parkTime == 0) || failed[i])
+      continue;
+
+    pParked->parkTime = 0;
+    sfvmk_filterResAccount(pAdapter, &pParked->entry, VMK_FALSE);
+    pAdapter->filterStats[SFVMK_FILTER_PARK_FLUSHED]++;
+  }
 }
 
-/*! \brief Iterator used to pop a filter DB entry from hash
-**         table and fill the filter DB Iterator context
-**         structure entry.
+/*! \brief  Account a vmkernel filter operation to the current rebalance,
+**         starting one if none is in progress. Adapter lock must be held.
 **
-** \param[in]     htbl   Hash handle.
-** \param[in]     key    Hash key.
-** \param[in]     value  Hash entry vlaue stored at key
-** \param[in,out] data   pointer to sfvmk_filterDBIterCtx_t
+** The vmkernel moves NetQueue filters with back to back remove and apply
+** callbacks and gives no notice of where a rebalance starts or ends.
+** A burst of filter callbacks is treated as one rebalance, which ends
+** once no callback came for SFVMK_FILTER_REBALANCE_MS.
 **
-** \return: Key iterator stop command.
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
 **
+** \return: void
 */
-static vmk_HashKeyIteratorCmd
-sfvmk_getFilterDBHashIter(vmk_HashTable htbl, vmk_HashKey key,
-                          vmk_HashValue value, vmk_AddrCookie data)
+void
+sfvmk_filterRebalanceOpStart(sfvmk_adapter_t *pAdapter)
 {
-  sfvmk_filterDBIterCtx_t *pIterCtx = data.ptr;
+  sfvmk_filterRebalance_t *pRebalance = &pAdapter->filterRebalance;
+
+  if (!pRebalance->inProgress) {
+    pRebalance->inProgress = VMK_TRUE;
+    sfvmk_getTime(&pRebalance->startTime);
+    pRebalance->lastOpTime = pRebalance->startTime;
+    pRebalance->numOps = 0;
+    pRebalance->startCommits = pAdapter->filterStats[SFVMK_FILTER_BATCH_COMMITS];
+  }
+
+  pRebalance->numOps++;
+}
+
+static void sfvmk_filterRebalanceHelper(vmk_AddrCookie data);
+
+/*! \brief  Queue the check for the end of the rebalance if not queued yet.
+**         Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_filterRebalanceSchedule(sfvmk_adapter_t *pAdapter)
+{
+  vmk_HelperRequestProps props = {0};
+  VMK_ReturnStatus status;
+
+  if (vmk_AtomicReadIfEqualWrite64(&pAdapter->filterRebalancePending, 0, 1) != 0)
+    return;
+
+  props.requestMayBlock = VMK_FALSE;
+  props.tag = (vmk_AddrCookie)NULL;
+  props.cancelFunc = NULL;
+  props.worldToBill = VMK_INVALID_WORLD_ID;
+  status = vmk_HelperSubmitDelayedRequest(pAdapter->helper,
+                                          sfvmk_filterRebalanceHelper,
+                                          (vmk_AddrCookie *)pAdapter,
+                                          SFVMK_FILTER_REBALANCE_MS,
+                                          &props);
+  if (status != VMK_OK) {
+    vmk_AtomicWrite64(&pAdapter->filterRebalancePending, 0);
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HelperSubmitDelayedRequest failed status: %s",
+                        vmk_StatusToString(status));
+    /* Without the helper nothing would remove the parked filters */
+    sfvmk_filterRebalanceEnd(pAdapter);
+  }
+}
+
+/*! \brief  Helper to end a rebalance once the vmkernel went quiet
+**
+** \param[in]  data  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_filterRebalanceHelper(vmk_AddrCookie data)
+{
+  sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)data.ptr;
+  vmk_uint64 currentTime;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_FILTER);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  vmk_AtomicWrite64(&pAdapter->filterRebalancePending, 0);
+
+  /* A stopped adapter ended the rebalance when its filters went */
+  if ((pAdapter->state == SFVMK_ADAPTER_STATE_STARTED) &&
+      pAdapter->filterRebalance.inProgress) {
+    sfvmk_getTime(&currentTime);
+    if (currentTime - pAdapter->filterRebalance.lastOpTime <
+        SFVMK_FILTER_REBALANCE_MS * VMK_USEC_PER_MSEC) {
+      sfvmk_filterRebalanceSchedule(pAdapter);
+    } else {
+      sfvmk_filterRebalanceEnd(pAdapter);
+      sfvmk_updateQueueFilterCapacity(pAdapter);
+    }
+  }
+
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_FILTER);
+}
+
+/*! \brief  Note the end of a vmkernel filter operation. Adapter lock
+**         must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_filterRebalanceOpDone(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_getTime(&pAdapter->filterRebalance.lastOpTime);
+  sfvmk_filterRebalanceSchedule(pAdapter);
+}
+
+/*! \brief  End the rebalance in progress, if any: the filters it parked
+**         are removed in one batch and its latency, from the first
+**         filter operation to the last HW filter change, is recorded.
+**         Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_filterRebalanceEnd(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_filterRebalance_t *pRebalance = &pAdapter->filterRebalance;
+  vmk_uint64 commits = pAdapter->filterStats[SFVMK_FILTER_BATCH_COMMITS];
+  vmk_uint64 endTime = pRebalance->lastOpTime;
+  vmk_uint64 latency;
+
+  sfvmk_flushParkedFilters(pAdapter);
+  if (pAdapter->filterStats[SFVMK_FILTER_BATCH_COMMITS] != commits)
+    sfvmk_getTime(&endTime);
+
+  if (!pRebalance->inProgress)
+    return;
+
+  pRebalance->inProgress = VMK_FALSE;
+  latency = endTime - pRebalance->startTime;
+
+  pAdapter->filterStats[SFVMK_FILTER_REBALANCES]++;
+  pAdapter->filterStats[SFVMK_FILTER_REBALANCE_OPS] += pRebalance->numOps;
+  pAdapter->filterStats[SFVMK_FILTER_REBALANCE_COMMITS] +=
+    pAdapter->filterStats[SFVMK_FILTER_BATCH_COMMITS] - pRebalance->startCommits;
+  pAdapter->filterStats[SFVMK_FILTER_REBALANCE_LAST_USEC] = latency;
+  pAdapter->filterStats[SFVMK_FILTER_REBALANCE_TOTAL_USEC] += latency;
+  if (latency > pAdapter->filterStats[SFVMK_FILTER_REBALANCE_MAX_USEC])
+    pAdapter->filterStats[SFVMK_FILTER_REBALANCE_MAX_USEC] = latency;
+}
+
+/*! \brief  Keep the HW filters of a filter DB entry removed by the
+**         vmkernel until the rebalance ends, so that an apply of the same
+**         match to another queue can move them without a window where no
+**         filter is installed. Whatever is still parked when the
+**         rebalance ends is removed in one batch.
+**
+** An entry promoted to EFX_FILTER_PRI_REQUIRED by an earlier move is
+** put back to EFX_FILTER_PRI_MANUAL here, as a higher priority insert
+** is what lets the next move replace it atomically. The vmkernel has
+** already taken the filter away, so the two back to back operations do
+** not open a window on a filter it still relies on.
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry being removed
+**
+** \return: VMK_OK [success] VMK_NO_RESOURCES [no free park slot]
+**          error code [demotion failed, the HW filters are unchanged]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_parkFilterRule(sfvmk_adapter_t *pAdapter,
+                     sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  sfvmk_filterParked_t *pParked = NULL;
+  sfvmk_filterBatch_t batch;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  for (i = 0; i < SFVMK_FILTER_PARK_MAX; i++) {
+    if (pAdapter->filterParked[i].parkTime == 0) {
+      pParked = &pAdapter->filterParked[i];
+      break;
+    }
+  }
+
+  if (pParked == NULL)
+    return VMK_NO_RESOURCES;
+
+  vmk_Memcpy(&pParked->entry, pFdbEntry, sizeof(pParked->entry));
+  pParked->entry.specIndexed = VMK_FALSE;
+  pParked->entry.pSpecNext = NULL;
+
+  if (pFdbEntry->spec[0].efs_priority == EFX_FILTER_PRI_REQUIRED) {
+    for (i = 0; i < pParked->entry.numHwFilter; i++)
+      pParked->entry.spec[i].efs_priority = EFX_FILTER_PRI_MANUAL;
+
+    sfvmk_filterBatchInit(&batch);
+    sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, pFdbEntry);
+    sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_INSERT, &pParked->entry);
+    status = sfvmk_filterBatchCommit(pAdapter, &batch);
+    if (status != VMK_OK)
+      return status;
+
+    pAdapter->filterStats[SFVMK_FILTER_PARK_DEMOTED]++;
+  }
+
+  sfvmk_getTime(&pParked->parkTime);
+  sfvmk_filterResAccount(pAdapter, &pParked->entry, VMK_TRUE);
+  pAdapter->filterStats[SFVMK_FILTER_PARKED]++;
+
+  return VMK_OK;
+}
+
+/*! \brief  Install a filter DB entry in place of a parked entry with the
+**         same match
+**
+** If both deliver to the same queue the parked HW filters are adopted.
+** Otherwise the new HW filters are inserted at a higher priority, which
+** makes the firmware replace the parked ones atomically. Parked entries
+** are always at EFX_FILTER_PRI_MANUAL, see sfvmk_parkFilterRule; one at
+** any other priority can not be replaced, its HW filters are removed and
+** the new ones inserted back to back in one batch.
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pParked    pointer to parked entry with the same match
+** \param[in]  pFdbEntry  pointer to filter DB entry to install
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_moveFilterRule(sfvmk_adapter_t *pAdapter,
+                     sfvmk_filterParked_t *pParked,
+                     sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  sfvmk_filterDBEntry_t *pOldEntry = &pParked->entry;
+  sfvmk_filterBatch_t batch;
+  vmk_uint64 currentTime;
+  vmk_Bool sameQueue = VMK_TRUE;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  sfvmk_getTime(&currentTime);
+
+  for (i = 0; i < pFdbEntry->numHwFilter; i++) {
+    if ((pOldEntry->spec[i].efs_dmaq_id != pFdbEntry->spec[i].efs_dmaq_id) ||
+        (pOldEntry->spec[i].efs_rss_context != pFdbEntry->spec[i].efs_rss_context) ||
+        (pOldEntry->spec[i].efs_flags != pFdbEntry->spec[i].efs_flags))
+      sameQueue = VMK_FALSE;
+  }
+
+  sfvmk_filterBatchInit(&batch);
+
+  if (sameQueue) {
+    vmk_Memcpy(pFdbEntry->spec, pOldEntry->spec, sizeof(pFdbEntry->spec));
+    pAdapter->filterStats[SFVMK_FILTER_MOVES_ADOPTED]++;
+  } else if (pOldEntry->spec[0].efs_priority == EFX_FILTER_PRI_MANUAL) {
+    for (i = 0; i < pFdbEntry->numHwFilter; i++)
+      pFdbEntry->spec[i].efs_priority = EFX_FILTER_PRI_REQUIRED;
+
+    sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_INSERT, pFdbEntry);
+    status = sfvmk_filterBatchCommit(pAdapter, &batch);
+    if (status != VMK_OK) {
+      for (i = 0; i < pFdbEntry->numHwFilter; i++)
+        pFdbEntry->spec[i].efs_priority = EFX_FILTER_PRI_MANUAL;
+      return status;
+    }
+
+    pAdapter->filterStats[SFVMK_FILTER_MOVES_REPLACED]++;
+  } else {
+    sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, pOldEntry);
+    sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_INSERT, pFdbEntry);
+    status = sfvmk_filterBatchCommit(pAdapter, &batch);
+    if (status != VMK_OK)
+      return status;
+
+    pAdapter->filterStats[SFVMK_FILTER_MOVES_BATCHED]++;
+  }
+
+  /* Time the vmkernel left between removing and applying the filter,
+   * traffic of the match used to fall back to the default queue */
+  pAdapter->filterStats[SFVMK_FILTER_MOVE_WINDOW_USEC] =
+    currentTime - pParked->parkTime;
+  pParked->parkTime = 0;
+  sfvmk_filterResAccount(pAdapter, pOldEntry, VMK_FALSE);
+
+  return VMK_OK;
+}
+
+/*! \brief  Remove at once the parked HW filters of a match the vmkernel
+**         applied to the default queue. No filter is installed for the
+**         default queue, so there is nothing to move them to.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  pFilter   filter applied to the default queue
+**
+** \return: void
+**
+*/
+void
+sfvmk_filterParkedDrop(sfvmk_adapter_t *pAdapter,
+                       vmk_UplinkQueueFilter *pFilter)
+{
+  sfvmk_filterDBEntry_t *pFdbEntry;
+  sfvmk_filterParked_t *pParked;
+  sfvmk_filterBatch_t batch;
+  vmk_uint32 i;
+
+  pFdbEntry = sfvmk_allocFilterRule(pAdapter);
+  if (pFdbEntry == NULL)
+    return;
+
+  if (sfvmk_prepareFilterRule(pAdapter, pFilter, pFdbEntry, 0, 0, 0) != VMK_OK)
+    goto done;
+
+  for (i = 0; i < SFVMK_FILTER_PARK_MAX; i++) {
+    pParked = &pAdapter->filterParked[i];
+    if ((pParked->parkTime == 0) ||
+        !sfvmk_filterSameMatch(&pParked->entry, pFdbEntry))
+      continue;
+
+    sfvmk_filterBatchInit(&batch);
+    sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, &pParked->entry);
+    if (sfvmk_filterBatchCommit(pAdapter, &batch) != VMK_OK) {
+      /* Left for the end of the rebalance to retry */
+      SFVMK_ADAPTER_ERROR(pAdapter, "Failed to remove parked filter %u",
+                          pParked->entry.key);
+      break;
+    }
+
+    pParked->parkTime = 0;
+    sfvmk_filterResAccount(pAdapter, &pParked->entry, VMK_FALSE);
+    pAdapter->filterStats[SFVMK_FILTER_PARK_FLUSHED]++;
+    break;
+  }
+
+done:
+  sfvmk_freeFilterRule(pAdapter, pFdbEntry);
+}
+
+/*! \brief  insert a filter rule
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry
+**
+** \return: VMK_OK if success, error number if failed
+**
+*/
+VMK_ReturnStatus
+sfvmk_insertFilterRule(sfvmk_adapter_t *pAdapter,
+                       sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  sfvmk_filterParked_t *pParked;
+  sfvmk_filterBatch_t batch;
+  vmk_uint32 i;
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  if (sfvmk_matchFilterRule(pAdapter, pFdbEntry) != NULL) {
+    status = VMK_EXISTS;
+    goto done;
+  }
+
+  for (i = 0; i < SFVMK_FILTER_PARK_MAX; i++) {
+    pParked = &pAdapter->filterParked[i];
+    if ((pParked->parkTime != 0) &&
+        sfvmk_filterSameMatch(&pParked->entry, pFdbEntry)) {
+      status = sfvmk_moveFilterRule(pAdapter, pParked, pFdbEntry);
+      goto check_status;
+    }
+  }
+
+  if (!sfvmk_filterResAdmit(pAdapter, pFdbEntry)) {
+    status = VMK_NO_SPACE;
+    goto done;
+  }
+
+  sfvmk_filterBatchInit(&batch);
+  sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_INSERT, pFdbEntry);
+
+  status = sfvmk_filterBatchCommit(pAdapter, &batch);
+
+check_status:
+  if (status != VMK_OK) {
+    if (status != VMK_NO_SPACE)
+      status = VMK_FAILURE;
+    goto done;
+  }
+
+  sfvmk_filterSpecIndexAdd(pAdapter, pFdbEntry);
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
+                      "Hw filter inserted successfully");
+
+done:
+  return status;
+}
+
+/*! \brief  Find the entry replayed after a driver reset that an uplink
+**         filter applied again by the vmkernel matches, on the same
+**         queue. The entry is adopted once: the caller returns its key
+**         instead of inserting a duplicate.
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to prepared filter DB entry
+**
+** \return: replayed entry, NULL if none matches
+**
+*/
+sfvmk_filterDBEntry_t *
+sfvmk_filterReplayedAdopt(sfvmk_adapter_t *pAdapter,
+                          sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  sfvmk_filterDBEntry_t *pKeptEntry;
+
+  pKeptEntry = sfvmk_matchFilterRule(pAdapter, pFdbEntry);
+  if ((pKeptEntry == NULL) || !pKeptEntry->replayed ||
+      (pKeptEntry->qID != pFdbEntry->qID))
+    return NULL;
+
+  pKeptEntry->replayed = VMK_FALSE;
+  pAdapter->filterStats[SFVMK_FILTER_REPLAY_ADOPTED]++;
+
+  return pKeptEntry;
+}
+
+/*! \brief  find and remove filter rule for given filterKey
+**
+** The HW filters are parked rather than removed when a park slot is
+** free, see sfvmk_parkFilterRule.
+**
+** \param[in]  pAdapter    pointer to sfvmk_adapter_t
+** \param[in]  filterKey   filter key of already created filter.
+**
+** \return: pointer to pFdbEntry if success, NULL if failed
+**
+*/
+sfvmk_filterDBEntry_t *
+sfvmk_removeFilterRule(sfvmk_adapter_t *pAdapter, vmk_uint32 filterKey)
+{
+  sfvmk_filterDBEntry_t *pFdbEntry;
+  sfvmk_filterBatch_t batch;
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  if (vmk_HashIsEmpty(pAdapter->filterDBHashTable)) {
+    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
+                        "Filter hash database table is empty");
+    return NULL;
+  }
+
+  status = vmk_HashKeyFind(pAdapter->filterDBHashTable,
+                           (vmk_HashKey)(vmk_uint64)filterKey,
+                           (vmk_HashValue *)&pFdbEntry);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_DBG,
+                        "vmk_HashKeyFind failed with error code %s",
+                        vmk_StatusToString(status));
+    return NULL;
+  }
+
+  if (!pFdbEntry) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "pFdbEntry is NULL for filter ID %d,"
+                        "This is unexpected", filterKey);
+    return NULL;
+  }
+
+  if (sfvmk_parkFilterRule(pAdapter, pFdbEntry) == VMK_OK)
+    return pFdbEntry;
+
+  sfvmk_filterBatchInit(&batch);
+  sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, pFdbEntry);
+
+  /* On failure the HW filters already removed are restored and the
+   * entry stays in the filter DB */
+  status = sfvmk_filterBatchCommit(pAdapter, &batch);
+  if (status != VMK_OK)
+    return NULL;
+
+  return pFdbEntry;
+}
+
+/*! \brief  Hash of an aRFS flow key
+**
+** \param[in]  pKey  pointer to flow key
+**
+** \return: 32 bit hash
+**
+*/
+static vmk_uint32
+sfvmk_arfsFlowHash(const sfvmk_arfsFlowKey_t *pKey)
+{
+  vmk_uint32 hash;
+
+  hash = pKey->localIp * 2654435761U;
+  hash = (hash ^ pKey->remoteIp) * 2654435761U;
+  hash = (hash ^ (((vmk_uint32)pKey->localPort << 16) | pKey->remotePort)) *
+         2654435761U;
+  hash ^= pKey->proto;
+
+  return hash ^ (hash >> 16);
+}
+
+/*! \brief  Compare two aRFS flow keys
+**
+** \param[in]  pKeyA  pointer to flow key
+** \param[in]  pKeyB  pointer to flow key
+**
+** \return: VMK_TRUE if the keys are equal, VMK_FALSE otherwise
+**
+*/
+static inline vmk_Bool
+sfvmk_arfsKeyEqual(const sfvmk_arfsFlowKey_t *pKeyA,
+                   const sfvmk_arfsFlowKey_t *pKeyB)
+{
+  return ((pKeyA->localIp == pKeyB->localIp) &&
+          (pKeyA->remoteIp == pKeyB->remoteIp) &&
+          (pKeyA->localPort == pKeyB->localPort) &&
+          (pKeyA->remotePort == pKeyB->remotePort) &&
+          (pKeyA->proto == pKeyB->proto));
+}
+
+/*! \brief  Remove the filter installed for an aRFS flow, if any
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  pFlow     pointer to flow table entry
+**
+** \return: void
+**
+*/
+static void
+sfvmk_arfsFlowUnsteer(sfvmk_adapter_t *pAdapter, sfvmk_arfsFlow_t *pFlow)
+{
+  sfvmk_filterBatch_t batch;
+
+  if (pFlow->pFdbEntry == NULL)
+    return;
+
+  sfvmk_filterBatchInit(&batch);
+  sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, pFlow->pFdbEntry);
+  sfvmk_filterBatchCommit(pAdapter, &batch);
+
+  sfvmk_freeFilterRule(pAdapter, pFlow->pFdbEntry);
+  pFlow->pFdbEntry = NULL;
+}
+
+/*! \brief  Release an aRFS flow table entry and its filter
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  pFlow     pointer to flow table entry
+**
+** \return: void
+**
+*/
+static void
+sfvmk_arfsFlowFree(sfvmk_adapter_t *pAdapter, sfvmk_arfsFlow_t *pFlow)
+{
+  sfvmk_arfsFlowUnsteer(pAdapter, pFlow);
+  pFlow->lastSeen = 0;
+  pAdapter->arfs.numFlows--;
+}
+
+/*! \brief  Record a flow seen on the TX side. The flow table is set
+**         associative, a new flow evicts the least recently seen flow
+**         of its set when the set is full.
+**
+** \param[in]  pAdapter     pointer to sfvmk_adapter_t
+** \param[in]  pKey         pointer to flow key
+** \param[in]  rxqIndex     RXQ affine to the PCPU the flow was sent from
+** \param[in]  currentTime  time in usec
+**
+** \return: void
+**
+*/
+static void
+sfvmk_arfsFlowUpdate(sfvmk_adapter_t *pAdapter,
+                     const sfvmk_arfsFlowKey_t *pKey,
+                     vmk_uint32 rxqIndex,
+                     vmk_uint64 currentTime)
+{
+  sfvmk_arfs_t *pArfs = &pAdapter->arfs;
+  sfvmk_arfsFlow_t *pSet;
+  sfvmk_arfsFlow_t *pVictim = NULL;
+  vmk_uint32 numSets = pArfs->maxFlows / SFVMK_ARFS_WAYS;
+  vmk_uint32 way;
+
+  pSet = &pArfs->pFlows[(sfvmk_arfsFlowHash(pKey) & (numSets - 1)) *
+                        SFVMK_ARFS_WAYS];
+
+  for (way = 0; way < SFVMK_ARFS_WAYS; way++) {
+    if ((pSet[way].lastSeen != 0) && sfvmk_arfsKeyEqual(&pSet[way].key, pKey)) {
+      pSet[way].lastSeen = currentTime;
+      if (pSet[way].rxqIndex != rxqIndex) {
+        /* The consumer moved, steer the flow again */
+        sfvmk_arfsFlowUnsteer(pAdapter, &pSet[way]);
+        pSet[way].rxqIndex = rxqIndex;
+        pArfs->stats[SFVMK_ARFS_MOVED]++;
+      }
+      return;
+    }
+
+    if ((pVictim == NULL) || (pSet[way].lastSeen < pVictim->lastSeen))
+      pVictim = &pSet[way];
+  }
+
+  if (pVictim->lastSeen != 0) {
+    sfvmk_arfsFlowFree(pAdapter, pVictim);
+    pArfs->stats[SFVMK_ARFS_EVICTED]++;
+  }
+
+  pVictim->key = *pKey;
+  pVictim->rxqIndex = rxqIndex;
+  pVictim->lastSeen = currentTime;
+  pVictim->pFdbEntry = NULL;
+  pArfs->numFlows++;
+  pArfs->stats[SFVMK_ARFS_LEARNT]++;
+}
+
+/*! \brief  Install a full 5-tuple filter steering an aRFS flow to its RXQ
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  pFlow     pointer to flow table entry
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_arfsFlowSteer(sfvmk_adapter_t *pAdapter, sfvmk_arfsFlow_t *pFlow)
+{
+  sfvmk_filterDBEntry_t *pFdbEntry;
+  sfvmk_rxq_t *pRxq;
+  VMK_ReturnStatus status;
+
+  pRxq = pAdapter->ppRxq[pFlow->rxqIndex];
+  if (pRxq == NULL)
+    return VMK_BAD_PARAM;
+
+  pFdbEntry = sfvmk_allocFilterRule(pAdapter);
+  if (pFdbEntry == NULL)
+    return VMK_NO_MEMORY;
+
+  /* Driver owned filters have no uplink filter class or key */
+  pFdbEntry->class = VMK_UPLINK_QUEUE_FILTER_CLASS_NONE;
+  pFdbEntry->qID = pFlow->rxqIndex;
+  pFdbEntry->numHwFilter = 1;
+
+  /* Hint priority, any uplink or management filter takes precedence */
+  efx_filter_spec_init_rx(&pFdbEntry->spec[0], EFX_FILTER_PRI_HINT, 0,
+                          pRxq->pCommonRxq);
+
+  /* Received packets of the flow have the TX source as destination */
+  status = efx_filter_spec_set_ipv4_full(&pFdbEntry->spec[0],
+                                         pFlow->key.proto,
+                                         pFlow->key.localIp,
+                                         pFlow->key.localPort,
+                                         pFlow->key.remoteIp,
+                                         pFlow->key.remotePort);
+  if (status != VMK_OK)
+    goto failed;
+
+  status = sfvmk_insertFilterRule(pAdapter, pFdbEntry);
+  if (status != VMK_OK)
+    goto failed;
+
+  pFlow->pFdbEntry = pFdbEntry;
+  return VMK_OK;
+
+failed:
+  sfvmk_freeFilterRule(pAdapter, pFdbEntry);
+  return status;
+}
+
+/*! \brief  Get the RXQs an aRFS flow seen on a TXQ may be steered to.
+**         Flows of the default queue and of the RSS queues are spread by
+**         RSS, steering one of them to another RXQ of the RSS pool only
+**         changes which of these RXQs takes it. Flows of a NetQueue with
+**         an RSS context stay within the RXQs of the context. Other
+**         NetQueue flows are already steered to their queue by the MAC
+**         filter and storage queues are left alone.
+**
+** \param[in]   pAdapter   pointer to sfvmk_adapter_t
+** \param[in]   txqIndex   TXQ index
+** \param[out]  pStart     first RXQ
+** \param[out]  pCount     number of RXQs
+**
+** \return: VMK_TRUE if flows of the TXQ may be steered
+**
+*/
+static vmk_Bool
+sfvmk_arfsRxqRange(sfvmk_adapter_t *pAdapter,
+                   vmk_uint32 txqIndex,
+                   vmk_uint32 *pStart,
+                   vmk_uint32 *pCount)
+{
+  vmk_uint32 i;
+
+  if (!sfvmk_isRSSEnable(pAdapter) || !pAdapter->rssInit)
+    return VMK_FALSE;
+
+  *pCount = pAdapter->numRSSQs;
+
+  if ((txqIndex == pAdapter->defRxqIndex) ||
+      (txqIndex == pAdapter->uplink.rssUplinkQueue)) {
+    *pStart = sfvmk_getRSSQStartIndex(pAdapter);
+    return VMK_TRUE;
+  }
+
+  for (i = 0; i < pAdapter->rssCtxMax; i++) {
+    if (pAdapter->rssCtx[i].inUse && (pAdapter->rssCtx[i].qID == txqIndex)) {
+      *pStart = sfvmk_getRssCtxQStartIndex(pAdapter, i);
+      return VMK_TRUE;
+    }
+  }
+
+  return VMK_FALSE;
+}
+
+/*! \brief  Find the RXQ whose EVQ interrupt was last delivered on a PCPU
+**
+** \param[in]   pAdapter   pointer to sfvmk_adapter_t
+** \param[in]   start      first RXQ to look at
+** \param[in]   count      number of RXQs to look at
+** \param[in]   pcpu       PCPU the flow was transmitted from
+** \param[out]  pRxqIndex  RXQ index
+**
+** \return: VMK_TRUE if an RXQ is affine to the PCPU
+**
+*/
+static vmk_Bool
+sfvmk_arfsAffineRxq(sfvmk_adapter_t *pAdapter,
+                    vmk_uint32 start,
+                    vmk_uint32 count,
+                    vmk_uint32 pcpu,
+                    vmk_uint32 *pRxqIndex)
+{
+  sfvmk_evq_t *pEvq;
+  vmk_uint32 qIndex;
+
+  /* RXQ n completes on EVQ n */
+  for (qIndex = start; qIndex < start + count; qIndex++) {
+    if ((qIndex >= pAdapter->numRxqsAllocated) ||
+        (qIndex >= pAdapter->numEvqsAllocated))
+      break;
+
+    pEvq = pAdapter->ppEvq[qIndex];
+    if ((pEvq != NULL) && (pEvq->intrPCPU == pcpu)) {
+      *pRxqIndex = qIndex;
+      return VMK_TRUE;
+    }
+  }
+
+  return VMK_FALSE;
+}
+
+/*! \brief  Learn the flows sampled on the TXQs since the last scan, age
+**         out idle flows and steer new ones within the insert budget.
+**         Each flow goes to the RXQ whose EVQ interrupt is delivered on
+**         the PCPU that transmits it, so that its receive processing
+**         runs where the consumer runs. Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+**
+*/
+static void
+sfvmk_arfsScan(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_arfs_t *pArfs = &pAdapter->arfs;
+  sfvmk_arfsSample_t learnt[SFVMK_ARFS_LEARN_SLOTS];
+  sfvmk_arfsFlow_t *pFlow;
+  sfvmk_txq_t *pTxq;
+  vmk_uint64 currentTime;
+  vmk_uint32 budget = SFVMK_ARFS_INSERT_BUDGET;
+  vmk_uint32 numLearnt;
+  vmk_uint32 rxqStart = 0;
+  vmk_uint32 rxqCount = 0;
+  vmk_uint32 rxqIndex;
+  vmk_uint32 qIndex;
+  vmk_uint32 i;
+  vmk_Bool learn;
+
+  sfvmk_getTime(&currentTime);
+
+  /* Per EVQ interrupts are needed to tell which RXQ is served where */
+  learn = ((pAdapter->intr.type == EFX_INTR_MESSAGE) &&
+           (pAdapter->intr.numIntrAlloc > 1) &&
+           !pAdapter->intr.sharedVector);
+
+  for (qIndex = 0; qIndex < pAdapter->numTxqsAllocated; qIndex++) {
+    pTxq = pAdapter->ppTxq[qIndex];
+    if (pTxq == NULL)
+      continue;
+
+    sfvmk_txqLock(pTxq);
+    pTxq->arfsLearn = learn && sfvmk_arfsRxqRange(pAdapter, qIndex,
+                                                  &rxqStart, &rxqCount);
+    numLearnt = pTxq->numArfsLearnt;
+    vmk_Memcpy(learnt, pTxq->arfsLearnt, numLearnt * sizeof(learnt[0]));
+    pTxq->numArfsLearnt = 0;
+    sfvmk_txqUnlock(pTxq);
+
+    if (!pTxq->arfsLearn)
+      continue;
+
+    /* Flows sent from a PCPU serving none of the RXQs are left to RSS */
+    for (i = 0; i < numLearnt; i++) {
+      if (sfvmk_arfsAffineRxq(pAdapter, rxqStart, rxqCount,
+                              learnt[i].pcpu, &rxqIndex))
+        sfvmk_arfsFlowUpdate(pAdapter, &learnt[i].key, rxqIndex, currentTime);
+    }
+  }
+
+  for (i = 0; i < pArfs->maxFlows; i++) {
+    pFlow = &pArfs->pFlows[i];
+    if (pFlow->lastSeen == 0)
+      continue;
+
+    if (currentTime - pFlow->lastSeen > SFVMK_ARFS_EXPIRE_MS * VMK_USEC_PER_MSEC) {
+      sfvmk_arfsFlowFree(pAdapter, pFlow);
+      pArfs->stats[SFVMK_ARFS_EXPIRED]++;
+      continue;
+    }
+
+    if (pFlow->pFdbEntry != NULL)
+      continue;
+
+    if (budget == 0) {
+      pArfs->stats[SFVMK_ARFS_RATE_LIMITED]++;
+      continue;
+    }
+
+    budget--;
+    if (sfvmk_arfsFlowSteer(pAdapter, pFlow) == VMK_OK)
+      pArfs->stats[SFVMK_ARFS_STEERED]++;
+    else
+      pArfs->stats[SFVMK_ARFS_STEER_FAILED]++;
+  }
+}
+
+/*! \brief  Helper running the periodic aRFS scan
+**
+** \param[in]  data  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_arfsHelper(vmk_AddrCookie data)
+{
+  sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)data.ptr;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_FILTER);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  vmk_AtomicWrite64(&pAdapter->arfs.pending, 0);
+
+  if ((pAdapter->state != SFVMK_ADAPTER_STATE_STARTED) ||
+      (pAdapter->arfs.pFlows == NULL))
+    goto done;
+
+  sfvmk_arfsScan(pAdapter);
+  sfvmk_updateQueueFilterCapacity(pAdapter);
+  sfvmk_arfsSchedule(pAdapter);
+
+done:
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_FILTER);
+}
+
+/*! \brief  Queue the next aRFS scan if aRFS is enabled and no scan is
+**         queued yet. Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_arfsSchedule(sfvmk_adapter_t *pAdapter)
+{
+  vmk_HelperRequestProps props = {0};
+  VMK_ReturnStatus status;
+
+  if (pAdapter->arfs.maxFlows == 0)
+    return;
+
+  if (vmk_AtomicReadIfEqualWrite64(&pAdapter->arfs.pending, 0, 1) != 0)
+    return;
+
+  props.requestMayBlock = VMK_FALSE;
+  props.tag = (vmk_AddrCookie)NULL;
+  props.cancelFunc = NULL;
+  props.worldToBill = VMK_INVALID_WORLD_ID;
+  status = vmk_HelperSubmitDelayedRequest(pAdapter->helper,
+                                          sfvmk_arfsHelper,
+                                          (vmk_AddrCookie *)pAdapter,
+                                          SFVMK_ARFS_SCAN_MS,
+                                          &props);
+  if (status != VMK_OK) {
+    vmk_AtomicWrite64(&pAdapter->arfs.pending, 0);
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HelperSubmitDelayedRequest failed status: %s",
+                        vmk_StatusToString(status));
+  }
+}
+
+/*! \brief  Remove all aRFS flows and their filters
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_arfsFlush(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint32 i;
+
+  if (pAdapter->arfs.pFlows == NULL)
+    return;
+
+  /* Sampling resumes with the next scan */
+  for (i = 0; i < pAdapter->numTxqsAllocated; i++) {
+    if (pAdapter->ppTxq[i] != NULL)
+      pAdapter->ppTxq[i]->arfsLearn = VMK_FALSE;
+  }
+
+  for (i = 0; i < pAdapter->arfs.maxFlows; i++) {
+    if (pAdapter->arfs.pFlows[i].lastSeen != 0)
+      sfvmk_arfsFlowFree(pAdapter, &pAdapter->arfs.pFlows[i]);
+  }
+}
+
+/*! \brief  Build the HW filter of a management steering rule
+**
+** \param[in]      pAdapter   pointer to sfvmk_adapter_t
+** \param[in]      pInfo      pointer to rule definition
+** \param[in,out]  pFdbEntry  pointer to filter DB entry
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_steerRulePrepare(sfvmk_adapter_t *pAdapter,
+                       const sfvmk_filterRuleInfo_t *pInfo,
+                       sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  efx_filter_spec_t *pSpec = &pFdbEntry->spec[0];
+  efx_filter_priority_t priority;
+  /* libefx takes addresses in network byte order, ports in host order */
+  vmk_uint32 localIp = vmk_CPUToBE32(pInfo->localIp);
+  vmk_uint32 remoteIp = vmk_CPUToBE32(pInfo->remoteIp);
+  vmk_uint16 localPort = pInfo->localPort;
+  vmk_uint16 remotePort = pInfo->remotePort;
+  sfvmk_rxq_t *pRxq;
+
+  pRxq = pAdapter->ppRxq[pInfo->hwQIndex];
+  if (pRxq == NULL)
+    return VMK_BAD_PARAM;
+
+  /* Normal rules rank with NetQueue filters, high priority rules
+   * replace any filter with the same match whoever installed it */
+  priority = (pInfo->priority == SFVMK_MGMT_FILTER_RULE_PRIO_HIGH) ?
+             EFX_FILTER_PRI_REQUIRED : EFX_FILTER_PRI_MANUAL;
+
+  pFdbEntry->class = VMK_UPLINK_QUEUE_FILTER_CLASS_NONE;
+  pFdbEntry->qID = pInfo->hwQIndex;
+  pFdbEntry->ruleId = pInfo->ruleId;
+  pFdbEntry->numHwFilter = 1;
+
+  efx_filter_spec_init_rx(pSpec, priority, 0, pRxq->pCommonRxq);
+
+  if ((localIp != 0) && (localPort != 0) &&
+      (remoteIp != 0) && (remotePort != 0))
+    return efx_filter_spec_set_ipv4_full(pSpec, pInfo->ipProto,
+                                         localIp, localPort,
+                                         remoteIp, remotePort);
+
+  if ((localIp != 0) && (localPort != 0) &&
+      (remoteIp == 0) && (remotePort == 0))
+    return efx_filter_spec_set_ipv4_local(pSpec, pInfo->ipProto,
+                                          localIp, localPort);
+
+  /* Partial matches, e.g. the port of a storage service alone. The
+   * firmware refuses the combinations it can not match on insert */
+  pSpec->efs_match_flags |= EFX_FILTER_MATCH_ETHER_TYPE |
+                            EFX_FILTER_MATCH_IP_PROTO;
+  pSpec->efs_ether_type = EFX_ETHER_TYPE_IPV4;
+  pSpec->efs_ip_proto = pInfo->ipProto;
+
+  if (localIp != 0) {
+    pSpec->efs_match_flags |= EFX_FILTER_MATCH_LOC_HOST;
+    pSpec->efs_loc_host.eo_u32[0] = localIp;
+  }
+
+  if (localPort != 0) {
+    pSpec->efs_match_flags |= EFX_FILTER_MATCH_LOC_PORT;
+    pSpec->efs_loc_port = localPort;
+  }
+
+  if (remoteIp != 0) {
+    pSpec->efs_match_flags |= EFX_FILTER_MATCH_REM_HOST;
+    pSpec->efs_rem_host.eo_u32[0] = remoteIp;
+  }
+
+  if (remotePort != 0) {
+    pSpec->efs_match_flags |= EFX_FILTER_MATCH_REM_PORT;
+    pSpec->efs_rem_port = remotePort;
+  }
+
+  return VMK_OK;
+}
+
+/*! \brief  Install the HW filter of a management steering rule
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  pRule     pointer to steering rule
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_steerRuleInstall(sfvmk_adapter_t *pAdapter, sfvmk_steerRule_t *pRule)
+{
+  sfvmk_filterDBEntry_t *pFdbEntry;
+  VMK_ReturnStatus status;
+
+  pFdbEntry = sfvmk_allocFilterRule(pAdapter);
+  if (pFdbEntry == NULL)
+    return VMK_NO_MEMORY;
+
+  status = sfvmk_steerRulePrepare(pAdapter, &pRule->info, pFdbEntry);
+  if (status != VMK_OK)
+    goto failed;
+
+  status = sfvmk_insertFilterRule(pAdapter, pFdbEntry);
+  if (status != VMK_OK)
+    goto failed;
+
+  pRule->pFdbEntry = pFdbEntry;
+  return VMK_OK;
+
+failed:
+  SFVMK_ADAPTER_ERROR(pAdapter, "Steering rule %u install failed status: %s",
+                      pRule->info.ruleId, vmk_StatusToString(status));
+  sfvmk_freeFilterRule(pAdapter, pFdbEntry);
+  return status;
+}
+
+/*! \brief  Remove the HW filter of a management steering rule, if any.
+**         The rule definition is kept.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  pRule     pointer to steering rule
+**
+** \return: void
+**
+*/
+static void
+sfvmk_steerRuleUninstall(sfvmk_adapter_t *pAdapter, sfvmk_steerRule_t *pRule)
+{
+  sfvmk_filterBatch_t batch;
+
+  if (pRule->pFdbEntry == NULL)
+    return;
+
+  sfvmk_filterBatchInit(&batch);
+  sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_REMOVE, pRule->pFdbEntry);
+  sfvmk_filterBatchCommit(pAdapter, &batch);
+
+  sfvmk_freeFilterRule(pAdapter, pRule->pFdbEntry);
+  pRule->pFdbEntry = NULL;
+}
+
+/*! \brief  Add a management steering rule and install it if the adapter
+**         is started. Adapter lock must be held.
+**
+** \param[in]      pAdapter  pointer to sfvmk_adapter_t
+** \param[in,out]  pInfo     pointer to rule definition, the rule ID and
+**                           the resolved RXQ are filled in
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+VMK_ReturnStatus
+sfvmk_steerRuleAdd(sfvmk_adapter_t *pAdapter, sfvmk_filterRuleInfo_t *pInfo)
+{
+  sfvmk_steerRule_t *pRule = NULL;
+  sfvmk_filterRuleInfo_t *pCur;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  if (((pInfo->ipProto != EFX_IPPROTO_TCP) &&
+       (pInfo->ipProto != EFX_IPPROTO_UDP)) ||
+      ((pInfo->localIp == 0) && (pInfo->localPort == 0) &&
+       (pInfo->remoteIp == 0) && (pInfo->remotePort == 0)) ||
+      (pInfo->priority >= SFVMK_MGMT_FILTER_RULE_PRIO_INVALID))
+    return VMK_BAD_PARAM;
+
+  if (pInfo->qIndex == SFVMK_MGMT_FILTER_RULE_STORAGE_RXQ) {
+    if (pAdapter->storageRxq == 0)
+      return VMK_NOT_SUPPORTED;
+    pInfo->hwQIndex = pAdapter->storageRxq;
+  } else if (pInfo->qIndex < pAdapter->numRxqsAllocated) {
+    pInfo->hwQIndex = pInfo->qIndex;
+  } else {
+    return VMK_BAD_PARAM;
+  }
+
+  for (i = 0; i < SFVMK_MGMT_FILTER_RULE_MAX; i++) {
+    pCur = &pAdapter->steerRules[i].info;
+    if (pCur->ruleId == 0) {
+      if (pRule == NULL)
+        pRule = &pAdapter->steerRules[i];
+      continue;
+    }
+
+    if ((pCur->ipProto == pInfo->ipProto) &&
+        (pCur->localIp == pInfo->localIp) &&
+        (pCur->localPort == pInfo->localPort) &&
+        (pCur->remoteIp == pInfo->remoteIp) &&
+        (pCur->remotePort == pInfo->remotePort))
+      return VMK_EXISTS;
+  }
+
+  if (pRule == NULL)
+    return VMK_LIMIT_EXCEEDED;
+
+  /* IDs are not reused soon, a stale ID does not remove another rule */
+  if (++pAdapter->steerRuleId == 0)
+    pAdapter->steerRuleId = 1;
+
+  pInfo->ruleId = pAdapter->steerRuleId;
+  pInfo->installed = VMK_FALSE;
+  pRule->info = *pInfo;
+  pRule->pFdbEntry = NULL;
+
+  /* Rules added while stopped are installed on start */
+  if (pAdapter->state != SFVMK_ADAPTER_STATE_STARTED)
+    return VMK_OK;
+
+  status = sfvmk_steerRuleInstall(pAdapter, pRule);
+  if (status != VMK_OK) {
+    pRule->info.ruleId = 0;
+    pInfo->ruleId = 0;
+    return status;
+  }
+
+  pInfo->installed = VMK_TRUE;
+  sfvmk_updateQueueFilterCapacity(pAdapter);
+
+  return VMK_OK;
+}
+
+/*! \brief  Remove a management steering rule and its HW filter.
+**         Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  ruleId    ID returned when the rule was added
+**
+** \return: VMK_OK [success] VMK_NOT_FOUND [no such rule]
+**
+*/
+VMK_ReturnStatus
+sfvmk_steerRuleDel(sfvmk_adapter_t *pAdapter, vmk_uint32 ruleId)
+{
+  sfvmk_steerRule_t *pRule;
+  vmk_uint32 i;
+
+  if (ruleId == 0)
+    return VMK_NOT_FOUND;
+
+  for (i = 0; i < SFVMK_MGMT_FILTER_RULE_MAX; i++) {
+    pRule = &pAdapter->steerRules[i];
+    if (pRule->info.ruleId != ruleId)
+      continue;
+
+    sfvmk_steerRuleUninstall(pAdapter, pRule);
+    pRule->info.ruleId = 0;
+
+    if (pAdapter->state == SFVMK_ADAPTER_STATE_STARTED)
+      sfvmk_updateQueueFilterCapacity(pAdapter);
+
+    return VMK_OK;
+  }
+
+  return VMK_NOT_FOUND;
+}
+
+/*! \brief  List the management steering rules. Adapter lock must be held.
+**
+** \param[in]   pAdapter  pointer to sfvmk_adapter_t
+** \param[out]  pRuleReq  pointer to rule request filled with all rules
+**
+** \return: void
+**
+*/
+void
+sfvmk_steerRuleList(sfvmk_adapter_t *pAdapter, sfvmk_filterRuleReq_t *pRuleReq)
+{
+  sfvmk_steerRule_t *pRule;
+  vmk_uint32 i;
+
+  pRuleReq->numRules = 0;
+
+  for (i = 0; i < SFVMK_MGMT_FILTER_RULE_MAX; i++) {
+    pRule = &pAdapter->steerRules[i];
+    if (pRule->info.ruleId == 0)
+      continue;
+
+    pRuleReq->rules[pRuleReq->numRules] = pRule->info;
+    pRuleReq->rules[pRuleReq->numRules].installed =
+      (pRule->pFdbEntry != NULL) ? VMK_TRUE : VMK_FALSE;
+    pRuleReq->numRules++;
+  }
+}
+
+/*! \brief  Install all management steering rules once the filter DB is
+**         set up again, so that rules survive resets. A rule failing to
+**         install is kept and reported as not installed.
+**         Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_steerRulesRestore(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_steerRule_t *pRule;
+  vmk_uint32 numRestored = 0;
+  vmk_uint32 i;
+
+  for (i = 0; i < SFVMK_MGMT_FILTER_RULE_MAX; i++) {
+    pRule = &pAdapter->steerRules[i];
+    if ((pRule->info.ruleId == 0) || (pRule->pFdbEntry != NULL))
+      continue;
+
+    if (sfvmk_steerRuleInstall(pAdapter, pRule) == VMK_OK)
+      numRestored++;
+  }
+
+  if (numRestored != 0) {
+    sfvmk_updateQueueFilterCapacity(pAdapter);
+    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_INFO,
+                        "Restored %u steering rules", numRestored);
+  }
+}
+
+/*! \brief  Remove the HW filters of all management steering rules,
+**         keeping the rules for sfvmk_steerRulesRestore
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_steerRulesFlush(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint32 i;
+
+  for (i = 0; i < SFVMK_MGMT_FILTER_RULE_MAX; i++)
+    sfvmk_steerRuleUninstall(pAdapter, &pAdapter->steerRules[i]);
+}
+
+/*! \brief Iterator used to pop a filter DB entry from hash
+**         table and fill the filter DB Iterator context
+**         structure entry.
+**
+** \param[in]     htbl   Hash handle.
+** \param[in]     key    Hash key.
+** \param[in]     value  Hash entry vlaue stored at key
+** \param[in,out] data   pointer to sfvmk_filterDBIterCtx_t
+**
+** \return: Key iterator stop command.
+**
+*/
+static vmk_HashKeyIteratorCmd
+sfvmk_getFilterDBHashIter(vmk_HashTable htbl, vmk_HashKey key,
+                          vmk_HashValue value, vmk_AddrCookie data)
+{
+  sfvmk_filterDBIterCtx_t *pIterCtx = data.ptr;
   sfvmk_filterDBEntry_t *pFdbEntry = value;
 
   if (!pIterCtx || !pFdbEntry)
@@ -583,21 +2153,60 @@ sfvmk_getFilterDBHashIter(vmk_HashTable htbl, vmk_HashKey key,
   return VMK_HASH_KEY_ITER_CMD_STOP;
 }
 
+/*! \brief  Drop an uplink filter DB entry whose HW filters are removed
+**         or gone, and release its uplink queue filter
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pFdbEntry  pointer to filter DB entry
+**
+** \return: void
+**
+*/
+static void
+sfvmk_filterDBEntryDrop(sfvmk_adapter_t *pAdapter,
+                        sfvmk_filterDBEntry_t *pFdbEntry)
+{
+  vmk_uint32 qID;
+  VMK_ReturnStatus status;
+
+  /* There is one to one mapping between RX HWQs index and uplinkQ index
+   * except for RSSQs. */
+  if (pFdbEntry->qID == sfvmk_getRSSQStartIndex(pAdapter)) {
+    qID = pAdapter->uplink.rssUplinkQueue;
+  } else {
+    qID = pFdbEntry->qID;
+  }
+
+  sfvmk_removeUplinkFilter(pAdapter, qID);
+  status = vmk_HashKeyDelete(pAdapter->filterDBHashTable,
+                             (vmk_HashKey)(vmk_uint64)pFdbEntry->key,
+                             NULL);
+  if (status != VMK_OK)
+    SFVMK_ADAPTER_ERROR(pAdapter, "Delete key entry failed with error %s",
+                        vmk_StatusToString(status));
+
+  sfvmk_freeFilterRule(pAdapter, pFdbEntry);
+}
+
 /*! \brief  clear all filters in the filter database hash
 **
-** \param[in]  pAdapter pointer to sfvmk_adapter_t
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  hwRemove  VMK_FALSE when the HW filters are already gone
 **
 ** \return: void
 **
 */
 static void
-sfvmk_clearAllFilterRules(sfvmk_adapter_t *pAdapter)
+sfvmk_clearAllFilterRules(sfvmk_adapter_t *pAdapter, vmk_Bool hwRemove)
 {
-  sfvmk_filterDBIterCtx_t iterCtx = {VMK_FALSE, NULL};
+  sfvmk_filterDBIterCtx_t iterCtx = {NULL};
   sfvmk_filterDBEntry_t *pFdbEntry;
   VMK_ReturnStatus status = VMK_FAILURE;
   vmk_uint32 i;
-  vmk_uint32 qID;
+
+  sfvmk_steerRulesFlush(pAdapter);
+  sfvmk_arfsFlush(pAdapter);
+  sfvmk_filterRebalanceEnd(pAdapter);
 
   while (!vmk_HashIsEmpty(pAdapter->filterDBHashTable)) {
 
@@ -622,7 +2231,7 @@ sfvmk_clearAllFilterRules(sfvmk_adapter_t *pAdapter)
     pFdbEntry = iterCtx.pFdbEntry;
     iterCtx.pFdbEntry = NULL;
 
-    for (i = 0; i < pFdbEntry->numHwFilter; i++) {
+    for (i = 0; hwRemove && (i < pFdbEntry->numHwFilter); i++) {
       status = efx_filter_remove(pAdapter->pNic, &pFdbEntry->spec[i]);
       if (status != VMK_OK) {
         SFVMK_ADAPTER_ERROR(pAdapter,
@@ -631,23 +2240,7 @@ sfvmk_clearAllFilterRules(sfvmk_adapter_t *pAdapter)
       }
     }
 
-    /* There is one to one mapping between RX HWQs index and uplinkQ index
-     * except for RSSQs. */
-    if (pFdbEntry->qID == sfvmk_getRSSQStartIndex(pAdapter)) {
-      qID = pAdapter->uplink.rssUplinkQueue;
-    } else {
-      qID = pFdbEntry->qID;
-    }
-
-    sfvmk_removeUplinkFilter(pAdapter, qID);
-    status = vmk_HashKeyDelete(pAdapter->filterDBHashTable,
-                               (vmk_HashKey)(vmk_uint64)pFdbEntry->key,
-                               NULL);
-    if (status != VMK_OK)
-      SFVMK_ADAPTER_ERROR(pAdapter, "Delete key entry failed with error %s",
-                          vmk_StatusToString(status));
-
-    sfvmk_freeFilterRule(pAdapter, pFdbEntry);
+    sfvmk_filterDBEntryDrop(pAdapter, pFdbEntry);
   }
 
 }
@@ -681,6 +2274,27 @@ sfvmk_allocFilterDBHash(sfvmk_adapter_t *pAdapter)
     return status;
   }
 
+  vmk_Memset(pAdapter->pFilterSpecIndex, 0, sizeof(pAdapter->pFilterSpecIndex));
+  vmk_Memset(pAdapter->filterParked, 0, sizeof(pAdapter->filterParked));
+  vmk_Memset(&pAdapter->filterRebalance, 0, sizeof(pAdapter->filterRebalance));
+  vmk_Memset(&pAdapter->filterRes, 0, sizeof(pAdapter->filterRes));
+
+  if (pAdapter->arfs.maxFlows != 0) {
+    pAdapter->arfs.pFlows = vmk_HeapAlloc(sfvmk_modInfo.heapID,
+                                          pAdapter->arfs.maxFlows *
+                                          sizeof(sfvmk_arfsFlow_t));
+    if (pAdapter->arfs.pFlows == NULL) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HeapAlloc failed for aRFS flow table");
+      vmk_HashRelease(pAdapter->filterDBHashTable);
+      pAdapter->filterDBHashTable = VMK_INVALID_HASH_HANDLE;
+      return VMK_NO_MEMORY;
+    }
+
+    vmk_Memset(pAdapter->arfs.pFlows, 0,
+               pAdapter->arfs.maxFlows * sizeof(sfvmk_arfsFlow_t));
+    pAdapter->arfs.numFlows = 0;
+  }
+
   pAdapter->filterKey = 0;
   return VMK_OK;
 }
@@ -695,10 +2309,173 @@ sfvmk_allocFilterDBHash(sfvmk_adapter_t *pAdapter)
 void
 sfvmk_freeFilterDBHash(sfvmk_adapter_t *pAdapter)
 {
-   sfvmk_clearAllFilterRules(pAdapter);
+   sfvmk_clearAllFilterRules(pAdapter, !pAdapter->filterDBKept);
+   pAdapter->filterDBKept = VMK_FALSE;
    vmk_HashDeleteAll(pAdapter->filterDBHashTable);
    if (vmk_HashIsEmpty(pAdapter->filterDBHashTable)) {
       vmk_HashRelease(pAdapter->filterDBHashTable);
       pAdapter->filterDBHashTable = VMK_INVALID_HASH_HANDLE;
    }
+
+   if (pAdapter->arfs.pFlows != NULL) {
+      vmk_HeapFree(sfvmk_modInfo.heapID, pAdapter->arfs.pFlows);
+      pAdapter->arfs.pFlows = NULL;
+   }
+}
+
+/*! \brief  Keep the filter DB over a driver reset instead of freeing it.
+**         Driver owned filters are dropped: aRFS relearns its flows and
+**         steering rules are installed again on start. The HW filters
+**         go with the reset, none is removed. Adapter lock must be held.
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t
+**
+** \return: void
+**
+*/
+void
+sfvmk_filterDBSuspend(sfvmk_adapter_t *pAdapter)
+{
+  pAdapter->filterDBKept = VMK_TRUE;
+
+  sfvmk_steerRulesFlush(pAdapter);
+  sfvmk_arfsFlush(pAdapter);
+  sfvmk_filterRebalanceEnd(pAdapter);
+}
+
+/*! \brief  Push a filter DB kept over a driver reset back to the NIC
+**
+** The entries are still indexed and accounted, so they are issued in
+** full batches back to back, without duplicate checks or capacity
+** admission. A failed batch is rolled back and its entries issued one
+** by one, only the entries failing on their own are dropped.
+** The vmkernel may apply the same filters again once IO is back, the
+** entries are marked so that sfvmk_filterReplayedAdopt hands back their
+** keys. Adapter lock must be held.
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t
+**
+** \return: void
+**
+*/
+void
+sfvmk_filterReplay(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_filterDBEntry_t **ppEntries = NULL;
+  sfvmk_filterDBEntry_t *pFdbEntry;
+  sfvmk_filterBatch_t batch;
+  vmk_uint64 startTime;
+  vmk_uint64 endTime;
+  vmk_uint32 numEntries = 0;
+  vmk_uint32 numFailed = 0;
+  vmk_uint32 rssContext;
+  vmk_uint32 rxqStart;
+  vmk_uint32 first;
+  vmk_uint32 i;
+  vmk_uint32 j;
+
+  sfvmk_getTime(&startTime);
+
+  for (i = 0; i < SFVMK_FILTER_SPEC_BUCKETS; i++) {
+    for (pFdbEntry = pAdapter->pFilterSpecIndex[i]; pFdbEntry != NULL;
+         pFdbEntry = pFdbEntry->pSpecNext)
+      numEntries++;
+  }
+
+  if (numEntries == 0)
+    goto done;
+
+  /* Snapshot the entries, re-indexing below reorders the chains */
+  ppEntries = vmk_HeapAlloc(sfvmk_modInfo.heapID,
+                            numEntries * sizeof(*ppEntries));
+  if (ppEntries == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HeapAlloc failed, filter DB dropped");
+    sfvmk_clearAllFilterRules(pAdapter, VMK_FALSE);
+    pAdapter->filterDBKept = VMK_FALSE;
+    goto done;
+  }
+
+  numEntries = 0;
+  for (i = 0; i < SFVMK_FILTER_SPEC_BUCKETS; i++) {
+    for (pFdbEntry = pAdapter->pFilterSpecIndex[i]; pFdbEntry != NULL;
+         pFdbEntry = pFdbEntry->pSpecNext) {
+      pFdbEntry->replayed = VMK_TRUE;
+      ppEntries[numEntries++] = pFdbEntry;
+    }
+  }
+
+  pAdapter->filterDBKept = VMK_FALSE;
+
+  /* NetQueue RSS contexts were freed on quiesce, filters of a NetQueue
+   * spread by its own context need the context allocated again, maybe
+   * in another slot with other HW queues */
+  for (i = 0; i < numEntries; i++) {
+    pFdbEntry = ppEntries[i];
+    if (!(pFdbEntry->spec[0].efs_flags & EFX_FILTER_FLAG_RX_RSS) ||
+        (pFdbEntry->qID == sfvmk_getRSSQStartIndex(pAdapter)))
+      continue;
+
+    if (sfvmk_rssContextGet(pAdapter, pFdbEntry->qID, &rssContext,
+                            &rxqStart) != VMK_OK)
+      goto drop_entry;
+
+    for (j = 0; j < pFdbEntry->numHwFilter; j++) {
+      if (efx_filter_spec_set_rss_context(&pFdbEntry->spec[j], rssContext) != 0)
+        goto drop_entry;
+      pFdbEntry->spec[j].efs_dmaq_id = rxqStart;
+    }
+
+    sfvmk_filterSpecIndexDel(pAdapter, pFdbEntry);
+    sfvmk_filterSpecIndexAdd(pAdapter, pFdbEntry);
+    continue;
+
+drop_entry:
+    sfvmk_filterDBEntryDrop(pAdapter, pFdbEntry);
+    ppEntries[i] = NULL;
+    numFailed++;
+  }
+
+  i = 0;
+  while (i < numEntries) {
+    first = i;
+    sfvmk_filterBatchInit(&batch);
+    for (; (i < numEntries) && (batch.numOps < SFVMK_FILTER_BATCH_MAX); i++) {
+      if (ppEntries[i] != NULL)
+        sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_INSERT, ppEntries[i]);
+    }
+
+    if ((batch.numOps == 0) ||
+        (sfvmk_filterBatchCommit(pAdapter, &batch) == VMK_OK))
+      continue;
+
+    for (j = first; j < i; j++) {
+      if (ppEntries[j] == NULL)
+        continue;
+
+      sfvmk_filterBatchInit(&batch);
+      sfvmk_filterBatchAdd(&batch, SFVMK_FILTER_OP_INSERT, ppEntries[j]);
+      if (sfvmk_filterBatchCommit(pAdapter, &batch) != VMK_OK) {
+        sfvmk_filterDBEntryDrop(pAdapter, ppEntries[j]);
+        numFailed++;
+      }
+    }
+  }
+
+  vmk_HeapFree(sfvmk_modInfo.heapID, ppEntries);
+
+  pAdapter->filterStats[SFVMK_FILTER_REPLAYED] += numEntries - numFailed;
+  pAdapter->filterStats[SFVMK_FILTER_REPLAY_FAILED] += numFailed;
+  sfvmk_updateQueueFilterCapacity(pAdapter);
+
+  if (numFailed != 0)
+    SFVMK_ADAPTER_ERROR(pAdapter, "%u of %u filters dropped on replay",
+                        numFailed, numEntries);
+
+done:
+  sfvmk_getTime(&endTime);
+  pAdapter->filterStats[SFVMK_FILTER_REPLAY_USEC] = endTime - startTime;
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_FILTER, SFVMK_LOG_LEVEL_INFO,
+                      "Replayed %u filters in %lu usec",
+                      numEntries - numFailed, endTime - startTime);
 }
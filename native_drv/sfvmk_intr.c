@@ -105,15 +105,52 @@ sfvmk_intrAckLine(void *arg, vmk_IntrCookie intrCookie)
     goto done;
   }
 
-  if (qMask == 0)
+  if (qMask == 0) {
     status = VMK_NOT_THIS_DEVICE;
-  else
-    status = VMK_OK;
+    goto done;
+  }
+
+  /* Record the EVQs to be scheduled by the shared vector handler */
+  if (pAdapter->intr.sharedVector)
+    vmk_AtomicOr64(&pAdapter->intr.pendingQMask, qMask);
+
+  status = VMK_OK;
 
 done:
   return status;
 }
 
+/*! \brief Activate the net poll of every EVQ flagged in the queue mask
+**         gathered by the line interrupt ack handler.
+**
+** \param[in] pAdapter   Pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_isrShared(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint64 qMask;
+  vmk_uint32 qIndex;
+  sfvmk_evq_t *pEvq;
+
+  qMask = vmk_AtomicReadWrite64(&pAdapter->intr.pendingQMask, 0);
+
+  for (qIndex = 0; (qMask != 0) && (qIndex < pAdapter->numEvqsAllocated);
+       qIndex++, qMask >>= 1) {
+    if ((qMask & 1) == 0)
+      continue;
+
+    pEvq = pAdapter->ppEvq[qIndex];
+    if ((pEvq == NULL) || (pEvq->netPoll == NULL))
+      continue;
+
+    pEvq->intrCount++;
+    pEvq->intrPCPU = vmk_GetPCPUNum();
+    vmk_NetPollActivate(pEvq->netPoll);
+  }
+}
+
 /*! \brief ISR handler to service the MSIX or legacy interrupt.
 **
 ** \param[in] arg         pointer to client data passed while registering the interrupt
@@ -126,9 +163,19 @@ sfvmk_isr(void *arg, vmk_IntrCookie intrCookie)
 {
   sfvmk_evq_t *pEvq = (sfvmk_evq_t *)arg;
 
+  if (pEvq == NULL)
+    return;
+
+  /* A shared vector fans out to all the EVQs which fired */
+  if (pEvq->pAdapter->intr.sharedVector) {
+    sfvmk_isrShared(pEvq->pAdapter);
+    return;
+  }
+
   /* Activate net poll to process the event */
-  if (pEvq != NULL)
-    vmk_NetPollActivate(pEvq->netPoll);
+  pEvq->intrCount++;
+  pEvq->intrPCPU = vmk_GetPCPUNum();
+  vmk_NetPollActivate(pEvq->netPoll);
 }
 
 /*! \brief Register interrupts.
@@ -287,6 +334,123 @@ done:
   return status;
 }
 
+#if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
+/*! \brief Get the PCPUs used for placing interrupt vectors as per
+**         intrAffinity module param: all PCPUs, or the PCPUs which belong
+**         to the device NUMA node whatever their numbering.
+**
+** \param[in]  pAdapter   Pointer to sfvmk_adapter_t
+** \param[out] pPCPUs     array of at least maxPCPUs PCPU IDs
+** \param[in]  maxPCPUs   number of PCPUs wanted
+** \param[out] pNumPCPUs  number of PCPUs returned
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+static VMK_ReturnStatus
+sfvmk_intrAffinityPCPUs(sfvmk_adapter_t *pAdapter,
+                        vmk_PCPUID *pPCPUs,
+                        vmk_uint32 maxPCPUs,
+                        vmk_uint32 *pNumPCPUs)
+{
+  vmk_uint32 numPCPUs = vmk_NumPCPUs();
+  vmk_Bool numaLocal = VMK_FALSE;
+  vmk_NUMANodeID pcpuNode;
+  vmk_NUMANodeID node;
+  vmk_PCPUID pcpu;
+  VMK_ReturnStatus status;
+
+  *pNumPCPUs = 0;
+
+  if ((modParams.intrAffinity == SFVMK_INTR_AFFINITY_NUMA_LOCAL) &&
+      (vmk_NUMAGetNumNodes() > 1)) {
+    status = vmk_PCIGetNUMANode(pAdapter->pciDevice, &node);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_PCIGetNUMANode failed status: %s",
+                          vmk_StatusToString(status));
+      return status;
+    }
+    numaLocal = VMK_TRUE;
+  }
+
+  for (pcpu = 0; (pcpu < numPCPUs) && (*pNumPCPUs < maxPCPUs); pcpu++) {
+    if (numaLocal) {
+      status = vmk_PCPUGetNUMANode(pcpu, &pcpuNode);
+      if ((status != VMK_OK) || (pcpuNode != node))
+        continue;
+    }
+    pPCPUs[(*pNumPCPUs)++] = pcpu;
+  }
+
+  if (*pNumPCPUs == 0) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "No PCPU found for interrupt affinity");
+    return VMK_NOT_FOUND;
+  }
+
+  return VMK_OK;
+}
+
+/*! \brief Spread interrupt vectors over PCPUs as per intrAffinity module
+**         param. Dedicated TX EVQ vectors follow the RX vectors so both
+**         end up spread over the same set of PCPUs. Affinity is a hint,
+**         failures are logged and vectors are left to vmkernel placement.
+**
+** \param[in] pAdapter   Pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_setIntrAffinity(sfvmk_adapter_t *pAdapter)
+{
+  vmk_AffinityMask affinityMask;
+  vmk_PCPUID pcpus[SFVMK_MAX_INTR];
+  vmk_uint32 numPCPUs;
+  vmk_uint32 index;
+  VMK_ReturnStatus status;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_INTR);
+
+  if ((modParams.intrAffinity == SFVMK_INTR_AFFINITY_NONE) ||
+      (modParams.intrAffinity >= SFVMK_INTR_AFFINITY_MAX) ||
+      (pAdapter->intr.type != EFX_INTR_MESSAGE) ||
+      (pAdapter->intr.numIntrAlloc <= 1))
+    goto done;
+
+  status = sfvmk_intrAffinityPCPUs(pAdapter, pcpus,
+                                   pAdapter->intr.numIntrAlloc, &numPCPUs);
+  if (status != VMK_OK)
+    goto done;
+
+  affinityMask = vmk_AffinityMaskCreate(vmk_ModuleCurrentID);
+  if (affinityMask == VMK_INVALID_AFFINITY_MASK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_AffinityMaskCreate failed");
+    goto done;
+  }
+
+  for (index = 0; index < pAdapter->intr.numIntrAlloc; index++) {
+    vmk_PCPUID pcpu = pcpus[index % numPCPUs];
+
+    vmk_AffinityMaskClear(affinityMask);
+    vmk_AffinityMaskAdd(pcpu, affinityMask);
+
+    status = vmk_IntrSetAffinity(pAdapter->intr.pIntrCookies[index],
+                                 affinityMask);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_IntrSetAffinity(%u) failed status: %s",
+                          index, vmk_StatusToString(status));
+      break;
+    }
+
+    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_INTR, SFVMK_LOG_LEVEL_DBG,
+                        "Interrupt %u affined to PCPU %u", index, pcpu);
+  }
+
+  vmk_AffinityMaskDestroy(affinityMask);
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_INTR);
+}
+#endif
+
 /*! \brief Enable interrupts.
 **
 ** \param[in] pAdapter   Pointer to sfvmk_adapter_t
@@ -371,6 +535,10 @@ sfvmk_intrStart(sfvmk_adapter_t *pAdapter)
     goto failed_intr_register;
   }
 
+#if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
+  sfvmk_setIntrAffinity(pAdapter);
+#endif
+
   status = sfvmk_enableInterrupts(pAdapter);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_enableInterrupts failed status: %s",
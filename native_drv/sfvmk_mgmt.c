@@ -1198,6 +1198,7 @@ sfvmk_mgmtHWQStatsCallback(vmk_MgmtCookies      *pCookies,
   vmk_ByteCount     bytesCopied = 0;
   vmk_ByteCount     maxBytes;
   vmk_ByteCount     totalBytes = 0;
+  vmk_ByteCount     bufferSize;
   VMK_ReturnStatus  status = VMK_FAILURE;
 
   vmk_SemaLock(&sfvmk_modInfo.lock);
@@ -1223,11 +1224,14 @@ sfvmk_mgmtHWQStatsCallback(vmk_MgmtCookies      *pCookies,
     goto end;
   }
 
+  /* Sized from the queues this adapter actually has */
+  bufferSize = sfvmk_statsBufferSize(pAdapter);
+
   if (pHwQueueStats->subCmd == SFVMK_MGMT_STATS_GET_SIZE) {
     /* Set size of the hardware queue stats buffer as requested
      * by user before allocating memory and requesting the hardware
      * queue stats data */
-    pHwQueueStats->size = SFVMK_STATS_BUFFER_SZ;
+    pHwQueueStats->size = bufferSize;
     pDevIface->status = VMK_OK;
     goto end;
   } else if (pHwQueueStats->subCmd != SFVMK_MGMT_STATS_GET) {
@@ -1242,22 +1246,22 @@ sfvmk_mgmtHWQStatsCallback(vmk_MgmtCookies      *pCookies,
     goto end;
   }
 
-  if (pHwQueueStats->size < SFVMK_STATS_BUFFER_SZ) {
+  if (pHwQueueStats->size < bufferSize) {
     SFVMK_ADAPTER_ERROR(pAdapter, "User buffer size is not sufficient");
     pDevIface->status = VMK_BAD_PARAM;
     goto end;
   }
 
-  pStatsBuffer = (char *)vmk_HeapAlloc(sfvmk_modInfo.heapID, SFVMK_STATS_BUFFER_SZ);
+  pStatsBuffer = (char *)vmk_HeapAlloc(sfvmk_modInfo.heapID, bufferSize);
   if (pStatsBuffer == NULL) {
     SFVMK_ADAPTER_ERROR(pAdapter, "Queue stats memory allocation failed");
     status = VMK_NO_MEMORY;
     goto end;
   }
 
-  vmk_Memset(pStatsBuffer, 0, SFVMK_STATS_BUFFER_SZ);
+  vmk_Memset(pStatsBuffer, 0, bufferSize);
   pCurr = pStatsBuffer;
-  maxBytes = SFVMK_STATS_BUFFER_SZ;
+  maxBytes = bufferSize;
 
   status = sfvmk_requestMACStats(pAdapter, pCurr, maxBytes, &bytesCopied);
   if (status != VMK_OK) {
@@ -1281,7 +1285,7 @@ sfvmk_mgmtHWQStatsCallback(vmk_MgmtCookies      *pCookies,
   totalBytes += bytesCopied;
 
   if ((status = vmk_CopyToUser((vmk_VA)pHwQueueStats->statsBuffer, (vmk_VA)pStatsBuffer,
-                                SFVMK_STATS_BUFFER_SZ)) != VMK_OK) {
+                                bufferSize)) != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "Copy to user failed with error: %s",
                         vmk_StatusToString(status));
     pDevIface->status = VMK_WRITE_ERROR;
@@ -1289,8 +1293,8 @@ sfvmk_mgmtHWQStatsCallback(vmk_MgmtCookies      *pCookies,
   }
 
   SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_MGMT, SFVMK_LOG_LEVEL_DBG,
-                      "max Bytes %d, bytes copied %lu, bytes remaining %lu",
-                      SFVMK_STATS_BUFFER_SZ, totalBytes, maxBytes);
+                      "max Bytes %lu, bytes copied %lu, bytes remaining %lu",
+                      bufferSize, totalBytes, maxBytes);
 
   pHwQueueStats->size = totalBytes;
   pDevIface->status = VMK_OK;
@@ -1712,3 +1716,546 @@ end:
   return VMK_OK;
 }
 
+
+/*! \brief  A Mgmt callback to Get/Set the event queue type of a queue
+ **
+ ** \param[in]      pCookies     Pointer to cookie
+ ** \param[in]      pEnvelope    Pointer to vmk_MgmtEnvelope
+ ** \param[in,out]  pDevIface    Pointer to device interface structure
+ ** \param[in,out]  pEvqTypeCfg  Pointer to sfvmk_evqTypeCfg_t structure
+ **
+ ** \return VMK_OK
+ **     Below error values are filled in the status field of
+ **     sfvmk_mgmtDevInfo_t.
+ **     VMK_NOT_FOUND:   In case of dev not found
+ **     VMK_BAD_PARAM:   Unknown command/param option, invalid
+ **                      queue index or Null Pointer passed in
+ **                      parameter
+ **     VMK_FAILURE:     Any other error
+ **
+ */
+VMK_ReturnStatus
+sfvmk_mgmtEvqTypeCallback(vmk_MgmtCookies     *pCookies,
+                          vmk_MgmtEnvelope    *pEnvelope,
+                          sfvmk_mgmtDevInfo_t *pDevIface,
+                          sfvmk_evqTypeCfg_t  *pEvqTypeCfg)
+{
+  static const sfvmk_evqType_t evqTypes[] = {
+    [SFVMK_MGMT_EVQ_TYPE_AUTO]        = SFVMK_EVQ_TYPE_AUTO,
+    [SFVMK_MGMT_EVQ_TYPE_THROUGHPUT]  = SFVMK_EVQ_TYPE_THROUGHPUT,
+    [SFVMK_MGMT_EVQ_TYPE_LOW_LATENCY] = SFVMK_EVQ_TYPE_LOW_LATENCY
+  };
+  sfvmk_adapter_t  *pAdapter = NULL;
+  sfvmk_evqType_t   evqType;
+  vmk_uint32        i;
+
+  vmk_SemaLock(&sfvmk_modInfo.lock);
+
+  if (!pDevIface) {
+    SFVMK_ERROR("pDevIface: NULL pointer passed as input");
+    goto end;
+  }
+
+  pDevIface->status = VMK_FAILURE;
+
+  if (!pEvqTypeCfg) {
+    SFVMK_ERROR("pEvqTypeCfg: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  pAdapter = sfvmk_mgmtFindAdapter(pDevIface);
+  if (!pAdapter) {
+    SFVMK_ERROR("Adapter structure corresponding to %s device not found",
+                pDevIface->deviceName);
+    pDevIface->status = VMK_NOT_FOUND;
+    goto end;
+  }
+
+  switch (pEvqTypeCfg->type) {
+    case SFVMK_MGMT_DEV_OPS_SET:
+      if (pEvqTypeCfg->evqType >= SFVMK_MGMT_EVQ_TYPE_INVALID) {
+        SFVMK_ADAPTER_ERROR(pAdapter, "Invalid EVQ type %u",
+                            pEvqTypeCfg->evqType);
+        pDevIface->status = VMK_BAD_PARAM;
+        goto end;
+      }
+
+      pDevIface->status = sfvmk_evqTypeSet(pAdapter, pEvqTypeCfg->qIndex,
+                                           evqTypes[pEvqTypeCfg->evqType]);
+      if (pDevIface->status != VMK_OK) {
+        SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_evqTypeSet(%u) failed status: %s",
+                            pEvqTypeCfg->qIndex,
+                            vmk_StatusToString(pDevIface->status));
+        goto end;
+      }
+      break;
+
+    case SFVMK_MGMT_DEV_OPS_GET:
+      pDevIface->status = sfvmk_evqTypeGet(pAdapter, pEvqTypeCfg->qIndex,
+                                           &evqType);
+      if (pDevIface->status != VMK_OK)
+        goto end;
+
+      pEvqTypeCfg->evqType = SFVMK_MGMT_EVQ_TYPE_INVALID;
+      for (i = 0; i < SFVMK_MGMT_EVQ_TYPE_INVALID; i++) {
+        if (evqTypes[i] == evqType)
+          pEvqTypeCfg->evqType = i;
+      }
+      break;
+
+    default:
+      pDevIface->status = VMK_BAD_PARAM;
+      goto end;
+  }
+
+  pDevIface->status = VMK_OK;
+
+end:
+  vmk_SemaUnlock(&sfvmk_modInfo.lock);
+  return VMK_OK;
+}
+
+/*! \brief  A Mgmt callback routine to get MAC and HW queue stats as a
+ **         binary record
+ **
+ ** \param[in]      pCookies    Pointer to cookie
+ ** \param[in]      pEnvelope   Pointer to vmk_MgmtEnvelope
+ ** \param[in,out]  pDevIface   Pointer to device interface structure
+ ** \param[in,out]  pStatsBin   Pointer to sfvmk_statsBin_t structure
+ **
+ ** \return: VMK_OK  [success]
+ **     Below error values are filled in the status field of
+ **     sfvmk_mgmtDevInfo_t.
+ **     VMK_NOT_FOUND:      In case of dev not found
+ **     VMK_BAD_PARAM:      Unknown option or NULL input param
+ **     VMK_NO_MEMORY:      Memory Allocation failed
+ **     VMK_WRITE_ERROR:    Copy to user buffer failed
+ **     VMK_FAILURE:        Any other error
+ **
+ */
+VMK_ReturnStatus
+sfvmk_mgmtStatsBinCallback(vmk_MgmtCookies      *pCookies,
+                           vmk_MgmtEnvelope     *pEnvelope,
+                           sfvmk_mgmtDevInfo_t  *pDevIface,
+                           sfvmk_statsBin_t     *pStatsBin)
+{
+  sfvmk_adapter_t   *pAdapter = NULL;
+  vmk_uint8         *pStatsBuffer = NULL;
+  vmk_ByteCount     bytesCopied = 0;
+  vmk_ByteCount     bufferSize;
+  VMK_ReturnStatus  status = VMK_FAILURE;
+
+  vmk_SemaLock(&sfvmk_modInfo.lock);
+
+  if (!pDevIface) {
+    SFVMK_ERROR("pDevIface: NULL pointer passed as input");
+    goto end;
+  }
+
+  pDevIface->status = VMK_FAILURE;
+
+  if (!pStatsBin) {
+    SFVMK_ERROR("pStatsBin: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  pAdapter = sfvmk_mgmtFindAdapter(pDevIface);
+  if (!pAdapter) {
+    SFVMK_ERROR("Adapter structure corresponding to %s device not found",
+                pDevIface->deviceName);
+    pDevIface->status = VMK_NOT_FOUND;
+    goto end;
+  }
+
+  bufferSize = sfvmk_statsBinBufferSize(pAdapter);
+
+  if (pStatsBin->subCmd == SFVMK_MGMT_STATS_GET_SIZE) {
+    pStatsBin->size = bufferSize;
+    pDevIface->status = VMK_OK;
+    goto end;
+  } else if (pStatsBin->subCmd != SFVMK_MGMT_STATS_GET) {
+    SFVMK_ERROR("Invalid sub command");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  if (!pStatsBin->statsBuffer) {
+    SFVMK_ERROR("statsBuffer: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  if (pStatsBin->size < bufferSize) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "User buffer size is not sufficient");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  pStatsBuffer = vmk_HeapAlloc(sfvmk_modInfo.heapID, bufferSize);
+  if (pStatsBuffer == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Binary stats memory allocation failed");
+    pDevIface->status = VMK_NO_MEMORY;
+    goto end;
+  }
+
+  status = sfvmk_requestBinStats(pAdapter, pStatsBuffer,
+                                 bufferSize, &bytesCopied);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_requestBinStats failed error: %s",
+                        vmk_StatusToString(status));
+    pDevIface->status = status;
+    goto freemem;
+  }
+
+  /* Only the record is copied, not the whole buffer */
+  if ((status = vmk_CopyToUser((vmk_VA)pStatsBin->statsBuffer,
+                               (vmk_VA)pStatsBuffer, bytesCopied)) != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Copy to user failed with error: %s",
+                        vmk_StatusToString(status));
+    pDevIface->status = VMK_WRITE_ERROR;
+    goto freemem;
+  }
+
+  pStatsBin->size = bytesCopied;
+  pDevIface->status = VMK_OK;
+
+freemem:
+  vmk_HeapFree(sfvmk_modInfo.heapID, pStatsBuffer);
+end:
+  vmk_SemaUnlock(&sfvmk_modInfo.lock);
+  return VMK_OK;
+}
+
+/*! \brief  A Mgmt callback routine to control EFSYS probe tracing and
+ **         to drain the trace ring
+ **
+ ** \param[in]      pCookies    Pointer to cookie
+ ** \param[in]      pEnvelope   Pointer to vmk_MgmtEnvelope
+ ** \param[in,out]  pDevIface   Pointer to device interface structure
+ ** \param[in,out]  pTraceReq   Pointer to sfvmk_traceReq_t structure
+ **
+ ** \return: VMK_OK  [success]
+ **     Below error values are filled in the status field of
+ **     sfvmk_mgmtDevInfo_t.
+ **     VMK_BAD_PARAM:      Unknown option or NULL input param
+ **     VMK_NOT_READY:      Trace ring not allocated
+ **     VMK_NO_MEMORY:      Memory Allocation failed
+ **     VMK_WRITE_ERROR:    Copy to user buffer failed
+ **     VMK_FAILURE:        Any other error
+ **
+ */
+VMK_ReturnStatus
+sfvmk_mgmtTraceCallback(vmk_MgmtCookies      *pCookies,
+                        vmk_MgmtEnvelope     *pEnvelope,
+                        sfvmk_mgmtDevInfo_t  *pDevIface,
+                        sfvmk_traceReq_t     *pTraceReq)
+{
+  vmk_uint32        bytesCopied = 0;
+  vmk_uint64        numLost = 0;
+  VMK_ReturnStatus  status = VMK_FAILURE;
+
+  vmk_SemaLock(&sfvmk_modInfo.lock);
+
+  if (!pDevIface) {
+    SFVMK_ERROR("pDevIface: NULL pointer passed as input");
+    goto end;
+  }
+
+  pDevIface->status = VMK_FAILURE;
+
+  if (!pTraceReq) {
+    SFVMK_ERROR("pTraceReq: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  /* The ring is module wide so no adapter lookup is needed */
+  pTraceReq->probeName[SFVMK_TRACE_PROBE_NAME_LEN - 1] = '\0';
+
+  switch (pTraceReq->subCmd) {
+    case SFVMK_MGMT_TRACE_ENABLE:
+    case SFVMK_MGMT_TRACE_DISABLE:
+      status = sfvmk_traceEnable(pTraceReq->probeName,
+                                 pTraceReq->subCmd == SFVMK_MGMT_TRACE_ENABLE);
+      if (status != VMK_OK) {
+        SFVMK_ERROR("Trace enable/disable of %s failed: %s",
+                    pTraceReq->probeName, vmk_StatusToString(status));
+        pDevIface->status = status;
+        goto end;
+      }
+      break;
+
+    case SFVMK_MGMT_TRACE_DRAIN:
+    case SFVMK_MGMT_TRACE_NAMES:
+      if (!pTraceReq->traceBuffer) {
+        SFVMK_ERROR("traceBuffer: NULL pointer passed as input");
+        pDevIface->status = VMK_BAD_PARAM;
+        goto end;
+      }
+
+      if (pTraceReq->subCmd == SFVMK_MGMT_TRACE_DRAIN)
+        status = sfvmk_traceDrain(pTraceReq->traceBuffer, pTraceReq->size,
+                                  &bytesCopied, &numLost);
+      else
+        status = sfvmk_traceProbeNames(pTraceReq->traceBuffer, pTraceReq->size,
+                                       &bytesCopied);
+
+      /* Records already moved out of the ring are reported even if a
+       * later copy failed */
+      pTraceReq->size = bytesCopied;
+      pTraceReq->numLost = numLost;
+
+      if (status != VMK_OK) {
+        SFVMK_ERROR("Trace copy to user failed: %s",
+                    vmk_StatusToString(status));
+        pDevIface->status = (status == VMK_NO_MEMORY ||
+                             status == VMK_NOT_READY ||
+                             status == VMK_BAD_PARAM) ?
+                            status : VMK_WRITE_ERROR;
+        goto end;
+      }
+      break;
+
+    default:
+      SFVMK_ERROR("Invalid sub command");
+      pDevIface->status = VMK_BAD_PARAM;
+      goto end;
+  }
+
+  pDevIface->status = VMK_OK;
+
+end:
+  vmk_SemaUnlock(&sfvmk_modInfo.lock);
+  return VMK_OK;
+}
+
+/*! \brief  A Mgmt callback routine to get the heaviest RSS flows
+ **         seen on a RXQ
+ **
+ ** \param[in]      pCookies    Pointer to cookie
+ ** \param[in]      pEnvelope   Pointer to vmk_MgmtEnvelope
+ ** \param[in,out]  pDevIface   Pointer to device interface structure
+ ** \param[in,out]  pFlowTop    Pointer to sfvmk_rxFlowTop_t structure
+ **
+ ** \return: VMK_OK  [success]
+ **     Below error values are filled in the status field of
+ **     sfvmk_mgmtDevInfo_t.
+ **     VMK_NOT_FOUND:      In case of dev not found
+ **     VMK_BAD_PARAM:      Invalid queue index or NULL input param
+ **     VMK_NOT_SUPPORTED:  Sketch disabled or not a RSS queue
+ **     VMK_FAILURE:        Any other error
+ **
+ */
+VMK_ReturnStatus
+sfvmk_mgmtRxFlowTopCallback(vmk_MgmtCookies      *pCookies,
+                            vmk_MgmtEnvelope     *pEnvelope,
+                            sfvmk_mgmtDevInfo_t  *pDevIface,
+                            sfvmk_rxFlowTop_t    *pFlowTop)
+{
+  sfvmk_adapter_t  *pAdapter = NULL;
+
+  vmk_SemaLock(&sfvmk_modInfo.lock);
+
+  if (!pDevIface) {
+    SFVMK_ERROR("pDevIface: NULL pointer passed as input");
+    goto end;
+  }
+
+  pDevIface->status = VMK_FAILURE;
+
+  if (!pFlowTop) {
+    SFVMK_ERROR("pFlowTop: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  pAdapter = sfvmk_mgmtFindAdapter(pDevIface);
+  if (!pAdapter) {
+    SFVMK_ERROR("Adapter structure corresponding to %s device not found",
+                pDevIface->deviceName);
+    pDevIface->status = VMK_NOT_FOUND;
+    goto end;
+  }
+
+  pFlowTop->numEntries = 0;
+  pDevIface->status = sfvmk_rxqFlowTopGet(pAdapter, pFlowTop->qIndex,
+                                          pFlowTop->reset,
+                                          pFlowTop->entries,
+                                          &pFlowTop->numEntries);
+  if (pDevIface->status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_rxqFlowTopGet(%u) failed status: %s",
+                        pFlowTop->qIndex,
+                        vmk_StatusToString(pDevIface->status));
+    goto end;
+  }
+
+end:
+  vmk_SemaUnlock(&sfvmk_modInfo.lock);
+  return VMK_OK;
+}
+
+/*! \brief  A Mgmt callback routine to control the datapath profiler
+ **         and to read its per stage breakdown
+ **
+ ** \param[in]      pCookies    Pointer to cookie
+ ** \param[in]      pEnvelope   Pointer to vmk_MgmtEnvelope
+ ** \param[in,out]  pDevIface   Pointer to device interface structure
+ ** \param[in,out]  pDpProfile  Pointer to sfvmk_dpProfile_t structure
+ **
+ ** \return: VMK_OK  [success]
+ **     Below error values are filled in the status field of
+ **     sfvmk_mgmtDevInfo_t.
+ **     VMK_NOT_FOUND:      In case of dev not found
+ **     VMK_BAD_PARAM:      Unknown option or NULL input param
+ **     VMK_FAILURE:        Any other error
+ **
+ */
+VMK_ReturnStatus
+sfvmk_mgmtDpProfileCallback(vmk_MgmtCookies      *pCookies,
+                            vmk_MgmtEnvelope     *pEnvelope,
+                            sfvmk_mgmtDevInfo_t  *pDevIface,
+                            sfvmk_dpProfile_t    *pDpProfile)
+{
+  sfvmk_adapter_t  *pAdapter = NULL;
+
+  vmk_SemaLock(&sfvmk_modInfo.lock);
+
+  if (!pDevIface) {
+    SFVMK_ERROR("pDevIface: NULL pointer passed as input");
+    goto end;
+  }
+
+  pDevIface->status = VMK_FAILURE;
+
+  if (!pDpProfile) {
+    SFVMK_ERROR("pDpProfile: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  pAdapter = sfvmk_mgmtFindAdapter(pDevIface);
+  if (!pAdapter) {
+    SFVMK_ERROR("Adapter structure corresponding to %s device not found",
+                pDevIface->deviceName);
+    pDevIface->status = VMK_NOT_FOUND;
+    goto end;
+  }
+
+  switch (pDpProfile->subCmd) {
+    case SFVMK_MGMT_PROF_GET:
+      sfvmk_dpProfileGet(pAdapter, pDpProfile->stages);
+      break;
+
+    case SFVMK_MGMT_PROF_RESET:
+      sfvmk_dpProfileReset(pAdapter);
+      break;
+
+    case SFVMK_MGMT_PROF_ENABLE:
+    case SFVMK_MGMT_PROF_DISABLE:
+      /* Datapath reads the flag once per stage, a stage in flight
+       * while it flips is either fully accounted or not at all */
+      pAdapter->dpProfile = (pDpProfile->subCmd == SFVMK_MGMT_PROF_ENABLE);
+      break;
+
+    default:
+      SFVMK_ADAPTER_ERROR(pAdapter, "Invalid sub command %u",
+                          pDpProfile->subCmd);
+      pDevIface->status = VMK_BAD_PARAM;
+      goto end;
+  }
+
+  pDpProfile->enabled = pAdapter->dpProfile;
+  pDpProfile->cyclesPerUSec = pAdapter->timerCyclesPerUSec;
+  pDevIface->status = VMK_OK;
+
+end:
+  vmk_SemaUnlock(&sfvmk_modInfo.lock);
+  return VMK_OK;
+}
+
+/*! \brief  A Mgmt callback routine to add, remove and list the
+ **         flow steering rules of an interface
+ **
+ ** \param[in]      pCookies    Pointer to cookie
+ ** \param[in]      pEnvelope   Pointer to vmk_MgmtEnvelope
+ ** \param[in,out]  pDevIface   Pointer to device interface structure
+ ** \param[in,out]  pRuleReq    Pointer to sfvmk_filterRuleReq_t structure
+ **
+ ** \return: VMK_OK  [success]
+ **     Below error values are filled in the status field of
+ **     sfvmk_mgmtDevInfo_t.
+ **     VMK_NOT_FOUND:      In case of dev or rule not found
+ **     VMK_BAD_PARAM:      Unknown option, invalid rule or NULL input param
+ **     VMK_EXISTS:         A rule with the same match exists
+ **     VMK_LIMIT_EXCEEDED: All rule slots are in use
+ **     VMK_NOT_SUPPORTED:  Storage rule without a storage RXQ
+ **     VMK_NO_SPACE:       HW filter table is full
+ **     VMK_FAILURE:        Any other error
+ **
+ */
+VMK_ReturnStatus
+sfvmk_mgmtFilterRuleCallback(vmk_MgmtCookies        *pCookies,
+                             vmk_MgmtEnvelope       *pEnvelope,
+                             sfvmk_mgmtDevInfo_t    *pDevIface,
+                             sfvmk_filterRuleReq_t  *pRuleReq)
+{
+  sfvmk_adapter_t  *pAdapter = NULL;
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  vmk_SemaLock(&sfvmk_modInfo.lock);
+
+  if (!pDevIface) {
+    SFVMK_ERROR("pDevIface: NULL pointer passed as input");
+    goto end;
+  }
+
+  pDevIface->status = VMK_FAILURE;
+
+  if (!pRuleReq) {
+    SFVMK_ERROR("pRuleReq: NULL pointer passed as input");
+    pDevIface->status = VMK_BAD_PARAM;
+    goto end;
+  }
+
+  pAdapter = sfvmk_mgmtFindAdapter(pDevIface);
+  if (!pAdapter) {
+    SFVMK_ERROR("Adapter structure corresponding to %s device not found",
+                pDevIface->deviceName);
+    pDevIface->status = VMK_NOT_FOUND;
+    goto end;
+  }
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  switch (pRuleReq->subCmd) {
+    case SFVMK_MGMT_FILTER_RULE_ADD:
+      status = sfvmk_steerRuleAdd(pAdapter, &pRuleReq->rules[0]);
+      break;
+
+    case SFVMK_MGMT_FILTER_RULE_DEL:
+      status = sfvmk_steerRuleDel(pAdapter, pRuleReq->rules[0].ruleId);
+      break;
+
+    case SFVMK_MGMT_FILTER_RULE_LIST:
+      sfvmk_steerRuleList(pAdapter, pRuleReq);
+      status = VMK_OK;
+      break;
+
+    default:
+      SFVMK_ADAPTER_ERROR(pAdapter, "Invalid sub command %u",
+                          pRuleReq->subCmd);
+      status = VMK_BAD_PARAM;
+  }
+
+  pRuleReq->storageQIndex = pAdapter->storageRxq;
+
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  pDevIface->status = status;
+
+end:
+  vmk_SemaUnlock(&sfvmk_modInfo.lock);
+  return VMK_OK;
+}
@@ -307,6 +307,96 @@ const vmk_MgmtCallbackInfo sfvmk_mgmtCallbacks[] = {
       .parmSizes[1] = sizeof(sfvmk_nvramCmdV2_t),
 
       .callbackId = SFVMK_CB_NVRAM_REQUEST_V2
+  },
+
+  {
+      .location = VMK_MGMT_CALLBACK_KERNEL,
+      .callback = sfvmk_mgmtEvqTypeCallback,
+      .synchronous = 1,
+      .numParms = 2,
+
+      .parmTypes[0] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[0] = sizeof(sfvmk_mgmtDevInfo_t),
+
+      .parmTypes[1] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[1] = sizeof(sfvmk_evqTypeCfg_t),
+
+      .callbackId = SFVMK_CB_EVQ_TYPE_REQUEST
+  },
+
+  {
+      .location = VMK_MGMT_CALLBACK_KERNEL,
+      .callback = sfvmk_mgmtStatsBinCallback,
+      .synchronous = 1,
+      .numParms = 2,
+
+      .parmTypes[0] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[0] = sizeof(sfvmk_mgmtDevInfo_t),
+
+      .parmTypes[1] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[1] = sizeof(sfvmk_statsBin_t),
+
+      .callbackId = SFVMK_CB_STATS_BIN_GET
+  },
+
+  {
+      .location = VMK_MGMT_CALLBACK_KERNEL,
+      .callback = sfvmk_mgmtTraceCallback,
+      .synchronous = 1,
+      .numParms = 2,
+
+      .parmTypes[0] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[0] = sizeof(sfvmk_mgmtDevInfo_t),
+
+      .parmTypes[1] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[1] = sizeof(sfvmk_traceReq_t),
+
+      .callbackId = SFVMK_CB_TRACE_REQUEST
+  },
+
+  {
+      .location = VMK_MGMT_CALLBACK_KERNEL,
+      .callback = sfvmk_mgmtRxFlowTopCallback,
+      .synchronous = 1,
+      .numParms = 2,
+
+      .parmTypes[0] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[0] = sizeof(sfvmk_mgmtDevInfo_t),
+
+      .parmTypes[1] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[1] = sizeof(sfvmk_rxFlowTop_t),
+
+      .callbackId = SFVMK_CB_RX_FLOW_TOP_GET
+  },
+
+  {
+      .location = VMK_MGMT_CALLBACK_KERNEL,
+      .callback = sfvmk_mgmtDpProfileCallback,
+      .synchronous = 1,
+      .numParms = 2,
+
+      .parmTypes[0] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[0] = sizeof(sfvmk_mgmtDevInfo_t),
+
+      .parmTypes[1] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[1] = sizeof(sfvmk_dpProfile_t),
+
+      .callbackId = SFVMK_CB_DP_PROFILE_REQUEST
+  },
+
+  {
+      .location = VMK_MGMT_CALLBACK_KERNEL,
+      .callback = sfvmk_mgmtFilterRuleCallback,
+      .synchronous = 1,
+      .numParms = 2,
+
+      .parmTypes[0] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[0] = sizeof(sfvmk_mgmtDevInfo_t),
+
+      .parmTypes[1] = VMK_MGMT_PARMTYPE_INOUT,
+      .parmSizes[1] = sizeof(sfvmk_filterRuleReq_t),
+
+      .callbackId = SFVMK_CB_FILTER_RULE_REQUEST
   }
 };
 
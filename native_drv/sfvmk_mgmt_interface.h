@@ -60,6 +60,12 @@
  ** SFVMK_CB_SENSOR_INFO_GET:          Get hardware sensor information
  ** SFVMK_CB_PRIVILEGE_REQUEST:        Get/Set PCI function privileges
  ** SFVMK_CB_NVRAM_REQUEST_V2:         NVRAM operations callback version 2
+ ** SFVMK_CB_EVQ_TYPE_REQUEST:         Get/Set event queue type of a queue
+ ** SFVMK_CB_STATS_BIN_GET:            Get MAC and queue stats in binary form
+ ** SFVMK_CB_TRACE_REQUEST:            Enable/disable and drain EFSYS probes
+ ** SFVMK_CB_RX_FLOW_TOP_GET:          Get the heaviest RSS flows of a RXQ
+ ** SFVMK_CB_DP_PROFILE_REQUEST:       Control and read the datapath profiler
+ ** SFVMK_CB_FILTER_RULE_REQUEST:      Add, remove and list flow steering rules
  **
  */
 typedef enum sfvmk_mgmtCbTypes_e {
@@ -81,6 +87,12 @@ typedef enum sfvmk_mgmtCbTypes_e {
   SFVMK_CB_SENSOR_INFO_GET,
   SFVMK_CB_PRIVILEGE_REQUEST,
   SFVMK_CB_NVRAM_REQUEST_V2,
+  SFVMK_CB_EVQ_TYPE_REQUEST,
+  SFVMK_CB_STATS_BIN_GET,
+  SFVMK_CB_TRACE_REQUEST,
+  SFVMK_CB_RX_FLOW_TOP_GET,
+  SFVMK_CB_DP_PROFILE_REQUEST,
+  SFVMK_CB_FILTER_RULE_REQUEST,
   SFVMK_CB_MAX
 } sfvmk_mgmtCbTypes_t;
 
@@ -747,6 +759,566 @@ typedef struct sfvmk_privilege_s {
   vmk_uint32           privRemoveMask;
 } __attribute__((__packed__))  sfvmk_privilege_t;
 
+/*! \brief Event queue types that can be selected per queue
+ **
+ ** SFVMK_MGMT_EVQ_TYPE_AUTO:        Let the firmware choose
+ **
+ ** SFVMK_MGMT_EVQ_TYPE_THROUGHPUT:  Optimise for throughput (uses
+ **                                  no continuation events where
+ **                                  supported)
+ **
+ ** SFVMK_MGMT_EVQ_TYPE_LOW_LATENCY: Optimise for latency
+ **
+ */
+typedef enum sfvmk_mgmtEvqType_e {
+  SFVMK_MGMT_EVQ_TYPE_AUTO,
+  SFVMK_MGMT_EVQ_TYPE_THROUGHPUT,
+  SFVMK_MGMT_EVQ_TYPE_LOW_LATENCY,
+  SFVMK_MGMT_EVQ_TYPE_INVALID
+} sfvmk_mgmtEvqType_t;
+
+/*! \brief struct sfvmk_evqTypeCfg_s to get/ set
+ **        the event queue type of a single queue
+ **
+ ** type[in]         Command type (Get/Set)
+ **
+ ** qIndex[in]       Event queue index; EVQ n serves
+ **                  hardware RXQ n
+ **
+ ** evqType[in,out]  Event queue type, one of
+ **                  sfvmk_mgmtEvqType_t
+ **
+ ** Please Note: Set recreates only the given event queue and
+ ** the queues completing on it.
+ **
+ */
+typedef struct sfvmk_evqTypeCfg_s {
+  sfvmk_mgmtDevOps_t type;
+  vmk_uint32         qIndex;
+  vmk_uint32         evqType;
+} __attribute__((__packed__)) sfvmk_evqTypeCfg_t;
+
+/* Version of the binary stats record layout; bumped whenever a group is
+ * added, a counter ID is added to a group or the meaning of an existing
+ * counter ID changes.
+ *  1: MAC, RXQ, TXQ and EVQ groups
+ *  2: RXQ_LATENCY and TXQ_LATENCY groups
+ *  3: RXQ ring level, ring time, ring level HWM and ring empty time,
+ *     TXQ ring level, ring time, ring level HWM and stopped time
+ */
+#define SFVMK_MGMT_STATS_BIN_VERSION  3
+
+/*! \brief Counter IDs of the SFVMK_MGMT_STATS_GROUP_EVQ section.
+ **        SFVMK_EVQ_POLL_HIST_* is a log2 histogram of the number
+ **        of events consumed by a poll which found work to do.
+ **        New IDs are only ever appended.
+ */
+typedef enum sfvmk_evqStats_e {
+  SFVMK_EVQ_INTERRUPTS = 0,
+  SFVMK_EVQ_NETPOLL_CALLS,
+  SFVMK_EVQ_POLLS,
+  SFVMK_EVQ_EMPTY_POLLS,
+  SFVMK_EVQ_BUDGET_EXHAUSTED,
+  SFVMK_EVQ_EVENTS,
+  SFVMK_EVQ_POLL_HIST_1,
+  SFVMK_EVQ_POLL_HIST_2_3,
+  SFVMK_EVQ_POLL_HIST_4_7,
+  SFVMK_EVQ_POLL_HIST_8_15,
+  SFVMK_EVQ_POLL_HIST_16_31,
+  SFVMK_EVQ_POLL_HIST_32_63,
+  SFVMK_EVQ_POLL_HIST_64_127,
+  SFVMK_EVQ_POLL_HIST_128_PLUS,
+  SFVMK_EVQ_MAX_STATS
+} sfvmk_evqStats_t;
+
+/*! \brief Counter IDs of the SFVMK_MGMT_STATS_GROUP_TXQ section.
+ **        New IDs are only ever appended.
+ */
+typedef enum sfvmk_txqStats_e {
+  SFVMK_TXQ_PKTS = 0,
+  SFVMK_TXQ_BYTES,
+  SFVMK_TXQ_INVALID_QUEUE_STATE,
+  SFVMK_TXQ_QUEUE_BUSY,
+  SFVMK_TXQ_DMA_MAP_ERROR,
+  SFVMK_TXQ_DESC_POST_FAILED,
+  SFVMK_TXQ_TSO_PARSING_FAILED,
+  SFVMK_TXQ_TSO_LONG_HEADER_ERROR,
+  SFVMK_TXQ_QUEUE_BLOCKED,
+  SFVMK_TXQ_QUEUE_UNBLOCKED,
+  SFVMK_TXQ_SG_ELEM_GET_FAILED,
+  SFVMK_TXQ_SG_ELEM_TOO_LONG,
+  SFVMK_TXQ_PARTIAL_COPY_FAILED,
+  SFVMK_TXQ_DISCARD,
+  SFVMK_TXQ_RING_LEVEL_US,
+  SFVMK_TXQ_RING_TIME_US,
+  SFVMK_TXQ_RING_LEVEL_HWM,
+  SFVMK_TXQ_STOPPED_US,
+  SFVMK_TXQ_MAX_STATS
+} sfvmk_txqStats_t;
+
+/*! \brief Counter IDs of the SFVMK_MGMT_STATS_GROUP_RXQ section.
+ **        New IDs are only ever appended.
+ */
+typedef enum sfvmk_rxqStats_e {
+  SFVMK_RXQ_PKTS = 0,
+  SFVMK_RXQ_BYTES,
+  SFVMK_RXQ_INVALID_DESC,
+  SFVMK_RXQ_INVALID_PKT_BUFFER,
+  SFVMK_RXQ_DMA_UNMAP_FAILED,
+  SFVMK_RXQ_PSEUDO_HDR_PKT_LEN_FAILED,
+  SFVMK_RXQ_PKT_HEAD_ROOM_FAILED,
+  SFVMK_RXQ_PKT_FRAME_MAPPED_PTR_FAILED,
+  SFVMK_RXQ_INVALID_BUFFER_DESC,
+  SFVMK_RXQ_INVALID_FRAME_SZ,
+  SFVMK_RXQ_INVALID_PROTO,
+  SFVMK_RXQ_DISCARD,
+  SFVMK_RXQ_RSS_HASH_FAILED,
+  SFVMK_RXQ_RING_LEVEL_US,
+  SFVMK_RXQ_RING_TIME_US,
+  SFVMK_RXQ_RING_LEVEL_HWM,
+  SFVMK_RXQ_RING_EMPTY_US,
+  SFVMK_RXQ_MAX_STATS
+} sfvmk_rxqStats_t;
+
+/*! \brief Group a section of the binary stats record belongs to
+ **
+ ** SFVMK_MGMT_STATS_GROUP_MAC:  MAC stats, counter IDs are the libefx
+ **                              efx_mac_stat_t of the driver. ID n is
+ **                              the n-th entry of the MAC stats text
+ **                              dump, which carries the names
+ **
+ ** SFVMK_MGMT_STATS_GROUP_RXQ:  RXQ stats, counter IDs are sfvmk_rxqStats_t
+ **
+ ** SFVMK_MGMT_STATS_GROUP_TXQ:  TXQ stats, counter IDs are sfvmk_txqStats_t
+ **
+ ** SFVMK_MGMT_STATS_GROUP_EVQ:  EVQ stats, counter IDs are sfvmk_evqStats_t
+ **
+ ** SFVMK_MGMT_STATS_GROUP_RXQ_LATENCY: RX event to delivery latency
+ **                               histogram of sampled packets
+ **
+ ** SFVMK_MGMT_STATS_GROUP_TXQ_LATENCY: TX doorbell to completion latency
+ **                               histogram of sampled packets
+ **
+ ** Latency groups are only present when the latSampleRate module
+ ** parameter is set. Their counter IDs are log-linear nanosecond
+ ** buckets: bucket b < 4 counts latency b, bucket b >= 4 counts
+ ** latencies from (4 + b % 4) << (b / 4 - 1) up to the next bucket.
+ ** The last bucket is open ended.
+ **
+ */
+typedef enum sfvmk_mgmtStatsGroup_e {
+  SFVMK_MGMT_STATS_GROUP_MAC = 1,
+  SFVMK_MGMT_STATS_GROUP_RXQ,
+  SFVMK_MGMT_STATS_GROUP_TXQ,
+  SFVMK_MGMT_STATS_GROUP_EVQ,
+  SFVMK_MGMT_STATS_GROUP_RXQ_LATENCY,
+  SFVMK_MGMT_STATS_GROUP_TXQ_LATENCY,
+  SFVMK_MGMT_STATS_GROUP_INVALID
+} sfvmk_mgmtStatsGroup_t;
+
+/*! \brief struct sfvmk_statsBinHdr_s heading a binary
+ **        stats record
+ **
+ ** version         SFVMK_MGMT_STATS_BIN_VERSION
+ **
+ ** numSections     Number of sections following
+ **                 the header
+ **
+ ** timestamp       Time of the sampling in usec
+ **
+ ** Please Note: A record is the header followed by numSections
+ ** sections, each one a sfvmk_statsBinSection_t followed by
+ ** numCounters sfvmk_statsBinCounter_t.
+ **
+ */
+typedef struct sfvmk_statsBinHdr_s {
+  vmk_uint32  version;
+  vmk_uint32  numSections;
+  vmk_uint64  timestamp;
+} __attribute__((__packed__)) sfvmk_statsBinHdr_t;
+
+/*! \brief struct sfvmk_statsBinSection_s heading the
+ **        counters of one group instance
+ **
+ ** group           One of sfvmk_mgmtStatsGroup_t
+ **
+ ** qIndex          Hardware queue index, 0 for MAC
+ **
+ ** numCounters     Number of counters following
+ **
+ */
+typedef struct sfvmk_statsBinSection_s {
+  vmk_uint16  group;
+  vmk_uint16  qIndex;
+  vmk_uint32  numCounters;
+} __attribute__((__packed__)) sfvmk_statsBinSection_t;
+
+/*! \brief struct sfvmk_statsBinCounter_s for a single
+ **        counter of a binary stats record
+ **
+ ** id              Counter ID within the section group
+ **
+ ** value           Counter value
+ **
+ */
+typedef struct sfvmk_statsBinCounter_s {
+  vmk_uint32  id;
+  vmk_uint64  value;
+} __attribute__((__packed__)) sfvmk_statsBinCounter_t;
+
+/*! \brief struct sfvmk_statsBin_s to get MAC and
+ **        hardware queue stats as a binary record
+ **
+ ** subCmd[in]         SFVMK_MGMT_STATS_GET_SIZE or
+ **                    SFVMK_MGMT_STATS_GET
+ **
+ ** statsBuffer[out]   Pointer to buffer receiving
+ **                    the record
+ **
+ ** size[in,out]       In: size of the user buffer,
+ **                    Out: size of the record
+ **
+ */
+typedef struct sfvmk_statsBin_s {
+  sfvmk_mgmtStatsOps_t subCmd;
+  vmk_uint64           statsBuffer;
+  vmk_uint32           size;
+} __attribute__((__packed__)) sfvmk_statsBin_t;
+
+/* Max length of an EFSYS probe name, including the terminator */
+#define SFVMK_TRACE_PROBE_NAME_LEN  32
+/* Max length of the source file name of a probe site */
+#define SFVMK_TRACE_PROBE_FILE_LEN  32
+/* Max number of arguments of an EFSYS probe */
+#define SFVMK_TRACE_MAX_ARGS        7
+
+/*! \brief Trace operations
+ **
+ ** SFVMK_MGMT_TRACE_ENABLE:   Start recording the probe named in
+ **                            probeName: a probe name for every
+ **                            site using it, "file.c:line" for a
+ **                            single site, "all" for every probe
+ **
+ ** SFVMK_MGMT_TRACE_DISABLE:  Stop recording the probe named in
+ **                            probeName, same forms as enable
+ **
+ ** SFVMK_MGMT_TRACE_DRAIN:    Move the recorded trace records
+ **                            to the user buffer
+ **
+ ** SFVMK_MGMT_TRACE_NAMES:    Copy the name of every probe hit
+ **                            while tracing to the user buffer
+ **
+ */
+typedef enum sfvmk_mgmtTraceOps_e {
+  SFVMK_MGMT_TRACE_ENABLE = 1,
+  SFVMK_MGMT_TRACE_DISABLE,
+  SFVMK_MGMT_TRACE_DRAIN,
+  SFVMK_MGMT_TRACE_NAMES,
+  SFVMK_MGMT_TRACE_INVALID
+} sfvmk_mgmtTraceOps_t;
+
+/*! \brief struct sfvmk_traceRecord_s for a single probe hit
+ **
+ ** seq             Sequence number, gaps mean records were
+ **                 overwritten before being drained
+ **
+ ** timestamp       Time of the hit in micro seconds
+ **
+ ** probeId         Probe identifier, see sfvmk_traceProbeName_t
+ **
+ ** cpu             PCPU the probe fired on
+ **
+ ** numArgs         Number of valid entries in args
+ **
+ */
+typedef struct sfvmk_traceRecord_s {
+  vmk_uint64  seq;
+  vmk_uint64  timestamp;
+  vmk_uint32  probeId;
+  vmk_uint16  cpu;
+  vmk_uint8   numArgs;
+  vmk_uint8   reserved;
+  vmk_uint64  args[SFVMK_TRACE_MAX_ARGS];
+} __attribute__((__packed__)) sfvmk_traceRecord_t;
+
+/*! \brief struct sfvmk_traceProbeName_s mapping a probe
+ **        identifier to the probe name and site. The identifier
+ **        is a hash of file, line and name, so every probe site
+ **        has its own entry.
+ */
+typedef struct sfvmk_traceProbeName_s {
+  vmk_uint32  probeId;
+  char        name[SFVMK_TRACE_PROBE_NAME_LEN];
+  char        file[SFVMK_TRACE_PROBE_FILE_LEN];
+  vmk_uint32  line;
+} __attribute__((__packed__)) sfvmk_traceProbeName_t;
+
+/*! \brief struct sfvmk_traceReq_s to control EFSYS probe
+ **        tracing and to drain the trace ring
+ **
+ ** subCmd[in]         One of sfvmk_mgmtTraceOps_t
+ **
+ ** probeName[in]      Probe name for enable/disable
+ **
+ ** traceBuffer[out]   Pointer to buffer receiving an array
+ **                    of sfvmk_traceRecord_t for drain or
+ **                    sfvmk_traceProbeName_t for names
+ **
+ ** size[in,out]       In: size of the user buffer,
+ **                    Out: number of bytes copied
+ **
+ ** numLost[out]       Records overwritten before this drain
+ **
+ ** Please Note: the trace ring is shared by all the adapters as
+ ** the common code probes carry no adapter context.
+ **
+ */
+typedef struct sfvmk_traceReq_s {
+  sfvmk_mgmtTraceOps_t subCmd;
+  char                 probeName[SFVMK_TRACE_PROBE_NAME_LEN];
+  vmk_uint64           traceBuffer;
+  vmk_uint32           size;
+  vmk_uint64           numLost;
+} __attribute__((__packed__)) sfvmk_traceReq_t;
+
+/* Number of heavy hitters tracked per RXQ */
+#define SFVMK_FLOW_TOP_K  16
+
+/*! \brief struct sfvmk_flowTopEntry_s for a single heavy
+ **        hitter flow
+ **
+ ** rssHash     Toeplitz hash of the flow computed by the NIC
+ **
+ ** pkts        Estimated packets received on the flow
+ **
+ ** bytes       Estimated bytes received on the flow
+ **
+ */
+typedef struct sfvmk_flowTopEntry_s {
+  vmk_uint32  rssHash;
+  vmk_uint64  pkts;
+  vmk_uint64  bytes;
+} __attribute__((__packed__)) sfvmk_flowTopEntry_t;
+
+/*! \brief struct sfvmk_rxFlowTop_s to get the heaviest
+ **        flows seen on a RSS RXQ
+ **
+ ** qIndex[in]        RXQ index, must be a RSS queue
+ **
+ ** reset[in]         Clear the sketch after reading it
+ **
+ ** numEntries[out]   Number of valid entries
+ **
+ ** entries[out]      Heavy hitters, unordered
+ **
+ ** Please Note: counts are count-min estimates, they never
+ ** under count a flow but flows sharing buckets may be over
+ ** counted. Only available when the rxFlowSketch module
+ ** parameter is set.
+ **
+ */
+typedef struct sfvmk_rxFlowTop_s {
+  vmk_uint32            qIndex;
+  vmk_Bool              reset;
+  vmk_uint32            numEntries;
+  sfvmk_flowTopEntry_t  entries[SFVMK_FLOW_TOP_K];
+} __attribute__((__packed__)) sfvmk_rxFlowTop_t;
+
+/*! \brief Datapath stages timed by the profiler. Stages nest, the
+ **        cycles of a stage include those of the stages it calls:
+ **        uplink_tx > transmit_pkt > populate_tx_desc and
+ **        transmit_pkt > tx_doorbell on TX, evq_poll >
+ **        rxq_complete and evq_poll > rxq_fill on RX.
+ **
+ ** SFVMK_MGMT_PROF_UPLINK_TX:         sfvmk_uplinkTx, per packet list
+ **
+ ** SFVMK_MGMT_PROF_TRANSMIT_PKT:      sfvmk_transmitPkt
+ **
+ ** SFVMK_MGMT_PROF_POPULATE_TX_DESC:  sfvmk_populateTxDescriptor,
+ **                                    DMA mapping and descriptor build
+ **
+ ** SFVMK_MGMT_PROF_TX_DOORBELL:       TX doorbell write
+ **
+ ** SFVMK_MGMT_PROF_EVQ_POLL:          sfvmk_evqPoll, packets are
+ **                                    events for this stage
+ **
+ ** SFVMK_MGMT_PROF_RXQ_COMPLETE:      sfvmk_rxqComplete
+ **
+ ** SFVMK_MGMT_PROF_RXQ_FILL:          sfvmk_rxqFill, packet allocation,
+ **                                    DMA mapping and RX doorbell
+ **
+ */
+typedef enum sfvmk_mgmtProfStage_e {
+  SFVMK_MGMT_PROF_UPLINK_TX = 0,
+  SFVMK_MGMT_PROF_TRANSMIT_PKT,
+  SFVMK_MGMT_PROF_POPULATE_TX_DESC,
+  SFVMK_MGMT_PROF_TX_DOORBELL,
+  SFVMK_MGMT_PROF_EVQ_POLL,
+  SFVMK_MGMT_PROF_RXQ_COMPLETE,
+  SFVMK_MGMT_PROF_RXQ_FILL,
+  SFVMK_MGMT_PROF_MAX_STAGES
+} sfvmk_mgmtProfStage_t;
+
+/*! \brief Datapath profiler operations
+ **
+ ** SFVMK_MGMT_PROF_GET:      Read the stage breakdown
+ **
+ ** SFVMK_MGMT_PROF_RESET:    Clear the accumulated cycles
+ **
+ ** SFVMK_MGMT_PROF_ENABLE:   Start profiling
+ **
+ ** SFVMK_MGMT_PROF_DISABLE:  Stop profiling, accumulated cycles
+ **                           are kept
+ **
+ */
+typedef enum sfvmk_mgmtProfOps_e {
+  SFVMK_MGMT_PROF_GET = 1,
+  SFVMK_MGMT_PROF_RESET,
+  SFVMK_MGMT_PROF_ENABLE,
+  SFVMK_MGMT_PROF_DISABLE,
+  SFVMK_MGMT_PROF_INVALID
+} sfvmk_mgmtProfOps_t;
+
+/*! \brief struct sfvmk_profStageInfo_s with the cost of a
+ **        datapath stage summed over all the queues
+ **
+ ** cycles          Timer cycles spent in the stage
+ **
+ ** calls           Number of times the stage ran
+ **
+ ** pkts            Packets (events for evq_poll) handled
+ **
+ ** cyclesPerPkt    cycles / pkts, 0 if no packet was handled
+ **
+ */
+typedef struct sfvmk_profStageInfo_s {
+  vmk_uint64  cycles;
+  vmk_uint64  calls;
+  vmk_uint64  pkts;
+  vmk_uint64  cyclesPerPkt;
+} __attribute__((__packed__)) sfvmk_profStageInfo_t;
+
+/*! \brief struct sfvmk_dpProfile_s to control and read the
+ **        datapath profiler
+ **
+ ** subCmd[in]          One of sfvmk_mgmtProfOps_t
+ **
+ ** enabled[out]        Profiler state after the command
+ **
+ ** cyclesPerUSec[out]  Timer cycles per micro second
+ **
+ ** stages[out]         Stage breakdown, indexed by
+ **                     sfvmk_mgmtProfStage_t (Get only)
+ **
+ */
+typedef struct sfvmk_dpProfile_s {
+  sfvmk_mgmtProfOps_t    subCmd;
+  vmk_Bool               enabled;
+  vmk_uint64             cyclesPerUSec;
+  sfvmk_profStageInfo_t  stages[SFVMK_MGMT_PROF_MAX_STAGES];
+} __attribute__((__packed__)) sfvmk_dpProfile_t;
+
+/* Max number of flow steering rules per interface */
+#define SFVMK_MGMT_FILTER_RULE_MAX   32
+
+/* Rule target standing for the dedicated storage RXQ */
+#define SFVMK_MGMT_FILTER_RULE_STORAGE_RXQ  0xFFFFFFFF
+
+/*! \brief Flow steering rule operations
+ **
+ ** SFVMK_MGMT_FILTER_RULE_ADD:    Add rules[0], the rule ID
+ **                                is returned in rules[0]
+ **
+ ** SFVMK_MGMT_FILTER_RULE_DEL:    Remove rule rules[0].ruleId
+ **
+ ** SFVMK_MGMT_FILTER_RULE_LIST:   List all rules
+ **
+ */
+typedef enum sfvmk_mgmtFilterRuleOps_e {
+  SFVMK_MGMT_FILTER_RULE_ADD = 1,
+  SFVMK_MGMT_FILTER_RULE_DEL,
+  SFVMK_MGMT_FILTER_RULE_LIST,
+  SFVMK_MGMT_FILTER_RULE_INVALID
+} sfvmk_mgmtFilterRuleOps_t;
+
+/*! \brief Flow steering rule priority
+ **
+ ** SFVMK_MGMT_FILTER_RULE_PRIO_NORMAL:  Same priority as NetQueue filters
+ **
+ ** SFVMK_MGMT_FILTER_RULE_PRIO_HIGH:    Replaces any other filter with
+ **                                      the same match
+ **
+ */
+typedef enum sfvmk_mgmtFilterRulePrio_e {
+  SFVMK_MGMT_FILTER_RULE_PRIO_NORMAL = 0,
+  SFVMK_MGMT_FILTER_RULE_PRIO_HIGH,
+  SFVMK_MGMT_FILTER_RULE_PRIO_INVALID
+} sfvmk_mgmtFilterRulePrio_t;
+
+/*! \brief struct sfvmk_filterRuleInfo_s describing an IPv4
+ **        flow steering rule
+ **
+ ** ruleId[in,out]      Rule ID, assigned by the driver on add
+ **
+ ** ipProto[in]         IP protocol, TCP (6) or UDP (17)
+ **
+ ** localIp[in]         Local IPv4 address in host byte
+ **                     order, 0 to match any
+ **
+ ** localPort[in]       Local port, 0 to match any
+ **
+ ** remoteIp[in]        Remote IPv4 address in host byte
+ **                     order, 0 to match any
+ **
+ ** remotePort[in]      Remote port, 0 to match any
+ **
+ ** priority[in]        One of sfvmk_mgmtFilterRulePrio_t
+ **
+ ** qIndex[in]          Target RXQ index or
+ **                     SFVMK_MGMT_FILTER_RULE_STORAGE_RXQ
+ **
+ ** hwQIndex[out]       RXQ the rule steers to
+ **
+ ** installed[out]      Rule has a HW filter, rules are kept
+ **                     across resets and re-installed on start
+ **
+ ** Please Note: at least one address or port must be set. The
+ ** firmware refuses match combinations it does not support.
+ **
+ */
+typedef struct sfvmk_filterRuleInfo_s {
+  vmk_uint32  ruleId;
+  vmk_uint8   ipProto;
+  vmk_uint32  localIp;
+  vmk_uint16  localPort;
+  vmk_uint32  remoteIp;
+  vmk_uint16  remotePort;
+  vmk_uint32  priority;
+  vmk_uint32  qIndex;
+  vmk_uint32  hwQIndex;
+  vmk_Bool    installed;
+} __attribute__((__packed__)) sfvmk_filterRuleInfo_t;
+
+/*! \brief struct sfvmk_filterRuleReq_s to manage the flow
+ **        steering rules of an interface
+ **
+ ** subCmd[in]          One of sfvmk_mgmtFilterRuleOps_t
+ **
+ ** storageQIndex[out]  Dedicated storage RXQ, 0 if none
+ **
+ ** numRules[out]       Number of valid rules (List only)
+ **
+ ** rules[in,out]       Rule to add or remove in rules[0],
+ **                     all rules on list
+ **
+ */
+typedef struct sfvmk_filterRuleReq_s {
+  sfvmk_mgmtFilterRuleOps_t  subCmd;
+  vmk_uint32                 storageQIndex;
+  vmk_uint32                 numRules;
+  sfvmk_filterRuleInfo_t     rules[SFVMK_MGMT_FILTER_RULE_MAX];
+} __attribute__((__packed__)) sfvmk_filterRuleReq_t;
+
 #ifdef VMKERNEL
 /*!
  ** These are the definitions of prototypes as viewed from kernel-facing code.
@@ -863,6 +1435,36 @@ VMK_ReturnStatus sfvmk_mgmtNVRAMV2Callback(vmk_MgmtCookies *pCookies,
                                            vmk_MgmtEnvelope *pEnvelope,
                                            sfvmk_mgmtDevInfo_t *pDevIface,
                                            sfvmk_nvramCmdV2_t *pNvrCmdV2);
+
+VMK_ReturnStatus sfvmk_mgmtEvqTypeCallback(vmk_MgmtCookies *pCookies,
+                                           vmk_MgmtEnvelope *pEnvelope,
+                                           sfvmk_mgmtDevInfo_t *pDevIface,
+                                           sfvmk_evqTypeCfg_t *pEvqTypeCfg);
+
+VMK_ReturnStatus sfvmk_mgmtStatsBinCallback(vmk_MgmtCookies *pCookies,
+                                            vmk_MgmtEnvelope *pEnvelope,
+                                            sfvmk_mgmtDevInfo_t *pDevIface,
+                                            sfvmk_statsBin_t *pStatsBin);
+
+VMK_ReturnStatus sfvmk_mgmtTraceCallback(vmk_MgmtCookies *pCookies,
+                                         vmk_MgmtEnvelope *pEnvelope,
+                                         sfvmk_mgmtDevInfo_t *pDevIface,
+                                         sfvmk_traceReq_t *pTraceReq);
+
+VMK_ReturnStatus sfvmk_mgmtRxFlowTopCallback(vmk_MgmtCookies *pCookies,
+                                             vmk_MgmtEnvelope *pEnvelope,
+                                             sfvmk_mgmtDevInfo_t *pDevIface,
+                                             sfvmk_rxFlowTop_t *pFlowTop);
+
+VMK_ReturnStatus sfvmk_mgmtDpProfileCallback(vmk_MgmtCookies *pCookies,
+                                             vmk_MgmtEnvelope *pEnvelope,
+                                             sfvmk_mgmtDevInfo_t *pDevIface,
+                                             sfvmk_dpProfile_t *pDpProfile);
+
+VMK_ReturnStatus sfvmk_mgmtFilterRuleCallback(vmk_MgmtCookies *pCookies,
+                                              vmk_MgmtEnvelope *pEnvelope,
+                                              sfvmk_mgmtDevInfo_t *pDevIface,
+                                              sfvmk_filterRuleReq_t *pRuleReq);
 #else /* VMKERNEL */
 /*!
  ** This section is where callback definitions, as visible to user-space, go.
@@ -887,6 +1489,12 @@ VMK_ReturnStatus sfvmk_mgmtNVRAMV2Callback(vmk_MgmtCookies *pCookies,
 #define sfvmk_mgmtHWSensorInfoCallback NULL
 #define sfvmk_mgmtFnPrivilegeCallback NULL
 #define sfvmk_mgmtNVRAMV2Callback NULL
+#define sfvmk_mgmtEvqTypeCallback NULL
+#define sfvmk_mgmtStatsBinCallback NULL
+#define sfvmk_mgmtTraceCallback NULL
+#define sfvmk_mgmtRxFlowTopCallback NULL
+#define sfvmk_mgmtDpProfileCallback NULL
+#define sfvmk_mgmtFilterRuleCallback NULL
 #endif
 
 #endif
@@ -68,6 +68,8 @@ sfvmk_modInfoCleanup(void)
     }
   }
 
+  sfvmk_traceFini();
+
   if (sfvmk_modInfo.lock != NULL) {
     vmk_SemaDestroy(&sfvmk_modInfo.lock);
   }
@@ -107,11 +109,18 @@ sfvmk_modInfoCleanup(void)
 static vmk_ByteCount
 sfvmk_calcHeapSize(void)
 {
-#define SFVMK_ALLOC_DESC_SIZE  32
+#define SFVMK_ALLOC_DESC_SIZE  39
   vmk_ByteCount maxSize = 0;
   vmk_HeapAllocationDescriptor allocDesc[SFVMK_ALLOC_DESC_SIZE];
   VMK_ReturnStatus status;
   vmk_uint32 index = 0;
+  vmk_uint32 maxHwq;
+  vmk_uint32 maxEvq;
+
+  /* Queue counts are only known at attach, bound them from the module
+   * params. An EVQ per HW queue and at most as many dedicated TX EVQs. */
+  maxHwq = sfvmk_getMaxHwqFromModParams();
+  maxEvq = 2 * maxHwq;
 
   allocDesc[index].size = vmk_LogHeapAllocSize();
   allocDesc[index].alignment = 0;
@@ -144,7 +153,7 @@ sfvmk_calcHeapSize(void)
   /* Per adapter - memBarLock, nicLock, uplinkLock, evqLock for each EVQ,
    * txqLock for each TXQ.
    */
-  allocDesc[index++].count = (3 + SFVMK_MAX_EVQ + SFVMK_MAX_TXQ) * SFVMK_MAX_ADAPTER;
+  allocDesc[index++].count = (3 + maxEvq + maxHwq) * SFVMK_MAX_ADAPTER;
 
   /* Space for helper thread */
   allocDesc[index].size = vmk_WorldCreateAllocSize(&allocDesc[index].alignment);
@@ -155,44 +164,48 @@ sfvmk_calcHeapSize(void)
   allocDesc[index++].count = SFVMK_MAX_ADAPTER;
 
   allocDesc[index].size = sizeof(sfvmk_evq_t);
-  allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_EVQ;
+  allocDesc[index].alignment = VMK_L1_CACHELINE_SIZE;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxEvq;
 
   allocDesc[index].size = sizeof(sfvmk_evq_t *);
   allocDesc[index].alignment = sizeof(sfvmk_evq_t *);
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_EVQ;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxEvq;
 
   allocDesc[index].size = sizeof(vmk_IntrCookie);
   allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_INTR;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxEvq;
 
   allocDesc[index].size = sizeof(sfvmk_rxq_t);
-  allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_RXQ;
+  allocDesc[index].alignment = VMK_L1_CACHELINE_SIZE;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxHwq;
 
   allocDesc[index].size = sizeof(sfvmk_rxq_t *);
   allocDesc[index].alignment = sizeof(sfvmk_rxq_t *);
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_RXQ;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxHwq;
 
-  allocDesc[index].size = sizeof(sfvmk_rxSwDesc_t);
+  /* One SW ring per RXQ, which ring params can grow to the HW maximum */
+  allocDesc[index].size = sizeof(sfvmk_rxSwDesc_t) * EFX_RXQ_MAXNDESCS;
   allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_RXQ * EFX_RXQ_MAXNDESCS;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxHwq;
 
   allocDesc[index].size = sizeof(sfvmk_txq_t);
-  allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_TXQ;
+  allocDesc[index].alignment = VMK_L1_CACHELINE_SIZE;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxHwq;
 
   allocDesc[index].size = sizeof(sfvmk_txq_t *);
   allocDesc[index].alignment = sizeof(sfvmk_txq_t *);
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_TXQ;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * maxHwq;
 
-  allocDesc[index].size = sizeof(vmk_UplinkSharedQueueData);
+  /* queueData, RX and TX uplink queues including the uplink RSS queue */
+  allocDesc[index].size = sizeof(vmk_UplinkSharedQueueData) *
+                          (SFVMK_MAX_NETQ_COUNT + 1) * 2;
   allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * (SFVMK_MAX_RXQ * SFVMK_MAX_TXQ);
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER;
 
   allocDesc[index].size = sizeof(sfvmk_filterDBEntry_t);
   allocDesc[index].alignment = 0;
-  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_FILTER;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER *
+                             (SFVMK_MAX_FILTER + SFVMK_ARFS_MAX_FLOWS);
 
   /* Allocaion done for both Signed and Unsigned Image type*/
   allocDesc[index].size = SFVMK_ALLOC_FW_IMAGE_SIZE;
@@ -216,6 +229,10 @@ sfvmk_calcHeapSize(void)
   allocDesc[index].alignment = 0;
   allocDesc[index++].count = 1;
 
+  allocDesc[index].size = SFVMK_STATS_BIN_BUFFER_SZ;
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = 1;
+
   allocDesc[index].size = (sizeof(efx_mon_stat_value_t) * EFX_MON_NSTATS);
   allocDesc[index].alignment = 0;
   allocDesc[index++].count = 1;
@@ -262,8 +279,39 @@ sfvmk_calcHeapSize(void)
   allocDesc[index++].count = 1;
 #endif
 
-  /* Allocation for activeQueues */
-  allocDesc[index].size = vmk_BitVectorSize(SFVMK_MAX_NETQ_COUNT * 2);
+  /* EFSYS probe trace ring and its drain buffer */
+  allocDesc[index].size = sizeof(sfvmk_trace_t);
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = 1;
+
+  allocDesc[index].size = SFVMK_TRACE_DRAIN_CHUNK * sizeof(sfvmk_traceRecord_t);
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = 1;
+
+  /* RX heavy hitter sketches, one per RSS RXQ at most */
+  allocDesc[index].size = sizeof(sfvmk_flowSketch_t);
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER * SFVMK_MAX_RSSQ_COUNT;
+
+  /* aRFS flow tables */
+  allocDesc[index].size = sizeof(sfvmk_arfsFlow_t) * SFVMK_ARFS_MAX_FLOWS;
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER;
+
+  /* RSS balancer history, one row per RSS RXQ */
+  allocDesc[index].size = sizeof(vmk_uint64) * SFVMK_MAX_RSSQ_COUNT *
+                          EFX_RSS_TBL_SIZE;
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER;
+
+  /* Allocation for activeQueues, RX and TX uplink queues including the
+   * uplink RSS queue */
+  allocDesc[index].size = vmk_BitVectorSize((SFVMK_MAX_NETQ_COUNT + 1) * 2);
+  allocDesc[index].alignment = 0;
+  allocDesc[index++].count = SFVMK_MAX_ADAPTER;
+
+  /* Filter DB snapshot replayed after a driver reset */
+  allocDesc[index].size = sizeof(sfvmk_filterDBEntry_t *) * SFVMK_MAX_FILTER;
   allocDesc[index].alignment = 0;
   allocDesc[index++].count = SFVMK_MAX_ADAPTER;
 
@@ -400,6 +448,13 @@ init_module(void)
     goto failed_hash_init;
   }
 
+  status = sfvmk_traceInit();
+  if (status != VMK_OK) {
+    SFVMK_ERROR("Initialization of trace ring failed: (%s)",
+                 vmk_StatusToString(status));
+    goto failed_trace_init;
+  }
+
 #ifdef SFVMK_SUPPORT_SRIOV
   vmk_ListInit(&sfvmk_modInfo.primaryList);
   vmk_ListInit(&sfvmk_modInfo.unassociatedList);
@@ -450,6 +505,7 @@ failed_sema_init:
 failed_listslock_init:
 #endif /* SFVMK_SUPPORT_SRIOV */
 failed_hash_init:
+failed_trace_init:
 failed_driver_register:
 failed_mgmt_init:
   sfvmk_modInfoCleanup();
@@ -322,14 +322,37 @@ void sfvmk_macLinkUpdate(sfvmk_adapter_t *pAdapter)
 
   for (index = 0; index < pQueueInfo->maxTxQueues; index++) {
     VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
-    vmk_SpinlockLock(pAdapter->ppTxq[index]->lock);
+    sfvmk_txqLock(pAdapter->ppTxq[index]);
     sfvmk_updateQueueStatus(pAdapter, state, index);
-    vmk_SpinlockUnlock(pAdapter->ppTxq[index]->lock);
+    sfvmk_txqUnlock(pAdapter->ppTxq[index]);
   }
+
+  if (pSharedData->link.state == VMK_LINK_STATE_UP)
+    sfvmk_resetLinkUp(pAdapter);
+
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_PORT);
 }
 
+/*! \brief Copy the cached MAC stats to the snapshot used by lockless
+**         readers. Adapter lock must be held to serialize the updaters.
+**
+** \param[in] pAdapter pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_macStatsPublish(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_port_t *pPort = &pAdapter->port;
+
+  vmk_VersionedAtomicBeginWrite(&pPort->macStatsLock);
+  vmk_Memcpy(pAdapter->adapterStatsSnapshot, pAdapter->adapterStats,
+             sizeof(pAdapter->adapterStatsSnapshot));
+  sfvmk_getTime(&pPort->macStatsTime);
+  vmk_VersionedAtomicEndWrite(&pPort->macStatsLock);
+}
+
 /*! \brief Function to read the latest stats DMAed from NIC
 **
 ** \param[in] pAdapter pointer to sfvmk_adapter_t
@@ -365,6 +388,9 @@ sfvmk_macStatsUpdate(sfvmk_adapter_t *pAdapter)
     /* Try to update the cached counters */
     status = efx_mac_stats_update(pAdapter->pNic, pMacStatsBuf,
                                   pAdapter->adapterStats, NULL);
+    if (status == VMK_OK)
+      sfvmk_macStatsPublish(pAdapter);
+
     if (status != VMK_RETRY)
        goto done;
 
@@ -383,6 +409,108 @@ done:
   return status;
 }
 
+/*! \brief  Helper world queue function for MAC stats update
+**
+** \param[in] data  Pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_macStatsUpdateHelper(vmk_AddrCookie data)
+{
+  sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)data.ptr;
+  VMK_ReturnStatus status;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_PORT);
+
+  if (pAdapter == NULL) {
+    SFVMK_ERROR("NULL adapter ptr");
+    goto done;
+  }
+
+  /* Clear before the update so an event arriving meanwhile is not lost */
+  vmk_AtomicWrite64(&pAdapter->port.macStatsUpdatePending, 0);
+
+  sfvmk_MutexLock(pAdapter->lock);
+  status = sfvmk_macStatsUpdate(pAdapter);
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  if ((status != VMK_OK) && (status != VMK_NOT_READY)) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_macStatsUpdate failed status: %s",
+                        vmk_StatusToString(status));
+  }
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_PORT);
+}
+
+/*! \brief Fuction to submit MAC stats update request. At most one request
+**        is queued at a time.
+**
+** \param[in] pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+VMK_ReturnStatus
+sfvmk_scheduleMacStatsUpdate(sfvmk_adapter_t *pAdapter)
+{
+  vmk_HelperRequestProps props = {0};
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  if (pAdapter == NULL) {
+    SFVMK_ERROR("NULL adapter ptr");
+    status = VMK_BAD_PARAM;
+    goto done;
+  }
+
+  if (vmk_AtomicReadIfEqualWrite64(&pAdapter->port.macStatsUpdatePending,
+                                   0, 1) != 0) {
+    status = VMK_OK;
+    goto done;
+  }
+
+  /* Create a request and submit */
+  props.requestMayBlock = VMK_FALSE;
+  props.tag = (vmk_AddrCookie)NULL;
+  props.cancelFunc = NULL;
+  props.worldToBill = VMK_INVALID_WORLD_ID;
+  status = vmk_HelperSubmitRequest(pAdapter->helper,
+                                   sfvmk_macStatsUpdateHelper,
+                                   (vmk_AddrCookie *)pAdapter,
+                                   &props);
+  if (status != VMK_OK) {
+    vmk_AtomicWrite64(&pAdapter->port.macStatsUpdatePending, 0);
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HelperSubmitRequest failed status: %s",
+                        vmk_StatusToString(status));
+  }
+
+done:
+  return status;
+}
+
+/*! \brief Schedule a MAC stats update if the snapshot a reader just got
+**        is stale. Never blocks, the reader keeps the stale values.
+**
+** \param[in] pAdapter      pointer to sfvmk_adapter_t
+** \param[in] snapshotTime  macStatsTime read along with the snapshot
+**
+** \return: void
+**
+*/
+void
+sfvmk_macStatsSnapshotCheck(sfvmk_adapter_t *pAdapter, vmk_uint64 snapshotTime)
+{
+  vmk_uint64 currentTime;
+
+  if (pAdapter->port.state != SFVMK_PORT_STATE_STARTED)
+    return;
+
+  sfvmk_getTime(&currentTime);
+  if ((currentTime - snapshotTime) > SFVMK_MAC_STATS_MAX_AGE_USEC)
+    (void)sfvmk_scheduleMacStatsUpdate(pAdapter);
+}
+
 /*! \brief Fuction to submit link update request.
 **
 ** \param[in] pAdapter  pointer to sfvmk_adapter_t
@@ -571,9 +699,10 @@ sfvmk_portStart(sfvmk_adapter_t *pAdapter)
 
   /* Update MAC stats by DMA every second.  SFVMK_STATS_UPDATE_WAIT_USEC
    * is ignored by the API. Firmware always update the stats at 1 second
-   * periodicity. */
+   * periodicity. Completion of each DMA is signalled by an event, which
+   * refreshes the snapshot read by sfvmk_uplinkStatsGet. */
   status = efx_mac_stats_periodic(pNic, &pPort->macStatsDmaBuf,
-                                  SFVMK_STATS_UPDATE_WAIT_USEC, B_FALSE);
+                                  SFVMK_STATS_UPDATE_WAIT_USEC, B_TRUE);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "efx_mac_stats_periodic failed status: %s",
                         vmk_StatusToString(status));
@@ -710,6 +839,11 @@ sfvmk_portInit(sfvmk_adapter_t *pAdapter)
   }
 
   memset(pAdapter->adapterStats, 0, EFX_MAC_NSTATS * sizeof(uint64_t));
+  memset(pAdapter->adapterStatsSnapshot, 0,
+         sizeof(pAdapter->adapterStatsSnapshot));
+  vmk_VersionedAtomicInit(&pPort->macStatsLock);
+  pPort->macStatsTime = 0;
+  vmk_AtomicWrite64(&pPort->macStatsUpdatePending, 0);
 
   /* Initialize filter and port just to get the media type. This media info
    * is used by the vmkernel before calling startIO. After getting media info
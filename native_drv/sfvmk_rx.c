@@ -42,8 +42,66 @@
 /* Max try count for pkt alloc */
 #define SFVMK_PKT_ALLOC_MAX_TRY_COUNT   2
 
+/* RSS balancer: below this total RSS receive rate (bytes/sec) queue loads
+ * are too noisy to act on */
+#define SFVMK_RSS_BALANCE_MIN_BYTE_RATE (10 * 1000 * 1000)
+/* RSS balancer: buckets moved at most per check */
+#define SFVMK_RSS_BALANCE_MAX_MOVES     8
+
+/*! \brief    Translate the requested RSS hash fields into the hash type
+**            programmed in the NIC, dropping the fields the NIC can not
+**            hash on. The fields kept are recorded in rssHashActive.
+**
+** \param[in]  pAdapter     pointer to sfvmk_adapter_t
+**
+** \return: efx hash type
+*/
+static efx_rx_hash_type_t
+sfvmk_rssHashType(sfvmk_adapter_t *pAdapter)
+{
+  const efx_nic_cfg_t *pNicCfg = efx_nic_cfg_get(pAdapter->pNic);
+  vmk_uint32 allowed = SFVMK_RSS_HASH_ALL;
+  vmk_uint32 fields;
+  efx_rx_hash_type_t hashType = 0;
+
+  if ((pNicCfg == NULL) || !(pNicCfg->enc_features & EFX_FEATURE_IPV6))
+    allowed &= ~SFVMK_RSS_HASH_IPV6_ALL;
+
+  fields = pAdapter->rssHashFields & allowed;
+
+  /* UDP 4-tuple hashing needs the additional RSS modes of EF10 firmware */
+  if ((fields & SFVMK_RSS_HASH_UDP_ALL) &&
+      ((pNicCfg == NULL) || !pNicCfg->enc_rx_scale_additional_modes_supported)) {
+    SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_RX, SFVMK_LOG_LEVEL_INFO,
+                        "UDP 4-tuple RSS hashing not supported");
+    fields &= ~SFVMK_RSS_HASH_UDP_ALL;
+  }
+
+  /* Never leave RSS without any hash input */
+  if (fields == 0)
+    fields = SFVMK_RSS_HASH_DEFAULT & allowed;
+
+  if (fields & SFVMK_RSS_HASH_IPV4)
+    hashType |= EFX_RX_HASH_IPV4;
+  if (fields & SFVMK_RSS_HASH_TCPIPV4)
+    hashType |= EFX_RX_HASH_TCPIPV4;
+  if (fields & SFVMK_RSS_HASH_UDPIPV4)
+    hashType |= EFX_RX_HASH_UDPIPV4;
+  if (fields & SFVMK_RSS_HASH_IPV6)
+    hashType |= EFX_RX_HASH_IPV6;
+  if (fields & SFVMK_RSS_HASH_TCPIPV6)
+    hashType |= EFX_RX_HASH_TCPIPV6;
+  if (fields & SFVMK_RSS_HASH_UDPIPV6)
+    hashType |= EFX_RX_HASH_UDPIPV6;
+
+  pAdapter->rssHashActive = fields;
+
+  return hashType;
+}
+
 /*! \brief    Configure RSS by setting hash key, indirection table
-**            and scale mode.
+**            and scale mode. The hash key and mode are also pushed to
+**            the NetQueue RSS contexts in use.
 **
 ** \param[in]  pAdapter     pointer to sfvmk_adapter_t
 ** \param[in]  pKey         pointer to hash key
@@ -62,8 +120,8 @@ sfvmk_configRSS(sfvmk_adapter_t *pAdapter,
 {
   VMK_ReturnStatus status = VMK_FAILURE;
   efx_rx_scale_context_type_t supportRSS;
-  const efx_nic_cfg_t *pNicCfg = NULL;
-  vmk_uint32 rssModes;
+  efx_rx_hash_type_t rssModes;
+  vmk_uint32 i;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_RX);
 
@@ -101,13 +159,7 @@ sfvmk_configRSS(sfvmk_adapter_t *pAdapter,
     goto done;
   }
 
-  rssModes = EFX_RX_HASH_IPV4 | EFX_RX_HASH_TCPIPV4;
-
-  pNicCfg = efx_nic_cfg_get(pAdapter->pNic);
-  if (pNicCfg != NULL) {
-    if (pNicCfg->enc_features & EFX_FEATURE_IPV6)
-      rssModes |= EFX_RX_HASH_IPV6 | EFX_RX_HASH_TCPIPV6;
-  }
+  rssModes = sfvmk_rssHashType(pAdapter);
 
   status = efx_rx_scale_mode_set(pAdapter->pNic,
                                  EFX_RSS_CONTEXT_DEFAULT,
@@ -128,12 +180,491 @@ sfvmk_configRSS(sfvmk_adapter_t *pAdapter,
     goto done;
   }
 
+  /* NetQueue RSS contexts hash like the vmkernel RSS pool */
+  for (i = 0; i < SFVMK_MAX_RSS_CONTEXTS; i++) {
+    if (!pAdapter->rssCtx[i].inUse)
+      continue;
+
+    status = efx_rx_scale_mode_set(pAdapter->pNic,
+                                   pAdapter->rssCtx[i].efxContext,
+                                   EFX_RX_HASHALG_TOEPLITZ,
+                                   rssModes, B_TRUE);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_mode_set(%u) failed status: %s",
+                          pAdapter->rssCtx[i].efxContext,
+                          vmk_StatusToString(status));
+      goto done;
+    }
+
+    status = efx_rx_scale_key_set(pAdapter->pNic,
+                                  pAdapter->rssCtx[i].efxContext,
+                                  pKey, keySize);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_key_set(%u) failed status: %s",
+                          pAdapter->rssCtx[i].efxContext,
+                          vmk_StatusToString(status));
+      goto done;
+    }
+  }
+
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX);
 
   return status;
 }
 
+/* Toeplitz key used by NetQueue RSS contexts until the vmkernel has
+ * programmed its own RSS key */
+static const vmk_uint8 sfvmk_rssDefaultKey[SFVMK_RSS_HASH_KEY_SIZE] = {
+  0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+  0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+  0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+  0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+  0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+};
+
+/*! \brief    Get the exclusive RSS context spreading the traffic of a
+**            NetQueue over the hardware queues of the context, allocating
+**            it on first use. Adapter lock must be held.
+**
+** \param[in]  pAdapter     pointer to sfvmk_adapter_t
+** \param[in]  qID          uplink queue index of the NetQueue
+** \param[out] pEfxContext  efx RSS context to set in the filters
+** \param[out] pRxqStart    first RXQ of the context, the filter queue
+**
+** \return: VMK_OK if the NetQueue has an RSS context
+** \return: VMK_NOT_FOUND if the NetQueue uses its own RXQ only
+** \return: error code if the context could not be set up
+*/
+VMK_ReturnStatus
+sfvmk_rssContextGet(sfvmk_adapter_t *pAdapter, vmk_uint32 qID,
+                    vmk_uint32 *pEfxContext, vmk_uint32 *pRxqStart)
+{
+  const efx_nic_cfg_t *pNicCfg = NULL;
+  sfvmk_rssContext_t *pCtx = NULL;
+  const vmk_uint8 *pKey;
+  vmk_uint32 indTable[EFX_RSS_TBL_SIZE];
+  vmk_uint32 keySize;
+  vmk_uint32 maxContexts;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  if ((pAdapter->rssCtxMax == 0) || !sfvmk_isRSSEnable(pAdapter))
+    return VMK_NOT_FOUND;
+
+  for (i = 0; i < SFVMK_MAX_RSS_CONTEXTS; i++) {
+    if (pAdapter->rssCtx[i].inUse && (pAdapter->rssCtx[i].qID == qID)) {
+      *pEfxContext = pAdapter->rssCtx[i].efxContext;
+      *pRxqStart = sfvmk_getRssCtxQStartIndex(pAdapter, i);
+      return VMK_OK;
+    }
+  }
+
+  pNicCfg = efx_nic_cfg_get(pAdapter->pNic);
+  if (pNicCfg == NULL)
+    return VMK_NOT_FOUND;
+
+  maxContexts = MIN(pAdapter->rssCtxMax,
+                    pNicCfg->enc_rx_scale_max_exclusive_contexts);
+
+  for (i = 0; i < maxContexts; i++) {
+    if (!pAdapter->rssCtx[i].inUse) {
+      pCtx = &pAdapter->rssCtx[i];
+      break;
+    }
+  }
+
+  /* The NetQueues allocated first, i.e. the busiest ones, got them all */
+  if (pCtx == NULL)
+    return VMK_NOT_FOUND;
+
+  status = efx_rx_scale_context_alloc(pAdapter->pNic, EFX_RX_SCALE_EXCLUSIVE,
+                                      pAdapter->numRSSQs, &pCtx->efxContext);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_context_alloc failed status: %s",
+                        vmk_StatusToString(status));
+    return status;
+  }
+
+  /* Same hash input as the vmkernel RSS pool */
+  status = efx_rx_scale_mode_set(pAdapter->pNic, pCtx->efxContext,
+                                 EFX_RX_HASHALG_TOEPLITZ,
+                                 sfvmk_rssHashType(pAdapter), B_TRUE);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_mode_set failed status: %s",
+                        vmk_StatusToString(status));
+    goto failed;
+  }
+
+  if (pAdapter->rssHashKeySize != 0) {
+    pKey = pAdapter->rssHashKey;
+    keySize = pAdapter->rssHashKeySize;
+  } else {
+    pKey = sfvmk_rssDefaultKey;
+    keySize = sizeof(sfvmk_rssDefaultKey);
+  }
+
+  status = efx_rx_scale_key_set(pAdapter->pNic, pCtx->efxContext,
+                                (vmk_uint8 *)pKey, keySize);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_key_set failed status: %s",
+                        vmk_StatusToString(status));
+    goto failed;
+  }
+
+  /* Entries are relative to the first queue of the context */
+  for (i = 0; i < EFX_RSS_TBL_SIZE; i++)
+    indTable[i] = i % pAdapter->numRSSQs;
+
+  status = efx_rx_scale_tbl_set(pAdapter->pNic, pCtx->efxContext,
+                                indTable, EFX_RSS_TBL_SIZE);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_tbl_set failed status: %s",
+                        vmk_StatusToString(status));
+    goto failed;
+  }
+
+  pCtx->inUse = VMK_TRUE;
+  pCtx->qID = qID;
+  *pEfxContext = pCtx->efxContext;
+  *pRxqStart = sfvmk_getRssCtxQStartIndex(pAdapter,
+                                          (vmk_uint32)(pCtx - pAdapter->rssCtx));
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_RSS, SFVMK_LOG_LEVEL_INFO,
+                      "RSS context %u spreads uplink queue %u over RXQs %u-%u",
+                      pCtx->efxContext, qID, *pRxqStart,
+                      *pRxqStart + pAdapter->numRSSQs - 1);
+
+  return VMK_OK;
+
+failed:
+  efx_rx_scale_context_free(pAdapter->pNic, pCtx->efxContext);
+  return status;
+}
+
+/*! \brief    Release the RSS context of a NetQueue, if it has one. The
+**            filters of the NetQueue must be removed already. Adapter
+**            lock must be held.
+**
+** \param[in]  pAdapter     pointer to sfvmk_adapter_t
+** \param[in]  qID          uplink queue index of the NetQueue
+**
+** \return: void
+*/
+void
+sfvmk_rssContextPut(sfvmk_adapter_t *pAdapter, vmk_uint32 qID)
+{
+  VMK_ReturnStatus status;
+  vmk_uint32 i;
+
+  for (i = 0; i < SFVMK_MAX_RSS_CONTEXTS; i++) {
+    if (!pAdapter->rssCtx[i].inUse || (pAdapter->rssCtx[i].qID != qID))
+      continue;
+
+    status = efx_rx_scale_context_free(pAdapter->pNic,
+                                       pAdapter->rssCtx[i].efxContext);
+    if (status != VMK_OK)
+      SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_context_free failed status: %s",
+                          vmk_StatusToString(status));
+
+    pAdapter->rssCtx[i].inUse = VMK_FALSE;
+  }
+}
+
+/*! \brief    Release the RSS contexts of all NetQueues. Called once all
+**            filters are removed, before the RX module is stopped.
+**
+** \param[in]  pAdapter     pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_rssContextFreeAll(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint32 i;
+
+  for (i = 0; i < SFVMK_MAX_RSS_CONTEXTS; i++) {
+    if (pAdapter->rssCtx[i].inUse)
+      sfvmk_rssContextPut(pAdapter, pAdapter->rssCtx[i].qID);
+  }
+}
+
+/*! \brief  Collect the per bucket and per queue receive counts of the RSS
+**         queues since the last check.
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  elapsedUs  time since the last check, 0 on the first one
+**
+** \return: total bytes received on RSS queues since the last check
+*/
+static vmk_uint64
+sfvmk_rssBalanceCollect(sfvmk_adapter_t *pAdapter, vmk_uint64 elapsedUs)
+{
+  sfvmk_rssBalance_t *pBalance = &pAdapter->rssBalance;
+  vmk_uint64 *bucketBytes = pBalance->bucketBytes;
+  vmk_uint64 *prevBucketBytes;
+  vmk_uint64 stats[SFVMK_RXQ_MAX_STATS];
+  vmk_uint64 total = 0;
+  vmk_uint64 delta;
+  sfvmk_rxq_t *pRxq;
+  vmk_uint32 qIndex;
+  vmk_uint32 i;
+
+  vmk_Memset(pBalance->bucketLoad, 0, sizeof(pBalance->bucketLoad));
+
+  for (qIndex = 0; qIndex < pAdapter->numRSSQs; qIndex++) {
+    pRxq = pAdapter->ppRxq[sfvmk_getRSSQStartIndex(pAdapter) + qIndex];
+    prevBucketBytes = &pBalance->pPrevBucketBytes[qIndex * EFX_RSS_TBL_SIZE];
+
+    sfvmk_queueStatsSnapshot(&pRxq->statsLock, pRxq->rssBucketBytes,
+                             bucketBytes, EFX_RSS_TBL_SIZE);
+    sfvmk_queueStatsSnapshot(&pRxq->statsLock, pRxq->stats, stats,
+                             SFVMK_RXQ_MAX_STATS);
+
+    /* A bucket moved between queues keeps counting on each of them, so
+     * its load is the sum of the deltas over all RSS queues. Counters
+     * only go backwards when the RXQ was recreated */
+    for (i = 0; i < EFX_RSS_TBL_SIZE; i++) {
+      delta = bucketBytes[i] - prevBucketBytes[i];
+      if (bucketBytes[i] < prevBucketBytes[i])
+        delta = bucketBytes[i];
+      prevBucketBytes[i] = bucketBytes[i];
+      pBalance->bucketLoad[i] += delta;
+      total += delta;
+    }
+
+    if (elapsedUs != 0) {
+      pBalance->pktRate[qIndex] = ((stats[SFVMK_RXQ_PKTS] -
+                                    pBalance->prevPkts[qIndex]) *
+                                   VMK_USEC_PER_SEC) / elapsedUs;
+      pBalance->byteRate[qIndex] = ((stats[SFVMK_RXQ_BYTES] -
+                                     pBalance->prevBytes[qIndex]) *
+                                    VMK_USEC_PER_SEC) / elapsedUs;
+    }
+    pBalance->prevPkts[qIndex] = stats[SFVMK_RXQ_PKTS];
+    pBalance->prevBytes[qIndex] = stats[SFVMK_RXQ_BYTES];
+  }
+
+  return total;
+}
+
+/*! \brief  Find the most and the least loaded RSS queues.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[out] pHot      most loaded RSS queue
+** \param[out] pCold     least loaded RSS queue
+**
+** \return: void
+*/
+static void
+sfvmk_rssBalanceExtremes(sfvmk_adapter_t *pAdapter,
+                         vmk_uint32 *pHot,
+                         vmk_uint32 *pCold)
+{
+  const vmk_uint64 *pLoad = pAdapter->rssBalance.queueLoad;
+  vmk_uint32 qIndex;
+
+  *pHot = 0;
+  *pCold = 0;
+  for (qIndex = 1; qIndex < pAdapter->numRSSQs; qIndex++) {
+    if (pLoad[qIndex] > pLoad[*pHot])
+      *pHot = qIndex;
+    if (pLoad[qIndex] < pLoad[*pCold])
+      *pCold = qIndex;
+  }
+}
+
+/*! \brief  Check the RSS queue loads and move the hottest indirection
+**         table buckets off the hottest queue when it is more loaded
+**         than the threshold allows. Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_rssBalanceCheck(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_rssBalance_t *pBalance = &pAdapter->rssBalance;
+  vmk_uint64 currentTime;
+  vmk_uint64 elapsedUs = 0;
+  vmk_uint64 total;
+  vmk_uint64 mean;
+  vmk_uint64 gap;
+  vmk_uint32 hot, cold, best;
+  vmk_uint32 numMoved = 0;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  sfvmk_getTime(&currentTime);
+  if (pBalance->lastTime != 0)
+    elapsedUs = currentTime - pBalance->lastTime;
+  pBalance->lastTime = currentTime;
+
+  total = sfvmk_rssBalanceCollect(pAdapter, elapsedUs);
+
+  /* First check only sets the baselines. Once the vmkernel updated its
+   * table the baselines are only kept current */
+  if ((elapsedUs == 0) || pBalance->hostActive)
+    return;
+
+  pBalance->stats[SFVMK_RSS_BALANCE_CHECKS]++;
+
+  if ((pAdapter->numRSSQs < 2) || (pAdapter->rssIndTableSize == 0) ||
+      ((total * VMK_USEC_PER_SEC) / elapsedUs < SFVMK_RSS_BALANCE_MIN_BYTE_RATE))
+    return;
+
+  /* Work on the full table the NIC uses: the one programmed last by the
+   * balancer, else the vmkernel table, which the NIC repeats when it is
+   * shorter */
+  vmk_Memset(pBalance->queueLoad, 0, sizeof(pBalance->queueLoad));
+  for (i = 0; i < EFX_RSS_TBL_SIZE; i++) {
+    if (pBalance->driverTable)
+      pBalance->newTable[i] = pBalance->table[i];
+    else
+      pBalance->newTable[i] = pAdapter->rssIndTable[i % pAdapter->rssIndTableSize];
+    if (pBalance->newTable[i] >= pAdapter->numRSSQs) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "Invalid RSS table entry %u",
+                          pBalance->newTable[i]);
+      return;
+    }
+    pBalance->queueLoad[pBalance->newTable[i]] += pBalance->bucketLoad[i];
+  }
+
+  mean = total / pAdapter->numRSSQs;
+  sfvmk_rssBalanceExtremes(pAdapter, &hot, &cold);
+  pBalance->stats[SFVMK_RSS_BALANCE_IMBALANCE_PCT] =
+    (pBalance->queueLoad[hot] * 100) / mean;
+
+  if (pBalance->stats[SFVMK_RSS_BALANCE_IMBALANCE_PCT] <= pBalance->thresholdPct)
+    return;
+
+  pBalance->stats[SFVMK_RSS_BALANCE_IMBALANCED]++;
+
+  /* Greedily move the heaviest bucket of the hottest queue that still
+   * narrows the gap to the coldest queue. A single bucket heavier than
+   * the gap (one elephant flow) cannot be helped and stays put */
+  while (numMoved < SFVMK_RSS_BALANCE_MAX_MOVES) {
+    gap = pBalance->queueLoad[hot] - pBalance->queueLoad[cold];
+    best = EFX_RSS_TBL_SIZE;
+
+    for (i = 0; i < EFX_RSS_TBL_SIZE; i++) {
+      if ((pBalance->newTable[i] != hot) || (pBalance->bucketLoad[i] == 0) ||
+          (pBalance->bucketLoad[i] >= gap))
+        continue;
+      if ((best == EFX_RSS_TBL_SIZE) ||
+          (pBalance->bucketLoad[i] > pBalance->bucketLoad[best]))
+        best = i;
+    }
+
+    if (best == EFX_RSS_TBL_SIZE)
+      break;
+
+    pBalance->newTable[best] = cold;
+    pBalance->queueLoad[hot] -= pBalance->bucketLoad[best];
+    pBalance->queueLoad[cold] += pBalance->bucketLoad[best];
+    numMoved++;
+
+    sfvmk_rssBalanceExtremes(pAdapter, &hot, &cold);
+    if ((pBalance->queueLoad[hot] * 100) / mean <= pBalance->thresholdPct)
+      break;
+  }
+
+  if (numMoved == 0)
+    return;
+
+  status = efx_rx_scale_tbl_set(pAdapter->pNic, EFX_RSS_CONTEXT_DEFAULT,
+                                pBalance->newTable, EFX_RSS_TBL_SIZE);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "efx_rx_scale_tbl_set failed status: %s",
+                        vmk_StatusToString(status));
+    pBalance->stats[SFVMK_RSS_BALANCE_TBL_SET_FAILED]++;
+    return;
+  }
+
+  /* The vmkernel table is left as the vmkernel set it */
+  vmk_Memcpy(pBalance->table, pBalance->newTable, sizeof(pBalance->table));
+  pBalance->driverTable = VMK_TRUE;
+
+  pBalance->stats[SFVMK_RSS_BALANCE_REBALANCES]++;
+  pBalance->stats[SFVMK_RSS_BALANCE_BUCKETS_MOVED] += numMoved;
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_RSS, SFVMK_LOG_LEVEL_INFO,
+                      "RSS rebalanced, %u buckets moved, imbalance %lu%%",
+                      numMoved, pBalance->stats[SFVMK_RSS_BALANCE_IMBALANCE_PCT]);
+}
+
+/*! \brief  Helper world queue function running the periodic RSS load
+**         check. Requeues itself while RSS stays configured.
+**
+** \param[in] data  Pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_rssBalanceHelper(vmk_AddrCookie data)
+{
+  sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)data.ptr;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_RSS);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  /* Cleared under the adapter lock so that sfvmk_rssBalanceSchedule
+   * called from RSS init either sees the chain alive or starts a new one */
+  vmk_AtomicWrite64(&pAdapter->rssBalance.pending, 0);
+
+  if ((pAdapter->state != SFVMK_ADAPTER_STATE_STARTED) || !pAdapter->rssInit ||
+      (pAdapter->rssBalance.pPrevBucketBytes == NULL))
+    goto done;
+
+  sfvmk_rssBalanceCheck(pAdapter);
+  sfvmk_rssBalanceSchedule(pAdapter);
+
+done:
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RSS);
+}
+
+/*! \brief  Queue the next RSS load check if the balancer is enabled and
+**         no check is queued yet. Adapter lock must be held.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_rssBalanceSchedule(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_rssBalance_t *pBalance = &pAdapter->rssBalance;
+  vmk_HelperRequestProps props = {0};
+  VMK_ReturnStatus status;
+
+  if (pBalance->intervalMs == 0)
+    return;
+
+  if (vmk_AtomicReadIfEqualWrite64(&pBalance->pending, 0, 1) != 0)
+    return;
+
+  props.requestMayBlock = VMK_FALSE;
+  props.tag = (vmk_AddrCookie)NULL;
+  props.cancelFunc = NULL;
+  props.worldToBill = VMK_INVALID_WORLD_ID;
+  status = vmk_HelperSubmitDelayedRequest(pAdapter->helper,
+                                          sfvmk_rssBalanceHelper,
+                                          (vmk_AddrCookie *)pAdapter,
+                                          pBalance->intervalMs,
+                                          &props);
+  if (status != VMK_OK) {
+    vmk_AtomicWrite64(&pBalance->pending, 0);
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HelperSubmitDelayedRequest failed status: %s",
+                        vmk_StatusToString(status));
+  }
+}
+
 /*! \brief     Initialize all resources required for a RXQ
 **
 ** \param[in]  pAdapter     pointer to sfvmk_adapter_t
@@ -162,8 +693,10 @@ sfvmk_rxqInit(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
     goto done;
   }
 
-  /* Allocate memory for RXQ data struture */
-  pRxq = vmk_HeapAlloc(sfvmk_modInfo.heapID, sizeof(sfvmk_rxq_t));
+  /* Allocate memory for RXQ data struture, cache line aligned so that
+   * the counter block does not share a line with other data */
+  pRxq = vmk_HeapAlign(sfvmk_modInfo.heapID, sizeof(sfvmk_rxq_t),
+                       VMK_L1_CACHELINE_SIZE);
   if(pRxq == NULL) {
     SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_HeapAlloc failed");
     status = VMK_NO_MEMORY;
@@ -173,6 +706,22 @@ sfvmk_rxqInit(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 
   pRxq->pAdapter = pAdapter;
   pRxq->index = qIndex;
+  vmk_VersionedAtomicInit(&pRxq->statsLock);
+
+  /* Only RSS queues have a hash to key the sketch on. The queues of the
+   * NetQueue RSS contexts carry a single NetQueue's flows and go without */
+  if (modParams.rxFlowSketch &&
+      (qIndex >= sfvmk_getRSSQStartIndex(pAdapter)) &&
+      (qIndex < sfvmk_getRSSQStartIndex(pAdapter) + pAdapter->numRSSQs)) {
+    pRxq->pFlowSketch = vmk_HeapAlloc(sfvmk_modInfo.heapID,
+                                      sizeof(sfvmk_flowSketch_t));
+    if (pRxq->pFlowSketch == NULL) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HeapAlloc failed for flow sketch");
+      status = VMK_NO_MEMORY;
+      goto failed_sketch_alloc;
+    }
+    vmk_Memset(pRxq->pFlowSketch, 0, sizeof(sfvmk_flowSketch_t));
+  }
 
   pRxq->state = SFVMK_RXQ_STATE_INITIALIZED;
 
@@ -181,6 +730,9 @@ sfvmk_rxqInit(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   status = VMK_OK;
   goto done;
 
+failed_sketch_alloc:
+  vmk_HeapFree(sfvmk_modInfo.heapID, pRxq);
+
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX, "qIndex[%u]" , qIndex);
 
@@ -223,6 +775,9 @@ sfvmk_rxqFini(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
     goto done;
   }
 
+  if (pRxq->pFlowSketch != NULL)
+    vmk_HeapFree(sfvmk_modInfo.heapID, pRxq->pFlowSketch);
+
   vmk_HeapFree(sfvmk_modInfo.heapID, pRxq);
 
   pAdapter->ppRxq[qIndex] = NULL;
@@ -243,6 +798,7 @@ sfvmk_rxInit(sfvmk_adapter_t *pAdapter)
 {
   vmk_uint32 qIndex;
   vmk_uint32 rxqArraySize;
+  vmk_uint32 numRssHwQs;
   VMK_ReturnStatus status = VMK_FAILURE;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_RX);
@@ -254,7 +810,7 @@ sfvmk_rxInit(sfvmk_adapter_t *pAdapter)
   }
 
   pAdapter->isRxCsumEnabled = VMK_TRUE;
-  pAdapter->numRxqsAllocated = MIN(pAdapter->numEvqsAllocated,
+  pAdapter->numRxqsAllocated = MIN(sfvmk_getTxEvqStartIndex(pAdapter),
                                    pAdapter->numRxqsAllotted);
 
   /* NetQ count can not be more than RXQs allocated */
@@ -262,12 +818,21 @@ sfvmk_rxInit(sfvmk_adapter_t *pAdapter)
     pAdapter->numNetQs = pAdapter->numRxqsAllocated;
     pAdapter->numRSSQs = 0;
   } else if (pAdapter->numRxqsAllocated >= sfvmk_getRSSQStartIndex(pAdapter)) {
-    pAdapter->numRSSQs = pAdapter->numRxqsAllocated - sfvmk_getRSSQStartIndex(pAdapter);
+    numRssHwQs = pAdapter->numRxqsAllocated - sfvmk_getRSSQStartIndex(pAdapter);
+    /* RSS queues are shared out between the vmkernel RSS pool and the
+     * NetQueue RSS contexts, drop contexts until each gets two queues */
+    while ((pAdapter->rssCtxMax > 0) &&
+           ((numRssHwQs / (pAdapter->rssCtxMax + 1)) < 2))
+      pAdapter->rssCtxMax--;
+    pAdapter->numRSSQs = numRssHwQs / (pAdapter->rssCtxMax + 1);
    /* If RSS is enabled there should be atleast two more RXQs to support RSS */
     if (pAdapter->numRSSQs < 2)
       pAdapter->numRSSQs = 0;
   }
 
+  if (pAdapter->numRSSQs == 0)
+    pAdapter->rssCtxMax = 0;
+
   rxqArraySize = sizeof(sfvmk_rxq_t *) * pAdapter->numRxqsAllocated;
 
   pAdapter->ppRxq = vmk_HeapAlloc(sfvmk_modInfo.heapID, rxqArraySize);
@@ -290,6 +855,34 @@ sfvmk_rxInit(sfvmk_adapter_t *pAdapter)
   /* Set default RXQ index */
   pAdapter->defRxqIndex = 0;
 
+  /* The last NetQueue is kept for storage steering rules, provided
+   * the default queue and one NetQueue remain for the vmkernel */
+  pAdapter->storageRxq = 0;
+  if (pAdapter->storageRxqEnabled && (pAdapter->numNetQs > 2))
+    pAdapter->storageRxq = pAdapter->numNetQs - 1;
+
+  /* Balancer history is sized by the RSS queues actually created */
+  if ((pAdapter->rssBalance.intervalMs != 0) && (pAdapter->numRSSQs != 0)) {
+    pAdapter->rssBalance.pPrevBucketBytes =
+      vmk_HeapAlloc(sfvmk_modInfo.heapID, pAdapter->numRSSQs *
+                    EFX_RSS_TBL_SIZE * sizeof(vmk_uint64));
+    if (pAdapter->rssBalance.pPrevBucketBytes == NULL) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HeapAlloc failed, RSS balancer disabled");
+      pAdapter->rssBalance.intervalMs = 0;
+    } else {
+      vmk_Memset(pAdapter->rssBalance.pPrevBucketBytes, 0,
+                 pAdapter->numRSSQs * EFX_RSS_TBL_SIZE * sizeof(vmk_uint64));
+    }
+  }
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_RX, SFVMK_LOG_LEVEL_INFO,
+                      "%u RXQs: %u NetQs, %u RSSQs, %u RSS contexts, "
+                      "storage RXQ %u",
+                      pAdapter->numRxqsAllocated, pAdapter->numNetQs,
+                      pAdapter->numRSSQs, pAdapter->rssCtxMax,
+                      pAdapter->storageRxq);
+
+  status = VMK_OK;
   goto done;
 
 failed_rxq_init:
@@ -335,6 +928,11 @@ void sfvmk_rxFini(sfvmk_adapter_t *pAdapter)
   vmk_HeapFree(sfvmk_modInfo.heapID, pAdapter->ppRxq);
   pAdapter->ppRxq = NULL;
 
+  if (pAdapter->rssBalance.pPrevBucketBytes != NULL) {
+    vmk_HeapFree(sfvmk_modInfo.heapID, pAdapter->rssBalance.pPrevBucketBytes);
+    pAdapter->rssBalance.pPrevBucketBytes = NULL;
+  }
+
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX);
 }
@@ -491,6 +1089,12 @@ void sfvmk_rxDeliver(sfvmk_adapter_t *pAdapter,
   pAdapter->ppRxq[qIndex]->stats[SFVMK_RXQ_BYTES] += pRxDesc->size;
   pAdapter->ppRxq[qIndex]->stats[SFVMK_RXQ_PKTS]++;
 
+  if (VMK_UNLIKELY(pRxDesc->evTime != 0)) {
+    sfvmk_latHistRecord(pAdapter, pAdapter->ppRxq[qIndex]->latHist,
+                        pRxDesc->evTime, vmk_GetTimerCycles());
+    pRxDesc->evTime = 0;
+  }
+
   pRxDesc->flags = EFX_DISCARD;
   pRxDesc->pPkt = NULL;
 
@@ -498,6 +1102,166 @@ done:
   return;
 }
 
+/*! \brief      Account the RX buffers owned by the NIC and the time the
+**              ring spent empty. Called within the RXQ stats write section.
+**
+** \param[in]  pRxq      Ptr to RXQ
+**
+** \return: void
+*/
+static void
+sfvmk_rxqLevelUpdate(sfvmk_rxq_t *pRxq)
+{
+  vmk_Bool wasEmpty = (pRxq->ringLevel.level == 0);
+  vmk_uint64 elapsedUs;
+
+  elapsedUs = sfvmk_ringLevelUpdate(pRxq->pAdapter, &pRxq->ringLevel,
+                                    pRxq->pushed - pRxq->pending,
+                                    &pRxq->stats[SFVMK_RXQ_RING_LEVEL_US],
+                                    &pRxq->stats[SFVMK_RXQ_RING_TIME_US],
+                                    &pRxq->stats[SFVMK_RXQ_RING_LEVEL_HWM]);
+  if (wasEmpty)
+    pRxq->stats[SFVMK_RXQ_RING_EMPTY_US] += elapsedUs;
+}
+
+/* Odd multipliers spreading the RSS hash over the sketch rows */
+static const vmk_uint32 sfvmkFlowSketchSeed[SFVMK_FLOW_SKETCH_DEPTH] = {
+  0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f
+};
+
+/*! \brief      Account a received packet against its flow in the RXQ
+**              heavy hitter sketch. Called within the RXQ stats write
+**              section.
+**
+** \param[in]  pSketch   Ptr to the RXQ flow sketch
+** \param[in]  rssHash   RSS hash of the packet
+** \param[in]  size      Frame length in bytes
+**
+** \return: void
+*/
+static void
+sfvmk_rxqFlowRecord(sfvmk_flowSketch_t *pSketch,
+                    vmk_uint32 rssHash,
+                    vmk_uint32 size)
+{
+  sfvmk_flowSketchCell_t *pCell;
+  vmk_uint64 estPkts = (vmk_uint64)-1;
+  vmk_uint64 estBytes = (vmk_uint64)-1;
+  vmk_uint32 row;
+  vmk_uint32 i;
+
+  /* Count-min: the estimate is the smallest cell the flow maps to */
+  for (row = 0; row < SFVMK_FLOW_SKETCH_DEPTH; row++) {
+    pCell = &pSketch->cells[row][(rssHash * sfvmkFlowSketchSeed[row]) >>
+                                 (32 - SFVMK_FLOW_SKETCH_WIDTH_SHIFT)];
+    pCell->pkts++;
+    pCell->bytes += size;
+    estPkts = MIN(estPkts, pCell->pkts);
+    estBytes = MIN(estBytes, pCell->bytes);
+  }
+
+  for (i = 0; i < pSketch->numTop; i++) {
+    if (pSketch->top[i].rssHash == rssHash)
+      break;
+  }
+
+  if (i < pSketch->numTop) {
+    /* Already a heavy hitter, only the minimum may have moved */
+    pSketch->top[i].pkts = estPkts;
+    pSketch->top[i].bytes = estBytes;
+    if (i != pSketch->minTop)
+      return;
+  } else if (pSketch->numTop < SFVMK_FLOW_TOP_K) {
+    i = pSketch->numTop++;
+    pSketch->top[i].rssHash = rssHash;
+    pSketch->top[i].pkts = estPkts;
+    pSketch->top[i].bytes = estBytes;
+  } else if (estBytes > pSketch->top[pSketch->minTop].bytes) {
+    i = pSketch->minTop;
+    pSketch->top[i].rssHash = rssHash;
+    pSketch->top[i].pkts = estPkts;
+    pSketch->top[i].bytes = estBytes;
+  } else {
+    return;
+  }
+
+  pSketch->minTop = 0;
+  for (i = 1; i < pSketch->numTop; i++) {
+    if (pSketch->top[i].bytes < pSketch->top[pSketch->minTop].bytes)
+      pSketch->minTop = i;
+  }
+}
+
+/*! \brief  Get the heaviest flows seen on a RSS RXQ and optionally
+**          clear its sketch.
+**
+** \param[in]  pAdapter     pointer to sfvmk_adapter_t
+** \param[in]  qIndex       RXQ index
+** \param[in]  reset        clear the sketch once read
+** \param[out] pEntries     array of SFVMK_FLOW_TOP_K entries
+** \param[out] pNumEntries  number of valid entries
+**
+** \return: VMK_OK on success
+**          VMK_BAD_PARAM      Invalid queue index
+**          VMK_NOT_SUPPORTED  No sketch on this queue
+*/
+VMK_ReturnStatus
+sfvmk_rxqFlowTopGet(sfvmk_adapter_t *pAdapter,
+                    vmk_uint32 qIndex,
+                    vmk_Bool reset,
+                    sfvmk_flowTopEntry_t *pEntries,
+                    vmk_uint32 *pNumEntries)
+{
+  sfvmk_rxq_t *pRxq;
+  sfvmk_flowSketch_t *pSketch;
+  sfvmk_evq_t *pEvq;
+  vmk_uint32 version;
+  VMK_ReturnStatus status = VMK_BAD_PARAM;
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pEntries);
+  VMK_ASSERT_NOT_NULL(pNumEntries);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  if ((pAdapter->ppRxq == NULL) || (qIndex >= pAdapter->numRxqsAllocated) ||
+      (pAdapter->ppRxq[qIndex] == NULL)) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid RXQ index %u", qIndex);
+    goto done;
+  }
+
+  pRxq = pAdapter->ppRxq[qIndex];
+  pSketch = pRxq->pFlowSketch;
+  if (pSketch == NULL) {
+    status = VMK_NOT_SUPPORTED;
+    goto done;
+  }
+
+  do {
+    version = vmk_VersionedAtomicBeginTryRead(&pRxq->statsLock);
+    *pNumEntries = MIN(pSketch->numTop, SFVMK_FLOW_TOP_K);
+    vmk_Memcpy(pEntries, pSketch->top,
+               *pNumEntries * sizeof(sfvmk_flowTopEntry_t));
+  } while (!vmk_VersionedAtomicEndTryRead(&pRxq->statsLock, version));
+
+  if (reset) {
+    /* The EVQ lock keeps sfvmk_rxqComplete out while the sketch is cleared */
+    pEvq = pAdapter->ppEvq[qIndex];
+    sfvmk_evqLock(pEvq);
+    vmk_VersionedAtomicBeginWrite(&pRxq->statsLock);
+    vmk_Memset(pSketch, 0, sizeof(sfvmk_flowSketch_t));
+    vmk_VersionedAtomicEndWrite(&pRxq->statsLock);
+    sfvmk_evqUnlock(pEvq);
+  }
+
+  status = VMK_OK;
+
+done:
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  return status;
+}
+
 /*! \brief      Read the pkt from the queue and pass it to uplink layer
 **              or discard it
 **
@@ -517,12 +1281,18 @@ void sfvmk_rxqComplete(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx)
   VMK_ReturnStatus status;
   vmk_VA pFrameVa;
   vmk_Bool isRxCsumEnabled = VMK_FALSE;
+  vmk_uint64 profStart;
 
   VMK_ASSERT_NOT_NULL(pRxq);
 
   pAdapter = pRxq->pAdapter;
   VMK_ASSERT_NOT_NULL(pAdapter);
 
+  profStart = sfvmk_profStart(pAdapter);
+
+  /* RXQ counters are written only here, under EVQ ownership */
+  vmk_VersionedAtomicBeginWrite(&pRxq->statsLock);
+
   completed = pRxq->completed;
   while (completed != pRxq->pending) {
     vmk_uint32 id;
@@ -563,18 +1333,29 @@ void sfvmk_rxqComplete(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx)
       vmk_PktRssType rssType = VMK_PKT_RSS_TYPE_NONE;
       vmk_uint32 rssHash;
 
+      vmk_uint32 hashFields = pAdapter->rssHashActive;
+
       /* Note: For tunneled packets RSS is performed on inner
        * headers so for those packets these fields should refer
-       * to the inner header protocol fields. */
+       * to the inner header protocol fields. The type reported
+       * is the one of the fields the NIC actually hashed. */
       if (pRxDesc->flags & EFX_PKT_IPV4) {
-        if (pRxDesc->flags & EFX_PKT_TCP)
+        if ((pRxDesc->flags & EFX_PKT_TCP) &&
+            (hashFields & SFVMK_RSS_HASH_TCPIPV4))
           rssType = VMK_PKT_RSS_TYPE_IPV4_TCP;
-        else
+        else if ((pRxDesc->flags & EFX_PKT_UDP) &&
+                 (hashFields & SFVMK_RSS_HASH_UDPIPV4))
+          rssType = VMK_PKT_RSS_TYPE_IPV4_UDP;
+        else if (hashFields & SFVMK_RSS_HASH_IPV4)
           rssType = VMK_PKT_RSS_TYPE_IPV4;
       } else if (pRxDesc->flags & EFX_PKT_IPV6) {
-        if (pRxDesc->flags & EFX_PKT_TCP)
+        if ((pRxDesc->flags & EFX_PKT_TCP) &&
+            (hashFields & SFVMK_RSS_HASH_TCPIPV6))
           rssType = VMK_PKT_RSS_TYPE_IPV6_TCP;
-        else
+        else if ((pRxDesc->flags & EFX_PKT_UDP) &&
+                 (hashFields & SFVMK_RSS_HASH_UDPIPV6))
+          rssType = VMK_PKT_RSS_TYPE_IPV6_UDP;
+        else if (hashFields & SFVMK_RSS_HASH_IPV6)
           rssType = VMK_PKT_RSS_TYPE_IPV6;
       }
 
@@ -588,6 +1369,15 @@ void sfvmk_rxqComplete(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx)
                               vmk_StatusToString(status));
           pRxq->stats[SFVMK_RXQ_RSS_HASH_FAILED]++;
         }
+
+        if (pRxq->pFlowSketch != NULL)
+          sfvmk_rxqFlowRecord(pRxq->pFlowSketch, rssHash,
+                              pRxDesc->size - pAdapter->rxPrefixSize);
+
+        /* The NIC indexes its indirection table with the low hash bits */
+        if (pAdapter->rssBalance.intervalMs != 0)
+          pRxq->rssBucketBytes[rssHash & (EFX_RSS_TBL_SIZE - 1)] +=
+            pRxDesc->size - pAdapter->rxPrefixSize;
       }
     }
 
@@ -664,6 +1454,8 @@ discard_pkt:
     if (pRxq->state == SFVMK_RXQ_STATE_STARTED)
       pRxq->stats[SFVMK_RXQ_DISCARD]++;
 
+    pRxDesc->evTime = 0;
+
     /* Return the packet to the pool */
     elem.ioAddr = pRxDesc->ioAddr;
     elem.length = pRxDesc->size;
@@ -678,6 +1470,13 @@ discard_pkt:
                            "pending = %u", completed, pRxq->pending);
   }
 
+  sfvmk_rxqLevelUpdate(pRxq);
+  sfvmk_profEnd(&pRxq->prof[SFVMK_MGMT_PROF_RXQ_COMPLETE], profStart,
+                completed - pRxq->completed);
+  vmk_VersionedAtomicEndWrite(&pRxq->statsLock);
+
+  SFVMK_DATAPATH_TRACE3(sfvmk_rxq_complete, pRxq->index,
+                        completed - pRxq->completed, pRxq->pending);
   pRxq->completed = completed;
   level = pRxq->added - pRxq->completed;
 
@@ -711,6 +1510,7 @@ void sfvmk_rxqFill(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx)
   vmk_uint32 mblkAllocSize;
   vmk_uint32 headroom;
   vmk_uint32 id;
+  vmk_uint64 profStart;
 
   VMK_ASSERT_NOT_NULL(pRxq);
 
@@ -721,6 +1521,8 @@ void sfvmk_rxqFill(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx)
   pAdapter = pRxq->pAdapter;
   VMK_ASSERT_NOT_NULL(pAdapter);
 
+  profStart = sfvmk_profStart(pAdapter);
+
   batch = 0;
   rxfill = pRxq->added - pRxq->completed;
 
@@ -818,6 +1620,11 @@ void sfvmk_rxqFill(sfvmk_rxq_t *pRxq, sfvmk_pktCompCtx_t *pCompCtx)
   /* Push entries in queue */
   efx_rx_qpush(pRxq->pCommonRxq, pRxq->added, &pRxq->pushed);
 
+  vmk_VersionedAtomicBeginWrite(&pRxq->statsLock);
+  sfvmk_rxqLevelUpdate(pRxq);
+  sfvmk_profEnd(&pRxq->prof[SFVMK_MGMT_PROF_RXQ_FILL], profStart, posted);
+  vmk_VersionedAtomicEndWrite(&pRxq->statsLock);
+
   /* The queue could still be empty if no descriptors were actually
    * pushed, in which case there will be no event to cause the next
    * refill, so we must schedule a refill ourselves.
@@ -842,7 +1649,7 @@ done:
 **
 ** \return: VMK_OK [success] or error code [failure]
 */
-static VMK_ReturnStatus
+VMK_ReturnStatus
 sfvmk_rxqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 {
   sfvmk_rxq_t *pRxq = NULL;
@@ -931,15 +1738,17 @@ sfvmk_rxqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 
   efx_rx_qenable(pRxq->pCommonRxq);
 
-  vmk_SpinlockLock(pEvq->lock);
+  sfvmk_evqLock(pEvq);
   pRxq->ptrMask = pAdapter->numRxqBuffDesc - 1;
   pRxq->refillThreshold = RX_REFILL_THRESHOLD(pRxq->numDesc);
   pRxq->flushState = SFVMK_FLUSH_STATE_REQUIRED;
   pRxq->state = SFVMK_RXQ_STATE_STARTED;
+  pRxq->ringLevel.lastCycles = vmk_GetTimerCycles();
+  pRxq->ringLevel.level = 0;
 
   /* Try to fill the queue from the pool. */
   sfvmk_rxqFill(pRxq, &compCtx);
-  vmk_SpinlockUnlock(pEvq->lock);
+  sfvmk_evqUnlock(pEvq);
 
   goto done;
 
@@ -960,17 +1769,66 @@ done:
   return status;
 }
 
-/*! \brief  Flush common code RXQs.
+/*! \brief  Flush a common code RXQ.
 **
 ** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
+** \param[in]  qIndex      RXQ index
 **
-** \return: void
+** \return: VMK_OK [success] error code [failure]
 */
-static void sfvmk_rxFlush(sfvmk_adapter_t *pAdapter)
+static VMK_ReturnStatus
+sfvmk_rxqFlush(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 {
   sfvmk_rxq_t *pRxq = NULL;
   sfvmk_evq_t *pEvq = NULL;
   VMK_ReturnStatus status = VMK_FAILURE;
+
+  pRxq = pAdapter->ppRxq[qIndex];
+  if (pRxq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL RXQ ptr for RXQ[%u]", qIndex);
+    return VMK_FAILURE;
+  }
+
+  pEvq = pAdapter->ppEvq[qIndex];
+  if (pEvq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL EVQ ptr for EVQ[%u]", qIndex);
+    return VMK_FAILURE;
+  }
+
+  sfvmk_evqLock(pEvq);
+
+  if (pRxq->state != SFVMK_RXQ_STATE_STARTED) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "RXQ is not yet started");
+    sfvmk_evqUnlock(pEvq);
+    return VMK_OK;
+  }
+
+  pRxq->state = SFVMK_RXQ_STATE_STOPPING;
+  pRxq->flushState = SFVMK_FLUSH_STATE_PENDING;
+  sfvmk_evqUnlock(pEvq);
+
+  /* Flush the receive queue */
+  status = efx_rx_qflush(pRxq->pCommonRxq);
+  if (status != VMK_OK) {
+    sfvmk_evqLock(pEvq);
+    if (status == VMK_EALREADY)
+      pRxq->flushState = SFVMK_FLUSH_STATE_DONE;
+    else
+      pRxq->flushState = SFVMK_FLUSH_STATE_FAILED;
+    sfvmk_evqUnlock(pEvq);
+  }
+
+  return VMK_OK;
+}
+
+/*! \brief  Flush common code RXQs.
+**
+** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void sfvmk_rxFlush(sfvmk_adapter_t *pAdapter)
+{
   vmk_uint32 qIndex;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_RX);
@@ -986,45 +1844,108 @@ static void sfvmk_rxFlush(sfvmk_adapter_t *pAdapter)
   }
 
   for (qIndex = 0; qIndex < pAdapter->numRxqsAllocated; qIndex++) {
-
-    pRxq = pAdapter->ppRxq[qIndex];
-    if (pRxq == NULL) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "NULL RXQ ptr for RXQ[%u]", qIndex);
+    if (sfvmk_rxqFlush(pAdapter, qIndex) != VMK_OK)
       goto done;
+  }
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX);
+}
+
+/*! \brief  Wait for flush of a common code RXQ and destroy it.
+**
+** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
+** \param[in]  qIndex      RXQ index
+** \param[in]  timeout     Absolute time (usec) to give up waiting for flush
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+static VMK_ReturnStatus
+sfvmk_rxqFlushWaitAndDestroy(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex,
+                             vmk_uint64 timeout)
+{
+  sfvmk_rxq_t *pRxq = NULL;
+  sfvmk_evq_t *pEvq = NULL;
+  vmk_uint64 currentTime;
+  VMK_ReturnStatus status = VMK_FAILURE;
+  sfvmk_pktCompCtx_t compCtx = {
+    .type = SFVMK_PKT_COMPLETION_OTHERS,
+  };
+
+  pRxq = pAdapter->ppRxq[qIndex];
+  if (pRxq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL RXQ ptr for RXQ[%u]", qIndex);
+    return VMK_FAILURE;
+  }
+
+  pEvq = pAdapter->ppEvq[qIndex];
+  if (pEvq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL EVQ ptr for EVQ[%u]", qIndex);
+    return VMK_FAILURE;
+  }
+
+  sfvmk_getTime(&currentTime);
+
+  sfvmk_evqLock(pEvq);
+
+  if (pRxq->state != SFVMK_RXQ_STATE_STOPPING) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "RXQ[%u] is not in stopping state", qIndex);
+    sfvmk_evqUnlock(pEvq);
+    return VMK_OK;
+  }
+
+  while (currentTime < timeout) {
+    /* Check to see if the flush event has been processed */
+    if (pRxq->flushState != SFVMK_FLUSH_STATE_PENDING) {
+      break;
     }
+    sfvmk_evqUnlock(pEvq);
 
-    pEvq = pAdapter->ppEvq[qIndex];
-    if (pEvq == NULL) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "NULL EVQ ptr for EVQ[%u]", qIndex);
-      goto done;
+    status = vmk_WorldSleep(SFVMK_RXQ_STOP_POLL_TIME_USEC);
+    if ((status != VMK_OK) && (status != VMK_WAIT_INTERRUPTED)) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_WorldSleep failed status: %s",
+                          vmk_StatusToString(status));
+      sfvmk_evqLock(pEvq);
+      break;
     }
 
-    vmk_SpinlockLock(pEvq->lock);
+    sfvmk_getTime(&currentTime);
+    sfvmk_evqLock(pEvq);
+  }
 
-    if (pRxq->state != SFVMK_RXQ_STATE_STARTED) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "RXQ is not yet started");
-      vmk_SpinlockUnlock(pEvq->lock);
-      continue;
-    }
+  /* If flush state is pending it means Flush timeout neither done nor failed */
+  if ((pRxq->flushState == SFVMK_FLUSH_STATE_PENDING) ||
+      (pRxq->flushState == SFVMK_FLUSH_STATE_FAILED)) {
+    pRxq->flushState = SFVMK_FLUSH_STATE_DONE;
+    SFVMK_ADAPTER_ERROR(pAdapter, "RXQ[%u] flush timeout", qIndex);
+  }
 
-    pRxq->state = SFVMK_RXQ_STATE_STOPPING;
-    pRxq->flushState = SFVMK_FLUSH_STATE_PENDING;
-    vmk_SpinlockUnlock(pEvq->lock);
+  pRxq->pending = pRxq->added;
+  sfvmk_rxqComplete(pRxq, &compCtx);
 
-    /* Flush the receive queue */
-    status = efx_rx_qflush(pRxq->pCommonRxq);
-    if (status != VMK_OK) {
-      vmk_SpinlockLock(pEvq->lock);
-      if (status == VMK_EALREADY)
-        pRxq->flushState = SFVMK_FLUSH_STATE_DONE;
-      else
-        pRxq->flushState = SFVMK_FLUSH_STATE_FAILED;
-      vmk_SpinlockUnlock(pEvq->lock);
-    }
+  pRxq->added = 0;
+  pRxq->pushed = 0;
+  pRxq->pending = 0;
+  pRxq->completed = 0;
+  pRxq->state = SFVMK_RXQ_STATE_INITIALIZED;
+  sfvmk_evqUnlock(pEvq);
+
+  /* Release DMA memory. */
+  if (pRxq->mem.pEsmBase) {
+    sfvmk_freeDMAMappedMem(pRxq->mem.esmHandle,
+                           pRxq->mem.pEsmBase,
+                           pRxq->mem.ioElem.ioAddr,
+                           pRxq->mem.ioElem.length);
   }
 
-done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX);
+  if (pRxq->pQueue)
+    vmk_HeapFree(sfvmk_modInfo.heapID, pRxq->pQueue);
+
+  /* Destroy the common code receive queue. */
+  if (pRxq->pCommonRxq)
+    efx_rx_qdestroy(pRxq->pCommonRxq);
+
+  return VMK_OK;
 }
 
 /*! \brief  Wait for flush and destroy common code RXQ.
@@ -1036,15 +1957,8 @@ done:
 static void
 sfvmk_rxFlushWaitAndDestroy(sfvmk_adapter_t *pAdapter)
 {
-  sfvmk_rxq_t *pRxq = NULL;
-  sfvmk_evq_t *pEvq = NULL;
   vmk_uint64 timeout, currentTime;
   vmk_uint32 qIndex;
-  VMK_ReturnStatus status = VMK_FAILURE;
-  sfvmk_pktCompCtx_t compCtx = {
-    .type = SFVMK_PKT_COMPLETION_OTHERS,
-  };
-
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_RX);
 
@@ -1062,81 +1976,53 @@ sfvmk_rxFlushWaitAndDestroy(sfvmk_adapter_t *pAdapter)
   timeout = currentTime + SFVMK_RXQ_STOP_TIME_OUT_USEC;
 
   for (qIndex = 0; qIndex < pAdapter->numRxqsAllocated; qIndex++) {
-
-    pRxq = pAdapter->ppRxq[qIndex];
-    if (pRxq == NULL) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "NULL RXQ ptr for RXQ[%u]", qIndex);
+    if (sfvmk_rxqFlushWaitAndDestroy(pAdapter, qIndex, timeout) != VMK_OK)
       goto done;
-    }
-
-    pEvq = pAdapter->ppEvq[qIndex];
-    if (pEvq == NULL) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "NULL EVQ ptr for EVQ[%u]", qIndex);
-      goto done;
-    }
-
-    vmk_SpinlockLock(pEvq->lock);
-
-    if (pRxq->state != SFVMK_RXQ_STATE_STOPPING) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "RXQ[%u] is not in stopping state", qIndex);
-      vmk_SpinlockUnlock(pEvq->lock);
-      continue;
-    }
+  }
 
-    while (currentTime < timeout) {
-      /* Check to see if the flush event has been processed */
-      if (pRxq->flushState != SFVMK_FLUSH_STATE_PENDING) {
-        break;
-      }
-      vmk_SpinlockUnlock(pEvq->lock);
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX);
+}
 
-      status = vmk_WorldSleep(SFVMK_RXQ_STOP_POLL_TIME_USEC);
-      if ((status != VMK_OK) && (status != VMK_WAIT_INTERRUPTED)) {
-        SFVMK_ADAPTER_ERROR(pAdapter, "vmk_WorldSleep failed status: %s",
-                            vmk_StatusToString(status));
-        vmk_SpinlockLock(pEvq->lock);
-        break;
-      }
+/*! \brief  Flush and destroy a single common code RXQ, leaving the
+**          rest of the receive path running.
+**
+** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
+** \param[in]  qIndex      RXQ index
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+VMK_ReturnStatus
+sfvmk_rxqStop(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
+{
+  vmk_uint64 currentTime;
+  VMK_ReturnStatus status = VMK_BAD_PARAM;
 
-      sfvmk_getTime(&currentTime);
-      vmk_SpinlockLock(pEvq->lock);
-    }
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_RX, "qIndex[%u]", qIndex);
 
-    /* If flush state is pending it means Flush timeout neither done nor failed */
-    if ((pRxq->flushState == SFVMK_FLUSH_STATE_PENDING) ||
-        (pRxq->flushState == SFVMK_FLUSH_STATE_FAILED)) {
-      pRxq->flushState = SFVMK_FLUSH_STATE_DONE;
-      SFVMK_ADAPTER_ERROR(pAdapter, "RXQ[%u] flush timeout", qIndex);
-    }
+  if ((pAdapter->ppEvq == NULL) || (pAdapter->ppRxq == NULL)) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "No EVQ/RXQ has been initialized");
+    status = VMK_FAILURE;
+    goto done;
+  }
 
-    pRxq->pending = pRxq->added;
-    sfvmk_rxqComplete(pRxq, &compCtx);
-
-    pRxq->added = 0;
-    pRxq->pushed = 0;
-    pRxq->pending = 0;
-    pRxq->completed = 0;
-    pRxq->state = SFVMK_RXQ_STATE_INITIALIZED;
-    vmk_SpinlockUnlock(pEvq->lock);
-
-    /* Release DMA memory. */
-    if (pRxq->mem.pEsmBase) {
-      sfvmk_freeDMAMappedMem(pRxq->mem.esmHandle,
-                             pRxq->mem.pEsmBase,
-                             pRxq->mem.ioElem.ioAddr,
-                             pRxq->mem.ioElem.length);
-    }
+  if (qIndex >= pAdapter->numRxqsAllocated) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid RXQ index %u", qIndex);
+    goto done;
+  }
 
-    if (pRxq->pQueue)
-      vmk_HeapFree(sfvmk_modInfo.heapID, pRxq->pQueue);
+  status = sfvmk_rxqFlush(pAdapter, qIndex);
+  if (status != VMK_OK)
+    goto done;
 
-    /* Destroy the common code receive queue. */
-    if (pRxq->pCommonRxq)
-      efx_rx_qdestroy(pRxq->pCommonRxq);
-  }
+  sfvmk_getTime(&currentTime);
+  status = sfvmk_rxqFlushWaitAndDestroy(pAdapter, qIndex,
+                                        currentTime + SFVMK_RXQ_STOP_TIME_OUT_USEC);
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX);
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_RX, "qIndex[%u]", qIndex);
+
+  return status;
 }
 
 /*! \brief  Create all Common code RXQs.
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2020 Xilinx, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sfvmk_driver.h"
+
+/*! \brief Strip the directory part of a source file name.
+**
+** \param[in]  pFile  __FILE__ of a probe site
+**
+** \return: file name without directories
+*/
+static const char *
+sfvmk_traceBaseName(const char *pFile)
+{
+  const char *pBase = pFile;
+
+  for (; *pFile != '\0'; pFile++) {
+    if (*pFile == '/')
+      pBase = pFile + 1;
+  }
+
+  return pBase;
+}
+
+/*! \brief Compute the identifier of a probe site from its file,
+**         line and name (FNV-1a), so that sites sharing a generic
+**         name such as fail1 get distinct identifiers.
+**
+** \param[in]  pSite  probe site
+**
+** \return: non zero probe identifier
+*/
+static vmk_uint32
+sfvmk_traceHash(const sfvmk_traceSite_t *pSite)
+{
+  const char *pStr[] = { sfvmk_traceBaseName(pSite->pFile), pSite->pName };
+  vmk_uint32 hash = 2166136261U;
+  vmk_uint32 line = pSite->line;
+  const char *pChar;
+  vmk_uint32 i;
+
+  for (i = 0; i < sizeof(pStr) / sizeof(pStr[0]); i++) {
+    for (pChar = pStr[i]; *pChar != '\0'; pChar++) {
+      hash ^= (vmk_uint8)*pChar;
+      hash *= 16777619U;
+    }
+  }
+
+  for (i = 0; i < sizeof(line); i++) {
+    hash ^= (line >> (i * 8)) & 0xff;
+    hash *= 16777619U;
+  }
+
+  return (hash != 0) ? hash : 1;
+}
+
+/*! \brief Check whether a probe site is named by an enable spec, either
+**         by probe name or as "file.c:line".
+**
+** \param[in]  pSite  probe site
+** \param[in]  pSpec  enable spec
+**
+** \return: VMK_TRUE [match] VMK_FALSE [no match]
+*/
+static vmk_Bool
+sfvmk_traceSpecMatch(const sfvmk_traceSite_t *pSite, const char *pSpec)
+{
+  char siteStr[SFVMK_TRACE_PROBE_NAME_LEN];
+  vmk_ByteCount len;
+
+  if (vmk_Strncmp(pSite->pName, pSpec, SFVMK_TRACE_PROBE_NAME_LEN) == 0)
+    return VMK_TRUE;
+
+  if (vmk_StringFormat(siteStr, sizeof(siteStr), &len, "%s:%u",
+                       sfvmk_traceBaseName(pSite->pFile),
+                       pSite->line) != VMK_OK)
+    return VMK_FALSE;
+
+  return (vmk_Strncmp(siteStr, pSpec, SFVMK_TRACE_PROBE_NAME_LEN) == 0);
+}
+
+/*! \brief Tell whether hits of a probe site are recorded. The site
+**         state is refreshed from the enable specs whenever they have
+**         changed since the site last looked; a refresh racing an
+**         enable/disable is redone on the next hit as the generation
+**         is bumped only once the specs are complete.
+**
+** \param[in]  pTrace  trace ring
+** \param[in]  pSite   probe site
+**
+** \return: VMK_TRUE [record] VMK_FALSE [skip]
+*/
+static vmk_Bool
+sfvmk_traceIsEnabled(sfvmk_trace_t *pTrace, sfvmk_traceSite_t *pSite)
+{
+  vmk_uint32 enableGen;
+  vmk_Bool enabled = VMK_FALSE;
+  vmk_uint32 i;
+
+  if (pTrace->allEnabled)
+    return VMK_TRUE;
+
+  enableGen = pTrace->enableGen;
+  if (VMK_LIKELY(pSite->enableGen == enableGen))
+    return pSite->enabled;
+
+  vmk_CPUMemFenceRead();
+  for (i = 0; (i < pTrace->numSpecs) && (i < SFVMK_TRACE_MAX_SPECS); i++) {
+    if (sfvmk_traceSpecMatch(pSite, pTrace->specs[i])) {
+      enabled = VMK_TRUE;
+      break;
+    }
+  }
+
+  pSite->enabled = enabled;
+  pSite->enableGen = enableGen;
+
+  return enabled;
+}
+
+/*! \brief Allocate the module wide probe trace ring.
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+VMK_ReturnStatus
+sfvmk_traceInit(void)
+{
+  sfvmk_trace_t *pTrace;
+
+  pTrace = vmk_HeapAlloc(sfvmk_modInfo.heapID, sizeof(sfvmk_trace_t));
+  if (pTrace == NULL) {
+    SFVMK_ERROR("Trace ring allocation failed");
+    return VMK_NO_MEMORY;
+  }
+
+  vmk_Memset(pTrace, 0, sizeof(sfvmk_trace_t));
+  vmk_AtomicWrite64(&pTrace->head, 0);
+  vmk_AtomicWrite64(&pTrace->numProbes, 0);
+  pTrace->enableGen = 1;
+
+  sfvmk_modInfo.traceNumEnabled = 0;
+  sfvmk_modInfo.pTrace = pTrace;
+
+  return VMK_OK;
+}
+
+/*! \brief Stop tracing and free the probe trace ring.
+**
+** \return: None
+*/
+void
+sfvmk_traceFini(void)
+{
+  sfvmk_trace_t *pTrace = sfvmk_modInfo.pTrace;
+
+  if (pTrace == NULL)
+    return;
+
+  sfvmk_modInfo.traceNumEnabled = 0;
+  sfvmk_modInfo.pTrace = NULL;
+  vmk_CPUMemFenceReadWrite();
+
+  vmk_HeapFree(sfvmk_modInfo.heapID, pTrace);
+}
+
+/*! \brief Assign the identifier of a probe site and remember its
+**         name and location so that drained records can be decoded.
+**         Called from SFVMK_TRACE_PROBE on the first hit of a site.
+**
+** \param[in]  pSite  probe site
+**
+** \return: None
+*/
+void
+sfvmk_traceProbeRegister(sfvmk_traceSite_t *pSite)
+{
+  sfvmk_trace_t *pTrace = sfvmk_modInfo.pTrace;
+  sfvmk_traceProbeName_t *pProbe;
+  vmk_uint32 probeId;
+  vmk_uint64 i;
+
+  /* Only the first CPU to hit the site registers it */
+  if (vmk_AtomicReadIfEqualWrite64(&pSite->registered, 0, 1) != 0)
+    return;
+
+  probeId = sfvmk_traceHash(pSite);
+
+  if (pTrace != NULL) {
+    i = vmk_AtomicReadInc64(&pTrace->numProbes);
+    if (i < SFVMK_TRACE_MAX_PROBES) {
+      pProbe = &pTrace->probes[i];
+      vmk_Strncpy(pProbe->name, pSite->pName, SFVMK_TRACE_PROBE_NAME_LEN - 1);
+      vmk_Strncpy(pProbe->file, sfvmk_traceBaseName(pSite->pFile),
+                  SFVMK_TRACE_PROBE_FILE_LEN - 1);
+      pProbe->line = pSite->line;
+      vmk_CPUMemFenceWrite();
+      pProbe->probeId = probeId;
+    }
+  }
+
+  pSite->probeId = probeId;
+}
+
+/*! \brief Record a probe hit in the trace ring if the probe is enabled.
+**         Slots are claimed with an atomic increment so probes on
+**         different CPUs never wait for each other; the record sequence
+**         number is written last so that the drain can skip records
+**         that are incomplete or have been overwritten.
+**
+** \param[in]  pSite    probe site
+** \param[in]  numArgs  number of valid arguments
+** \param[in]  arg1..7  probe arguments
+**
+** \return: None
+*/
+void
+sfvmk_traceRecord(sfvmk_traceSite_t *pSite, vmk_uint32 numArgs,
+                  vmk_uint64 arg1, vmk_uint64 arg2, vmk_uint64 arg3,
+                  vmk_uint64 arg4, vmk_uint64 arg5, vmk_uint64 arg6,
+                  vmk_uint64 arg7)
+{
+  sfvmk_trace_t *pTrace = sfvmk_modInfo.pTrace;
+  sfvmk_traceRecord_t *pRecord;
+  vmk_uint64 slot;
+
+  if ((pTrace == NULL) || !sfvmk_traceIsEnabled(pTrace, pSite))
+    return;
+
+  slot = vmk_AtomicReadInc64(&pTrace->head);
+  pRecord = &pTrace->ring[slot & (SFVMK_TRACE_RING_ENTRIES - 1)];
+
+  pRecord->seq = 0;
+  vmk_CPUMemFenceWrite();
+
+  sfvmk_getTime(&pRecord->timestamp);
+  pRecord->probeId = pSite->probeId;
+  pRecord->cpu = (vmk_uint16)vmk_GetPCPUNum();
+  pRecord->numArgs = (vmk_uint8)numArgs;
+  pRecord->args[0] = arg1;
+  pRecord->args[1] = arg2;
+  pRecord->args[2] = arg3;
+  pRecord->args[3] = arg4;
+  pRecord->args[4] = arg5;
+  pRecord->args[5] = arg6;
+  pRecord->args[6] = arg7;
+
+  vmk_CPUMemFenceWrite();
+  pRecord->seq = slot + 1;
+}
+
+/*! \brief Enable or disable recording of a probe. Must be called
+**         with sfvmk_modInfo.lock held.
+**
+** \param[in]  pName   probe name for every site using it, "file.c:line"
+**                     for a single site, "all" for every probe
+** \param[in]  enable  VMK_TRUE to start recording, VMK_FALSE to stop
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+VMK_ReturnStatus
+sfvmk_traceEnable(const char *pName, vmk_Bool enable)
+{
+  sfvmk_trace_t *pTrace = sfvmk_modInfo.pTrace;
+  vmk_uint32 i;
+
+  if (pTrace == NULL)
+    return VMK_NOT_READY;
+
+  if ((pName == NULL) || (pName[0] == '\0'))
+    return VMK_BAD_PARAM;
+
+  if (vmk_Strcmp(pName, "all") == 0) {
+    pTrace->allEnabled = enable;
+    if (enable == VMK_FALSE)
+      pTrace->numSpecs = 0;
+  } else {
+    for (i = 0; i < pTrace->numSpecs; i++) {
+      if (vmk_Strncmp(pTrace->specs[i], pName, SFVMK_TRACE_PROBE_NAME_LEN) == 0)
+        break;
+    }
+
+    if (enable && (i == pTrace->numSpecs)) {
+      if (pTrace->numSpecs == SFVMK_TRACE_MAX_SPECS)
+        return VMK_NO_SPACE;
+
+      vmk_Strncpy(pTrace->specs[i], pName, SFVMK_TRACE_PROBE_NAME_LEN - 1);
+      vmk_CPUMemFenceWrite();
+      pTrace->numSpecs++;
+    } else if (!enable && (i < pTrace->numSpecs)) {
+      /* Sites refreshing meanwhile redo it once enableGen moves */
+      pTrace->numSpecs--;
+      vmk_CPUMemFenceWrite();
+      if (i != pTrace->numSpecs)
+        vmk_Memcpy(pTrace->specs[i], pTrace->specs[pTrace->numSpecs],
+                   SFVMK_TRACE_PROBE_NAME_LEN);
+    }
+  }
+
+  vmk_CPUMemFenceWrite();
+  pTrace->enableGen++;
+  sfvmk_modInfo.traceNumEnabled = pTrace->numSpecs +
+                                  (pTrace->allEnabled ? 1 : 0);
+
+  return VMK_OK;
+}
+
+/*! \brief Move trace records from the ring to a user buffer. Records
+**         overwritten before they could be drained are counted as lost.
+**         Must be called with sfvmk_modInfo.lock held.
+**
+** \param[in]  userBuffer    user buffer address
+** \param[in]  size          user buffer size in bytes
+** \param[out] pBytesCopied  number of bytes copied
+** \param[out] pNumLost      number of records lost since the last drain
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+VMK_ReturnStatus
+sfvmk_traceDrain(vmk_uint64 userBuffer, vmk_uint32 size,
+                 vmk_uint32 *pBytesCopied, vmk_uint64 *pNumLost)
+{
+  sfvmk_trace_t *pTrace = sfvmk_modInfo.pTrace;
+  sfvmk_traceRecord_t *pChunk = NULL;
+  sfvmk_traceRecord_t *pRecord;
+  vmk_uint32 maxRecords;
+  vmk_uint32 numCopied = 0;
+  vmk_uint32 numChunk = 0;
+  vmk_uint64 numLost = 0;
+  vmk_uint64 head;
+  vmk_uint64 seq;
+  VMK_ReturnStatus status = VMK_OK;
+
+  *pBytesCopied = 0;
+  *pNumLost = 0;
+
+  if (pTrace == NULL)
+    return VMK_NOT_READY;
+
+  maxRecords = size / sizeof(sfvmk_traceRecord_t);
+  if (maxRecords == 0)
+    return VMK_BAD_PARAM;
+
+  pChunk = vmk_HeapAlloc(sfvmk_modInfo.heapID,
+                         SFVMK_TRACE_DRAIN_CHUNK * sizeof(sfvmk_traceRecord_t));
+  if (pChunk == NULL) {
+    SFVMK_ERROR("Trace drain buffer allocation failed");
+    return VMK_NO_MEMORY;
+  }
+
+  head = vmk_AtomicRead64(&pTrace->head);
+  if (head - pTrace->tail > SFVMK_TRACE_RING_ENTRIES) {
+    numLost += head - pTrace->tail - SFVMK_TRACE_RING_ENTRIES;
+    pTrace->tail = head - SFVMK_TRACE_RING_ENTRIES;
+  }
+
+  while ((pTrace->tail != head) && (numCopied < maxRecords)) {
+    pRecord = &pTrace->ring[pTrace->tail & (SFVMK_TRACE_RING_ENTRIES - 1)];
+
+    seq = pRecord->seq;
+    vmk_CPUMemFenceRead();
+    if (seq == pTrace->tail + 1) {
+      pChunk[numChunk] = *pRecord;
+      vmk_CPUMemFenceRead();
+      seq = pRecord->seq;
+    }
+
+    if (seq == pTrace->tail + 1) {
+      numChunk++;
+      numCopied++;
+    } else if ((seq == 0) || (seq < pTrace->tail + 1)) {
+      /* Writer has not finished with this slot, pick it up next time */
+      break;
+    } else {
+      numLost++;
+    }
+    pTrace->tail++;
+
+    if ((numChunk == SFVMK_TRACE_DRAIN_CHUNK) || (numCopied == maxRecords)) {
+      status = vmk_CopyToUser((vmk_VA)userBuffer + *pBytesCopied,
+                              (vmk_VA)pChunk,
+                              numChunk * sizeof(sfvmk_traceRecord_t));
+      if (status != VMK_OK) {
+        SFVMK_ERROR("Trace records copy to user failed: %s",
+                    vmk_StatusToString(status));
+        goto done;
+      }
+      *pBytesCopied += numChunk * sizeof(sfvmk_traceRecord_t);
+      numChunk = 0;
+    }
+  }
+
+  if (numChunk != 0) {
+    status = vmk_CopyToUser((vmk_VA)userBuffer + *pBytesCopied,
+                            (vmk_VA)pChunk,
+                            numChunk * sizeof(sfvmk_traceRecord_t));
+    if (status != VMK_OK) {
+      SFVMK_ERROR("Trace records copy to user failed: %s",
+                  vmk_StatusToString(status));
+      goto done;
+    }
+    *pBytesCopied += numChunk * sizeof(sfvmk_traceRecord_t);
+  }
+
+done:
+  *pNumLost = numLost;
+  vmk_HeapFree(sfvmk_modInfo.heapID, pChunk);
+
+  return status;
+}
+
+/*! \brief Copy the names of the probes hit while tracing to a user buffer.
+**
+** \param[in]  userBuffer    user buffer address
+** \param[in]  size          user buffer size in bytes
+** \param[out] pBytesCopied  number of bytes copied
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+VMK_ReturnStatus
+sfvmk_traceProbeNames(vmk_uint64 userBuffer, vmk_uint32 size,
+                      vmk_uint32 *pBytesCopied)
+{
+  sfvmk_trace_t *pTrace = sfvmk_modInfo.pTrace;
+  vmk_uint64 numProbes;
+  vmk_uint32 numCopy;
+  VMK_ReturnStatus status;
+
+  *pBytesCopied = 0;
+
+  if (pTrace == NULL)
+    return VMK_NOT_READY;
+
+  numProbes = MIN(vmk_AtomicRead64(&pTrace->numProbes), SFVMK_TRACE_MAX_PROBES);
+  numCopy = MIN(numProbes, size / sizeof(sfvmk_traceProbeName_t));
+  if (numCopy == 0)
+    return VMK_OK;
+
+  vmk_CPUMemFenceRead();
+  status = vmk_CopyToUser((vmk_VA)userBuffer, (vmk_VA)pTrace->probes,
+                          numCopy * sizeof(sfvmk_traceProbeName_t));
+  if (status != VMK_OK) {
+    SFVMK_ERROR("Trace probe names copy to user failed: %s",
+                vmk_StatusToString(status));
+    return status;
+  }
+
+  *pBytesCopied = numCopy * sizeof(sfvmk_traceProbeName_t);
+
+  return VMK_OK;
+}
@@ -34,6 +34,8 @@
 /* Number of desc needed for each SG */
 #define SFVMK_TXD_NEEDED(sgSize, maxBufSize)  EFX_DIV_ROUND_UP(sgSize, maxBufSize)
 #define SFVMK_TX_TSO_DMA_DESC_MAX             EFX_TX_FATSOV2_DMA_SEGS_PER_PKT_MAX
+/* Latency samples of a completion pass published in one write section */
+#define SFVMK_TXQ_LAT_BATCH                   8
 
 static const
 sfvmk_hdrParseCtrl_t sfvmk_tsoHdrList[] = {
@@ -87,6 +89,79 @@ sfvmk_hdrParseCtrl_t *(sfvmk_tunnelTsoHdrList)[4] = {
   sfvmk_allEncapTsoHdrList
 };
 
+/*! \brief  Bind a TXQ to the EVQ which receives its completion events.
+**          TXQ i uses EVQ i unless dedicated TX EVQs are present, in
+**          which case txqsPerEvq consecutive TXQs share a TX EVQ. TXQs
+**          left over when there are too few TX EVQs use EVQ i.
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t
+** \param[in]  pTxq     pointer to TXQ
+**
+** \return: VMK_OK [success] error code [failure]
+**
+*/
+static VMK_ReturnStatus
+sfvmk_txqBindEvq(sfvmk_adapter_t *pAdapter, sfvmk_txq_t *pTxq)
+{
+  sfvmk_evq_t *pEvq = NULL;
+  vmk_uint32 evqIndex;
+  vmk_uint32 txEvq;
+
+  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
+  VMK_ASSERT(pAdapter->txqsPerEvq != 0);
+
+  txEvq = pTxq->index / pAdapter->txqsPerEvq;
+  if (txEvq < pAdapter->numTxEvqs)
+    evqIndex = sfvmk_getTxEvqStartIndex(pAdapter) + txEvq;
+  else
+    evqIndex = pTxq->index;
+
+  if (evqIndex >= pAdapter->numEvqsAllocated) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid EVQ index %u for TXQ[%u]",
+                        evqIndex, pTxq->index);
+    return VMK_BAD_PARAM;
+  }
+
+  pEvq = pAdapter->ppEvq[evqIndex];
+  VMK_ASSERT_NOT_NULL(pEvq);
+
+  if (pEvq->numTxqs >= SFVMK_MAX_TXQ_LABEL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "No TXQ label left on EVQ[%u]", evqIndex);
+    return VMK_NO_SPACE;
+  }
+
+  pTxq->evqIndex = evqIndex;
+  pTxq->label = pEvq->numTxqs;
+  pEvq->pTxqs[pEvq->numTxqs++] = pTxq;
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_DBG,
+                      "TXQ[%u] bound to EVQ[%u] label %u",
+                      pTxq->index, pTxq->evqIndex, pTxq->label);
+
+  return VMK_OK;
+}
+
+/*! \brief  Release the TXQ label held on its completion EVQ.
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t
+** \param[in]  pTxq     pointer to TXQ
+**
+** \return: void
+**
+*/
+static void
+sfvmk_txqUnbindEvq(sfvmk_adapter_t *pAdapter, sfvmk_txq_t *pTxq)
+{
+  sfvmk_evq_t *pEvq = pAdapter->ppEvq[pTxq->evqIndex];
+
+  VMK_ASSERT_NOT_NULL(pEvq);
+
+  /* TXQs are released in reverse order, so the label is always the last */
+  VMK_ASSERT_EQ(pTxq->label + 1, pEvq->numTxqs);
+  pEvq->pTxqs[pTxq->label] = NULL;
+  pEvq->numTxqs--;
+}
+
 /*! \brief  Allocate resources required for a particular TX queue.
 **
 ** \param[in]  pAdapter pointer to sfvmk_adapter_t
@@ -110,7 +185,10 @@ sfvmk_txqInit(sfvmk_adapter_t *pAdapter, vmk_uint32 txqIndex)
     goto done;
   }
 
-  pTxq = vmk_HeapAlloc(sfvmk_modInfo.heapID, sizeof(sfvmk_txq_t));
+  /* Cache line aligned so that the counter block and the completion
+   * fields do not share lines with other data */
+  pTxq = vmk_HeapAlign(sfvmk_modInfo.heapID, sizeof(sfvmk_txq_t),
+                       VMK_L1_CACHELINE_SIZE);
   if (pTxq == NULL) {
     SFVMK_ADAPTER_ERROR(pAdapter, "vmk_HeapAlloc failed");
     status = VMK_NO_MEMORY;
@@ -137,11 +215,23 @@ sfvmk_txqInit(sfvmk_adapter_t *pAdapter, vmk_uint32 txqIndex)
 
   pTxq->index = txqIndex;
   pTxq->hwVlanTci = 0;
+  vmk_VersionedAtomicInit(&pTxq->statsLock);
+
+  status = sfvmk_txqBindEvq(pAdapter, pTxq);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_txqBindEvq failed status: %s",
+                        vmk_StatusToString(status));
+    goto failed_bind_evq;
+  }
+
   pTxq->state = SFVMK_TXQ_STATE_INITIALIZED;
   pAdapter->ppTxq[txqIndex] = pTxq;
 
   goto done;
 
+failed_bind_evq:
+  sfvmk_destroyLock(pTxq->lock);
+
 failed_create_lock:
 failed_valid_buff_desc:
   vmk_HeapFree(sfvmk_modInfo.heapID, pTxq);
@@ -178,6 +268,8 @@ sfvmk_txqFini(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 
   VMK_ASSERT_EQ(pTxq->state, SFVMK_TXQ_STATE_INITIALIZED);
 
+  sfvmk_txqUnbindEvq(pAdapter, pTxq);
+
   sfvmk_destroyLock(pTxq->lock);
 
   vmk_HeapFree(sfvmk_modInfo.heapID, pTxq);
@@ -224,7 +316,7 @@ sfvmk_txInit(sfvmk_adapter_t *pAdapter)
                       pCfg->enc_fw_assisted_tso_v2_enabled,
                       pAdapter->isTsoFwAssisted);
 
-  pAdapter->numTxqsAllocated = MIN(pAdapter->numEvqsAllocated,
+  pAdapter->numTxqsAllocated = MIN(sfvmk_getTxEvqStartIndex(pAdapter),
                                    pAdapter->numTxqsAllotted);
 
   txqArraySize = sizeof(sfvmk_txq_t *) * pAdapter->numTxqsAllocated;
@@ -300,111 +392,177 @@ sfvmk_txFini(sfvmk_adapter_t *pAdapter)
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
 }
 
-/*! \brief  Wait for flush and destroy common code TXQ.
+/*! \brief  Wait for flush of a common code TXQ and destroy it.
 **
 ** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
+** \param[in]  qIndex      TXQ index
+** \param[in]  timeout     Absolute time (usec) to give up waiting for flush
 **
-** \return: void
+** \return: VMK_OK [success] error code [failure]
 */
-static void
-sfvmk_txFlushWaitAndDestroy(sfvmk_adapter_t *pAdapter)
+static VMK_ReturnStatus
+sfvmk_txqFlushWaitAndDestroy(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex,
+                             vmk_uint64 timeout)
 {
   sfvmk_txq_t *pTxq = NULL;
   sfvmk_evq_t *pEvq = NULL;
-  vmk_uint64 timeout, currentTime;
-  vmk_uint32 qIndex;
+  vmk_uint64 currentTime;
   VMK_ReturnStatus status = VMK_FAILURE;
   sfvmk_pktCompCtx_t compCtx = {
     .type = SFVMK_PKT_COMPLETION_OTHERS,
   };
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  pTxq = pAdapter->ppTxq[qIndex];
+  if (pTxq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL TXQ ptr for TXQ[%u]", qIndex);
+    return VMK_FAILURE;
+  }
 
-  VMK_ASSERT_NOT_NULL(pAdapter);
-  VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
-  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
-  
   sfvmk_getTime(&currentTime);
-  timeout = currentTime + SFVMK_TXQ_STOP_TIME_OUT_USEC;
 
-  for (qIndex = 0; qIndex < pAdapter->numTxqsAllocated; qIndex++) {
+  sfvmk_txqLock(pTxq);
 
-    pTxq = pAdapter->ppTxq[qIndex];
-    if (pTxq == NULL) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "NULL TXQ ptr for TXQ[%u]", qIndex);
-      goto done;
+  if (pTxq->state != SFVMK_TXQ_STATE_STOPPING) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "TXQ[%u] is not in stopping state", qIndex);
+    sfvmk_txqUnlock(pTxq);
+    return VMK_OK;
+  }
+
+  while (currentTime < timeout) {
+    /* Check to see if the flush event has been processed */
+    if (pTxq->flushState != SFVMK_FLUSH_STATE_PENDING) {
+      break;
+    }
+    sfvmk_txqUnlock(pTxq);
+
+    status = vmk_WorldSleep(SFVMK_TXQ_STOP_POLL_TIME_USEC);
+    if ((status != VMK_OK) && (status != VMK_WAIT_INTERRUPTED)) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_WorldSleep failed status: %s",
+                          vmk_StatusToString(status));
+      sfvmk_txqLock(pTxq);
+      break;
     }
 
-    vmk_SpinlockLock(pTxq->lock);
+    sfvmk_getTime(&currentTime);
+    sfvmk_txqLock(pTxq);
+  }
+  if (pTxq->flushState != SFVMK_FLUSH_STATE_DONE) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "TXQ[%u] flush timeout", qIndex);
+    pTxq->flushState = SFVMK_FLUSH_STATE_DONE;
+  }
 
-    if (pTxq->state != SFVMK_TXQ_STATE_STOPPING) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "TXQ[%u] is not in stopping state", qIndex);
-      vmk_SpinlockUnlock(pTxq->lock);
-      continue;
-    }
+  pTxq->pending = pTxq->added;
 
-    while (currentTime < timeout) {
-      /* Check to see if the flush event has been processed */
-      if (pTxq->flushState != SFVMK_FLUSH_STATE_PENDING) {
-        break;
-      }
-      vmk_SpinlockUnlock(pTxq->lock);
-
-      status = vmk_WorldSleep(SFVMK_TXQ_STOP_POLL_TIME_USEC);
-      if ((status != VMK_OK) && (status != VMK_WAIT_INTERRUPTED)) {
-        SFVMK_ADAPTER_ERROR(pAdapter, "vmk_WorldSleep failed status: %s",
-                            vmk_StatusToString(status));
-        vmk_SpinlockLock(pTxq->lock);
-        break;
-      }
+  pEvq = pAdapter->ppEvq[pTxq->evqIndex];
+  VMK_ASSERT_NOT_NULL(pEvq);
 
-      sfvmk_getTime(&currentTime);
-      vmk_SpinlockLock(pTxq->lock);
-    }
-    if (pTxq->flushState != SFVMK_FLUSH_STATE_DONE) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "TXQ[%u] flush timeout", qIndex);
-      pTxq->flushState = SFVMK_FLUSH_STATE_DONE;
-    }
+  sfvmk_txqComplete(pTxq, pEvq, &compCtx);
+  if(pTxq->completed != pTxq->added)
+    SFVMK_ADAPTER_ERROR(pAdapter, "pTxq->completed != pTxq->added");
 
-    pTxq->pending = pTxq->added;
+  pTxq->added = 0;
+  pTxq->pending = 0;
+  pTxq->completed = 0;
+  pTxq->reaped = 0;
 
-    pEvq = pAdapter->ppEvq[qIndex];
-    VMK_ASSERT_NOT_NULL(pEvq);
+  pTxq->state = SFVMK_TXQ_STATE_INITIALIZED;
 
-    sfvmk_txqComplete(pTxq, pEvq, &compCtx);
-    if(pTxq->completed != pTxq->added)
-      SFVMK_ADAPTER_ERROR(pAdapter, "pTxq->completed != pTxq->added");
+  sfvmk_memPoolFree((vmk_VA)pTxq->pPendDesc, sizeof(efx_desc_t) *
+                    pTxq->numDesc);
+  pTxq->pPendDesc = NULL;
+  sfvmk_memPoolFree((vmk_VA)pTxq->pTxMap, sizeof(sfvmk_txMapping_t) *
+                    pTxq->numDesc);
+  pTxq->pTxMap = NULL;
+  sfvmk_txqUnlock(pTxq);
 
-    pTxq->added = 0;
-    pTxq->pending = 0;
-    pTxq->completed = 0;
-    pTxq->reaped = 0;
+  /* Destroy the common code transmit queue. */
+  efx_tx_qdestroy(pTxq->pCommonTxq);
 
-    pTxq->state = SFVMK_TXQ_STATE_INITIALIZED;
+  pTxq->pCommonTxq = NULL;
 
-    sfvmk_memPoolFree((vmk_VA)pTxq->pPendDesc, sizeof(efx_desc_t) *
-                      pTxq->numDesc);
-    pTxq->pPendDesc = NULL;
-    sfvmk_memPoolFree((vmk_VA)pTxq->pTxMap, sizeof(sfvmk_txMapping_t) *
-                      pTxq->numDesc);
-    pTxq->pTxMap = NULL;
-    vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_freeDMAMappedMem(pAdapter->dmaEngine,
+                         pTxq->mem.pEsmBase,
+                         pTxq->mem.ioElem.ioAddr,
+                         pTxq->mem.ioElem.length);
 
-    /* Destroy the common code transmit queue. */
-    efx_tx_qdestroy(pTxq->pCommonTxq);
+  return VMK_OK;
+}
 
-    pTxq->pCommonTxq = NULL;
+/*! \brief  Wait for flush and destroy common code TXQ.
+**
+** \param[in]  pAdapter    Pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_txFlushWaitAndDestroy(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint64 timeout, currentTime;
+  vmk_uint32 qIndex;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
 
-    sfvmk_freeDMAMappedMem(pAdapter->dmaEngine,
-                           pTxq->mem.pEsmBase,
-                           pTxq->mem.ioElem.ioAddr,
-                           pTxq->mem.ioElem.length);
+  sfvmk_getTime(&currentTime);
+  timeout = currentTime + SFVMK_TXQ_STOP_TIME_OUT_USEC;
+
+  for (qIndex = 0; qIndex < pAdapter->numTxqsAllocated; qIndex++) {
+    if (sfvmk_txqFlushWaitAndDestroy(pAdapter, qIndex, timeout) != VMK_OK)
+      goto done;
   }
 
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
 }
 
+/*! \brief  Flush a common code TXQ.
+**
+** \param[in]  pAdapter  Pointer to sfvmk_adapter_t
+** \param[in]  qIndex    TXQ index
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+static VMK_ReturnStatus
+sfvmk_txqFlush(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
+{
+  sfvmk_txq_t *pTxq = NULL;
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  pTxq = pAdapter->ppTxq[qIndex];
+  if (pTxq == NULL) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "NULL TXQ ptr for TXQ[%u]", qIndex);
+    return VMK_FAILURE;
+  }
+
+  sfvmk_txqLock(pTxq);
+
+  if (pTxq->state != SFVMK_TXQ_STATE_STARTED) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "TXQ is not yet started");
+    sfvmk_txqUnlock(pTxq);
+    return VMK_OK;
+  }
+
+  pTxq->state = SFVMK_TXQ_STATE_STOPPING;
+  pTxq->flushState = SFVMK_FLUSH_STATE_PENDING;
+  sfvmk_txqUnlock(pTxq);
+
+  /* Flush the transmit queue */
+  status = efx_tx_qflush(pTxq->pCommonTxq);
+  if (status != VMK_OK) {
+    sfvmk_txqLock(pTxq);
+    if (status == VMK_EALREADY)
+      pTxq->flushState = SFVMK_FLUSH_STATE_DONE;
+    else
+      pTxq->flushState = SFVMK_FLUSH_STATE_FAILED;
+    sfvmk_txqUnlock(pTxq);
+  }
+
+  return VMK_OK;
+}
+
 /*! \brief  Flush common code TXQs.
 **
 ** \param[in]  pAdapter  Pointer to sfvmk_adapter_t
@@ -413,8 +571,6 @@ done:
 */
 static void sfvmk_txFlush(sfvmk_adapter_t *pAdapter)
 {
-  sfvmk_txq_t *pTxq = NULL;
-  VMK_ReturnStatus status = VMK_FAILURE;
   vmk_uint32 qIndex;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
@@ -423,41 +579,51 @@ static void sfvmk_txFlush(sfvmk_adapter_t *pAdapter)
   VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
 
   for (qIndex = 0; qIndex < pAdapter->numTxqsAllocated; qIndex++) {
-
-    pTxq = pAdapter->ppTxq[qIndex];
-    if (pTxq == NULL) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "NULL TXQ ptr for TXQ[%u]", qIndex);
+    if (sfvmk_txqFlush(pAdapter, qIndex) != VMK_OK)
       goto done;
-    }
+  }
 
-    vmk_SpinlockLock(pTxq->lock);
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+}
 
-    if (pTxq->state != SFVMK_TXQ_STATE_STARTED) {
-      SFVMK_ADAPTER_ERROR(pAdapter, "TXQ is not yet started");
-      vmk_SpinlockUnlock(pTxq->lock);
-      continue;
-    }
+/*! \brief Flush and destroy a single common code TXQ, leaving the
+**        rest of the transmit path running.
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[in]  qIndex    TXQ index
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+VMK_ReturnStatus
+sfvmk_txqStop(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
+{
+  vmk_uint64 currentTime;
+  VMK_ReturnStatus status = VMK_BAD_PARAM;
 
-    pTxq->state = SFVMK_TXQ_STATE_STOPPING;
-    pTxq->flushState = SFVMK_FLUSH_STATE_PENDING;
-    vmk_SpinlockUnlock(pTxq->lock);
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX, "qIndex[%u]", qIndex);
 
-    /* Flush the transmit queue */
-    status = efx_tx_qflush(pTxq->pCommonTxq);
-    if (status != VMK_OK) {
-      vmk_SpinlockLock(pTxq->lock);
-      if (status == VMK_EALREADY)
-        pTxq->flushState = SFVMK_FLUSH_STATE_DONE;
-      else
-        pTxq->flushState = SFVMK_FLUSH_STATE_FAILED;
-      vmk_SpinlockUnlock(pTxq->lock);
-    }
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppTxq);
+
+  if (qIndex >= pAdapter->numTxqsAllocated) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid queue index %u", qIndex);
+    goto done;
   }
 
+  status = sfvmk_txqFlush(pAdapter, qIndex);
+  if (status != VMK_OK)
+    goto done;
+
+  sfvmk_getTime(&currentTime);
+  status = sfvmk_txqFlushWaitAndDestroy(pAdapter, qIndex,
+                                        currentTime + SFVMK_TXQ_STOP_TIME_OUT_USEC);
+
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
-}
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX, "qIndex[%u]", qIndex);
 
+  return status;
+}
 
 /*! \brief Flush and destroy all common code TXQs.
 **
@@ -490,7 +656,7 @@ sfvmk_txStop(sfvmk_adapter_t *pAdapter)
 **
 ** \return: VMK_OK [success] error code [failure]
 */
-static VMK_ReturnStatus
+VMK_ReturnStatus
 sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
 {
   sfvmk_txq_t *pTxq = NULL;
@@ -518,7 +684,7 @@ sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   VMK_ASSERT_NOT_NULL(pTxq);
 
   if (pAdapter->ppEvq != NULL)
-    pEvq = pAdapter->ppEvq[pTxq->index];
+    pEvq = pAdapter->ppEvq[pTxq->evqIndex];
   VMK_ASSERT_NOT_NULL(pEvq);
 
   VMK_ASSERT_EQ(pTxq->state, SFVMK_TXQ_STATE_INITIALIZED);
@@ -534,7 +700,7 @@ sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
     goto done;
   }
 
-  vmk_SpinlockLock(pTxq->lock);
+  sfvmk_txqLock(pTxq);
 
   pTxq->hwVlanTci = 0;
   pTxq->numDesc = pAdapter->numTxqBuffDesc;
@@ -545,14 +711,14 @@ sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   pTxq->mem.ioElem.ioAddr = ioAddr;
   pTxq->mem.pEsmBase = pTxqMem;
 
-  vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_txqUnlock(pTxq);
 
   flags = EFX_TXQ_CKSUM_IPV4 | EFX_TXQ_CKSUM_TCPUDP;
   if (pAdapter->isTsoFwAssisted == VMK_TRUE)
     flags |= EFX_TXQ_FATSOV2;
 
   /* Create the common code transmit queue. */
-  status = efx_tx_qcreate(pAdapter->pNic, qIndex, 0, &pTxq->mem,
+  status = efx_tx_qcreate(pAdapter->pNic, qIndex, pTxq->label, &pTxq->mem,
                           pAdapter->numTxqBuffDesc, 0, flags,
                           pEvq->pCommonEvq, &pTxq->pCommonTxq, &descIndex);
   if (status != VMK_OK) {
@@ -566,7 +732,7 @@ sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
     flags &= ~EFX_TXQ_FATSOV2;
     pAdapter->isTsoFwAssisted = VMK_FALSE;
 
-    status = efx_tx_qcreate(pAdapter->pNic, qIndex, 0, &pTxq->mem,
+    status = efx_tx_qcreate(pAdapter->pNic, qIndex, pTxq->label, &pTxq->mem,
                             pAdapter->numTxqBuffDesc, 0, flags,
                             pEvq->pCommonEvq, &pTxq->pCommonTxq, &descIndex);
     if (status != VMK_OK) {
@@ -594,16 +760,19 @@ sfvmk_txqStart(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
     goto pend_desc_alloc_failed;
   }
 
-  vmk_SpinlockLock(pTxq->lock);
+  sfvmk_txqLock(pTxq);
   pTxq->isCso = VMK_TRUE;
   pTxq->isEncapCso = VMK_FALSE;
   pTxq->pTxMap = pTxMap;
   pTxq->pPendDesc = pPendDesc;
   pTxq->nPendDesc = 0;
   pTxq->added = pTxq->pending = pTxq->completed = pTxq->reaped = descIndex;
+  pTxq->ringLevel.lastCycles = vmk_GetTimerCycles();
+  pTxq->ringLevel.level = 0;
+  pTxq->stopCycles = 0;
   pTxq->state = SFVMK_TXQ_STATE_STARTED;
   pTxq->flushState = SFVMK_FLUSH_STATE_REQUIRED;
-  vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_txqUnlock(pTxq);
 
   SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_DBG,
                       "Txq[%u] ioa: %lx vmem: %p, pPendDesc: %p, numDesc: %u",
@@ -689,13 +858,42 @@ sfvmk_txqFlushDone(sfvmk_txq_t *pTxq)
 {
   VMK_ASSERT_NOT_NULL(pTxq);
 
-  vmk_SpinlockLock(pTxq->lock);
+  sfvmk_txqLock(pTxq);
   pTxq->flushState = SFVMK_FLUSH_STATE_DONE;
-  vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_txqUnlock(pTxq);
 
   return VMK_OK;
 }
 
+/*! \brief Publish the latency samples of a completion pass and, once
+**         the pass is done, the ring level in one stats write section.
+**         TXQ lock must be held.
+**
+** \param[in]  pTxq        pointer to txq
+** \param[in]  pPushTime   doorbell time of the sampled packets
+** \param[in]  numSamples  number of samples in pPushTime
+** \param[in]  passDone    account the ring level as well
+**
+** \return: void
+*/
+static void
+sfvmk_txqCompleteStats(sfvmk_txq_t *pTxq, const vmk_uint64 *pPushTime,
+                       vmk_uint32 numSamples, vmk_Bool passDone)
+{
+  vmk_uint64 now = 0;
+  vmk_uint32 i;
+
+  if (numSamples != 0)
+    now = vmk_GetTimerCycles();
+
+  vmk_VersionedAtomicBeginWrite(&pTxq->statsLock);
+  for (i = 0; i < numSamples; i++)
+    sfvmk_latHistRecord(pTxq->pAdapter, pTxq->latHist, pPushTime[i], now);
+  if (passDone)
+    sfvmk_txqLevelAccount(pTxq);
+  vmk_VersionedAtomicEndWrite(&pTxq->statsLock);
+}
+
 /*! \brief reap the tx queue
 **
 ** \param[in]  pTxq    pointer to txq
@@ -745,9 +943,11 @@ sfvmk_txqComplete(sfvmk_txq_t *pTxq, sfvmk_evq_t *pEvq, sfvmk_pktCompCtx_t *pCom
 {
   unsigned int completed;
   struct sfvmk_adapter_s *pAdapter = pTxq->pAdapter;
+  vmk_uint64 pushTime[SFVMK_TXQ_LAT_BATCH];
+  vmk_uint32 numSamples = 0;
 
   if (VMK_UNLIKELY(vmk_SystemCheckState(VMK_SYSTEM_STATE_PANIC) == VMK_TRUE) &&
-     (pEvq != pAdapter->ppEvq[0])) {
+     (pEvq->index != pAdapter->ppTxq[0]->evqIndex)) {
     SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                            "System in panic state, returning");
     goto done;
@@ -773,6 +973,14 @@ sfvmk_txqComplete(sfvmk_txq_t *pTxq, sfvmk_evq_t *pEvq, sfvmk_pktCompCtx_t *pCom
       sfvmk_pktRelease(pAdapter, pCompCtx, pTxMap->pOrigPkt);
     }
 
+    if (VMK_UNLIKELY(pTxMap->pushTime != 0)) {
+      if (numSamples == SFVMK_TXQ_LAT_BATCH) {
+        sfvmk_txqCompleteStats(pTxq, pushTime, numSamples, VMK_FALSE);
+        numSamples = 0;
+      }
+      pushTime[numSamples++] = pTxMap->pushTime;
+    }
+
     vmk_Memset(pTxMap, 0, sizeof(sfvmk_txMapping_t));
   }
 
@@ -781,6 +989,7 @@ sfvmk_txqComplete(sfvmk_txq_t *pTxq, sfvmk_evq_t *pEvq, sfvmk_pktCompCtx_t *pCom
                          pTxq->completed, pTxq->pending);
 
   pTxq->completed = completed;
+  sfvmk_txqCompleteStats(pTxq, pushTime, numSamples, VMK_TRUE);
 
   /* Check whether we need to unblock the queue. */
   vmk_CPUMemFenceWrite();
@@ -904,7 +1113,7 @@ sfvmk_txNonTsoPkt(sfvmk_txq_t *pTxq,
   sfvmk_txMapping_t *pTxMap = pTxq->pTxMap;
   vmk_uint32 nPendDescOri = pTxq->nPendDesc;
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   id = startID = *pTxMapId;
   pktLen = pktLenLeft = vmk_PktFrameLenGet(pXmitPkt);
@@ -913,11 +1122,12 @@ sfvmk_txNonTsoPkt(sfvmk_txq_t *pTxq,
   SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                          "Start creating non-TSO desc, pXmitPkt=%p, "
                          "numElems=%d, startID=%d", pXmitPkt, numElems, startID);
+  SFVMK_DATAPATH_TRACE3(sfvmk_tx_non_tso, pTxq->index, numElems, startID);
 
   for (i = 0; i < numElems && pktLenLeft > 0; i ++) {
      pSgElem = vmk_PktSgElemGet(pXmitPkt, i);
      if (pSgElem == NULL) {
-       pTxq->stats[SFVMK_TXQ_SG_ELEM_GET_FAILED]++;
+       sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_SG_ELEM_GET_FAILED, 1);
        SFVMK_ADAPTER_ERROR(pAdapter, "vmk_PktSgElemGet returned NULL");
        status = VMK_FAILURE;
        goto fail_map;
@@ -925,7 +1135,7 @@ sfvmk_txNonTsoPkt(sfvmk_txq_t *pTxq,
 
      elemLength = pSgElem->length;
      if (elemLength > pAdapter->txDmaDescMaxSize) {
-       pTxq->stats[SFVMK_TXQ_SG_ELEM_TOO_LONG]++;
+       sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_SG_ELEM_TOO_LONG, 1);
        SFVMK_ADAPTER_ERROR(pAdapter, "ElemLength[%u] exceeded max allowed",
                            elemLength);
        status = VMK_FAILURE;
@@ -948,7 +1158,7 @@ sfvmk_txNonTsoPkt(sfvmk_txq_t *pTxq,
         SFVMK_ADAPTER_ERROR(pAdapter,"Failed to map elem %lx size %u: %s",
                             pSgElem->addr, elemLength,
                             vmk_DMAMapErrorReasonToString(dmaMapErr.reason));
-        pTxq->stats[SFVMK_TXQ_DMA_MAP_ERROR]++;
+        sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_DMA_MAP_ERROR, 1);
         goto fail_map;
      }
 
@@ -971,7 +1181,7 @@ sfvmk_txNonTsoPkt(sfvmk_txq_t *pTxq,
   *pTxMapId = id;
   descCount = pTxq->nPendDesc - nPendDescOri;
 
-  pTxq->stats[SFVMK_TXQ_BYTES] += pktLen;
+  pTxq->burstBytes += pktLen;
 
   SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                          "non-TSO %u descriptors created, next startID = %u",
@@ -993,7 +1203,7 @@ fail_map:
   }
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return status;
 }
 
@@ -1017,7 +1227,7 @@ sfvmk_txMaybeInsertTag(sfvmk_txq_t *pTxq,
   sfvmk_txMapping_t *pTxMap = pTxq->pTxMap;
   sfvmk_adapter_t *pAdapter = pTxq->pAdapter;
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   if (pXmitInfo->offloadFlag & SFVMK_TX_VLAN) {
     vlanId = vmk_PktVlanIDGet(pkt);
@@ -1059,7 +1269,7 @@ tagged:
    *pTxMapId = (*pTxMapId + 1) & pTxq->ptrMask;
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return;
 }
 
@@ -1099,7 +1309,7 @@ sfvmk_fillXmitInfo(sfvmk_txq_t *pTxq,
   sfvmk_hdrInfo_t *pTcpHdr     = &hdrInfoArray[SFVMK_HDR_INFO_TYPE_TCP];
   sfvmk_hdrInfo_t *pEncapIpHdr = &hdrInfoArray[SFVMK_HDR_INFO_TYPE_ENCAP_IP];
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   VMK_ASSERT_NOT_NULL(pTxq);
 
@@ -1267,7 +1477,7 @@ done:
     vmk_PktHeaderDataRelease(pkt, pTcpHdr->pHdrEntry,
                              (void *)pTcpHdr->pMappedPtr, VMK_FALSE);
 
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
 
   return status;
 }
@@ -1297,7 +1507,7 @@ sfvmk_hwTsoFixPkt(sfvmk_txq_t *pTxq,
   vmk_Bool         headerSaved = (pXmitInfo->headerLen == pXmitInfo->firstSgLen);
   vmk_uint32       i = 0;
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   numElems = vmk_PktSgArrayGet(pOrigPkt)->numElems;
   VMK_ASSERT(numElems > 1);
@@ -1362,7 +1572,7 @@ sfvmk_hwTsoFixPkt(sfvmk_txq_t *pTxq,
    * contents beyond that will be referring to buffers shared with pOrigPkt */
   status = vmk_PktPartialCopy(pOrigPkt, copyBytes, &pXmitPkt);
   if (status != VMK_OK) {
-    pTxq->stats[SFVMK_TXQ_PARTIAL_COPY_FAILED]++;
+    sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_PARTIAL_COPY_FAILED, 1);
     SFVMK_ADAPTER_ERROR(pAdapter, "Partial copy[%p] failed[%s], numBytes: %u",
                         pOrigPkt, vmk_StatusToString(status), copyBytes);
     goto done;
@@ -1379,7 +1589,7 @@ sfvmk_hwTsoFixPkt(sfvmk_txq_t *pTxq,
   status = VMK_OK;
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return status;
 }
 
@@ -1454,7 +1664,7 @@ sfvmk_txHwTso(sfvmk_txq_t *pTxq,
   vmk_PktHandle *pOrigPkt = pXmitInfo->pOrigPkt;
   vmk_PktHandle *pXmitPkt = pXmitInfo->pXmitPkt;
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
   VMK_ASSERT_NOT_NULL(pAdapter);
 
   pTxMap = pTxq->pTxMap;
@@ -1494,7 +1704,7 @@ sfvmk_txHwTso(sfvmk_txq_t *pTxq,
       SFVMK_ADAPTER_ERROR(pAdapter,"Failed to map pkt %p size %u: %s",
                           pXmitPkt, pktLen,
                           vmk_DMAMapErrorReasonToString(dmaMapErr.reason));
-      pTxq->stats[SFVMK_TXQ_DMA_MAP_ERROR]++;
+      sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_DMA_MAP_ERROR, 1);
       goto fail_map;
     }
 
@@ -1558,7 +1768,7 @@ sfvmk_txHwTso(sfvmk_txq_t *pTxq,
   descCount = pTxq->nPendDesc - nPendDescOri;
   VMK_ASSERT(descCount <= pXmitInfo->dmaDescsEst + EFX_TX_FATSOV2_OPT_NDESCS);
 
-  pTxq->stats[SFVMK_TXQ_BYTES] += pktLen;
+  pTxq->burstBytes += pktLen;
 
   SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                          "FATSO done: created %u desc, next startID = %u",
@@ -1580,7 +1790,7 @@ fail_map:
    }
 
 done:
-   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+   SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
    return status;
 }
 
@@ -1597,7 +1807,7 @@ sfvmk_txqListPost(sfvmk_txq_t *pTxq)
   VMK_ReturnStatus status = VMK_FAILURE;
   sfvmk_adapter_t *pAdapter = pTxq->pAdapter;
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   VMK_ASSERT(pTxq->nPendDesc != 0);
 
@@ -1624,7 +1834,7 @@ sfvmk_txqListPost(sfvmk_txq_t *pTxq)
   pTxq->nPendDesc = 0;
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return status;
 }
 
@@ -1642,7 +1852,7 @@ sfvmk_txCreateCsumDesc(sfvmk_txq_t *pTxq, vmk_Bool isCso, vmk_Bool isEncapCso) {
 
   vmk_uint16 flags = 0;
 
-  SFVMK_DEBUG_FUNC_ENTRY(SFVMK_DEBUG_TX);
+  SFVMK_DEBUG_IO_FUNC_ENTRY(SFVMK_DEBUG_TX);
   SFVMK_ADAPTER_DEBUG_IO(pTxq->pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                          "isCso: %u, isEncapCso: %u", isCso, isEncapCso);
 
@@ -1656,7 +1866,7 @@ sfvmk_txCreateCsumDesc(sfvmk_txq_t *pTxq, vmk_Bool isCso, vmk_Bool isEncapCso) {
                                flags,
                                &pTxq->pPendDesc[pTxq->nPendDesc ++]);
 
-  SFVMK_DEBUG_FUNC_EXIT(SFVMK_DEBUG_TX);
+  SFVMK_DEBUG_IO_FUNC_EXIT(SFVMK_DEBUG_TX);
 }
 
 
@@ -1677,8 +1887,9 @@ sfvmk_populateTxDescriptor(sfvmk_txq_t *pTxq,
   vmk_uint32 txMapId = (pTxq->added) & pTxq->ptrMask;
   vmk_Bool isCso = VMK_FALSE;
   vmk_Bool isEncapCso = VMK_FALSE;
+  vmk_uint64 profStart = sfvmk_profStart(pAdapter);
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
   VMK_ASSERT(pTxq->nPendDesc == 0);
 
   /* VLAN handling */
@@ -1735,13 +1946,15 @@ sfvmk_populateTxDescriptor(sfvmk_txq_t *pTxq,
    /* Post the pSgElemment list. */
   status = sfvmk_txqListPost(pTxq);
   if (status != VMK_OK) {
-    pTxq->stats[SFVMK_TXQ_DESC_POST_FAILED]++;
+    sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_DESC_POST_FAILED, 1);
     SFVMK_ADAPTER_ERROR(pAdapter, "pkt[%p] post failed: %s",
                         pXmitInfo->pXmitPkt, vmk_StatusToString(status));
   }
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  sfvmk_profEnd(&pTxq->prof[SFVMK_MGMT_PROF_POPULATE_TX_DESC], profStart,
+                (status == VMK_OK) ? 1 : 0);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return status;
 }
 
@@ -1759,7 +1972,7 @@ sfvmk_isTxqStopped(sfvmk_adapter_t *pAdapter, vmk_uint32 txqIndex)
   vmk_Bool stopped;
   vmk_uint32 txqStartIndex;
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   txqStartIndex = sfvmk_getUplinkTxqStartIndex(&pAdapter->uplink);
 
@@ -1767,10 +1980,75 @@ sfvmk_isTxqStopped(sfvmk_adapter_t *pAdapter, vmk_uint32 txqIndex)
                                txqIndex + txqStartIndex);
 
 
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return stopped;
 }
 
+/*! \brief Sample the flow of a transmitted packet for accelerated RFS
+**        along with the PCPU it is transmitted from. Only IPv4 TCP and
+**        UDP packets that are not tunnel offloads are recorded. Called
+**        with the TXQ lock held.
+**
+** \param[in]  pTxq  pointer to txq
+** \param[in]  pkt   packet about to be transmitted
+**
+** \return: void
+*/
+void
+sfvmk_txqArfsLearn(sfvmk_txq_t *pTxq, vmk_PktHandle *pkt)
+{
+  vmk_PktHeaderEntry *pL3Entry = NULL;
+  vmk_PktHeaderEntry *pL4Entry = NULL;
+  vmk_IPv4Hdr *pIpHdr = NULL;
+  vmk_uint16 *pPorts = NULL;
+  sfvmk_arfsSample_t *pSample;
+  vmk_uint16 hdrIndex;
+
+  if ((++pTxq->arfsSampleCount & (SFVMK_ARFS_SAMPLE_RATE - 1)) != 0)
+    return;
+
+  if (pTxq->numArfsLearnt >= SFVMK_ARFS_LEARN_SLOTS)
+    return;
+
+#if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
+  if (vmk_PktIsInnerOffload(pkt))
+#else
+  if (vmk_PktIsEncapsulatedFrame(pkt))
+#endif
+    return;
+
+  if ((vmk_PktHeaderL3Find(pkt, &pL3Entry, &hdrIndex) != VMK_OK) ||
+      (pL3Entry->type != VMK_PKT_HEADER_L3_IPv4))
+    return;
+
+  if ((vmk_PktHeaderL4Find(pkt, &pL4Entry, &hdrIndex) != VMK_OK) ||
+      ((pL4Entry->type != VMK_PKT_HEADER_L4_TCP) &&
+       (pL4Entry->type != VMK_PKT_HEADER_L4_UDP)))
+    return;
+
+  if (vmk_PktHeaderDataGet(pkt, pL3Entry, (void **)&pIpHdr) != VMK_OK)
+    return;
+
+  /* TCP and UDP headers both start with the source and destination ports */
+  if (vmk_PktHeaderDataGet(pkt, pL4Entry, (void **)&pPorts) != VMK_OK)
+    goto release_l3;
+
+  /* Addresses are kept in network byte order, ports in host byte order */
+  pSample = &pTxq->arfsLearnt[pTxq->numArfsLearnt++];
+  pSample->key.localIp = pIpHdr->saddr;
+  pSample->key.remoteIp = pIpHdr->daddr;
+  pSample->key.localPort = vmk_BE16ToCPU(pPorts[0]);
+  pSample->key.remotePort = vmk_BE16ToCPU(pPorts[1]);
+  pSample->key.proto = (pL4Entry->type == VMK_PKT_HEADER_L4_TCP) ?
+                       EFX_IPPROTO_TCP : EFX_IPPROTO_UDP;
+  pSample->pcpu = vmk_GetPCPUNum();
+
+  vmk_PktHeaderDataRelease(pkt, pL4Entry, (void *)pPorts, VMK_FALSE);
+
+release_l3:
+  vmk_PktHeaderDataRelease(pkt, pL3Entry, (void *)pIpHdr, VMK_FALSE);
+}
+
 /*! \brief transmit the packet on the uplink interface
 **
 ** \param[in]  pTxq      pointer to txq
@@ -1788,13 +2066,17 @@ sfvmk_transmitPkt(sfvmk_txq_t *pTxq,
   vmk_uint32 nTotalDesc = 0;
   sfvmk_adapter_t *pAdapter = NULL;
   sfvmk_xmitInfo_t xmitInfo;
+  vmk_uint64 profStart;
+  vmk_uint64 bellStart;
 
   VMK_ASSERT_NOT_NULL(pTxq);
   VMK_ASSERT_NOT_NULL(pTxq->pCommonTxq);
   pAdapter = pTxq->pAdapter;
   VMK_ASSERT_NOT_NULL(pAdapter);
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
+  profStart = sfvmk_profStart(pAdapter);
+
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_TX);
 
   vmk_Memset(&xmitInfo, 0, sizeof(sfvmk_xmitInfo_t));
   xmitInfo.offloadFlag |= vmk_PktMustVlanTag(pkt) ? SFVMK_TX_VLAN : 0;
@@ -1816,6 +2098,8 @@ sfvmk_transmitPkt(sfvmk_txq_t *pTxq,
                          xmitInfo.offloadFlag & SFVMK_TX_ENCAP_TSO  ? "en" : "dis",
                          vmk_PktSgArrayGet(pkt)->numElems,
                          vmk_PktFrameLenGet(pkt));
+  SFVMK_DATAPATH_TRACE3(sfvmk_tx_start, pTxq->index, vmk_PktFrameLenGet(pkt),
+                        xmitInfo.offloadFlag);
 
   /* Do estimation as early as possible */
   nTotalDesc = sfvmk_txDmaDescEstimate(pTxq, pkt, &xmitInfo);
@@ -1833,6 +2117,8 @@ sfvmk_transmitPkt(sfvmk_txq_t *pTxq,
     SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_TX, SFVMK_LOG_LEVEL_IO,
                            "not enough desc entries in txq[%u], stopping the queue",
                            pTxq->index);
+    SFVMK_DATAPATH_TRACE2(sfvmk_txq_stop, pTxq->index,
+                          pTxq->added - pTxq->reaped);
     status = VMK_BUSY;
     goto done;
   }
@@ -1846,7 +2132,7 @@ sfvmk_transmitPkt(sfvmk_txq_t *pTxq,
     status = sfvmk_fillXmitInfo(pTxq, pkt, &xmitInfo);
     if (status != VMK_OK) {
       SFVMK_ADAPTER_ERROR(pAdapter, "failed to parse xmit pkt info");
-      pTxq->stats[SFVMK_TXQ_TSO_PARSING_FAILED]++;
+      sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_TSO_PARSING_FAILED, 1);
       goto done;
     }
 
@@ -1875,11 +2161,21 @@ sfvmk_transmitPkt(sfvmk_txq_t *pTxq,
     goto done;
   }
 
-  if (pTxq->added != pushed)
+  if (pTxq->added != pushed) {
+    bellStart = sfvmk_profStart(pAdapter);
     efx_tx_qpush(pTxq->pCommonTxq, pTxq->added, pushed);
+    sfvmk_profEnd(&pTxq->prof[SFVMK_MGMT_PROF_TX_DOORBELL], bellStart, 1);
+
+    /* Stamp the last descriptor, it is the last one reclaimed */
+    if (sfvmk_latSample(pAdapter, &pTxq->latSampleCount))
+      pTxq->pTxMap[(pTxq->added - 1) & pTxq->ptrMask].pushTime =
+        vmk_GetTimerCycles();
+  }
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
+  sfvmk_profEnd(&pTxq->prof[SFVMK_MGMT_PROF_TRANSMIT_PKT], profStart,
+                (status == VMK_OK) ? 1 : 0);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_TX);
   return status;
 }
 
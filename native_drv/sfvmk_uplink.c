@@ -408,7 +408,7 @@ sfvmk_associateRSSNetPoll(sfvmk_adapter_t *pAdapter)
   VMK_ASSERT_NOT_NULL(pAdapter);
 
   qStartIndex = sfvmk_getRSSQStartIndex(pAdapter);
-  qEndIndex = qStartIndex + pAdapter->numRSSQs;
+  qEndIndex = qStartIndex + sfvmk_getNumRSSHwQs(pAdapter);
 
   VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
 
@@ -454,7 +454,7 @@ sfvmk_disassociateRssNetPoll(sfvmk_adapter_t *pAdapter)
   VMK_ASSERT_NOT_NULL(pAdapter);
 
   qStartIndex = sfvmk_getRSSQStartIndex(pAdapter);
-  qEndIndex = qStartIndex + pAdapter->numRSSQs;
+  qEndIndex = qStartIndex + sfvmk_getNumRSSHwQs(pAdapter);
 
   VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
 
@@ -464,6 +464,71 @@ sfvmk_disassociateRssNetPoll(sfvmk_adapter_t *pAdapter)
   }
 }
 
+/*! \brief Associate the dedicated TX EVQ netpolls with the uplink
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t
+**
+** \return: VMK_OK on success or error code otherwise
+**
+*/
+static VMK_ReturnStatus
+sfvmk_associateTxEvqNetPoll(sfvmk_adapter_t *pAdapter)
+{
+  VMK_ReturnStatus status = VMK_OK;
+  vmk_Name netpollName;
+  vmk_uint32 qIndex;
+  vmk_uint32 qStartIndex;
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
+
+  qStartIndex = sfvmk_getTxEvqStartIndex(pAdapter);
+
+  for (qIndex = qStartIndex; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    vmk_NameFormat(&netpollName, "txevq-%d", qIndex);
+    /* TX EVQ netpolls are not associated to any uplink shared queue */
+    VMK_ASSERT_NOT_NULL(pAdapter->ppEvq[qIndex]);
+    status = vmk_NetPollRegisterUplink(pAdapter->ppEvq[qIndex]->netPoll,
+                                       pAdapter->uplink.handle, netpollName, VMK_FALSE);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_NetPollRegisterUplink(%u) Failed status: %s",
+                          qIndex, vmk_StatusToString(status));
+      goto failed;
+    }
+  }
+
+  goto done;
+
+failed:
+  while (qIndex > qStartIndex)
+    vmk_NetPollUnregisterUplink(pAdapter->ppEvq[--qIndex]->netPoll);
+
+done:
+  return status;
+}
+
+/*! \brief Disassociate the dedicated TX EVQ netpolls from the uplink
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t
+**
+** \return: void
+**
+*/
+static void
+sfvmk_disassociateTxEvqNetPoll(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint32 qIndex;
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
+
+  for (qIndex = sfvmk_getTxEvqStartIndex(pAdapter);
+       qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    VMK_ASSERT_NOT_NULL(pAdapter->ppEvq[qIndex]);
+    vmk_NetPollUnregisterUplink(pAdapter->ppEvq[qIndex]->netPoll);
+  }
+}
+
 /*! \brief  Uplink callback function to associate uplink device with driver and
 **          driver register its cap with uplink device.
 **
@@ -530,6 +595,15 @@ sfvmk_uplinkAssociate(vmk_AddrCookie cookie, vmk_Uplink uplinkHandle)
     }
   }
 
+  status = sfvmk_associateTxEvqNetPoll(pAdapter);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_associateTxEvqNetPoll Failed status: %s",
+                        vmk_StatusToString(status));
+    if (sfvmk_isRSSEnable(pAdapter))
+      sfvmk_disassociateRssNetPoll(pAdapter);
+    goto done;
+  }
+
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
 
@@ -590,6 +664,8 @@ sfvmk_uplinkDisassociate(vmk_AddrCookie cookie)
     sfvmk_disassociateRssNetPoll(pAdapter);
   }
 
+  sfvmk_disassociateTxEvqNetPoll(pAdapter);
+
   vmk_SemaUnlock(&sfvmk_modInfo.lock);
 
   pAdapter->uplink.handle = NULL;
@@ -624,15 +700,21 @@ sfvmk_uplinkTx(vmk_AddrCookie cookie, vmk_PktList pktList)
   vmk_int16 maxRxQueues;
   vmk_int16 maxTxQueues;
   vmk_Bool queueIdentified = VMK_FALSE;
+  vmk_uint64 numDropped = 0;
+  vmk_uint32 numSent = 0;
+  vmk_uint32 numDiscard = 0;
+  vmk_uint64 profStart;
   VMK_PKTLIST_ITER_STACK_DEF(iter);
   sfvmk_pktCompCtx_t compCtx = {
     .type = SFVMK_PKT_COMPLETION_OTHERS,
   };
 
-  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
 
   VMK_ASSERT_NOT_NULL(pAdapter);
 
+  profStart = sfvmk_profStart(pAdapter);
+
   maxRxQueues = pAdapter->uplink.queueInfo.maxRxQueues;
   maxTxQueues = pAdapter->uplink.queueInfo.maxTxQueues;
 
@@ -665,11 +747,11 @@ sfvmk_uplinkTx(vmk_AddrCookie cookie, vmk_PktList pktList)
 
   queueIdentified = VMK_TRUE;
 
-  vmk_SpinlockLock(pAdapter->ppTxq[qid]->lock);
+  sfvmk_txqLock(pAdapter->ppTxq[qid]);
 
   if (pAdapter->ppTxq[qid]->state != SFVMK_TXQ_STATE_STARTED) {
-    pAdapter->ppTxq[qid]->stats[SFVMK_TXQ_INVALID_QUEUE_STATE]++;
-    vmk_SpinlockUnlock(pAdapter->ppTxq[qid]->lock);
+    sfvmk_txqStatsAdd(pAdapter->ppTxq[qid], SFVMK_TXQ_INVALID_QUEUE_STATE, 1);
+    sfvmk_txqUnlock(pAdapter->ppTxq[qid]);
     goto release_all_pkts;
   }
 
@@ -682,50 +764,67 @@ sfvmk_uplinkTx(vmk_AddrCookie cookie, vmk_PktList pktList)
     }
 
     if (sfvmk_isTxqStopped(pAdapter, qid)) {
-      vmk_SpinlockUnlock(pAdapter->ppTxq[qid]->lock);
+      sfvmk_txqBurstPublish(pAdapter->ppTxq[qid], numSent, numDiscard, 1);
+      sfvmk_profEnd(&pAdapter->ppTxq[qid]->prof[SFVMK_MGMT_PROF_UPLINK_TX],
+                    profStart, numSent);
+      sfvmk_txqUnlock(pAdapter->ppTxq[qid]);
 
       SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_UPLINK, SFVMK_LOG_LEVEL_IO,
                              "Queue stopped, returning");
       vmk_PktListIterInsertPktBefore(iter, pkt);
-      pAdapter->ppTxq[qid]->stats[SFVMK_TXQ_QUEUE_BUSY]++;
       status = VMK_BUSY;
       goto done;
     }
 
+    if (VMK_UNLIKELY(pAdapter->ppTxq[qid]->arfsLearn))
+      sfvmk_txqArfsLearn(pAdapter->ppTxq[qid], pkt);
+
     status = sfvmk_transmitPkt(pAdapter->ppTxq[qid], pkt);
     if(status == VMK_BUSY) {
-      vmk_SpinlockUnlock(pAdapter->ppTxq[qid]->lock);
+      sfvmk_txqBurstPublish(pAdapter->ppTxq[qid], numSent, numDiscard, 1);
+      sfvmk_profEnd(&pAdapter->ppTxq[qid]->prof[SFVMK_MGMT_PROF_UPLINK_TX],
+                    profStart, numSent);
+      sfvmk_txqUnlock(pAdapter->ppTxq[qid]);
       SFVMK_ADAPTER_DEBUG_IO(pAdapter, SFVMK_DEBUG_UPLINK, SFVMK_LOG_LEVEL_IO,
                              "Queue full, returning");
       vmk_PktListIterInsertPktBefore(iter, pkt);
-      pAdapter->ppTxq[qid]->stats[SFVMK_TXQ_QUEUE_BUSY]++;
       goto done;
     } else if (status != VMK_OK) {
       SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_transmitPkt failed status %s",
                           vmk_StatusToString(status));
       sfvmk_pktRelease(pAdapter, &compCtx, pkt);
-      vmk_AtomicInc64(&pAdapter->txDrops);
-      pAdapter->ppTxq[qid]->stats[SFVMK_TXQ_DISCARD]++;
+      numDiscard++;
       continue;
     }
 
-    pAdapter->ppTxq[qid]->stats[SFVMK_TXQ_PKTS]++;
+    numSent++;
   }
 
-  vmk_SpinlockUnlock(pAdapter->ppTxq[qid]->lock);
+  /* Burst counters are published at once rather than per packet */
+  sfvmk_txqBurstPublish(pAdapter->ppTxq[qid], numSent, numDiscard, 0);
+  sfvmk_profEnd(&pAdapter->ppTxq[qid]->prof[SFVMK_MGMT_PROF_UPLINK_TX],
+                profStart, numSent);
+  sfvmk_txqUnlock(pAdapter->ppTxq[qid]);
   goto done;
 
 release_all_pkts:
   for (vmk_PktListIterStart(iter, pktList); !vmk_PktListIterIsAtEnd(iter);) {
     vmk_PktListIterRemovePkt(iter, &pkt);
     sfvmk_pktRelease(pAdapter, &compCtx, pkt);
-    vmk_AtomicInc64(&pAdapter->txDrops);
-    if (queueIdentified)
-      pAdapter->ppTxq[qid]->stats[SFVMK_TXQ_DISCARD]++;
+    numDropped++;
+  }
+
+  /* TXQ counters have a single writer, the TXQ lock holder */
+  if (queueIdentified) {
+    sfvmk_txqLock(pAdapter->ppTxq[qid]);
+    sfvmk_txqStatsAdd(pAdapter->ppTxq[qid], SFVMK_TXQ_DISCARD, numDropped);
+    sfvmk_txqUnlock(pAdapter->ppTxq[qid]);
+  } else {
+    vmk_AtomicAdd64(&pAdapter->txDropsNoQueue, numDropped);
   }
 
 done:
-  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
+  SFVMK_ADAPTER_DEBUG_IO_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
   return status;
 }
 
@@ -807,9 +906,8 @@ static VMK_ReturnStatus sfvmk_panicPoll(vmk_AddrCookie cookie,
   for (qIndex = 0; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
     sfvmk_evq_t *pEvq = pAdapter->ppEvq[qIndex];
 
-    vmk_SpinlockLock(pEvq->lock);
+    /* Other CPUs are halted; no EVQ handshake is possible or needed */
     pEvq->panicPktList = pktList;
-    vmk_SpinlockUnlock(pEvq->lock);
 
     sfvmk_evqPoll(pEvq, VMK_TRUE);
   }
@@ -964,6 +1062,39 @@ done:
   return status;
 }
 
+/*! \brief Sum the tx drops of all TXQs and the drops seen before a
+**         TXQ was identified
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: number of tx packets dropped
+*/
+static vmk_uint64
+sfvmk_txDropsGet(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint64 txqStats[SFVMK_TXQ_MAX_STATS];
+  vmk_uint64 txDrops;
+  vmk_uint32 qIndex;
+
+  txDrops = vmk_AtomicRead64(&pAdapter->txDropsNoQueue);
+
+  if (pAdapter->ppTxq == NULL)
+    goto done;
+
+  for (qIndex = 0; qIndex < pAdapter->numTxqsAllocated; qIndex++) {
+    if (pAdapter->ppTxq[qIndex] == NULL)
+      continue;
+
+    sfvmk_queueStatsSnapshot(&pAdapter->ppTxq[qIndex]->statsLock,
+                             pAdapter->ppTxq[qIndex]->stats,
+                             txqStats, SFVMK_TXQ_MAX_STATS);
+    txDrops += txqStats[SFVMK_TXQ_DISCARD];
+  }
+
+done:
+  return txDrops;
+}
+
 /*! \brief Uplink callback function to get the NIC stats
 **
 ** \param[in]  cookie  pointer to vmk_AddrCookie
@@ -976,6 +1107,8 @@ static VMK_ReturnStatus
 sfvmk_uplinkStatsGet(vmk_AddrCookie cookie, vmk_UplinkStats *pNicStats)
 {
   sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)cookie.ptr;
+  efsys_stat_t *pStats;
+  vmk_uint64 snapshotTime;
   VMK_ReturnStatus status = VMK_FAILURE;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
@@ -988,53 +1121,54 @@ sfvmk_uplinkStatsGet(vmk_AddrCookie cookie, vmk_UplinkStats *pNicStats)
 
   vmk_Memset(pNicStats, 0, sizeof(*pNicStats));
 
-  sfvmk_MutexLock(pAdapter->lock);
+  /* Copy from the snapshot refreshed in the background on each MAC stats
+   * DMA; neither adapter lock nor waiting for the DMA is needed here */
+  pStats = pAdapter->adapterStatsSnapshot;
 
-  status = sfvmk_macStatsUpdate(pAdapter);
-  if (status != VMK_OK) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "Stats update failed with error %s",
-                        vmk_StatusToString(status));
-    goto failed_stats_update;
-  }
+  SFVMK_MAC_STATS_BEGIN_READ(pAdapter);
 
-  pNicStats->rxPkts = pAdapter->adapterStats[EFX_MAC_RX_PKTS];
-  pNicStats->txPkts = pAdapter->adapterStats[EFX_MAC_TX_PKTS];
-  pNicStats->rxBytes = pAdapter->adapterStats[EFX_MAC_RX_OCTETS];
-  pNicStats->txBytes = pAdapter->adapterStats[EFX_MAC_TX_OCTETS];
+  pNicStats->rxPkts = pStats[EFX_MAC_RX_PKTS];
+  pNicStats->txPkts = pStats[EFX_MAC_TX_PKTS];
+  pNicStats->rxBytes = pStats[EFX_MAC_RX_OCTETS];
+  pNicStats->txBytes = pStats[EFX_MAC_TX_OCTETS];
 
-  pNicStats->rxErrors = pAdapter->adapterStats[EFX_MAC_RX_ERRORS];
-  pNicStats->txErrors = pAdapter->adapterStats[EFX_MAC_TX_ERRORS];
+  pNicStats->rxErrors = pStats[EFX_MAC_RX_ERRORS];
+  pNicStats->txErrors = pStats[EFX_MAC_TX_ERRORS];
 
-  pNicStats->rxDrops = pAdapter->adapterStats[EFX_MAC_RX_DROP_EVENTS];
-  pNicStats->txDrops = vmk_AtomicRead64(&pAdapter->txDrops);
+  pNicStats->rxDrops = pStats[EFX_MAC_RX_DROP_EVENTS];
 
-  pNicStats->rxMulticastPkts = pAdapter->adapterStats[EFX_MAC_RX_MULTICST_PKTS];
-  pNicStats->rxBroadcastPkts = pAdapter->adapterStats[EFX_MAC_RX_BRDCST_PKTS];
-  pNicStats->txMulticastPkts = pAdapter->adapterStats[EFX_MAC_TX_MULTICST_PKTS];
-  pNicStats->txBroadcastPkts = pAdapter->adapterStats[EFX_MAC_TX_BRDCST_PKTS];
+  pNicStats->rxMulticastPkts = pStats[EFX_MAC_RX_MULTICST_PKTS];
+  pNicStats->rxBroadcastPkts = pStats[EFX_MAC_RX_BRDCST_PKTS];
+  pNicStats->txMulticastPkts = pStats[EFX_MAC_TX_MULTICST_PKTS];
+  pNicStats->txBroadcastPkts = pStats[EFX_MAC_TX_BRDCST_PKTS];
 
-  pNicStats->collisions = pAdapter->adapterStats[EFX_MAC_TX_SGL_COL_PKTS] +
-                         pAdapter->adapterStats[EFX_MAC_TX_MULT_COL_PKTS] +
-                         pAdapter->adapterStats[EFX_MAC_TX_EX_COL_PKTS] +
-                         pAdapter->adapterStats[EFX_MAC_TX_LATE_COL_PKTS];
+  pNicStats->collisions = pStats[EFX_MAC_TX_SGL_COL_PKTS] +
+                         pStats[EFX_MAC_TX_MULT_COL_PKTS] +
+                         pStats[EFX_MAC_TX_EX_COL_PKTS] +
+                         pStats[EFX_MAC_TX_LATE_COL_PKTS];
 
-  pNicStats->rxLengthErrors = pAdapter->adapterStats[EFX_MAC_RX_JABBER_PKTS];
+  pNicStats->rxLengthErrors = pStats[EFX_MAC_RX_JABBER_PKTS];
 
-  pNicStats->rxOverflowErrors = pAdapter->adapterStats[EFX_MAC_RX_NODESC_DROP_CNT];
-  pNicStats->rxCRCErrors = pAdapter->adapterStats[EFX_MAC_RX_FCS_ERRORS];
-  pNicStats->rxFrameAlignErrors = pAdapter->adapterStats[EFX_MAC_RX_ALIGN_ERRORS];
+  pNicStats->rxOverflowErrors = pStats[EFX_MAC_RX_NODESC_DROP_CNT];
+  pNicStats->rxCRCErrors = pStats[EFX_MAC_RX_FCS_ERRORS];
+  pNicStats->rxFrameAlignErrors = pStats[EFX_MAC_RX_ALIGN_ERRORS];
 
-  pNicStats->rxFifoErrors = pAdapter->adapterStats[EFX_MAC_PM_TRUNC_BB_OVERFLOW] +
-	                    pAdapter->adapterStats[EFX_MAC_PM_DISCARD_BB_OVERFLOW] +
-	                    pAdapter->adapterStats[EFX_MAC_PM_TRUNC_VFIFO_FULL] +
-	                    pAdapter->adapterStats[EFX_MAC_PM_DISCARD_VFIFO_FULL];
+  pNicStats->rxFifoErrors = pStats[EFX_MAC_PM_TRUNC_BB_OVERFLOW] +
+	                    pStats[EFX_MAC_PM_DISCARD_BB_OVERFLOW] +
+	                    pStats[EFX_MAC_PM_TRUNC_VFIFO_FULL] +
+	                    pStats[EFX_MAC_PM_DISCARD_VFIFO_FULL];
 
-  pNicStats->rxMissErrors = pAdapter->adapterStats[EFX_MAC_RXDP_DI_DROPPED_PKTS];
+  pNicStats->rxMissErrors = pStats[EFX_MAC_RXDP_DI_DROPPED_PKTS];
 
-  status = VMK_OK;
+  snapshotTime = pAdapter->port.macStatsTime;
 
-failed_stats_update:
-  sfvmk_MutexUnlock(pAdapter->lock);
+  SFVMK_MAC_STATS_END_READ(pAdapter);
+
+  pNicStats->txDrops = sfvmk_txDropsGet(pAdapter);
+
+  sfvmk_macStatsSnapshotCheck(pAdapter, snapshotTime);
+
+  status = VMK_OK;
 
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
@@ -1042,9 +1176,12 @@ done:
 }
 
 #define SFVMK_PRIV_STATS_ENTRY_LEN  100
-#define SFVMK_PRIV_STATS_BUFFER_SZ  ((EFX_MAC_NSTATS * SFVMK_PRIV_STATS_ENTRY_LEN) + \
-                                     ((SFVMK_MAX_TXQ + SFVMK_MAX_RXQ) * \
-                                      SFVMK_PRIV_STATS_ENTRY_LEN))
+/* Each event queue takes up to three entries: counters and poll histogram */
+#define SFVMK_PRIV_STATS_BUFFER_SZ(pAdapter)                                \
+          ((EFX_MAC_NSTATS * SFVMK_PRIV_STATS_ENTRY_LEN) +                    \
+           (((pAdapter)->numTxqsAllocated + (pAdapter)->numRxqsAllocated +    \
+             ((pAdapter)->numEvqsAllocated * 3)) *                            \
+            SFVMK_PRIV_STATS_ENTRY_LEN))
 
 /*! \brief Fill the buffer with a Tx queue stats
 **         lock is already taken.
@@ -1069,6 +1206,7 @@ sfvmk_fillTxQueueStats(sfvmk_adapter_t *pAdapter,
 {
   char *pCurr;
   sfvmk_txq_t *pTxq;
+  vmk_uint64 stats[SFVMK_TXQ_MAX_STATS];
   vmk_ByteCount bytesCopied = 0;
   VMK_ReturnStatus status = VMK_FAILURE;
 
@@ -1080,15 +1218,26 @@ sfvmk_fillTxQueueStats(sfvmk_adapter_t *pAdapter,
   pTxq = pAdapter->ppTxq[qIndex];
   pCurr = pStart;
 
+  sfvmk_queueStatsSnapshot(&pTxq->statsLock, pTxq->stats, stats,
+                           SFVMK_TXQ_MAX_STATS);
+
   status = vmk_StringFormat(pCurr, maxBytes,
-                            &bytesCopied, "TxQ[%u]: %s %lu %s %lu %s %lu\n",
+                            &bytesCopied, "TxQ[%u]: %s %lu %s %lu %s %lu "
+                            "tx_ring_level_avg %lu %s %lu %s %lu\n",
                             qIndex,
                             pSfvmkTxqStatsName[SFVMK_TXQ_PKTS],
-                            pTxq->stats[SFVMK_TXQ_PKTS],
+                            stats[SFVMK_TXQ_PKTS],
                             pSfvmkTxqStatsName[SFVMK_TXQ_BYTES],
-                            pTxq->stats[SFVMK_TXQ_BYTES],
+                            stats[SFVMK_TXQ_BYTES],
                             pSfvmkTxqStatsName[SFVMK_TXQ_DISCARD],
-                            pTxq->stats[SFVMK_TXQ_DISCARD]);
+                            stats[SFVMK_TXQ_DISCARD],
+                            stats[SFVMK_TXQ_RING_TIME_US] ?
+                            stats[SFVMK_TXQ_RING_LEVEL_US] /
+                            stats[SFVMK_TXQ_RING_TIME_US] : 0,
+                            pSfvmkTxqStatsName[SFVMK_TXQ_RING_LEVEL_HWM],
+                            stats[SFVMK_TXQ_RING_LEVEL_HWM],
+                            pSfvmkTxqStatsName[SFVMK_TXQ_STOPPED_US],
+                            stats[SFVMK_TXQ_STOPPED_US]);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
                         vmk_StatusToString(status));
@@ -1126,6 +1275,7 @@ sfvmk_fillRxQueueStats(sfvmk_adapter_t *pAdapter,
 {
   char *pCurr;
   sfvmk_rxq_t *pRxq;
+  vmk_uint64 stats[SFVMK_RXQ_MAX_STATS];
   vmk_ByteCount bytesCopied = 0;
   VMK_ReturnStatus status = VMK_FAILURE;
 
@@ -1137,15 +1287,106 @@ sfvmk_fillRxQueueStats(sfvmk_adapter_t *pAdapter,
   pRxq = pAdapter->ppRxq[qIndex];
   pCurr = pStart;
 
+  sfvmk_queueStatsSnapshot(&pRxq->statsLock, pRxq->stats, stats,
+                           SFVMK_RXQ_MAX_STATS);
+
   status = vmk_StringFormat(pCurr, maxBytes,
-                            &bytesCopied, "RxQ[%u]: %s %lu %s %lu %s %lu\n",
+                            &bytesCopied, "RxQ[%u]: %s %lu %s %lu %s %lu "
+                            "rx_ring_level_avg %lu %s %lu %s %lu\n",
                             qIndex,
                             pSfvmkRxqStatsName[SFVMK_RXQ_PKTS],
-                            pRxq->stats[SFVMK_RXQ_PKTS],
+                            stats[SFVMK_RXQ_PKTS],
                             pSfvmkRxqStatsName[SFVMK_RXQ_BYTES],
-                            pRxq->stats[SFVMK_RXQ_BYTES],
+                            stats[SFVMK_RXQ_BYTES],
                             pSfvmkRxqStatsName[SFVMK_RXQ_DISCARD],
-                            pRxq->stats[SFVMK_RXQ_DISCARD]);
+                            stats[SFVMK_RXQ_DISCARD],
+                            stats[SFVMK_RXQ_RING_TIME_US] ?
+                            stats[SFVMK_RXQ_RING_LEVEL_US] /
+                            stats[SFVMK_RXQ_RING_TIME_US] : 0,
+                            pSfvmkRxqStatsName[SFVMK_RXQ_RING_LEVEL_HWM],
+                            stats[SFVMK_RXQ_RING_LEVEL_HWM],
+                            pSfvmkRxqStatsName[SFVMK_RXQ_RING_EMPTY_US],
+                            stats[SFVMK_RXQ_RING_EMPTY_US]);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
+                        vmk_StatusToString(status));
+    goto done;
+  }
+
+  if (pBytesCopied != NULL)
+   *pBytesCopied += bytesCopied;
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
+  return status;
+}
+
+/*! \brief Fill the buffer with an event queue stats
+**         lock is already taken.
+**
+** \param[in]  pAdapter      pointer to sfvmk_adapter_t
+** \param[in]  qIndex        queue Index
+** \param[in]  pStart        pointer to start position in stats buffer
+** \param[in]  maxBytes      maximum number of bytes to output
+** \param[out] pBytesCopied  pointer to number of bytes copied in stats buffer
+**
+** \return: VMK_OK [success]
+**     Below error values are returned in case of failure,
+**           VMK_LIMIT_EXCEEDED  If stats buffer overflowed
+**           VMK_BAD_PARAM       If buffer is not valid.
+**           VMK_FAILURE         Any other error
+*/
+static VMK_ReturnStatus
+sfvmk_fillEvQueueStats(sfvmk_adapter_t *pAdapter,
+                       vmk_uint16 qIndex,
+                       char *pStart, vmk_ByteCount maxBytes,
+                       vmk_ByteCount *pBytesCopied)
+{
+  sfvmk_evq_t *pEvq;
+  vmk_uint64 stats[SFVMK_EVQ_MAX_STATS];
+  vmk_ByteCount bytesCopied = 0;
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
+
+  if (pBytesCopied != NULL)
+    *pBytesCopied = 0;
+
+  pEvq = pAdapter->ppEvq[qIndex];
+  if (pEvq == NULL) {
+    status = VMK_OK;
+    goto done;
+  }
+
+  sfvmk_evqStatsSnapshot(pEvq, stats);
+
+  status = vmk_StringFormat(pStart, maxBytes, &bytesCopied,
+                            "EvQ[%u]: %s %lu %s %lu %s %lu\n"
+                            "EvQ[%u]: %s %lu %s %lu %s %lu\n"
+                            "EvQ[%u]: poll_hist %lu %lu %lu %lu %lu %lu %lu %lu\n",
+                            qIndex,
+                            pSfvmkEvqStatsName[SFVMK_EVQ_INTERRUPTS],
+                            stats[SFVMK_EVQ_INTERRUPTS],
+                            pSfvmkEvqStatsName[SFVMK_EVQ_NETPOLL_CALLS],
+                            stats[SFVMK_EVQ_NETPOLL_CALLS],
+                            pSfvmkEvqStatsName[SFVMK_EVQ_POLLS],
+                            stats[SFVMK_EVQ_POLLS],
+                            qIndex,
+                            pSfvmkEvqStatsName[SFVMK_EVQ_EMPTY_POLLS],
+                            stats[SFVMK_EVQ_EMPTY_POLLS],
+                            pSfvmkEvqStatsName[SFVMK_EVQ_BUDGET_EXHAUSTED],
+                            stats[SFVMK_EVQ_BUDGET_EXHAUSTED],
+                            pSfvmkEvqStatsName[SFVMK_EVQ_EVENTS],
+                            stats[SFVMK_EVQ_EVENTS],
+                            qIndex,
+                            stats[SFVMK_EVQ_POLL_HIST_1],
+                            stats[SFVMK_EVQ_POLL_HIST_2_3],
+                            stats[SFVMK_EVQ_POLL_HIST_4_7],
+                            stats[SFVMK_EVQ_POLL_HIST_8_15],
+                            stats[SFVMK_EVQ_POLL_HIST_16_31],
+                            stats[SFVMK_EVQ_POLL_HIST_32_63],
+                            stats[SFVMK_EVQ_POLL_HIST_64_127],
+                            stats[SFVMK_EVQ_POLL_HIST_128_PLUS]);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
                         vmk_StatusToString(status));
@@ -1168,7 +1409,7 @@ done:
                                      (*(pCummCount)) += (count); \
                                  } while(VMK_FALSE)
 
-/*! \brief Fill the buffer with per Rx/Tx queue stats
+/*! \brief Fill the buffer with per Rx/Tx/Ev queue stats
 **         lock is already taken.
 **
 ** \param[in]  pAdapter      pointer to sfvmk_adapter_t
@@ -1249,12 +1490,34 @@ sfvmk_fillQueueStats(sfvmk_adapter_t *pAdapter,
     SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
   }
 
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, "\n");
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
+                        vmk_StatusToString(status));
+    goto done;
+  }
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  bytesCopied = 0;
+
+  for (qIndex = 0; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    status = sfvmk_fillEvQueueStats(pAdapter, qIndex, pCurr,
+                                    maxBytes, &bytesCopied);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_fillEvQueueStats failed status: %s",
+                          vmk_StatusToString(status));
+      goto done;
+    }
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
 done:
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
   return status;
 }
 
-/*! \brief Fill the buffer with private stats
+/*! \brief Fill the buffer with MAC stats, assumes adapter
 **         lock is already taken.
 **
 ** \param[in]  pAdapter      pointer to sfvmk_adapter_t
@@ -1276,6 +1539,7 @@ sfvmk_fillMacStats(sfvmk_adapter_t *pAdapter,
   const char *pEntryName;
   char *pCurr;
   uint32_t id;
+  vmk_uint64 snapshotTime;
   vmk_ByteCount bytesCopied = 0;
   VMK_ReturnStatus status = VMK_FAILURE;
 
@@ -1284,12 +1548,14 @@ sfvmk_fillMacStats(sfvmk_adapter_t *pAdapter,
   if (pBytesCopied != NULL)
     *pBytesCopied = 0;
 
-  status = sfvmk_macStatsUpdate(pAdapter);
-  if (status != VMK_OK) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "Stats sync failed with error %s",
-                        vmk_StatusToString(status));
-    goto done;
-  }
+  /* Format from one consistent copy of the snapshot */
+  SFVMK_MAC_STATS_BEGIN_READ(pAdapter);
+  vmk_Memcpy(pAdapter->macStatsCopy, pAdapter->adapterStatsSnapshot,
+             sizeof(pAdapter->macStatsCopy));
+  snapshotTime = pAdapter->port.macStatsTime;
+  SFVMK_MAC_STATS_END_READ(pAdapter);
+
+  sfvmk_macStatsSnapshotCheck(pAdapter, snapshotTime);
 
   pCurr = pStart;
 
@@ -1297,7 +1563,7 @@ sfvmk_fillMacStats(sfvmk_adapter_t *pAdapter,
     pEntryName = efx_mac_stat_name(pAdapter->pNic, id);
     status = vmk_StringFormat(pCurr, maxBytes,
                               &bytesCopied, "%s: %lu\n", pEntryName,
-                              pAdapter->adapterStats[id]);
+                              pAdapter->macStatsCopy[id]);
     if (status != VMK_OK) {
       SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
                           vmk_StatusToString(status));
@@ -1342,7 +1608,7 @@ sfvmk_privStatsLengthGet(vmk_AddrCookie cookie, vmk_ByteCount *pLength)
     goto done;
   }
 
-  *pLength = SFVMK_PRIV_STATS_BUFFER_SZ;
+  *pLength = SFVMK_PRIV_STATS_BUFFER_SZ(pAdapter);
    status = VMK_OK;
 
 done:
@@ -1384,7 +1650,7 @@ sfvmk_privStatsGet(vmk_AddrCookie cookie,
   }
 
   sfvmk_MutexLock(pAdapter->lock);
-  maxBytes = SFVMK_PRIV_STATS_BUFFER_SZ;
+  maxBytes = MIN(length, SFVMK_PRIV_STATS_BUFFER_SZ(pAdapter));
   pCurr = pStatsBuf;
 
   status = vmk_StringFormat(pCurr, maxBytes,
@@ -2124,6 +2390,7 @@ void sfvmk_updateQueueStatus(sfvmk_adapter_t *pAdapter,
   vmk_UplinkSharedQueueData *queueData;
   sfvmk_txqStats_t idx = SFVMK_TXQ_QUEUE_BLOCKED;
   sfvmk_uplink_t *pUplink = &pAdapter->uplink;
+  sfvmk_txq_t *pTxq = pAdapter->ppTxq[qIndex];
   vmk_uint32 txqStartIndex;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
@@ -2157,12 +2424,19 @@ void sfvmk_updateQueueStatus(sfvmk_adapter_t *pAdapter,
       if (qState == VMK_UPLINK_QUEUE_STATE_STOPPED) {
         vmk_UplinkQueueStop(pAdapter->uplink.handle, queueData[qIndex].qid);
         idx = SFVMK_TXQ_QUEUE_BLOCKED;
+        pTxq->stopCycles = vmk_GetTimerCycles();
       }
       else {
         vmk_UplinkQueueStart(pAdapter->uplink.handle, queueData[qIndex].qid);
         idx = SFVMK_TXQ_QUEUE_UNBLOCKED;
+        if (pTxq->stopCycles != 0) {
+          sfvmk_txqStatsAdd(pTxq, SFVMK_TXQ_STOPPED_US,
+                            (vmk_GetTimerCycles() - pTxq->stopCycles) /
+                            pAdapter->timerCyclesPerUSec);
+          pTxq->stopCycles = 0;
+        }
       }
-      pAdapter->ppTxq[qIndex]->stats[idx]++;
+      sfvmk_txqStatsAdd(pTxq, idx, 1);
     }
   }
 
@@ -2502,11 +2776,16 @@ sfvmk_startIO(sfvmk_adapter_t *pAdapter)
     goto failed_tx_start;
   }
 
-  status = sfvmk_allocFilterDBHash(pAdapter);
-  if (status != VMK_OK) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_allocFilterDBHash failed status: %s",
-                        vmk_StatusToString(status));
-    goto failed_filter_db_init;
+  /* A filter DB kept over a driver reset is pushed back as it is */
+  if (pAdapter->filterDBKept) {
+    sfvmk_filterReplay(pAdapter);
+  } else {
+    status = sfvmk_allocFilterDBHash(pAdapter);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_allocFilterDBHash failed status: %s",
+                          vmk_StatusToString(status));
+      goto failed_filter_db_init;
+    }
   }
 
   if (pAdapter->isTunnelEncapSupported) {
@@ -2525,6 +2804,8 @@ sfvmk_startIO(sfvmk_adapter_t *pAdapter)
   }
 
   pAdapter->state = SFVMK_ADAPTER_STATE_STARTED;
+  sfvmk_steerRulesRestore(pAdapter);
+  sfvmk_arfsSchedule(pAdapter);
 
   /* Send startIO completion event to any world waiting for this event */
   if (pAdapter->startIO_compl_event) {
@@ -2631,7 +2912,11 @@ sfvmk_quiesceIO(sfvmk_adapter_t *pAdapter)
   pAdapter->port.linkMode = EFX_LINK_DOWN;
   sfvmk_macLinkUpdate(pAdapter);
 
-  sfvmk_freeFilterDBHash(pAdapter);
+  if (pAdapter->filterReplay)
+    sfvmk_filterDBSuspend(pAdapter);
+  else
+    sfvmk_freeFilterDBHash(pAdapter);
+  sfvmk_rssContextFreeAll(pAdapter);
 
   sfvmk_txStop(pAdapter);
 
@@ -2872,9 +3157,12 @@ sfvmk_netPollCB(vmk_AddrCookie cookie, vmk_uint32 budget)
   vmk_Bool pendCompletion = VMK_FALSE;
   sfvmk_evq_t *pEvq = (sfvmk_evq_t *)cookie.ptr;
 
-  SFVMK_DEBUG_FUNC_ENTRY(SFVMK_DEBUG_UPLINK);
+  SFVMK_DEBUG_IO_FUNC_ENTRY(SFVMK_DEBUG_UPLINK);
 
   VMK_ASSERT_NOT_NULL(pEvq);
+  vmk_VersionedAtomicBeginWrite(&pEvq->statsLock);
+  pEvq->stats[SFVMK_EVQ_NETPOLL_CALLS]++;
+  vmk_VersionedAtomicEndWrite(&pEvq->statsLock);
   pEvq->rxBudget = budget;
   pEvq->txBudget = SFVMK_NETPOLL_TX_BUDGET;
 
@@ -2884,7 +3172,7 @@ sfvmk_netPollCB(vmk_AddrCookie cookie, vmk_uint32 budget)
       pendCompletion = VMK_TRUE;
   }
 
-  SFVMK_DEBUG_FUNC_EXIT(SFVMK_DEBUG_UPLINK);
+  SFVMK_DEBUG_IO_FUNC_EXIT(SFVMK_DEBUG_UPLINK);
   return pendCompletion;
 }
 
@@ -2901,11 +3189,11 @@ sfvmk_createNetPollForRSSQs(sfvmk_adapter_t *pAdapter, vmk_ServiceAcctID service
   VMK_ASSERT_NOT_NULL(pAdapter);
 
   qStartIndex = sfvmk_getRSSQStartIndex(pAdapter);
-  qEndIndex = qStartIndex + pAdapter->numRSSQs;
+  qEndIndex = qStartIndex + sfvmk_getNumRSSHwQs(pAdapter);
 
   VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
 
-  /* Create NetQueue for RSS Queues */
+  /* Create NetQueue for RSS Queues, NetQueue RSS context queues included */
   for(qIndex = qStartIndex; qIndex < qEndIndex; qIndex++) {
     vmk_NetPollProperties pollProp;
 
@@ -2939,6 +3227,90 @@ done:
   return status;
 }
 
+/*! \brief  Create netpolls for the dedicated TX EVQs
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  serviceID  service to which work has to be charged
+**
+** \return: VMK_OK [success] error code [failure]
+*/
+static VMK_ReturnStatus
+sfvmk_createNetPollForTxEvqs(sfvmk_adapter_t *pAdapter, vmk_ServiceAcctID serviceID)
+{
+  vmk_uint32 qStartIndex;
+  vmk_uint32 qIndex;
+  VMK_ReturnStatus status = VMK_OK;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
+
+  qStartIndex = sfvmk_getTxEvqStartIndex(pAdapter);
+
+  for (qIndex = qStartIndex; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    vmk_NetPollProperties pollProp = {0};
+
+    VMK_ASSERT_NOT_NULL(pAdapter->ppEvq[qIndex]);
+
+    /* Poll properties for creating netPoll */
+    pollProp.poll = sfvmk_netPollCB;
+    pollProp.priv.ptr = pAdapter->ppEvq[qIndex];
+    pollProp.deliveryCallback = NULL;
+    pollProp.features = VMK_NETPOLL_NONE;
+
+    status = vmk_NetPollCreate(&pollProp, serviceID, vmk_ModuleCurrentID,
+                               &pAdapter->ppEvq[qIndex]->netPoll);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "vmk_NetPollCreate(%u) failed status: %s",
+                          qIndex, vmk_StatusToString(status));
+      goto failed;
+    }
+  }
+
+  goto done;
+
+failed:
+  while (qIndex > qStartIndex) {
+    qIndex--;
+    vmk_NetPollDestroy(pAdapter->ppEvq[qIndex]->netPoll);
+    pAdapter->ppEvq[qIndex]->netPoll = NULL;
+  }
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
+
+  return status;
+}
+
+/*! \brief  Destroy netpolls of the dedicated TX EVQs
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+static void
+sfvmk_destroyNetPollForTxEvqs(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint32 qIndex;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
+
+  for (qIndex = sfvmk_getTxEvqStartIndex(pAdapter);
+       qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    VMK_ASSERT_NOT_NULL(pAdapter->ppEvq[qIndex]);
+    if (pAdapter->ppEvq[qIndex]->netPoll != NULL) {
+      vmk_NetPollDestroy(pAdapter->ppEvq[qIndex]->netPoll);
+      pAdapter->ppEvq[qIndex]->netPoll = NULL;
+    }
+  }
+
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
+}
+
 void
 sfvmk_destroyNetPollForRSSQs(sfvmk_adapter_t *pAdapter)
 {
@@ -2951,7 +3323,7 @@ sfvmk_destroyNetPollForRSSQs(sfvmk_adapter_t *pAdapter)
   VMK_ASSERT_NOT_NULL(pAdapter);
 
   qStartIndex = sfvmk_getRSSQStartIndex(pAdapter);
-  qEndIndex = qStartIndex + pAdapter->numRSSQs;
+  qEndIndex = qStartIndex + sfvmk_getNumRSSHwQs(pAdapter);
 
   VMK_ASSERT_NOT_NULL(pAdapter->ppEvq);
 
@@ -3008,9 +3380,10 @@ sfvmk_createUplinkRxq(sfvmk_adapter_t *pAdapter,
     goto done;
   }
 
-  /* Check if queue is free */
+  /* Check if queue is free, the storage RXQ is never handed out */
   for (queueIndex = queueStartIndex; queueIndex <= queueEndIndex; queueIndex++)
-    if (sfvmk_isQueueFree(&pAdapter->uplink, queueIndex))
+    if (sfvmk_isQueueFree(&pAdapter->uplink, queueIndex) &&
+        !sfvmk_isStorageRxq(pAdapter, queueIndex))
       break;
 
   if (queueIndex > queueEndIndex) {
@@ -3479,6 +3852,13 @@ sfvmk_sharedQueueInfoInit(sfvmk_adapter_t *pAdapter)
     }
   }
 
+  status = sfvmk_createNetPollForTxEvqs(pAdapter, serviceID);
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_createNetPollForTxEvqs failed status: %s",
+                        vmk_StatusToString(status));
+    goto failed_create_netpoll_txevq;
+  }
+
   /* Update shared TXQData */
   status = sfvmk_txqDataInit(pAdapter);
   if (status != VMK_OK) {
@@ -3508,6 +3888,9 @@ sfvmk_sharedQueueInfoInit(sfvmk_adapter_t *pAdapter)
 failed_create_uplink_txq:
 failed_create_uplink_rxq:
 failed_txqdata_init:
+  sfvmk_destroyNetPollForTxEvqs(pAdapter);
+
+failed_create_netpoll_txevq:
   if (sfvmk_isRSSEnable(pAdapter))
     sfvmk_destroyNetPollForRSSQs(pAdapter);
 
@@ -3550,6 +3933,8 @@ sfvmk_sharedQueueInfoFini(sfvmk_adapter_t *pAdapter)
   if (sfvmk_isRSSEnable(pAdapter))
     sfvmk_destroyNetPollForRSSQs(pAdapter);
 
+  sfvmk_destroyNetPollForTxEvqs(pAdapter);
+
   if (pAdapter->uplink.queueInfo.activeQueues) {
     vmk_BitVectorFree(sfvmk_modInfo.heapID,
                       pAdapter->uplink.queueInfo.activeQueues);
@@ -3900,6 +4285,12 @@ sfvmk_quiesceUplinkRxq(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   }
 
   sfvmk_MutexLock(pAdapter->lock);
+  /* Parked filters may still steer traffic to this queue */
+  if (pAdapter->state == SFVMK_ADAPTER_STATE_STARTED) {
+    sfvmk_filterRebalanceEnd(pAdapter);
+    sfvmk_rssContextPut(pAdapter, qIndex);
+  }
+
   if ((qIndex == pAdapter->uplink.rssUplinkQueue) &&
       (pAdapter->rssInit) &&
       (pAdapter->state == SFVMK_ADAPTER_STATE_STARTED)) {
@@ -3979,9 +4370,9 @@ sfvmk_quiesceUplinkTxq(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   txqStartIndex = sfvmk_getUplinkTxqStartIndex(&pAdapter->uplink);
   pTxq = pAdapter->ppTxq[qIndex - txqStartIndex];
 
-  vmk_SpinlockLock(pTxq->lock);
+  sfvmk_txqLock(pTxq);
   sfvmk_updateQueueStatus(pAdapter, VMK_UPLINK_QUEUE_STATE_STOPPED, pTxq->index);
-  vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_txqUnlock(pTxq);
 
   status = VMK_OK;
 
@@ -4133,9 +4524,9 @@ sfvmk_startUplinkTxq(sfvmk_adapter_t *pAdapter, vmk_uint32 qIndex)
   txqStartIndex = sfvmk_getUplinkTxqStartIndex(&pAdapter->uplink);
   pTxq = pAdapter->ppTxq[qIndex - txqStartIndex];
 
-  vmk_SpinlockLock(pTxq->lock);
+  sfvmk_txqLock(pTxq);
   sfvmk_updateQueueStatus(pAdapter, VMK_UPLINK_QUEUE_STATE_STARTED, pTxq->index);
-  vmk_SpinlockUnlock(pTxq->lock);
+  sfvmk_txqUnlock(pTxq);
 
   status = VMK_OK;
 
@@ -4231,10 +4622,12 @@ sfvmk_removeQueueFilter(vmk_AddrCookie cookie,
     goto done;
   }
 
+  sfvmk_filterRebalanceOpStart(pAdapter);
+
   if (qidVal == 0) {
     SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_UPLINK, SFVMK_LOG_LEVEL_DBG,
                         "Queue ID value is 0, Ignoring filterKey:%u", filterKey);
-    goto done;
+    goto op_done;
   }
 
   pQueueInfo = &pAdapter->uplink.queueInfo;
@@ -4244,13 +4637,13 @@ sfvmk_removeQueueFilter(vmk_AddrCookie cookie,
     SFVMK_ADAPTER_ERROR(pAdapter, "qData[%u].activeFilters = %u (max %u), Ignoring",
                         qidVal, pQueueData[qidVal].activeFilters,
                         pQueueData[qidVal].maxFilters);
-    goto done;
+    goto op_done;
   }
 
   pFdbEntry = sfvmk_removeFilterRule(pAdapter, filterKey);
   if (!pFdbEntry) {
     SFVMK_ADAPTER_ERROR(pAdapter, "Filter not found for filterKey: %u", filterKey);
-    goto done;
+    goto op_done;
   }
 
   status = vmk_HashKeyDelete(pAdapter->filterDBHashTable,
@@ -4260,12 +4653,14 @@ sfvmk_removeQueueFilter(vmk_AddrCookie cookie,
     SFVMK_ADAPTER_ERROR(pAdapter, "Hash key (%u) delete failed, status: %s",
                         filterKey, vmk_StatusToString(status));
     status = VMK_FAILURE;
-    goto done;
+    goto op_done;
   }
 
   sfvmk_removeUplinkFilter(pAdapter, qidVal);
   sfvmk_freeFilterRule(pAdapter, pFdbEntry);
 
+op_done:
+  sfvmk_filterRebalanceOpDone(pAdapter);
 done:
   sfvmk_MutexUnlock(pAdapter->lock);
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
@@ -4293,12 +4688,16 @@ sfvmk_applyQueueFilter(vmk_AddrCookie cookie,
 {
   sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)cookie.ptr;
   sfvmk_filterDBEntry_t *pFdbEntry = NULL;
+  sfvmk_filterDBEntry_t *pKeptEntry;
   vmk_UplinkSharedQueueInfo *pQueueInfo;
   vmk_UplinkSharedQueueData *pQueueData;
   vmk_uint32 qidVal = vmk_UplinkQueueIDVal(qid);
   vmk_uint32 hwQid = 0;
   vmk_uint32 filterKey;
   efx_filter_flags_t hwFilterFlag = 0;
+  vmk_uint32 rssContext = EFX_RSS_CONTEXT_DEFAULT;
+  vmk_Bool netqRss = VMK_FALSE;
+  vmk_uint32 i;
 
   VMK_ReturnStatus status = VMK_OK;
 
@@ -4311,9 +4710,13 @@ sfvmk_applyQueueFilter(vmk_AddrCookie cookie,
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
 
   sfvmk_MutexLock(pAdapter->lock);
+  sfvmk_filterRebalanceOpStart(pAdapter);
 
   if (qidVal == 0) {
-    /* Do not commit filters to default queue */
+    /* Do not commit filters to default queue, a filter moved there
+     * from a NetQueue is not coming back to any queue */
+    if (pAdapter->state == SFVMK_ADAPTER_STATE_STARTED)
+      sfvmk_filterParkedDrop(pAdapter, pFilter);
     goto done;
   }
 
@@ -4322,12 +4725,6 @@ sfvmk_applyQueueFilter(vmk_AddrCookie cookie,
   pQueueInfo = &pAdapter->uplink.queueInfo;
   pQueueData = &pQueueInfo->queueData[0];
 
-  if (pQueueData[qidVal].activeFilters >= pQueueData[qidVal].maxFilters) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "Reached max filter count for QID %u\n", qidVal);
-    status = VMK_FAILURE;
-    goto done;
-  }
-
   pFdbEntry = sfvmk_allocFilterRule(pAdapter);
   if (!pFdbEntry) {
     SFVMK_ADAPTER_ERROR(pAdapter, "Memory allocation for filter entry failed");
@@ -4349,6 +4746,11 @@ sfvmk_applyQueueFilter(vmk_AddrCookie cookie,
   if (qidVal == pAdapter->uplink.rssUplinkQueue) {
     hwQid = sfvmk_getRSSQStartIndex(pAdapter);
     hwFilterFlag = EFX_FILTER_FLAG_RX_RSS;
+  } else if (sfvmk_rssContextGet(pAdapter, qidVal, &rssContext,
+                                 &hwQid) == VMK_OK) {
+    /* NetQueue spread over the HW queues of its own RSS context */
+    hwFilterFlag = EFX_FILTER_FLAG_RX_RSS;
+    netqRss = VMK_TRUE;
   } else {
     hwQid = qidVal;
   }
@@ -4362,10 +4764,45 @@ sfvmk_applyQueueFilter(vmk_AddrCookie cookie,
     goto free_filter_rule;
   }
 
+  if (netqRss) {
+    for (i = 0; i < pFdbEntry->numHwFilter; i++) {
+      status = efx_filter_spec_set_rss_context(&pFdbEntry->spec[i], rssContext);
+      if (status != VMK_OK) {
+        SFVMK_ADAPTER_ERROR(pAdapter, "efx_filter_spec_set_rss_context failed status: %s",
+                            vmk_StatusToString(status));
+        status = VMK_FAILURE;
+        goto free_filter_rule;
+      }
+    }
+
+    /* Filter DB entries are kept against the uplink queue, only the
+     * vmkernel RSS queue is known by its first RSS hardware queue */
+    pFdbEntry->qID = qidVal;
+  }
+
+  /* The vmkernel applies its filters again after a driver reset, the
+   * entry replayed for the filter is already in the DB and accounted */
+  pKeptEntry = sfvmk_filterReplayedAdopt(pAdapter, pFdbEntry);
+  if (pKeptEntry != NULL) {
+    sfvmk_freeFilterRule(pAdapter, pFdbEntry);
+    vmk_UplinkQueueMkFilterID(pFId, pKeptEntry->key);
+    *pPairHwQid = qidVal + sfvmk_getUplinkTxqStartIndex(&pAdapter->uplink);
+    status = VMK_OK;
+    goto done;
+  }
+
+  if (pQueueData[qidVal].activeFilters >= pQueueData[qidVal].maxFilters) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "Reached max filter count for QID %u\n", qidVal);
+    status = VMK_FAILURE;
+    goto free_filter_rule;
+  }
+
   status = sfvmk_insertFilterRule(pAdapter, pFdbEntry);
   if (status != VMK_OK) {
-    SFVMK_ADAPTER_ERROR(pAdapter, "Failed in Hw filter rule creation, %s\n",
-                        vmk_StatusToString(status));
+    /* Filter table exhaustion is counted in the filter stats */
+    if (status != VMK_NO_SPACE)
+      SFVMK_ADAPTER_ERROR(pAdapter, "Failed in Hw filter rule creation, %s\n",
+                          vmk_StatusToString(status));
     goto free_filter_rule;
   }
 
@@ -4385,6 +4822,7 @@ sfvmk_applyQueueFilter(vmk_AddrCookie cookie,
 free_filter_rule:
   sfvmk_freeFilterRule(pAdapter, pFdbEntry);
 done:
+  sfvmk_filterRebalanceOpDone(pAdapter);
   sfvmk_MutexUnlock(pAdapter->lock);
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
 end:
@@ -4533,6 +4971,8 @@ sfvmk_addUplinkFilter(sfvmk_adapter_t *pAdapter,
 
   pQueueData[txQueueStartIndex + qidVal].activeFeatures |= VMK_UPLINK_QUEUE_FEAT_PAIR;
   sfvmk_sharedAreaEndWrite(&pAdapter->uplink);
+
+  sfvmk_updateQueueFilterCapacity(pAdapter);
 }
 
 /*! \brief remove uplink filter
@@ -4575,6 +5015,56 @@ sfvmk_removeUplinkFilter(sfvmk_adapter_t *pAdapter,
   txQueueStartIndex = sfvmk_getUplinkTxqStartIndex(&pAdapter->uplink);
   pQueueData[txQueueStartIndex + qidVal].activeFeatures &= ~VMK_UPLINK_QUEUE_FEAT_PAIR;
   sfvmk_sharedAreaEndWrite(&pAdapter->uplink);
+
+  sfvmk_updateQueueFilterCapacity(pAdapter);
+}
+
+/*! \brief Report the uplink filters each RX queue can still take,
+**        bounded by the free HW filter slots
+**
+** \param[in]  pAdapter pointer to sfvmk_adapter_t, adapter lock held
+**
+** \return: void
+**
+*/
+void
+sfvmk_updateQueueFilterCapacity(sfvmk_adapter_t *pAdapter)
+{
+  vmk_UplinkSharedQueueInfo *pQueueInfo = &pAdapter->uplink.queueInfo;
+  vmk_UplinkSharedQueueData *pQueueData;
+  vmk_uint32 hwLimit = sfvmk_filterHwLimit(pAdapter);
+  vmk_uint32 hwPerFilter = 1;
+  vmk_uint32 freeFilters = 0;
+  vmk_uint32 queueShare;
+  vmk_uint32 queueStartIndex;
+  vmk_uint32 queueEndIndex;
+  vmk_uint32 queueIndex;
+
+  if (pQueueInfo->maxRxQueues == 0)
+    return;
+
+  /* Assume the worst case of tunnel filters when those are offloaded */
+  if (pAdapter->isTunnelEncapSupported)
+    hwPerFilter = SFMK_MAX_HWF_PER_UPF;
+
+  if (pAdapter->filterRes.hwInUse < hwLimit)
+    freeFilters = (hwLimit - pAdapter->filterRes.hwInUse) / hwPerFilter;
+
+  queueShare = SFVMK_MAX_FILTER / pQueueInfo->maxRxQueues;
+  queueStartIndex = sfvmk_getUplinkRxqStartIndex(&pAdapter->uplink);
+  queueEndIndex = queueStartIndex + sfvmk_getNumUplinkRxq(pAdapter);
+
+  sfvmk_sharedAreaBeginWrite(&pAdapter->uplink);
+  for (queueIndex = queueStartIndex; queueIndex < queueEndIndex; queueIndex++) {
+    if (sfvmk_isDefaultUplinkRxq(&pAdapter->uplink, queueIndex))
+      continue;
+
+    pQueueData = &pQueueInfo->queueData[queueIndex];
+    pQueueData->maxFilters = pQueueData->activeFilters + freeFilters;
+    if (pQueueData->maxFilters > queueShare)
+      pQueueData->maxFilters = queueShare;
+  }
+  sfvmk_sharedAreaEndWrite(&pAdapter->uplink);
 }
 
 /*! \brief Helper callback to reset NIC.
@@ -4589,6 +5079,8 @@ sfvmk_uplinkResetHelper(vmk_AddrCookie cookie)
 {
   sfvmk_adapter_t *pAdapter = (sfvmk_adapter_t *)cookie.ptr;
   VMK_ReturnStatus status;
+  vmk_uint64 resetStartTime;
+  vmk_uint64 currentTime;
   unsigned int attempt;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
@@ -4608,7 +5100,11 @@ sfvmk_uplinkResetHelper(vmk_AddrCookie cookie)
   pAdapter->evbState = SFVMK_EVB_STATE_STOPPING;
 #endif
 
+  /* Keep the filter DB to replay it once IO is started again */
+  pAdapter->resetIOStarted = VMK_FALSE;
+  pAdapter->filterReplay = VMK_TRUE;
   status = sfvmk_quiesceIO(pAdapter);
+  pAdapter->filterReplay = VMK_FALSE;
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_quiesceIO failed with error %s",
                         vmk_StatusToString(status));
@@ -4639,6 +5135,14 @@ sfvmk_uplinkResetHelper(vmk_AddrCookie cookie)
        * therefore update the new firmware version in adpater
        * shared data info */
       sfvmk_updateDrvInfo(pAdapter);
+
+      resetStartTime = vmk_AtomicRead64(&pAdapter->resetStartTime);
+      if (resetStartTime != 0) {
+        sfvmk_getTime(&currentTime);
+        pAdapter->filterStats[SFVMK_FILTER_RESET_RESTART_USEC] =
+          currentTime - resetStartTime;
+        pAdapter->resetIOStarted = VMK_TRUE;
+      }
       goto end;
     }
 
@@ -4655,6 +5159,13 @@ sfvmk_uplinkResetHelper(vmk_AddrCookie cookie)
   SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_startIO failed");
 
 end:
+  /* IO did not start again, nothing to replay the filter DB to */
+  if (pAdapter->filterDBKept)
+    sfvmk_freeFilterDBHash(pAdapter);
+
+  if (!pAdapter->resetIOStarted)
+    vmk_AtomicWrite64(&pAdapter->resetStartTime, 0);
+
   sfvmk_MutexUnlock(pAdapter->lock);
 
   SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
@@ -4672,6 +5183,7 @@ sfvmk_scheduleReset(sfvmk_adapter_t *pAdapter)
 {
   vmk_HelperRequestProps props;
   VMK_ReturnStatus status = VMK_FAILURE;
+  vmk_uint64 currentTime;
 
   SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
 
@@ -4686,6 +5198,11 @@ sfvmk_scheduleReset(sfvmk_adapter_t *pAdapter)
   props.tag = (vmk_AddrCookie)NULL;
   props.cancelFunc = NULL;
   props.worldToBill = VMK_INVALID_WORLD_ID;
+
+  /* Dark time is measured from the first of back to back reset requests */
+  sfvmk_getTime(&currentTime);
+  vmk_AtomicReadIfEqualWrite64(&pAdapter->resetStartTime, 0, currentTime);
+
   status = vmk_HelperSubmitRequest(pAdapter->helper,
                                    sfvmk_uplinkResetHelper,
                                    (vmk_AddrCookie *)pAdapter,
@@ -4694,6 +5211,7 @@ sfvmk_scheduleReset(sfvmk_adapter_t *pAdapter)
      SFVMK_ADAPTER_ERROR(pAdapter, "Failed to submit reset request to "
                          "helper world queue with error %s",
                          vmk_StatusToString(status));
+     vmk_AtomicReadIfEqualWrite64(&pAdapter->resetStartTime, currentTime, 0);
   }
 
 done:
@@ -4702,6 +5220,40 @@ done:
   return status;
 }
 
+/*! \brief Account the time traffic was down for on the first link up
+**        after a driver reset. Assumes Adapter lock is already taken.
+**
+** \param[in] pAdapter pointer to sfvmk_adapter_t
+**
+** \return: void
+**
+*/
+void
+sfvmk_resetLinkUp(sfvmk_adapter_t *pAdapter)
+{
+  vmk_uint64 resetStartTime;
+  vmk_uint64 currentTime;
+  vmk_uint64 darkTime;
+
+  if (!pAdapter->resetIOStarted)
+    return;
+
+  pAdapter->resetIOStarted = VMK_FALSE;
+  resetStartTime = vmk_AtomicReadWrite64(&pAdapter->resetStartTime, 0);
+  if (resetStartTime == 0)
+    return;
+
+  sfvmk_getTime(&currentTime);
+  darkTime = currentTime - resetStartTime;
+
+  pAdapter->filterStats[SFVMK_FILTER_RESET_DARK_USEC] = darkTime;
+  if (darkTime > pAdapter->filterStats[SFVMK_FILTER_RESET_DARK_MAX_USEC])
+    pAdapter->filterStats[SFVMK_FILTER_RESET_DARK_MAX_USEC] = darkTime;
+
+  SFVMK_ADAPTER_DEBUG(pAdapter, SFVMK_DEBUG_UPLINK, SFVMK_LOG_LEVEL_INFO,
+                      "Traffic restored %lu usec after reset", darkTime);
+}
+
 /*! \brief function to set requested intr moderation settings.
 **
 ** \param[in] pAdapter    pointer to sfvmk_adapter_t
@@ -5414,8 +5966,16 @@ sfvmk_rssStateInit(vmk_AddrCookie cookie,
 
   memcpy(pAdapter->rssHashKey, &pRssHashKey->key, pRssHashKey->keySize);
   pAdapter->rssHashKeySize = pRssHashKey->keySize;
+  pAdapter->rssIndTableSize = tableSize;
   pAdapter->rssInit = VMK_TRUE;
 
+  /* Rebaseline, counts since the last check may span a reset. The
+   * vmkernel table just programmed replaces any balanced one */
+  pAdapter->rssBalance.lastTime = 0;
+  pAdapter->rssBalance.driverTable = VMK_FALSE;
+  pAdapter->rssBalance.hostActive = VMK_FALSE;
+  sfvmk_rssBalanceSchedule(pAdapter);
+
 done:
   sfvmk_MutexUnlock(pAdapter->lock);
 
@@ -5475,6 +6035,14 @@ sfvmk_rssIndTableUpdate(vmk_AddrCookie cookie,
     goto done;
   }
 
+  /* The vmkernel table replaces any balanced one. A vmkernel updating
+   * its table balances the RSS queues itself, the balancer stands down
+   * until RSS is initialized again rather than fight it */
+  pAdapter->rssIndTableSize = tableSize;
+  pAdapter->rssBalance.driverTable = VMK_FALSE;
+  pAdapter->rssBalance.hostActive = VMK_TRUE;
+  pAdapter->rssBalance.stats[SFVMK_RSS_BALANCE_HOST_UPDATES]++;
+
 done:
   sfvmk_MutexUnlock(pAdapter->lock);
 
@@ -5684,14 +6252,21 @@ done:
   return status;
 }
 
-/*! \brief Fill the buffer with a Rx/Tx queue stats
+/* Kind of hardware queue whose stats are being dumped */
+typedef enum sfvmk_statsQueueKind_e {
+  SFVMK_STATS_QUEUE_RX = 0,
+  SFVMK_STATS_QUEUE_TX,
+  SFVMK_STATS_QUEUE_EV
+} sfvmk_statsQueueKind_t;
+
+/*! \brief Fill the buffer with a Rx/Tx/Ev queue stats
 **         lock is already taken.
 **
 ** \param[in]  pAdapter      pointer to sfvmk_adapter_t
 ** \param[in]  qIndex        queue Index
 ** \param[in]  pStart        pointer to start position in stats buffer
 ** \param[in]  maxBytes      maximum number of bytes to output
-** \param[in]  isRxQueue     VMK_TRUE if called for a rx queue
+** \param[in]  qKind         kind of queue the stats are dumped for
 ** \param[out] pBytesCopied  pointer to number of bytes copied in stats buffer
 **
 ** \return: VMK_OK [success]
@@ -5704,11 +6279,15 @@ static VMK_ReturnStatus
 sfvmk_fillAllQueueStats(sfvmk_adapter_t *pAdapter,
                         vmk_uint16 qIndex,
                         char *pStart, vmk_ByteCount maxBytes,
-                        vmk_Bool isRxQueue, vmk_ByteCount *pBytesCopied)
+                        sfvmk_statsQueueKind_t qKind,
+                        vmk_ByteCount *pBytesCopied)
 {
   char *pCurr;
+  const char *pHeader;
   char **ppStatsName = NULL;
   vmk_uint64 *pStatsVal = NULL;
+  vmk_uint64 stats[MAX(MAX(SFVMK_RXQ_MAX_STATS, SFVMK_TXQ_MAX_STATS),
+                       SFVMK_EVQ_MAX_STATS)];
   vmk_ByteCount bytesCopied = 0;
   vmk_uint32 i, statsCounts = 0;
   vmk_uint32 maxStats;
@@ -5721,19 +6300,46 @@ sfvmk_fillAllQueueStats(sfvmk_adapter_t *pAdapter,
 
   pCurr = pStart;
 
-  if (isRxQueue) {
-    pStatsVal = (vmk_uint64 *)&pAdapter->ppRxq[qIndex]->stats;
-    ppStatsName = (char **)pSfvmkRxqStatsName;
-    maxStats = SFVMK_RXQ_MAX_STATS;
-  } else {
-    pStatsVal = (vmk_uint64 *)&pAdapter->ppTxq[qIndex]->stats;
-    ppStatsName = (char **)pSfvmkTxqStatsName;
-    maxStats = SFVMK_TXQ_MAX_STATS;
+  switch (qKind) {
+    case SFVMK_STATS_QUEUE_RX:
+      sfvmk_queueStatsSnapshot(&pAdapter->ppRxq[qIndex]->statsLock,
+                               pAdapter->ppRxq[qIndex]->stats, stats,
+                               SFVMK_RXQ_MAX_STATS);
+      pStatsVal = stats;
+      ppStatsName = (char **)pSfvmkRxqStatsName;
+      maxStats = SFVMK_RXQ_MAX_STATS;
+      pHeader = "RxQ[%u]:\n";
+      break;
+
+    case SFVMK_STATS_QUEUE_TX:
+      sfvmk_queueStatsSnapshot(&pAdapter->ppTxq[qIndex]->statsLock,
+                               pAdapter->ppTxq[qIndex]->stats, stats,
+                               SFVMK_TXQ_MAX_STATS);
+      pStatsVal = stats;
+      ppStatsName = (char **)pSfvmkTxqStatsName;
+      maxStats = SFVMK_TXQ_MAX_STATS;
+      pHeader = "TxQ[%u]:\n";
+      break;
+
+    case SFVMK_STATS_QUEUE_EV:
+      if (pAdapter->ppEvq[qIndex] == NULL) {
+        status = VMK_OK;
+        goto done;
+      }
+      sfvmk_evqStatsSnapshot(pAdapter->ppEvq[qIndex], stats);
+      pStatsVal = stats;
+      ppStatsName = (char **)pSfvmkEvqStatsName;
+      maxStats = SFVMK_EVQ_MAX_STATS;
+      pHeader = "EvQ[%u]:\n";
+      break;
+
+    default:
+      SFVMK_ADAPTER_ERROR(pAdapter, "Invalid queue kind %u", qKind);
+      status = VMK_BAD_PARAM;
+      goto done;
   }
 
-  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied,
-                            isRxQueue ?  "RxQ[%u]:\n" : "TxQ[%u]:\n",
-                            qIndex);
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, pHeader, qIndex);
   if (status != VMK_OK) {
     SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
                         vmk_StatusToString(status));
@@ -5778,7 +6384,185 @@ done:
   return status;
 }
 
-/*! \brief Fill the buffer with per Rx/Tx queue stats
+/*! \brief Fill the buffer with the filter programming counters and
+**        the HW filter table usage. Adapter lock must be held.
+**
+** \param[in]  pAdapter      pointer to sfvmk_adapter_t
+** \param[in]  pStart        pointer to start position in stats buffer
+** \param[in]  maxBytes      maximum number of bytes to output
+** \param[out] pBytesCopied  pointer to number of bytes copied in stats buffer
+**
+** \return: VMK_OK [success]
+**     Below error values are returned in case of failure,
+**           VMK_LIMIT_EXCEEDED  If stats buffer overflowed
+**           VMK_FAILURE         Any other error
+*/
+static VMK_ReturnStatus
+sfvmk_fillFilterStats(sfvmk_adapter_t *pAdapter,
+                      char *pStart, vmk_ByteCount maxBytes,
+                      vmk_ByteCount *pBytesCopied)
+{
+  sfvmk_filterRes_t *pRes = &pAdapter->filterRes;
+  char *pCurr = pStart;
+  vmk_ByteCount bytesCopied = 0;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, "Filters:\n");
+  if (status != VMK_OK)
+    goto done;
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+
+  for (i = 0; i < SFVMK_FILTER_MAX_STATS; i++) {
+    bytesCopied = 0;
+    status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, " %-30s %-22lu\n",
+                              pSfvmkFilterStatsName[i],
+                              pAdapter->filterStats[i]);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+  bytesCopied = 0;
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied,
+                            " %-30s %u/%u\n", "filter_hw_in_use",
+                            pRes->hwInUse, sfvmk_filterHwLimit(pAdapter));
+  if (status != VMK_OK)
+    goto done;
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+
+  for (i = 0; i < SFVMK_FILTER_CLASS_MAX; i++) {
+    bytesCopied = 0;
+    status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied,
+                              " filter_class_%-17s %u (%u hw)\n",
+                              pSfvmkFilterClassName[i],
+                              pRes->classFilters[i], pRes->classHwFilters[i]);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+done:
+  if (status != VMK_OK)
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
+                        vmk_StatusToString(status));
+  return status;
+}
+
+/*! \brief Fill the buffer with the aRFS counters. Adapter lock must be held.
+**
+** \param[in]  pAdapter      pointer to sfvmk_adapter_t
+** \param[in]  pStart        pointer to start position in stats buffer
+** \param[in]  maxBytes      maximum number of bytes to output
+** \param[out] pBytesCopied  pointer to number of bytes copied in stats buffer
+**
+** \return: VMK_OK [success]
+**     Below error values are returned in case of failure,
+**           VMK_LIMIT_EXCEEDED  If stats buffer overflowed
+**           VMK_FAILURE         Any other error
+*/
+static VMK_ReturnStatus
+sfvmk_fillArfsStats(sfvmk_adapter_t *pAdapter,
+                    char *pStart, vmk_ByteCount maxBytes,
+                    vmk_ByteCount *pBytesCopied)
+{
+  sfvmk_arfs_t *pArfs = &pAdapter->arfs;
+  char *pCurr = pStart;
+  vmk_ByteCount bytesCopied = 0;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied,
+                            "aRFS: %u/%u flows\n",
+                            pArfs->numFlows, pArfs->maxFlows);
+  if (status != VMK_OK)
+    goto done;
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+
+  for (i = 0; i < SFVMK_ARFS_MAX_STATS; i++) {
+    bytesCopied = 0;
+    status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, " %-30s %-22lu\n",
+                              pSfvmkArfsStatsName[i], pArfs->stats[i]);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+done:
+  if (status != VMK_OK)
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
+                        vmk_StatusToString(status));
+  return status;
+}
+
+/*! \brief Fill the buffer with the RSS balancer decisions and the RSS
+**        queue rates it measured. Adapter lock must be held.
+**
+** \param[in]  pAdapter      pointer to sfvmk_adapter_t
+** \param[in]  pStart        pointer to start position in stats buffer
+** \param[in]  maxBytes      maximum number of bytes to output
+** \param[out] pBytesCopied  pointer to number of bytes copied in stats buffer
+**
+** \return: VMK_OK [success]
+**     Below error values are returned in case of failure,
+**           VMK_LIMIT_EXCEEDED  If stats buffer overflowed
+**           VMK_FAILURE         Any other error
+*/
+static VMK_ReturnStatus
+sfvmk_fillRssBalanceStats(sfvmk_adapter_t *pAdapter,
+                          char *pStart, vmk_ByteCount maxBytes,
+                          vmk_ByteCount *pBytesCopied)
+{
+  sfvmk_rssBalance_t *pBalance = &pAdapter->rssBalance;
+  char *pCurr = pStart;
+  vmk_ByteCount bytesCopied = 0;
+  vmk_uint32 i;
+  VMK_ReturnStatus status;
+
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, "RSS balance:\n");
+  if (status != VMK_OK)
+    goto done;
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+
+  for (i = 0; i < SFVMK_RSS_BALANCE_MAX_STATS; i++) {
+    bytesCopied = 0;
+    status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, " %-30s %-22lu\n",
+                              pSfvmkRssBalanceStatsName[i],
+                              pBalance->stats[i]);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+  for (i = 0; i < pAdapter->numRSSQs; i++) {
+    bytesCopied = 0;
+    status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied,
+                              " rss_q%u_pkt_rate  %-22lu\n"
+                              " rss_q%u_byte_rate %-22lu\n",
+                              i, pBalance->pktRate[i],
+                              i, pBalance->byteRate[i]);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+done:
+  if (status != VMK_OK)
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
+                        vmk_StatusToString(status));
+  return status;
+}
+
+/*! \brief Fill the buffer with per Rx/Tx/Ev queue stats
 **
 ** \param[in]  pAdapter      pointer to sfvmk_adapter_t
 ** \param[in]  pStart        pointer to start position in stats buffer
@@ -5832,8 +6616,8 @@ sfvmk_requestQueueStats(sfvmk_adapter_t *pAdapter,
   SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
 
   for (qIndex = 0; qIndex < maxRxQueues; qIndex++) {
-    status = sfvmk_fillAllQueueStats(pAdapter, qIndex, pCurr,
-                                     maxBytes, VMK_TRUE, &bytesCopied);
+    status = sfvmk_fillAllQueueStats(pAdapter, qIndex, pCurr, maxBytes,
+                                     SFVMK_STATS_QUEUE_RX, &bytesCopied);
     if (status != VMK_OK) {
       SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_fillRxQueueStats failed status: %s",
                           vmk_StatusToString(status));
@@ -5854,8 +6638,8 @@ sfvmk_requestQueueStats(sfvmk_adapter_t *pAdapter,
   SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
 
   for (qIndex = 0; qIndex < maxTxQueues; qIndex++) {
-    status = sfvmk_fillAllQueueStats(pAdapter, qIndex ,pCurr,
-                                     maxBytes, VMK_FALSE, &bytesCopied);
+    status = sfvmk_fillAllQueueStats(pAdapter, qIndex, pCurr, maxBytes,
+                                     SFVMK_STATS_QUEUE_TX, &bytesCopied);
     if (status != VMK_OK) {
       SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_fillTxQueueStats failed status: %s",
                           vmk_StatusToString(status));
@@ -5865,6 +6649,53 @@ sfvmk_requestQueueStats(sfvmk_adapter_t *pAdapter,
     SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
   }
 
+  bytesCopied = 0;
+  status = vmk_StringFormat(pCurr, maxBytes, &bytesCopied, "\n");
+  if (status != VMK_OK) {
+    SFVMK_ADAPTER_ERROR(pAdapter, "vmk_StringFormat failed status: %s",
+                        vmk_StatusToString(status));
+    goto done;
+  }
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+
+  for (qIndex = 0; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    status = sfvmk_fillAllQueueStats(pAdapter, qIndex, pCurr, maxBytes,
+                                     SFVMK_STATS_QUEUE_EV, &bytesCopied);
+    if (status != VMK_OK) {
+      SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_fillEvQueueStats failed status: %s",
+                          vmk_StatusToString(status));
+      goto done;
+    }
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+  if (sfvmk_isRSSEnable(pAdapter) && (pAdapter->rssBalance.intervalMs != 0)) {
+    bytesCopied = 0;
+    status = sfvmk_fillRssBalanceStats(pAdapter, pCurr, maxBytes, &bytesCopied);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
+  bytesCopied = 0;
+  status = sfvmk_fillFilterStats(pAdapter, pCurr, maxBytes, &bytesCopied);
+  if (status != VMK_OK)
+    goto done;
+
+  SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+
+  if (pAdapter->arfs.maxFlows != 0) {
+    bytesCopied = 0;
+    status = sfvmk_fillArfsStats(pAdapter, pCurr, maxBytes, &bytesCopied);
+    if (status != VMK_OK)
+      goto done;
+
+    SFVMK_UPDATE_STATS_INFO(pCurr, maxBytes, bytesCopied, pBytesCopied);
+  }
+
   status = VMK_OK;
 
 done:
@@ -5873,6 +6704,344 @@ done:
   return status;
 }
 
+/*! \brief Add the profile of one queue to the per stage totals
+**
+** \param[in,out] pStages  stage totals, SFVMK_MGMT_PROF_MAX_STAGES entries
+** \param[in]     pProf    queue profile, SFVMK_MGMT_PROF_MAX_STAGES entries
+**
+** \return: void
+*/
+static void
+sfvmk_dpProfileAdd(sfvmk_profStageInfo_t *pStages,
+                   const sfvmk_profStage_t *pProf)
+{
+  vmk_uint32 i;
+
+  for (i = 0; i < SFVMK_MGMT_PROF_MAX_STAGES; i++) {
+    pStages[i].cycles += pProf[i].cycles;
+    pStages[i].calls += pProf[i].calls;
+    pStages[i].pkts += pProf[i].pkts;
+  }
+}
+
+/*! \brief Sum the datapath profile of all the queues per stage
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+** \param[out] pStages   SFVMK_MGMT_PROF_MAX_STAGES stage totals
+**
+** \return: void
+*/
+void
+sfvmk_dpProfileGet(sfvmk_adapter_t *pAdapter, sfvmk_profStageInfo_t *pStages)
+{
+  sfvmk_profStage_t prof[SFVMK_MGMT_PROF_MAX_STAGES];
+  vmk_uint32 qIndex;
+  vmk_uint32 i;
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+  VMK_ASSERT_NOT_NULL(pStages);
+
+  vmk_Memset(pStages, 0, SFVMK_MGMT_PROF_MAX_STAGES * sizeof(*pStages));
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  for (qIndex = 0; (pAdapter->ppTxq != NULL) &&
+                   (qIndex < pAdapter->numTxqsAllocated); qIndex++) {
+    if (pAdapter->ppTxq[qIndex] == NULL)
+      continue;
+    sfvmk_queueStatsSnapshot(&pAdapter->ppTxq[qIndex]->statsLock,
+                             (vmk_uint64 *)pAdapter->ppTxq[qIndex]->prof,
+                             (vmk_uint64 *)prof,
+                             sizeof(prof) / sizeof(vmk_uint64));
+    sfvmk_dpProfileAdd(pStages, prof);
+  }
+
+  for (qIndex = 0; (pAdapter->ppRxq != NULL) &&
+                   (qIndex < pAdapter->numRxqsAllocated); qIndex++) {
+    if (pAdapter->ppRxq[qIndex] == NULL)
+      continue;
+    sfvmk_queueStatsSnapshot(&pAdapter->ppRxq[qIndex]->statsLock,
+                             (vmk_uint64 *)pAdapter->ppRxq[qIndex]->prof,
+                             (vmk_uint64 *)prof,
+                             sizeof(prof) / sizeof(vmk_uint64));
+    sfvmk_dpProfileAdd(pStages, prof);
+  }
+
+  /* EVQ counters are read without a lock like the EVQ stats */
+  for (qIndex = 0; (pAdapter->ppEvq != NULL) &&
+                   (qIndex < pAdapter->numEvqsAllocated); qIndex++) {
+    if (pAdapter->ppEvq[qIndex] == NULL)
+      continue;
+    sfvmk_dpProfileAdd(pStages, pAdapter->ppEvq[qIndex]->prof);
+  }
+
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  for (i = 0; i < SFVMK_MGMT_PROF_MAX_STAGES; i++) {
+    if (pStages[i].pkts != 0)
+      pStages[i].cyclesPerPkt = pStages[i].cycles / pStages[i].pkts;
+  }
+}
+
+/*! \brief Clear the datapath profile of all the queues
+**
+** \param[in]  pAdapter  pointer to sfvmk_adapter_t
+**
+** \return: void
+*/
+void
+sfvmk_dpProfileReset(sfvmk_adapter_t *pAdapter)
+{
+  sfvmk_evq_t *pEvq;
+  sfvmk_rxq_t *pRxq;
+  vmk_uint32 qIndex;
+
+  VMK_ASSERT_NOT_NULL(pAdapter);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  for (qIndex = 0; (pAdapter->ppTxq != NULL) &&
+                   (qIndex < pAdapter->numTxqsAllocated); qIndex++) {
+    if (pAdapter->ppTxq[qIndex] == NULL)
+      continue;
+    sfvmk_txqLock(pAdapter->ppTxq[qIndex]);
+    vmk_Memset(pAdapter->ppTxq[qIndex]->prof, 0,
+               sizeof(pAdapter->ppTxq[qIndex]->prof));
+    sfvmk_txqUnlock(pAdapter->ppTxq[qIndex]);
+  }
+
+  /* EVQ ownership keeps the RXQ and EVQ writers out */
+  for (qIndex = 0; (pAdapter->ppEvq != NULL) &&
+                   (qIndex < pAdapter->numEvqsAllocated); qIndex++) {
+    pEvq = pAdapter->ppEvq[qIndex];
+    if (pEvq == NULL)
+      continue;
+
+    sfvmk_evqLock(pEvq);
+    vmk_Memset(pEvq->prof, 0, sizeof(pEvq->prof));
+
+    pRxq = ((pAdapter->ppRxq != NULL) &&
+            (qIndex < pAdapter->numRxqsAllocated)) ?
+           pAdapter->ppRxq[qIndex] : NULL;
+    if (pRxq != NULL) {
+      vmk_VersionedAtomicBeginWrite(&pRxq->statsLock);
+      vmk_Memset(pRxq->prof, 0, sizeof(pRxq->prof));
+      vmk_VersionedAtomicEndWrite(&pRxq->statsLock);
+    }
+    sfvmk_evqUnlock(pEvq);
+  }
+
+  sfvmk_MutexUnlock(pAdapter->lock);
+}
+
+/*! \brief Append a section of counters to a binary stats record
+**
+** \param[in,out] ppCurr       pointer to current position in the record
+** \param[in,out] pMaxBytes    pointer to number of bytes left in the record
+** \param[in]     group        group the counters belong to
+** \param[in]     qIndex       hardware queue index, 0 for MAC stats
+** \param[in]     pValues      counter values indexed by counter ID
+** \param[in]     numCounters  number of counters
+**
+** \return: VMK_OK [success]
+**           VMK_LIMIT_EXCEEDED  If stats buffer overflowed
+*/
+static VMK_ReturnStatus
+sfvmk_fillBinStatsSection(vmk_uint8 **ppCurr, vmk_ByteCount *pMaxBytes,
+                          sfvmk_mgmtStatsGroup_t group, vmk_uint32 qIndex,
+                          const vmk_uint64 *pValues, vmk_uint32 numCounters)
+{
+  sfvmk_statsBinSection_t *pSection;
+  sfvmk_statsBinCounter_t *pCounter;
+  vmk_ByteCount len;
+  vmk_uint32 id;
+
+  len = sizeof(*pSection) + (numCounters * sizeof(*pCounter));
+  if (len > *pMaxBytes)
+    return VMK_LIMIT_EXCEEDED;
+
+  pSection = (sfvmk_statsBinSection_t *)*ppCurr;
+  pSection->group = group;
+  pSection->qIndex = qIndex;
+  pSection->numCounters = numCounters;
+
+  pCounter = (sfvmk_statsBinCounter_t *)(pSection + 1);
+  for (id = 0; id < numCounters; id++) {
+    pCounter[id].id = id;
+    pCounter[id].value = pValues[id];
+  }
+
+  *ppCurr += len;
+  *pMaxBytes -= len;
+
+  return VMK_OK;
+}
+
+/*! \brief Fill the buffer with a binary record of MAC and per Rx/Tx/Ev
+**        queue stats, laid out as described by sfvmk_statsBinHdr_t
+**
+** \param[in]  pAdapter      pointer to sfvmk_adapter_t
+** \param[in]  pStart        pointer to start position in stats buffer
+** \param[in]  maxBytes      maximum number of bytes to output
+** \param[out] pBytesCopied  pointer to number of bytes copied in stats buffer
+**
+** \return: VMK_OK [success]
+**     Below error values are returned in case of failure,
+**           VMK_LIMIT_EXCEEDED  If stats buffer overflowed
+**           VMK_BAD_PARAM       If buffer is not valid.
+*/
+VMK_ReturnStatus
+sfvmk_requestBinStats(sfvmk_adapter_t *pAdapter, vmk_uint8 *pStart,
+                      vmk_ByteCount maxBytes, vmk_ByteCount *pBytesCopied)
+{
+  sfvmk_statsBinHdr_t *pHdr;
+  vmk_uint8 *pCurr;
+  vmk_uint8 *pMacSection;
+  vmk_ByteCount macMaxBytes;
+  vmk_uint64 snapshotTime;
+  vmk_uint64 timestamp;
+  vmk_uint64 queueStats[MAX(MAX(SFVMK_RXQ_MAX_STATS, SFVMK_TXQ_MAX_STATS),
+                            MAX(SFVMK_EVQ_MAX_STATS,
+                                SFVMK_LAT_HIST_BUCKETS))];
+  vmk_uint32 numSections = 0;
+  vmk_uint16 maxRxQueues;
+  vmk_uint16 maxTxQueues;
+  vmk_uint16 qIndex;
+  VMK_ReturnStatus status = VMK_FAILURE;
+
+  SFVMK_ADAPTER_DEBUG_FUNC_ENTRY(pAdapter, SFVMK_DEBUG_UPLINK);
+
+  if ((pStart == NULL) || (maxBytes < sizeof(*pHdr))) {
+    status = VMK_BAD_PARAM;
+    SFVMK_ADAPTER_ERROR(pAdapter, "Invalid parameter: %s",
+                        vmk_StatusToString(status));
+    goto done;
+  }
+
+  if (pBytesCopied != NULL)
+    *pBytesCopied = 0;
+
+  pHdr = (sfvmk_statsBinHdr_t *)pStart;
+  pCurr = pStart + sizeof(*pHdr);
+  maxBytes -= sizeof(*pHdr);
+
+  /* MAC stats come from the lockless snapshot; the section is rewritten
+   * from scratch if the snapshot changed under us */
+  pMacSection = pCurr;
+  macMaxBytes = maxBytes;
+  SFVMK_MAC_STATS_BEGIN_READ(pAdapter);
+  pCurr = pMacSection;
+  maxBytes = macMaxBytes;
+  status = sfvmk_fillBinStatsSection(&pCurr, &maxBytes,
+                                     SFVMK_MGMT_STATS_GROUP_MAC, 0,
+                                     pAdapter->adapterStatsSnapshot,
+                                     EFX_MAC_NSTATS);
+  snapshotTime = pAdapter->port.macStatsTime;
+  SFVMK_MAC_STATS_END_READ(pAdapter);
+  if (status != VMK_OK)
+    goto failed_fill;
+
+  numSections++;
+  sfvmk_macStatsSnapshotCheck(pAdapter, snapshotTime);
+
+  sfvmk_MutexLock(pAdapter->lock);
+
+  maxRxQueues = sfvmk_getMaxRxHardwareQueues(pAdapter);
+  maxTxQueues = sfvmk_getMaxTxHardwareQueues(pAdapter);
+
+  for (qIndex = 0; qIndex < maxRxQueues; qIndex++) {
+    sfvmk_queueStatsSnapshot(&pAdapter->ppRxq[qIndex]->statsLock,
+                             pAdapter->ppRxq[qIndex]->stats, queueStats,
+                             SFVMK_RXQ_MAX_STATS);
+    status = sfvmk_fillBinStatsSection(&pCurr, &maxBytes,
+                                       SFVMK_MGMT_STATS_GROUP_RXQ, qIndex,
+                                       queueStats,
+                                       SFVMK_RXQ_MAX_STATS);
+    if (status != VMK_OK)
+      goto failed_fill_queue;
+    numSections++;
+  }
+
+  for (qIndex = 0; qIndex < maxTxQueues; qIndex++) {
+    sfvmk_queueStatsSnapshot(&pAdapter->ppTxq[qIndex]->statsLock,
+                             pAdapter->ppTxq[qIndex]->stats, queueStats,
+                             SFVMK_TXQ_MAX_STATS);
+    status = sfvmk_fillBinStatsSection(&pCurr, &maxBytes,
+                                       SFVMK_MGMT_STATS_GROUP_TXQ, qIndex,
+                                       queueStats,
+                                       SFVMK_TXQ_MAX_STATS);
+    if (status != VMK_OK)
+      goto failed_fill_queue;
+    numSections++;
+  }
+
+  for (qIndex = 0; qIndex < pAdapter->numEvqsAllocated; qIndex++) {
+    if (pAdapter->ppEvq[qIndex] == NULL)
+      continue;
+
+    sfvmk_evqStatsSnapshot(pAdapter->ppEvq[qIndex], queueStats);
+    status = sfvmk_fillBinStatsSection(&pCurr, &maxBytes,
+                                       SFVMK_MGMT_STATS_GROUP_EVQ, qIndex,
+                                       queueStats,
+                                       SFVMK_EVQ_MAX_STATS);
+    if (status != VMK_OK)
+      goto failed_fill_queue;
+    numSections++;
+  }
+
+  /* Latency histograms are only maintained while sampling is on */
+  if (pAdapter->latSampleRate != 0) {
+    for (qIndex = 0; qIndex < maxRxQueues; qIndex++) {
+      sfvmk_queueStatsSnapshot(&pAdapter->ppRxq[qIndex]->statsLock,
+                               pAdapter->ppRxq[qIndex]->latHist, queueStats,
+                               SFVMK_LAT_HIST_BUCKETS);
+      status = sfvmk_fillBinStatsSection(&pCurr, &maxBytes,
+                                         SFVMK_MGMT_STATS_GROUP_RXQ_LATENCY,
+                                         qIndex, queueStats,
+                                         SFVMK_LAT_HIST_BUCKETS);
+      if (status != VMK_OK)
+        goto failed_fill_queue;
+      numSections++;
+    }
+
+    for (qIndex = 0; qIndex < maxTxQueues; qIndex++) {
+      sfvmk_queueStatsSnapshot(&pAdapter->ppTxq[qIndex]->statsLock,
+                               pAdapter->ppTxq[qIndex]->latHist, queueStats,
+                               SFVMK_LAT_HIST_BUCKETS);
+      status = sfvmk_fillBinStatsSection(&pCurr, &maxBytes,
+                                         SFVMK_MGMT_STATS_GROUP_TXQ_LATENCY,
+                                         qIndex, queueStats,
+                                         SFVMK_LAT_HIST_BUCKETS);
+      if (status != VMK_OK)
+        goto failed_fill_queue;
+      numSections++;
+    }
+  }
+
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+  sfvmk_getTime(&timestamp);
+  pHdr->version = SFVMK_MGMT_STATS_BIN_VERSION;
+  pHdr->numSections = numSections;
+  pHdr->timestamp = timestamp;
+
+  if (pBytesCopied != NULL)
+    *pBytesCopied = pCurr - pStart;
+
+  goto done;
+
+failed_fill_queue:
+  sfvmk_MutexUnlock(pAdapter->lock);
+
+failed_fill:
+  SFVMK_ADAPTER_ERROR(pAdapter, "sfvmk_fillBinStatsSection failed status: %s",
+                      vmk_StatusToString(status));
+
+done:
+  SFVMK_ADAPTER_DEBUG_FUNC_EXIT(pAdapter, SFVMK_DEBUG_UPLINK);
+  return status;
+}
+
 /*! \brief Fill the buffer with MAC stats
 **
 ** \param[in]  pAdapter      pointer to sfvmk_adapter_t
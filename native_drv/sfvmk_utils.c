@@ -305,6 +305,42 @@ vmk_uint32 sfvmk_pow2GE(vmk_uint32 value)
   return (1ul << (order));
 }
 
+/*! \brief  Account a latency sample in a log-linear histogram
+**
+** \param[in]  pAdapter   pointer to sfvmk_adapter_t
+** \param[in]  pHist      histogram of SFVMK_LAT_HIST_BUCKETS entries
+** \param[in]  startTime  timer cycles at the start of the interval
+** \param[in]  endTime    timer cycles at the end of the interval
+**
+** \return: void
+*/
+void sfvmk_latHistRecord(sfvmk_adapter_t *pAdapter, vmk_uint64 *pHist,
+                         vmk_uint64 startTime, vmk_uint64 endTime)
+{
+  vmk_uint64 latency = 0;
+  vmk_uint32 msb = 0;
+  vmk_uint32 bucket;
+
+  /* Timer cycles of different PCPUs may be slightly skewed */
+  if (endTime > startTime)
+    latency = ((endTime - startTime) * VMK_NSEC_PER_USEC) /
+              pAdapter->timerCyclesPerUSec;
+
+  if (latency < SFVMK_LAT_HIST_SUB_BUCKETS) {
+    bucket = latency;
+  } else {
+    while ((latency >> (msb + 1)) != 0)
+      msb++;
+
+    bucket = ((msb - SFVMK_LAT_HIST_SUB_BITS + 1) * SFVMK_LAT_HIST_SUB_BUCKETS) +
+             ((latency >> (msb - SFVMK_LAT_HIST_SUB_BITS)) &
+              (SFVMK_LAT_HIST_SUB_BUCKETS - 1));
+    bucket = MIN(bucket, SFVMK_LAT_HIST_BUCKETS - 1);
+  }
+
+  pHist[bucket]++;
+}
+
 #if VMKAPI_REVISION >= VMK_REVISION_FROM_NUMBERS(2, 4, 0, 0)
 /*! \brief It creates a mutex lock with specified name.
 **